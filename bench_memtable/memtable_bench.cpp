@@ -20,7 +20,11 @@
 
 #include "db/dbformat.h"
 #include "db/memtable.h"
+#include "db/version_set.h"
 #include "ltc/storage_selector.h"
+#include "ltc/stoc_client_impl.h"
+#include "novalsm/rdma_server.h"
+#include "stoc/storage_worker.h"
 #include "memtable_worker.h"
 
 using namespace std;
@@ -33,8 +37,20 @@ DEFINE_uint32(value_size, 0, "");
 DEFINE_uint64(memtable_size_mb, 0, "");
 DEFINE_uint32(npartitions, 0, "");
 DEFINE_uint64(max_ops, 0, "");
+DEFINE_string(mode, "partition",
+              "partition/pool/pool_lockfree. pool and pool_lockfree write through DBImpl::WriteMemTablePool with npartitions memtables in the pool. pool_lockfree enables the lock-free memtable selection.");
+DEFINE_string(db_path, "/tmp/memtable_bench", "Path of the database of the pool modes.");
 
 NovaConfig *NovaConfig::config;
+std::atomic_int_fast32_t leveldb::EnvBGThread::bg_flush_memtable_thread_id_seq;
+std::atomic_int_fast32_t leveldb::EnvBGThread::bg_compaction_thread_id_seq;
+std::atomic_int_fast32_t nova::StorageWorker::storage_file_number_seq;
+std::atomic_int_fast32_t nova::RDMAServerImpl::compaction_storage_worker_seq_id_;
+std::atomic_int_fast32_t nova::RDMAServerImpl::fg_storage_worker_seq_id_;
+std::atomic_int_fast32_t nova::RDMAServerImpl::bg_storage_worker_seq_id_;
+std::atomic_int_fast32_t leveldb::StoCBlockClient::rdma_worker_seq_id_;
+std::atomic_int_fast32_t leveldb::StorageSelector::stoc_for_compaction_seq_id;
+std::unordered_map<uint64_t, leveldb::FileMetaData *> leveldb::Version::last_fnfile;
 NovaGlobalVariables NovaGlobalVariables::global;
 std::atomic<nova::Servers *> leveldb::StorageSelector::available_stoc_servers;
 
@@ -55,8 +71,33 @@ int main(int argc, char *argv[]) {
     }
 
     uint64_t memtable_size = FLAGS_memtable_size_mb * 1024 * 1024;
-    leveldb::PartitionedMemTableBench *memtable = new leveldb::PartitionedMemTableBench(
-            FLAGS_npartitions, memtable_size);
+    leveldb::MemTableBenchWrapper *memtable = nullptr;
+    if (FLAGS_mode == "pool" || FLAGS_mode == "pool_lockfree") {
+        // Full memtables are never flushed. Make sure the pool holds all
+        // writes so that writers never wait for a free memtable.
+        uint64_t max_key_size = std::to_string(FLAGS_nkeys).size();
+        uint64_t total_bytes = FLAGS_num_workers * FLAGS_max_ops *
+                               (max_key_size + FLAGS_value_size);
+        NOVA_ASSERT(total_bytes <= FLAGS_npartitions * memtable_size)
+            << fmt::format("pool of {} memtables cannot hold {} bytes",
+                           FLAGS_npartitions, total_bytes);
+        NovaConfig::config = new NovaConfig;
+        NovaConfig::config->my_server_id = 0;
+        NovaConfig::config->num_memtables = FLAGS_npartitions;
+        NovaConfig::config->log_record_mode = NovaLogRecordMode::LOG_NONE;
+        auto cfg = new Configuration;
+        cfg->fragments.push_back(new LTCFragment);
+        NovaConfig::config->cfgs.push_back(cfg);
+        leveldb::EnvBGThread::bg_flush_memtable_thread_id_seq = 0;
+        memtable = new leveldb::DBMemTablePoolBench(FLAGS_db_path,
+                                                    FLAGS_npartitions,
+                                                    memtable_size,
+                                                    FLAGS_mode ==
+                                                    "pool_lockfree");
+    } else {
+        memtable = new leveldb::PartitionedMemTableBench(FLAGS_npartitions,
+                                                         memtable_size);
+    }
 
     std::vector<std::thread> worker_threads;
     std::vector<leveldb::MemTableWorker *> workers;
@@ -80,6 +121,6 @@ int main(int argc, char *argv[]) {
         thpt += workers[i]->throughput_;
     }
 
-    NOVA_LOG(INFO) << fmt::format("throughput,{}", thpt);
+    NOVA_LOG(INFO) << fmt::format("mode,{},throughput,{}", FLAGS_mode, thpt);
     return 0;
 }
@@ -6,6 +6,10 @@
 
 #include "memtable_worker.h"
 
+#include "common/nova_config.h"
+#include "leveldb/env_bg_thread.h"
+#include "util/env_posix.h"
+
 namespace {
     class YCSBKeyComparator : public leveldb::Comparator {
     public:
@@ -36,6 +40,29 @@ namespace {
 
         void FindShortSuccessor(std::string *) const {}
     };
+
+    // Drops flush tasks. Full memtables stay in memory.
+    class NoopFlushThread : public leveldb::EnvBGThread {
+    public:
+        bool Schedule(const leveldb::EnvBGTask &task) override {
+            return true;
+        }
+
+        leveldb::StoCClient *stoc_client() override { return nullptr; }
+
+        leveldb::MemManager *mem_manager() override { return nullptr; }
+
+        uint64_t thread_id() override { return 0; }
+
+        uint32_t num_running_tasks() override { return 0; }
+
+        bool IsInitialized() override { return true; }
+
+        unsigned int *rand_seed() override { return &rand_seed_; }
+
+    private:
+        unsigned int rand_seed_ = 0;
+    };
 }
 
 namespace leveldb {
@@ -73,6 +100,60 @@ namespace leveldb {
         mutexs_[partition_id]->unlock();
     }
 
+    DBMemTablePoolBench::DBMemTablePoolBench(const std::string &db_path,
+                                             uint32_t nmemtables,
+                                             uint64_t memtable_size,
+                                             bool lockfree) {
+        total_writes_ = 0;
+        auto pool = new MemTablePool;
+        pool->num_available_memtables_ = nmemtables;
+        pool->range_cond_vars_ = new port::CondVar *[1];
+
+        EnvOptions env_option;
+        env_option.sstable_mode = NovaSSTableMode::SSTABLE_MEM;
+        PosixEnv *env = new PosixEnv;
+        env->set_env_option(env_option);
+
+        Options options;
+        options.env = env;
+        options.debug = true;
+        options.create_if_missing = true;
+        options.comparator = new YCSBKeyComparator();
+        options.memtable_type = MemTableType::kMemTablePool;
+        options.memtable_pool = pool;
+        options.num_memtables = nmemtables;
+        options.write_buffer_size = memtable_size;
+        options.enable_lockfree_memtable_selection = lockfree;
+        options.enable_lookup_index = false;
+        options.enable_subranges = false;
+        options.bg_flush_memtable_threads.push_back(new NoopFlushThread);
+
+        std::string dbname = nova::DBName(db_path, 0);
+        nova::mkdirs(dbname.c_str());
+        Logger *log = nullptr;
+        NOVA_ASSERT(env->NewLogger(dbname + "/LOG-0", &log).ok());
+        options.info_log = log;
+        Status s = DB::Open(options, dbname, &db_);
+        NOVA_ASSERT(s.ok()) << s.ToString();
+    }
+
+    void DBMemTablePoolBench::Add(leveldb::SequenceNumber seq,
+                                  leveldb::ValueType type,
+                                  const leveldb::Slice &key,
+                                  const leveldb::Slice &value) {
+        // The database assigns its own sequence number. Workers only write
+        // values.
+        thread_local unsigned int rand_seed = 0;
+        WriteOptions option;
+        option.thread_id = seq >> 32;
+        option.rand_seed = &rand_seed;
+        option.local_write = true;
+        option.total_writes =
+                total_writes_.fetch_add(1, std::memory_order_relaxed) + 1;
+        Status s = db_->Put(option, key, value);
+        NOVA_ASSERT(s.ok()) << s.ToString();
+    }
+
     MemTableWorker::MemTableWorker(uint32_t thread_id,
                                    MemTableBenchWrapper *mem_table,
                                    uint64_t max_ops, uint32_t nkeys,
@@ -9,6 +9,7 @@
 
 #include "common/nova_common.h"
 #include "db/memtable.h"
+#include "leveldb/db.h"
 
 #include <queue>
 
@@ -33,6 +34,22 @@ namespace leveldb {
         uint64_t memtable_size_;
     };
 
+    // Writes through DBImpl::WriteMemTablePool of a database that uses a
+    // pool of memtables. Full memtables are not flushed, so the pool must be
+    // large enough to hold all writes.
+    class DBMemTablePoolBench : public MemTableBenchWrapper {
+    public:
+        DBMemTablePoolBench(const std::string &db_path, uint32_t nmemtables,
+                            uint64_t memtable_size, bool lockfree);
+
+        void Add(SequenceNumber seq, ValueType type, const Slice &key,
+                 const Slice &value) override;
+
+    private:
+        DB *db_ = nullptr;
+        std::atomic_int_fast64_t total_writes_;
+    };
+
     class MemTableWorker {
     public:
         MemTableWorker(uint32_t thread_id, MemTableBenchWrapper *memtable,
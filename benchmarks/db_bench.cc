@@ -42,6 +42,9 @@
 #include <string.h>
 #include <gflags/gflags.h>
 #include "db/version_set.h"
+#include "db/dbformat.h"
+#include "ltc/db_helper.h"
+#include "table/merger.h"
 
 using namespace std;
 using namespace rdmaio;
@@ -61,7 +64,6 @@ std::atomic_int_fast32_t nova::RDMAServerImpl::compaction_storage_worker_seq_id_
 std::atomic_int_fast32_t nova::RDMAServerImpl::fg_storage_worker_seq_id_;
 std::atomic_int_fast32_t nova::RDMAServerImpl::bg_storage_worker_seq_id_;
 std::atomic_int_fast32_t leveldb::StoCBlockClient::rdma_worker_seq_id_;
-std::atomic_int_fast32_t nova::DBMigration::migration_seq_id_;
 
 DEFINE_string(db_path, "/tmp/db", "level db path");
 DEFINE_string(stoc_files_path, "/tmp/stoc", "StoC files path");
@@ -103,6 +105,8 @@ DEFINE_uint32(num_memtables, 0, "Number of memtables.");
 DEFINE_uint32(num_memtable_partitions, 0,
               "Number of memtable partitions. One active memtable per partition.");
 DEFINE_bool(enable_lookup_index, false, "Enable lookup index.");
+DEFINE_bool(enable_binary_keys, false,
+            "Encode keys as big-endian fixed-width integers instead of decimal strings.");
 DEFINE_bool(enable_range_index, false, "Enable range index.");
 
 DEFINE_uint32(l0_start_compaction_mb, 0,
@@ -180,6 +184,8 @@ DEFINE_bool(use_ordered_flush, false, "use ordered flush");
 //      seekordered   -- N ordered seeks
 //      open          -- cost of opening a DB
 //      crc32c        -- repeated crc32c of 4K of data
+//      compactmerge  -- merge N entries from --compact_merge_inputs sorted
+//                       runs and drop duplicates like a compaction
 //   Meta operations:
 //      compact     -- Compact the entire DB
 //      stats       -- Print DB stats
@@ -240,6 +246,9 @@ DEFINE_bool(histogram, false,
 // Count the number of string comparisons performed
 DEFINE_bool(comparisons, false,
             "Count the number of string comparisons performed");
+
+DEFINE_int32(compact_merge_inputs, 32,
+             "Number of sorted runs merged by the compactmerge benchmark");
 //static bool FLAGS_comparisons = false;
 
 // Number of bytes to buffer in memtable before compacting
@@ -703,9 +712,9 @@ namespace leveldb {
         leveldb::StoCBlockClient::rdma_worker_seq_id_ = 0;
         nova::StorageWorker::storage_file_number_seq = 0;
         nova::RDMAServerImpl::compaction_storage_worker_seq_id_ = 0;
-        nova::DBMigration::migration_seq_id_ = 0;
         leveldb::StorageSelector::stoc_for_compaction_seq_id = nova::NovaConfig::config->my_server_id;
         nova::NovaGlobalVariables::global.Initialize();
+        nova::NovaGlobalVariables::global.binary_keys = FLAGS_enable_binary_keys;
         auto available_stoc_servers = new Servers;
         available_stoc_servers->servers = NovaConfig::config->cfgs[0]->stoc_servers;
         for (int i = 0; i < available_stoc_servers->servers.size(); i++) {
@@ -995,6 +1004,8 @@ namespace leveldb {
                     method = &Benchmark::ReadWhileWriting;
 //                } else if (name == Slice("compact")) {
 //                    method = &Benchmark::Compact;
+                } else if (name == Slice("compactmerge")) {
+                    method = &Benchmark::CompactMerge;
                 } else if (name == Slice("crc32c")) {
                     method = &Benchmark::Crc32c;
                 } else if (name == Slice("snappycomp")) {
@@ -1197,6 +1208,127 @@ namespace leveldb {
             thread->stats.AddMessage(label);
         }
 
+        // Iterates a sorted run of internal keys.
+        class SortedRunIterator : public Iterator {
+        public:
+            explicit SortedRunIterator(
+                    const std::vector<std::pair<std::string, std::string>>* run)
+                    : run_(run), pos_(run->size()) {}
+
+            bool Valid() const override { return pos_ < run_->size(); }
+
+            void SeekToFirst() override { pos_ = 0; }
+
+            void SeekToLast() override {
+                pos_ = run_->empty() ? 0 : run_->size() - 1;
+            }
+
+            void Seek(const Slice& target) override {
+                pos_ = 0;
+                while (pos_ < run_->size() &&
+                       Slice((*run_)[pos_].first).compare(target) < 0) {
+                    pos_++;
+                }
+            }
+
+            void SkipToNextUserKey(const Slice& target) override {
+                Seek(target);
+            }
+
+            void Next() override { pos_++; }
+
+            void Prev() override {
+                pos_ = pos_ == 0 ? run_->size() : pos_ - 1;
+            }
+
+            Slice key() const override { return (*run_)[pos_].first; }
+
+            Slice value() const override { return (*run_)[pos_].second; }
+
+            Status status() const override { return Status::OK(); }
+
+        private:
+            const std::vector<std::pair<std::string, std::string>>* run_;
+            size_t pos_;
+        };
+
+        // Merges the runs and drops the older versions of each key. Returns
+        // the number of entries kept.
+        static uint64_t MergeRuns(
+                Iterator* input, const Comparator* user_comparator) {
+            uint64_t kept = 0;
+            std::string current_user_key;
+            bool has_current_user_key = false;
+            for (input->SeekToFirst(); input->Valid(); input->Next()) {
+                Slice user_key = ExtractUserKey(input->key());
+                if (has_current_user_key &&
+                    user_comparator->Compare(user_key, current_user_key) == 0) {
+                    continue;
+                }
+                current_user_key.assign(user_key.data(), user_key.size());
+                has_current_user_key = true;
+                kept++;
+            }
+            delete input;
+            return kept;
+        }
+
+        void CompactMerge(ThreadState* thread) {
+            const int ninputs = std::max(FLAGS_compact_merge_inputs, 1);
+            Comparator* user_comparator = NewUserKeyComparator();
+            InternalKeyComparator icmp(user_comparator);
+            RandomGenerator gen;
+            std::vector<std::vector<std::pair<std::string, std::string>>> runs(
+                    ninputs);
+            // Runs overlap and contain older versions of the same keys, the
+            // same as L0 SSTables.
+            for (int i = 0; i < num_; i++) {
+                uint64_t k = thread->rand.Next() % FLAGS_num;
+                std::string ikey = int_to_user_key(k);
+                PutFixed64(&ikey, (static_cast<uint64_t>(i + 1) << 8) |
+                                  kTypeValue);
+                runs[thread->rand.Next() % ninputs].emplace_back(
+                        ikey, gen.Generate(value_size_).ToString());
+            }
+            for (auto& run : runs) {
+                std::sort(run.begin(), run.end(),
+                          [&](const std::pair<std::string, std::string>& a,
+                              const std::pair<std::string, std::string>& b) {
+                              return icmp.Compare(a.first, b.first) < 0;
+                          });
+            }
+
+            std::vector<Iterator*> children(ninputs);
+            for (int i = 0; i < ninputs; i++) {
+                children[i] = new SortedRunIterator(&runs[i]);
+            }
+            uint64_t start = g_env->NowMicros();
+            uint64_t linear_kept = MergeRuns(
+                    NewMergingIterator(&icmp, &children[0], ninputs),
+                    user_comparator);
+            uint64_t linear_micros = g_env->NowMicros() - start;
+
+            for (int i = 0; i < ninputs; i++) {
+                children[i] = new SortedRunIterator(&runs[i]);
+            }
+            thread->stats.Start();
+            uint64_t kept = MergeRuns(
+                    NewCompactionMergingIterator(&icmp, &children[0], ninputs),
+                    user_comparator);
+            for (int i = 0; i < num_; i++) {
+                thread->stats.FinishedSingleOp();
+            }
+            NOVA_ASSERT(kept == linear_kept) << kept << " " << linear_kept;
+
+            char msg[100];
+            std::snprintf(msg, sizeof(msg),
+                          "(%d inputs, %llu kept, linear merge %.3f micros/op)",
+                          ninputs, (unsigned long long) kept,
+                          (double) linear_micros / std::max(num_, 1));
+            thread->stats.AddMessage(msg);
+            delete user_comparator;
+        }
+
         void SnappyCompress(ThreadState* thread) {
             RandomGenerator gen;
             Slice input = gen.Generate(Options().block_size);
@@ -1339,28 +1471,33 @@ namespace leveldb {
 //    KeyBuffer key;
 //            std::unique_ptr<const char[]> key_guard;
 //            Slice key = AllocateKey(&key_guard);
-            char* key_b = new char[10];
+            char* key_b = new char[20];
             for (int i = 0; i < num_; i += entries_per_batch_) {
                 batch.Clear();
                 for (int j = 0; j < entries_per_batch_; j++) {
                     //The key range should be adjustable.
 //        const int k = seq ? i + j : thread->rand.Uniform(FLAGS_num*FLAGS_threads);
                     const uint64_t k = seq ? i + j : (thread->rand.Next()%(key_range) + frag->range.key_start);
-                    size_t len = nova::int_to_str(key_b, k);
+                    size_t len = nova::int_to_user_key(key_b, k);
                     Slice key =  Slice(key_b, len);
 //        key.Set(k);
 //                    GenerateKeyFromInt(k, FLAGS_num, &key);
 //                    memcpy((void *) key.data(), (void*)(&k), sizeof(int));
 //                    std::cout<< key.ToString() <<std::endl;
                     write_options_.hash = k;
-//        batch.Put(key.slice(), gen.Generate(value_size_));
-                    db_->Put(write_options_, key, gen.Generate(value_size_));
+                    if (entries_per_batch_ > 1) {
+                        batch.Put(key, gen.Generate(value_size_));
+                    } else {
+                        s = db_->Put(write_options_, key, gen.Generate(value_size_));
+                    }
 
 //        bytes += value_size_ + key.slice().size();
                     bytes += value_size_ + key.size();
                     thread->stats.FinishedSingleOp();
                 }
-//                s = db_->Write(write_options_, &batch);
+                if (entries_per_batch_ > 1) {
+                    s = db_->Write(write_options_, &batch);
+                }
                 if (!s.ok()) {
                     std::fprintf(stderr, "put error: %s\n", s.ToString().c_str());
                     std::exit(1);
@@ -1418,11 +1555,11 @@ namespace leveldb {
             LTCFragment* frag = cfg->fragments[FLAGS_server_id];
             assert(FLAGS_server_id == frag->ltc_server_id);
             size_t key_range = frag->range.key_end - frag->range.key_start;
-            char* key_b = new char[10];
+            char* key_b = new char[20];
             for (int i = 0; i < reads_; i++) {
 //      const int k = thread->rand.Uniform(FLAGS_num*FLAGS_threads);// make it uniform as write.
                 const int k = thread->rand.Next()%(key_range) + frag->range.key_start;
-                size_t len = nova::int_to_str(key_b, k);
+                size_t len = nova::int_to_user_key(key_b, k);
                 Slice key =  Slice(key_b, len);
 //            key.Set(k);
 //                GenerateKeyFromInt(k, FLAGS_num, &key);
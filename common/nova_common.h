@@ -36,6 +36,7 @@ namespace nova {
 #define RDMA_POLL_MAX_TIMEOUT_US 10
 #define LEVELDB_TABLE_PADDING_SIZE_MB 2
 #define MAX_BLOCK_SIZE 10240
+#define BINARY_KEY_SIZE 8
     using namespace std;
     using namespace rdmaio;
 
@@ -52,6 +53,10 @@ namespace nova {
             is_ready_to_process_requests = false;
         }
 
+        // User keys are big-endian fixed-width integers instead of decimal
+        // strings. It is set once before any database is opened.
+        bool binary_keys = false;
+
         // DC stats
         std::atomic_int_fast64_t stoc_pending_disk_writes;
         std::atomic_int_fast64_t stoc_pending_disk_reads;
@@ -152,6 +157,7 @@ namespace nova {
 
     enum RequestType : char {
         GET = 'g',
+        MULTI_GET = 'M',
         PUT = 'p',
         VERIFY_LOAD = 'v',
         REQ_SCAN = 'r',
@@ -170,6 +176,8 @@ namespace nova {
         switch (c) {
             case 'g':
                 return GET;
+            case 'M':
+                return MULTI_GET;
             case 'p' :
                 return PUT;
             case 'r' :
@@ -308,6 +316,39 @@ namespace nova {
         return len + 1;
     }
 
+    // Returns the integer value of a user key. A binary key is the big-endian
+    // encoding of its integer so that its bytewise order is the integer order.
+    inline uint64_t user_key_to_int(const char *key, uint32_t nkey) {
+        uint64_t x = 0;
+        if (NovaGlobalVariables::global.binary_keys && nkey > 0) {
+            NOVA_ASSERT(nkey == BINARY_KEY_SIZE) << nkey;
+            memcpy(&x, key, BINARY_KEY_SIZE);
+            return __builtin_bswap64(x);
+        }
+        str_to_int(key, &x, nkey);
+        return x;
+    }
+
+    // Writes the user key of the integer into str and returns its size.
+    inline uint32_t int_to_user_key(char *str, uint64_t x) {
+        if (NovaGlobalVariables::global.binary_keys) {
+            x = __builtin_bswap64(x);
+            memcpy(str, &x, BINARY_KEY_SIZE);
+            return BINARY_KEY_SIZE;
+        }
+        // Exclude the terminator written by int_to_str.
+        return int_to_str(str, x) - 1;
+    }
+
+    inline std::string int_to_user_key(uint64_t x) {
+        if (NovaGlobalVariables::global.binary_keys) {
+            char buf[BINARY_KEY_SIZE];
+            int_to_user_key(buf, x);
+            return std::string(buf, BINARY_KEY_SIZE);
+        }
+        return std::to_string(x);
+    }
+
     inline std::string
     LogFileName(uint32_t db_id, uint32_t memtableid) {
         return fmt::format("{}-{}", db_id, memtableid);
@@ -647,6 +688,31 @@ namespace nova {
         return size;
     }
 
+    // Split the log records into consecutive groups whose total size fits
+    // into "max_size". (*group_ends)[i] is the end of group i. Returns false
+    // if a record alone does not fit.
+    inline bool
+    SplitLogRecords(const std::vector<leveldb::LevelDBLogRecord> &log_records,
+                    uint32_t max_size, std::vector<uint32_t> *group_ends) {
+        group_ends->clear();
+        uint32_t size = 0;
+        for (uint32_t i = 0; i < log_records.size(); i++) {
+            uint32_t record_size = LogRecordSize(log_records[i]);
+            if (record_size > max_size) {
+                return false;
+            }
+            if (size + record_size > max_size) {
+                group_ends->push_back(i);
+                size = 0;
+            }
+            size += record_size;
+        }
+        if (size > 0) {
+            group_ends->push_back(log_records.size());
+        }
+        return true;
+    }
+
     inline uint32_t
     EncodeLogRecord(char *buf,
                     const leveldb::LevelDBLogRecord &record) {
@@ -656,8 +722,8 @@ namespace nova {
         size += leveldb::EncodeSlice(buf + size, record.key);
         size += leveldb::EncodeSlice(buf + size, record.value);
         size += leveldb::EncodeFixed64(buf + size, record.sequence_number);
-        // The last byte is 1.
-        buf[size] = 1;
+        // The last byte is 1 for a value and 2 for a deletion.
+        buf[size] = record.type == leveldb::ValueType::kTypeDeletion ? 2 : 1;
         size++;
         return size;
     }
@@ -677,7 +743,11 @@ namespace nova {
         if (!leveldb::DecodeFixed64(buf, &log_record->sequence_number)) {
             return false;
         }
-        if ((*buf)[0] != 1) {
+        if ((*buf)[0] == 1) {
+            log_record->type = leveldb::ValueType::kTypeValue;
+        } else if ((*buf)[0] == 2) {
+            log_record->type = leveldb::ValueType::kTypeDeletion;
+        } else {
             return false;
         }
         if (record_size != LogRecordSize(*log_record)) {
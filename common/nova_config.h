@@ -31,6 +31,12 @@ namespace nova {
         LOCAL
     };
 
+    enum RDMATransport {
+        RC_TRANSPORT,
+        // Emulate RDMA with shared memory between servers on one machine.
+        SHM_TRANSPORT
+    };
+
     enum LTCMigrationPolicy {
         PROCESS_UNTIL_MIGRATION_COMPLETE,
         IMMEDIATE
@@ -180,6 +186,9 @@ namespace nova {
         int rdma_port = 0;
         int rdma_max_num_sends = 0;
         int rdma_doorbell_batch_size = 0;
+        RDMATransport rdma_transport = RDMATransport::RC_TRANSPORT;
+        std::string shm_transport_dir;
+        uint64_t shm_transport_latency_us = 0;
 
         uint64_t max_stoc_file_size = 0;
         uint64_t sstable_size = 0;
@@ -191,23 +200,30 @@ namespace nova {
         bool enable_subrange_reorg = false;
         bool enable_flush_multiple_memtables = false;
         std::string memtable_type;
+        bool enable_lockfree_memtable_selection = false;
+        bool enable_concurrent_memtable_writes = false;
         std::string major_compaction_type;
         uint32_t major_compaction_max_parallism = 0;
         uint32_t major_compaction_max_tables_in_a_set = 0;
 
         uint64_t mem_pool_size_gb = 0;
+        bool mem_numa_aware = false;
         uint32_t num_mem_partitions = 0;
         char *nova_buf = nullptr;
         uint64_t nnovabuf = 0;
 
         ScatterPolicy scatter_policy = ScatterPolicy::POWER_OF_TWO;
         NovaLogRecordMode log_record_mode = NovaLogRecordMode::LOG_NONE;
+        uint32_t log_group_commit_max_batch_size = 0;
+        uint64_t log_group_commit_max_delay_us = 0;
         bool recover_dbs = false;
         uint32_t number_of_recovery_threads = 0;
         uint32_t number_of_sstable_metadata_replicas = 0;
         uint32_t number_of_sstable_data_replicas = 0;
         uint32_t number_of_manifest_replicas = 0;
         bool use_parity_for_sstable_data_blocks = false;
+        uint32_t number_of_sstable_parity_fragments = 1;
+        double hedged_read_percentile = 0;
 
         double subrange_sampling_ratio = 0;
         std::string zipfian_dist_file_path;
@@ -222,20 +238,33 @@ namespace nova {
         int num_compaction_workers = 0;
         int num_bg_rdma_workers = 0;
         int num_storage_workers = 0;
+        // Maximum number of queued tasks of each class per storage worker.
+        // 0 means unbounded.
+        uint32_t storage_worker_queue_size = 0;
+        // Depth of the io_uring of each storage worker. 0 uses blocking
+        // disk reads and writes.
+        uint32_t stoc_io_uring_depth = 0;
         int level = 0;
 
         int block_cache_mb = 0;
+        std::string block_cache_policy;
         bool enable_lookup_index = false;
         bool enable_range_index = false;
+        uint32_t scan_prefetch_max_blocks = 0;
+        uint32_t metadata_partition_size = 0;
+        bool enable_blocked_bloom_filter = false;
+        std::vector<uint32_t> bloom_bits_per_key_per_level;
         //total number of memtable in one LTC
         uint32_t num_memtables = 0;
         uint32_t num_memtable_partitions = 0;
         uint64_t memtable_size_mb = 0;
         uint64_t l0_stop_write_mb = 0;
         uint64_t l0_start_compaction_mb = 0;
+        double tombstone_compaction_density = 0;
 
         int num_stocs_scatter_data_blocks = 0;
         int num_migration_threads = 0;
+        uint32_t ltc_migration_chunk_size = 1024 * 1024;
 
         LTCMigrationPolicy ltc_migration_policy = LTCMigrationPolicy::IMMEDIATE;
 
@@ -5,11 +5,83 @@
 //
 
 #include <fmt/core.h>
+#include <algorithm>
+#include <dirent.h>
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 #include "nova_mem_manager.h"
 #include "nova_common.h"
 
 namespace nova {
+    namespace {
+        const uint64_t kMagazinePointerMask = (1ull << 48) - 1;
+
+        // The thread caches of a thread. They are returned to their
+        // memory managers when the thread exits.
+        struct ThreadCaches {
+            ~ThreadCaches() {
+                for (int i = 0; i < caches.size(); i++) {
+                    if (caches[i] != nullptr) {
+                        managers[i]->ReleaseThreadCache(caches[i]);
+                    }
+                }
+            }
+
+            std::vector<NovaPartitionedMemManager::ThreadCache *> caches;
+            std::vector<NovaPartitionedMemManager *> managers;
+        };
+
+        thread_local ThreadCaches thread_caches;
+
+        uint32_t NumberOfNumaNodes() {
+            DIR *dir = opendir("/sys/devices/system/node");
+            if (dir == nullptr) {
+                return 1;
+            }
+            uint32_t nodes = 0;
+            struct dirent *entry;
+            while ((entry = readdir(dir)) != nullptr) {
+                if (strncmp(entry->d_name, "node", 4) == 0 &&
+                    isdigit(entry->d_name[4])) {
+                    nodes++;
+                }
+            }
+            closedir(dir);
+            return std::max(nodes, 1u);
+        }
+
+        uint32_t CurrentNumaNode() {
+            unsigned cpu = 0;
+            unsigned node = 0;
+            if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) {
+                return 0;
+            }
+            return node;
+        }
+
+        // Move the pages of [buf, buf + size) to "node" and allocate new
+        // pages from it.
+        void BindToNumaNode(char *buf, uint64_t size, uint32_t node) {
+            uint64_t page_size = sysconf(_SC_PAGESIZE);
+            uint64_t start = ((uint64_t) buf + page_size - 1) / page_size *
+                             page_size;
+            uint64_t end = ((uint64_t) buf + size) / page_size * page_size;
+            if (end <= start) {
+                return;
+            }
+            unsigned long nodemask = 1ul << node;
+            long ret = syscall(SYS_mbind, start, end - start, MPOL_BIND,
+                               &nodemask, sizeof(nodemask) * 8,
+                               MPOL_MF_MOVE);
+            if (ret != 0) {
+                NOVA_LOG(WARNING)
+                    << fmt::format("Failed to bind memory to NUMA node {}: {}",
+                                   node, strerror(errno));
+            }
+        }
+    }
 
     Slab::Slab(char *base, uint64_t slab_size_mb) {
         next_ = base;
@@ -47,7 +119,11 @@ namespace nova {
         }
 
         Slab *slab = slabs[slabs.size() - 1];
-        return slab->AllocItem();
+        char *ptr = slab->AllocItem();
+        if (ptr != nullptr) {
+            nslab_items++;
+        }
+        return ptr;
     }
 
     void SlabClass::FreeItem(char *buf) {
@@ -58,10 +134,63 @@ namespace nova {
         slabs.push_back(slab);
     }
 
+    void MagazineDepot::Push(Magazine *magazine) {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        uint64_t new_head;
+        do {
+            magazine->next.store(
+                    reinterpret_cast<Magazine *>(head & kMagazinePointerMask),
+                    std::memory_order_relaxed);
+            new_head = (reinterpret_cast<uint64_t>(magazine) &
+                        kMagazinePointerMask) |
+                       (((head >> 48) + 1) << 48);
+        } while (!head_.compare_exchange_weak(head, new_head,
+                                              std::memory_order_release,
+                                              std::memory_order_relaxed));
+    }
+
+    Magazine *MagazineDepot::Pop() {
+        uint64_t head = head_.load(std::memory_order_acquire);
+        Magazine *magazine;
+        uint64_t new_head;
+        do {
+            magazine = reinterpret_cast<Magazine *>(head &
+                                                    kMagazinePointerMask);
+            if (magazine == nullptr) {
+                return nullptr;
+            }
+            // Magazines are never deleted. The version detects a magazine
+            // that is popped and pushed again.
+            Magazine *next = magazine->next.load(std::memory_order_relaxed);
+            new_head = (reinterpret_cast<uint64_t>(next) &
+                        kMagazinePointerMask) |
+                       (((head >> 48) + 1) << 48);
+        } while (!head_.compare_exchange_weak(head, new_head,
+                                              std::memory_order_acquire,
+                                              std::memory_order_acquire));
+        return magazine;
+    }
+
+    struct NovaPartitionedMemManager::ThreadCache {
+        // Held by the owner thread while it uses its magazines and by
+        // threads that steal items from them.
+        std::mutex mutex;
+        Magazine *loaded[MAX_NUMBER_OF_SLAB_CLASSES] = {};
+        Magazine *previous[MAX_NUMBER_OF_SLAB_CLASSES] = {};
+    };
+
+    std::atomic_uint_fast32_t NovaPartitionedMemManager::next_id_(0);
+
     NovaPartitionedMemManager::NovaPartitionedMemManager(int pid, char *buf,
                                                          uint64_t data_size,
                                                          uint64_t slab_size_mb)
-            : slab_size_mb_(slab_size_mb) {
+            : id_(next_id_.fetch_add(1)), slab_size_mb_(slab_size_mb) {
+        for (int i = 0; i < MAX_NUMBER_OF_SLAB_CLASSES; i++) {
+            ndepot_items_[i] = 0;
+            ndepot_refills_[i] = 0;
+            ncontended_locks_[i] = 0;
+            nstolen_items_[i] = 0;
+        }
         uint64_t slab_size = slab_size_mb * 1024 * 1024;
 //        uint64_t slab_sizes[] = {8192, 1024 };
 
@@ -107,106 +236,330 @@ namespace nova {
         return res;
     }
 
-    char *NovaPartitionedMemManager::ItemAlloc(uint32_t scid) {
-        char *free_item = nullptr;
-        Slab *slab = nullptr;
+    NovaPartitionedMemManager::ThreadCache *
+    NovaPartitionedMemManager::GetThreadCache() {
+        if (thread_caches.caches.size() <= id_) {
+            thread_caches.caches.resize(id_ + 1, nullptr);
+            thread_caches.managers.resize(id_ + 1, nullptr);
+        }
+        ThreadCache *cache = thread_caches.caches[id_];
+        if (cache == nullptr) {
+            cache = new ThreadCache;
+            thread_caches.caches[id_] = cache;
+            thread_caches.managers[id_] = this;
+            thread_caches_mutex_.lock();
+            thread_caches_.push_back(cache);
+            thread_caches_mutex_.unlock();
+        }
+        return cache;
+    }
 
-        slab_class_mutex_[scid].lock();
-        free_item = slab_classes_[scid].AllocItem();
-        if (free_item != nullptr) {
-            slab_class_mutex_[scid].unlock();
-            return free_item;
+    void NovaPartitionedMemManager::LockSlabClass(uint32_t scid) {
+        if (!slab_class_mutex_[scid].try_lock()) {
+            ncontended_locks_[scid].fetch_add(1, std::memory_order_relaxed);
+            slab_class_mutex_[scid].lock();
         }
-        // Grab a slab from the free list.
-        free_slabs_mutex_.lock();
-        if (free_slab_index_ == -1) {
-            free_slabs_mutex_.unlock();
-            slab_class_mutex_[scid].unlock();
-
-            oom_lock.lock();
-            if (!print_class_oom) {
-                NOVA_LOG(INFO) << "No free slabs: Print slab class usages.";
-                print_class_oom = true;
-                for (int i = 0; i < MAX_NUMBER_OF_SLAB_CLASSES; i++) {
-                    slab_class_mutex_[scid].lock();
-                    NOVA_LOG(INFO) << fmt::format(
-                                "slab class {} size:{} nfreeitems:{} slabs:{}",
-                                i,
-                                slab_classes_[i].size,
-                                slab_classes_[i].free_list.size(),
-                                slab_classes_[i].slabs.size());
-                    slab_class_mutex_[scid].unlock();
-                }
+    }
+
+    uint32_t
+    NovaPartitionedMemManager::SlabClassAlloc(uint32_t scid, char **items,
+                                              uint32_t nitems) {
+        uint32_t n = 0;
+        LockSlabClass(scid);
+        while (n < nitems) {
+            char *free_item = slab_classes_[scid].AllocItem();
+            if (free_item != nullptr) {
+                items[n++] = free_item;
+                continue;
             }
-            oom_lock.unlock();
-            return nullptr;
+            // Grab a slab from the free list.
+            free_slabs_mutex_.lock();
+            if (free_slab_index_ == -1) {
+                free_slabs_mutex_.unlock();
+                break;
+            }
+            Slab *slab = free_slabs_[free_slab_index_];
+            free_slab_index_--;
+            free_slabs_mutex_.unlock();
+
+            slab->Init(static_cast<uint32_t>(slab_classes_[scid].size));
+            slab_classes_[scid].AddSlab(slab);
+        }
+        slab_class_mutex_[scid].unlock();
+        if (n > 0) {
+            return n;
         }
-        slab = free_slabs_[free_slab_index_];
-        free_slab_index_--;
-        free_slabs_mutex_.unlock();
 
-        slab->Init(static_cast<uint32_t>(slab_classes_[scid].size));
+        oom_lock.lock();
+        if (!print_class_oom) {
+            NOVA_LOG(INFO) << "No free slabs: Print slab class usages.";
+            print_class_oom = true;
+            for (int i = 0; i < MAX_NUMBER_OF_SLAB_CLASSES; i++) {
+                slab_class_mutex_[i].lock();
+                NOVA_LOG(INFO) << fmt::format(
+                            "slab class {} size:{} nfreeitems:{} slabs:{} depot:{}",
+                            i,
+                            slab_classes_[i].size,
+                            slab_classes_[i].free_list.size(),
+                            slab_classes_[i].slabs.size(),
+                            ndepot_items_[i].load());
+                slab_class_mutex_[i].unlock();
+            }
+        }
+        oom_lock.unlock();
+        return 0;
+    }
 
-        slab_classes_[scid].AddSlab(slab);
-        free_item = slab->AllocItem();
+    void NovaPartitionedMemManager::SlabClassFree(uint32_t scid, char **items,
+                                                  uint32_t nitems) {
+        LockSlabClass(scid);
+        for (int i = 0; i < nitems; i++) {
+            slab_classes_[scid].FreeItem(items[i]);
+        }
         slab_class_mutex_[scid].unlock();
+    }
+
+    char *NovaPartitionedMemManager::ItemAlloc(uint32_t scid) {
+        char *free_item = nullptr;
+        if (slab_classes_[scid].size > MAX_MAGAZINE_ITEM_SIZE) {
+            SlabClassAlloc(scid, &free_item, 1);
+            return free_item;
+        }
+        ThreadCache *cache = GetThreadCache();
+        cache->mutex.lock();
+        free_item = ThreadCacheAlloc(cache, scid);
+        cache->mutex.unlock();
+        if (free_item == nullptr) {
+            free_item = StealItem(cache, scid);
+        }
         return free_item;
     }
 
+    char *NovaPartitionedMemManager::ThreadCacheAlloc(ThreadCache *cache,
+                                                      uint32_t scid) {
+        Magazine *&loaded = cache->loaded[scid];
+        Magazine *&previous = cache->previous[scid];
+        if (loaded == nullptr) {
+            loaded = new Magazine;
+            previous = new Magazine;
+        }
+        if (loaded->nitems == 0 && previous->nitems > 0) {
+            std::swap(loaded, previous);
+        }
+        if (loaded->nitems == 0) {
+            // Exchange the empty magazine for a full one in the depot.
+            Magazine *full = full_magazines_[scid].Pop();
+            if (full != nullptr) {
+                ndepot_items_[scid].fetch_sub(full->nitems,
+                                              std::memory_order_relaxed);
+                ndepot_refills_[scid].fetch_add(1, std::memory_order_relaxed);
+                empty_magazines_[scid].Push(loaded);
+                loaded = full;
+            } else {
+                // Fill half of the magazine so that frees do not spill
+                // to the depot right away.
+                loaded->nitems = SlabClassAlloc(scid, loaded->items,
+                                                MAGAZINE_SIZE / 2);
+            }
+        }
+        if (loaded->nitems == 0) {
+            return nullptr;
+        }
+        loaded->nitems--;
+        return loaded->items[loaded->nitems];
+    }
+
+    char *NovaPartitionedMemManager::StealItem(ThreadCache *cache,
+                                               uint32_t scid) {
+        // A magazine may have reached the depot after the thread cache
+        // missed it.
+        Magazine *full = full_magazines_[scid].Pop();
+        if (full != nullptr) {
+            ndepot_items_[scid].fetch_sub(full->nitems,
+                                          std::memory_order_relaxed);
+            NOVA_ASSERT(full->nitems > 0);
+            full->nitems--;
+            char *item = full->items[full->nitems];
+            if (full->nitems == 0) {
+                empty_magazines_[scid].Push(full);
+            } else {
+                ndepot_items_[scid].fetch_add(full->nitems,
+                                              std::memory_order_relaxed);
+                full_magazines_[scid].Push(full);
+            }
+            return item;
+        }
+        // Take a free item cached by another thread.
+        char *item = nullptr;
+        thread_caches_mutex_.lock();
+        for (ThreadCache *other : thread_caches_) {
+            if (other == cache) {
+                continue;
+            }
+            other->mutex.lock();
+            for (Magazine *magazine : {other->loaded[scid],
+                                       other->previous[scid]}) {
+                if (magazine != nullptr && magazine->nitems > 0) {
+                    magazine->nitems--;
+                    item = magazine->items[magazine->nitems];
+                    break;
+                }
+            }
+            other->mutex.unlock();
+            if (item != nullptr) {
+                nstolen_items_[scid].fetch_add(1, std::memory_order_relaxed);
+                break;
+            }
+        }
+        thread_caches_mutex_.unlock();
+        return item;
+    }
+
     void NovaPartitionedMemManager::FreeItem(char *buf, uint32_t scid) {
 //        memset(buf, 0, slab_classes_[scid].size);
-        slab_class_mutex_[scid].lock();
-        slab_classes_[scid].FreeItem(buf);
-        slab_class_mutex_[scid].unlock();
+        if (slab_classes_[scid].size > MAX_MAGAZINE_ITEM_SIZE) {
+            SlabClassFree(scid, &buf, 1);
+            return;
+        }
+        ThreadCache *cache = GetThreadCache();
+        std::lock_guard<std::mutex> lock(cache->mutex);
+        Magazine *&loaded = cache->loaded[scid];
+        Magazine *&previous = cache->previous[scid];
+        if (loaded == nullptr) {
+            loaded = new Magazine;
+            previous = new Magazine;
+        }
+        if (loaded->nitems == MAGAZINE_SIZE && previous->nitems == 0) {
+            std::swap(loaded, previous);
+        }
+        if (loaded->nitems == MAGAZINE_SIZE) {
+            // Exchange the full magazine for an empty one in the depot.
+            ndepot_items_[scid].fetch_add(loaded->nitems,
+                                          std::memory_order_relaxed);
+            full_magazines_[scid].Push(loaded);
+            loaded = empty_magazines_[scid].Pop();
+            if (loaded == nullptr) {
+                loaded = new Magazine;
+            }
+        }
+        loaded->items[loaded->nitems] = buf;
+        loaded->nitems++;
     }
 
     void NovaPartitionedMemManager::FreeItems(const std::vector<char *> &items,
                                               uint32_t scid) {
-        slab_class_mutex_[scid].lock();
         for (auto buf : items) {
-            slab_classes_[scid].FreeItem(buf);
+            FreeItem(buf, scid);
+        }
+    }
+
+    void NovaPartitionedMemManager::ReleaseThreadCache(ThreadCache *cache) {
+        // No other thread steals from the cache once it is removed.
+        thread_caches_mutex_.lock();
+        thread_caches_.erase(std::find(thread_caches_.begin(),
+                                       thread_caches_.end(), cache));
+        thread_caches_mutex_.unlock();
+        for (int scid = 0; scid < MAX_NUMBER_OF_SLAB_CLASSES; scid++) {
+            for (Magazine *magazine : {cache->loaded[scid],
+                                       cache->previous[scid]}) {
+                if (magazine == nullptr) {
+                    continue;
+                }
+                if (magazine->nitems == 0) {
+                    empty_magazines_[scid].Push(magazine);
+                } else {
+                    ndepot_items_[scid].fetch_add(magazine->nitems,
+                                                  std::memory_order_relaxed);
+                    full_magazines_[scid].Push(magazine);
+                }
+            }
+        }
+        delete cache;
+    }
+
+    void NovaPartitionedMemManager::GetSlabClassStats(
+            std::vector<SlabClassStats> *stats) {
+        stats->resize(MAX_NUMBER_OF_SLAB_CLASSES);
+        for (int i = 0; i < MAX_NUMBER_OF_SLAB_CLASSES; i++) {
+            SlabClassStats &s = (*stats)[i];
+            s.scid = i;
+            s.size = slab_classes_[i].size;
+            slab_class_mutex_[i].lock();
+            s.nslabs += slab_classes_[i].slabs.size();
+            s.nslab_items += slab_classes_[i].nslab_items;
+            s.nfree_items += slab_classes_[i].free_list.size();
+            slab_class_mutex_[i].unlock();
+            s.nfree_items += ndepot_items_[i].load(std::memory_order_relaxed);
+            s.ncontended_locks += ncontended_locks_[i].load(
+                    std::memory_order_relaxed);
+            s.ndepot_refills += ndepot_refills_[i].load(
+                    std::memory_order_relaxed);
+            s.nstolen_items += nstolen_items_[i].load(
+                    std::memory_order_relaxed);
         }
-        slab_class_mutex_[scid].unlock();
     }
 
     NovaMemManager::NovaMemManager(char *buf, uint32_t num_mem_partitions,
                                    uint64_t mem_pool_size_gb,
-                                   uint64_t slab_size_mb) {
-        uint64_t partition_size = mem_pool_size_gb * 1024 * 1024 * 1024 /
-                                  num_mem_partitions;
+                                   uint64_t slab_size_mb, bool numa_aware)
+            : base_(buf), numa_aware_(numa_aware) {
+        if (numa_aware_) {
+            num_mem_partitions = NumberOfNumaNodes();
+        }
+        partition_size_ = mem_pool_size_gb * 1024 * 1024 * 1024 /
+                          num_mem_partitions;
         char *base = buf;
         for (int i = 0; i < num_mem_partitions; i++) {
+            if (numa_aware_ && num_mem_partitions > 1) {
+                BindToNumaNode(base, partition_size_, i);
+            }
             partitioned_mem_managers_.push_back(
-                    new NovaPartitionedMemManager(i, base, partition_size,
+                    new NovaPartitionedMemManager(i, base, partition_size_,
                                                   slab_size_mb));
-            base += partition_size;
+            base += partition_size_;
         }
     }
 
-    char *NovaMemManager::ItemAlloc(uint64_t key, uint32_t scid) {
+    NovaPartitionedMemManager *NovaMemManager::AllocPartition(uint64_t key) {
+        if (numa_aware_) {
+            key = CurrentNumaNode();
+        }
         return partitioned_mem_managers_[key %
-                                         partitioned_mem_managers_.size()]->ItemAlloc(
-                scid);
+                                         partitioned_mem_managers_.size()];
+    }
+
+    NovaPartitionedMemManager *NovaMemManager::FreePartition(char *buf) {
+        NOVA_ASSERT(buf >= base_);
+        uint64_t pid = (buf - base_) / partition_size_;
+        NOVA_ASSERT(pid < partitioned_mem_managers_.size());
+        return partitioned_mem_managers_[pid];
+    }
+
+    char *NovaMemManager::ItemAlloc(uint64_t key, uint32_t scid) {
+        return AllocPartition(key)->ItemAlloc(scid);
     }
 
     uint32_t NovaMemManager::slabclassid(uint64_t key, uint64_t size) {
-        return partitioned_mem_managers_[key %
-                                         partitioned_mem_managers_.size()]->slabclassid(
-                size);
+        return AllocPartition(key)->slabclassid(size);
     }
 
     void NovaMemManager::FreeItem(uint64_t key, char *buf, uint32_t scid) {
-        partitioned_mem_managers_[key %
-                                  partitioned_mem_managers_.size()]->FreeItem(
-                buf, scid);
+        FreePartition(buf)->FreeItem(buf, scid);
     }
 
     void NovaMemManager::FreeItems(uint64_t key,
                                    const std::vector<char *> &items,
                                    uint32_t scid) {
-        partitioned_mem_managers_[key %
-                                  partitioned_mem_managers_.size()]->FreeItems(
-                items, scid);
+        for (auto buf : items) {
+            FreePartition(buf)->FreeItem(buf, scid);
+        }
+    }
+
+    void NovaMemManager::GetSlabClassStats(std::vector<SlabClassStats> *stats) {
+        stats->clear();
+        for (auto manager : partitioned_mem_managers_) {
+            manager->GetSlabClassStats(stats);
+        }
     }
 
 }
\ No newline at end of file
@@ -8,6 +8,7 @@
 #define NOVA_MEM_MANAGER_H
 
 #include <stdint.h>
+#include <atomic>
 #include <cstring>
 #include <vector>
 #include <queue>
@@ -18,6 +19,10 @@ namespace nova {
 
 #define MAX_NUMBER_OF_SLAB_CLASSES 64
 #define SLAB_SIZE_FACTOR 2
+// Number of items in a magazine.
+#define MAGAZINE_SIZE 32
+// Items larger than this bypass the thread caches.
+#define MAX_MAGAZINE_ITEM_SIZE 128 * 1024
 
     class Slab {
     public:
@@ -45,6 +50,8 @@ namespace nova {
 
         uint64_t nitems_per_slab;
         uint64_t size;
+        // Number of items allocated from slabs.
+        uint64_t nslab_items = 0;
         std::vector<Slab *> slabs;
         std::queue<char *> free_list;
 
@@ -57,6 +64,48 @@ namespace nova {
         }
     };
 
+    // A magazine caches free items of a slab class.
+    struct Magazine {
+        uint32_t nitems = 0;
+        char *items[MAGAZINE_SIZE];
+        std::atomic<Magazine *> next;
+    };
+
+    // A lock-free stack of magazines.
+    class MagazineDepot {
+    public:
+        void Push(Magazine *magazine);
+
+        Magazine *Pop();
+
+    private:
+        // The top magazine in the lower 48 bits and a version in the upper
+        // 16 bits to avoid ABA.
+        std::atomic<uint64_t> head_{0};
+    };
+
+    struct SlabClassStats {
+        uint32_t scid = 0;
+        uint64_t size = 0;
+        uint64_t nslabs = 0;
+        // Number of items allocated from slabs.
+        uint64_t nslab_items = 0;
+        // Number of free items in the free list and the depot. It does not
+        // include items cached by threads.
+        uint64_t nfree_items = 0;
+        // Number of times a thread waited for the slab class lock.
+        uint64_t ncontended_locks = 0;
+        // Number of full magazines taken from the depot.
+        uint64_t ndepot_refills = 0;
+        // Number of items taken from the magazines of other threads.
+        uint64_t nstolen_items = 0;
+    };
+
+    // Each thread caches free items of a slab class in two magazines.
+    // A thread exchanges full and empty magazines with a global depot
+    // without locks. It only locks the slab class when the depot has no
+    // full magazines. When the slab class is out of memory, it steals a
+    // free item cached by another thread.
     class NovaPartitionedMemManager {
     public:
         NovaPartitionedMemManager(int pid, char *buf, uint64_t data_size,
@@ -71,7 +120,44 @@ namespace nova {
 
         uint32_t slabclassid(uint64_t  size);
 
+        void GetSlabClassStats(std::vector<SlabClassStats> *stats);
+
+        struct ThreadCache;
+
+        // Return the items cached by an exiting thread to the depots.
+        void ReleaseThreadCache(ThreadCache *cache);
+
     private:
+        ThreadCache *GetThreadCache();
+
+        // Allocate an item from the magazines of "cache" or refill them.
+        // The caller holds the lock of "cache".
+        char *ThreadCacheAlloc(ThreadCache *cache, uint32_t scid);
+
+        // Take a free item from the depot or the magazines of other
+        // threads. Returns nullptr if there is none.
+        char *StealItem(ThreadCache *cache, uint32_t scid);
+
+        // Allocate up to "nitems" items from the slab class.
+        uint32_t SlabClassAlloc(uint32_t scid, char **items, uint32_t nitems);
+
+        void SlabClassFree(uint32_t scid, char **items, uint32_t nitems);
+
+        void LockSlabClass(uint32_t scid);
+
+        static std::atomic_uint_fast32_t next_id_;
+        const uint32_t id_;
+
+        MagazineDepot full_magazines_[MAX_NUMBER_OF_SLAB_CLASSES];
+        MagazineDepot empty_magazines_[MAX_NUMBER_OF_SLAB_CLASSES];
+        std::atomic_uint_fast64_t ndepot_items_[MAX_NUMBER_OF_SLAB_CLASSES];
+        std::atomic_uint_fast64_t ndepot_refills_[MAX_NUMBER_OF_SLAB_CLASSES];
+        std::atomic_uint_fast64_t ncontended_locks_[MAX_NUMBER_OF_SLAB_CLASSES];
+        std::atomic_uint_fast64_t nstolen_items_[MAX_NUMBER_OF_SLAB_CLASSES];
+
+        std::mutex thread_caches_mutex_;
+        std::vector<ThreadCache *> thread_caches_;
+
         std::mutex slab_class_mutex_[MAX_NUMBER_OF_SLAB_CLASSES];
         SlabClass slab_classes_[MAX_NUMBER_OF_SLAB_CLASSES];
         std::mutex oom_lock;
@@ -82,10 +168,14 @@ namespace nova {
         uint64_t slab_size_mb_ = 0;
     };
 
+    // If "numa_aware" is true, it creates one partition per NUMA node and
+    // binds the memory of a partition to its node. A thread allocates from
+    // the partition of the node it runs on.
     class NovaMemManager : public leveldb::MemManager {
     public:
         NovaMemManager(char *buf, uint32_t num_mem_partitions,
-                       uint64_t mem_pool_size_gb, uint64_t slab_size_mb);
+                       uint64_t mem_pool_size_gb, uint64_t slab_size_mb,
+                       bool numa_aware = false);
 
         char *ItemAlloc(uint64_t key, uint32_t scid) override;
 
@@ -97,8 +187,19 @@ namespace nova {
 
         uint32_t slabclassid(uint64_t key, uint64_t  size) override;
 
+        // Stats of slab classes summed over all partitions.
+        void GetSlabClassStats(std::vector<SlabClassStats> *stats);
+
     private:
+        NovaPartitionedMemManager *AllocPartition(uint64_t key);
+
+        // The partition that owns "buf".
+        NovaPartitionedMemManager *FreePartition(char *buf);
+
         std::vector<NovaPartitionedMemManager *> partitioned_mem_managers_;
+        char *base_ = nullptr;
+        uint64_t partition_size_ = 0;
+        bool numa_aware_ = false;
     };
 }
 
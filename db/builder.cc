@@ -126,6 +126,10 @@ namespace leveldb {
                 if (insert) {
                     meta->largest.DecodeFrom(key);
                     builder->Add(key, iter->value());
+                    meta->num_entries++;
+                    if (ExtractValueType(key) == kTypeDeletion) {
+                        meta->num_deletions++;
+                    }
                 }
 //                total_kv_num++;
             }
@@ -163,9 +167,9 @@ namespace leveldb {
             uint32_t new_file_size = stoc_writable_file->Finalize();
 
             meta->block_replica_handles = stoc_writable_file->replicas();
-            meta->parity_block_handle = stoc_writable_file->parity_block_handle();
+            meta->parity_block_handles = stoc_writable_file->parity_block_handles();
             meta->converted_file_size = new_file_size;
-            stoc_writable_file->Validate(meta->block_replica_handles, meta->parity_block_handle);
+            stoc_writable_file->Validate(meta->block_replica_handles, meta->parity_block_handles);
 
             delete stoc_writable_file;
             stoc_writable_file = nullptr;
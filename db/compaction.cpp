@@ -104,10 +104,28 @@ namespace leveldb {
               seen_key_(false),
               overlapped_bytes_(0) {
         is_completed_ = false;
-        level_ptrs_.resize(options->level);
-        for (int i = 0; i < options->level; i++) {
-            level_ptrs_[i] = 0;
+    }
+
+    bool Compaction::IsBaseLevelForKey(const Slice &user_key) {
+        if (!drop_obsolete_deletions_) {
+            return false;
         }
+        const Comparator *user_cmp = icmp_->user_comparator();
+        while (deeper_range_index_ < deeper_ranges_.size()) {
+            const auto &range = deeper_ranges_[deeper_range_index_];
+            if (user_cmp->Compare(user_key, range.second) <= 0) {
+                // We've advanced far enough.
+                return user_cmp->Compare(user_key, range.first) < 0;
+            }
+            deeper_range_index_++;
+        }
+        return true;
+    }
+
+    bool Compaction::IsObsoleteDeletion(const Slice &user_key,
+                                        SequenceNumber sequence) {
+        return IsBaseLevelForKey(user_key) &&
+               sequence < smallest_unflushed_sequence_;
     }
 
     std::string Compaction::DebugString(const Comparator *user_comparator) {
@@ -243,7 +261,12 @@ namespace leveldb {
                 bg_thread_->rand_seed(),
                 filename);
         compact->outfile = new MemWritableFile(stoc_writable_file);
-        compact->builder = new TableBuilder(options_, compact->outfile);
+        int output_level = 0;
+        if (compact->compaction) {
+            output_level = compact->compaction->target_level();
+        }
+        compact->builder = new TableBuilder(options_, compact->outfile,
+                                            output_level);
         return Status::OK();
     }
 
@@ -296,8 +319,8 @@ namespace leveldb {
             FileMetaData *output = compact->current_output();
             output->converted_file_size = mem_file->Finalize();
             output->block_replica_handles = mem_file->replicas();
-            output->parity_block_handle = mem_file->parity_block_handle();
-            mem_file->Validate(output->block_replica_handles, output->parity_block_handle);
+            output->parity_block_handles = mem_file->parity_block_handles();
+            mem_file->Validate(output->block_replica_handles, output->parity_block_handles);
             delete mem_file;
             mem_file = nullptr;
             delete compact->outfile;
@@ -343,6 +366,10 @@ namespace leveldb {
         ParsedInternalKey ikey;
         std::string current_user_key;
         bool has_current_user_key = false;
+        // Integer of current_user_key if the comparator maps keys to
+        // integers. It avoids decoding current_user_key for every entry.
+        uint64_t current_user_key_int = 0;
+        bool current_user_key_int_valid = false;
         SequenceNumber last_sequence_for_key = kMaxSequenceNumber;
         std::vector<std::string> keys;
         uint64_t memtable_size = 0;
@@ -362,13 +389,25 @@ namespace leveldb {
 
             // Handle key/value, add to state, etc.
             bool drop = false;
-            if (!has_current_user_key ||
-                user_comparator_->Compare(ikey.user_key,
-                                          Slice(current_user_key)) !=
-                0) {
-                // First occurrence of this user key
+            uint64_t user_key_int = 0;
+            bool user_key_int_valid = user_comparator_->KeyToInt(
+                    ikey.user_key, &user_key_int);
+            bool same_user_key = false;
+            if (has_current_user_key) {
+                if (user_key_int_valid && current_user_key_int_valid) {
+                    same_user_key = user_key_int == current_user_key_int;
+                } else {
+                    same_user_key = user_comparator_->Compare(
+                            ikey.user_key, Slice(current_user_key)) == 0;
+                }
+            }
+            if (!same_user_key) {
+                // First occurrence of this user key. assign() reuses the
+                // capacity of current_user_key.
                 current_user_key.assign(ikey.user_key.data(),
                                         ikey.user_key.size());
+                current_user_key_int = user_key_int;
+                current_user_key_int_valid = user_key_int_valid;
                 has_current_user_key = true;
                 last_sequence_for_key = kMaxSequenceNumber;
             }
@@ -376,6 +415,24 @@ namespace leveldb {
             if (last_sequence_for_key <= compact->smallest_snapshot) {
                 // Hidden by an newer entry for same user key
                 drop = true;  // (A)
+            } else if (ikey.type == kTypeDeletion &&
+                       ikey.sequence <= compact->smallest_snapshot &&
+                       output_type == kCompactOutputSSTables &&
+                       compact->compaction &&
+                       compact->compaction->IsObsoleteDeletion(ikey.user_key,
+                                                               ikey.sequence)) {
+                // For this user key:
+                // (1) there is no data outside this compaction at the source
+                //     level or deeper
+                // (2) data in upper levels and unflushed memtables will have
+                //     larger sequence numbers
+                // (3) data in the inputs that have smaller sequence numbers
+                //     will be dropped in the next few iterations of this loop
+                //     (by rule (A) above).
+                // Therefore this deletion marker is obsolete and can be
+                // dropped.
+                drop = true;
+                stats->dropped_deletions += 1;
             }
             last_sequence_for_key = ikey.sequence;
 #if 0
@@ -409,7 +466,12 @@ namespace leveldb {
 //                    << fmt::format("add key-{}", ikey.FullDebugString());
 //                keys.push_back(ikey.DebugString());
                 if (output_type == kCompactOutputSSTables) {
-                    compact->current_output()->largest.DecodeFrom(key);
+                    FileMetaData *out = compact->current_output();
+                    out->largest.DecodeFrom(key);
+                    out->num_entries++;
+                    if (ikey.type == kTypeDeletion) {
+                        out->num_deletions++;
+                    }
                     if (!compact->builder->Add(key, input->value())) {
                         std::string added_keys;
                         for (auto &k : keys) {
@@ -474,13 +536,14 @@ namespace leveldb {
             const int src_level = compact->compaction->level();
             const int dest_level = compact->compaction->target_level();
             output = fmt::format(
-                    "bg[{}]: Major Compacted {}@{} + {}@{} files => {} bytes",
+                    "bg[{}]: Major Compacted {}@{} + {}@{} files => {} bytes, dropped {} deletions",
                     bg_thread_->thread_id(),
                     compact->compaction->num_input_files(0),
                     src_level,
                     compact->compaction->num_input_files(1),
                     dest_level,
-                    compact->total_bytes);
+                    compact->total_bytes,
+                    stats->dropped_deletions);
             NOVA_LOG(rdmaio::INFO) << output;
             Log(options_.info_log, "%s", output.c_str());
         }
@@ -100,8 +100,29 @@ namespace leveldb {
         // before processing "internal_key".
         bool ShouldStopBefore(const Slice &internal_key);
 
+        // Returns true if no file outside the compaction inputs at the
+        // source level or deeper may contain "user_key".
+        // REQUIRES: user keys are passed in ascending order.
+        bool IsBaseLevelForKey(const Slice &user_key);
+
+        // Returns true if a deletion of "user_key" at "sequence" shadows
+        // nothing once it is compacted: IsBaseLevelForKey holds and no
+        // unflushed memtable may contain an older entry of the key.
+        // REQUIRES: user keys are passed in ascending order.
+        bool IsObsoleteDeletion(const Slice &user_key, SequenceNumber sequence);
+
         VersionFileMap *input_version_;
 
+        // User key ranges of the files that are not inputs but may hold
+        // older entries of the compacted keys. The ranges are sorted and
+        // disjoint. Deletions are kept unless the ranges are computed.
+        bool drop_obsolete_deletions_ = false;
+        std::vector<std::pair<std::string, std::string>> deeper_ranges_;
+        // Smallest sequence number of the memtables that were not flushed
+        // when the compaction was picked. Flushes are unordered, so an
+        // older entry of a compacted key may still be in one of them.
+        SequenceNumber smallest_unflushed_sequence_ = 0;
+
         sem_t *complete_signal_ = nullptr;
         std::atomic_bool is_completed_;
 
@@ -130,11 +151,9 @@ namespace leveldb {
 
         // State for implementing IsBaseLevelForKey
 
-        // level_ptrs_ holds indices into input_version_->levels_: our state
-        // is that we are positioned at one of the file ranges for each
-        // higher level than the ones involved in this compaction (i.e. for
-        // all L >= level_ + 2).
-        std::vector<size_t> level_ptrs_;
+        // deeper_range_index_ holds an index into deeper_ranges_. All
+        // ranges before it end before the last key passed in.
+        size_t deeper_range_index_ = 0;
     };
 
     // Per level compaction stats.  stats_[level] stores the stats for
@@ -147,6 +166,8 @@ namespace leveldb {
         }
 
         uint64_t micros;
+        // Deletion markers dropped because they shadow nothing.
+        uint64_t dropped_deletions = 0;
         CompactionTableStats input_source = {};
         CompactionTableStats input_target = {};
         CompactionTableStats output = {};
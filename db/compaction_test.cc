@@ -0,0 +1,136 @@
+//
+// Copyright (c) 2020 University of Southern California. All rights reserved.
+//
+
+#include "db/compaction.h"
+#include "db/memtable.h"
+#include "db/version_set.h"
+#include "leveldb/stoc_client.h"
+#include "ltc/db_helper.h"
+#include "ltc/storage_selector.h"
+#include "util/testharness.h"
+
+namespace leveldb {
+
+    class CompactionTest {
+    public:
+        CompactionTest() : icmp_(new YCSBKeyComparator) {
+            options_.level = 2;
+            version_ = new Version(&icmp_, nullptr, &options_, 1, nullptr);
+        }
+
+        FileMetaData *CreateFileMetaData(int level, int smallest, int largest) {
+            FileMetaData *f = new FileMetaData();
+            f->number = fn_++;
+            f->smallest = InternalKey(std::to_string(smallest), seq_id_++,
+                                      ValueType::kTypeDeletion);
+            f->largest = InternalKey(std::to_string(largest), seq_id_++,
+                                     ValueType::kTypeDeletion);
+            version_->files_[level].push_back(f);
+            version_->fn_files_[f->number] = f;
+            return f;
+        }
+
+        // A compaction of "f" from L0 to L1.
+        Compaction *NewCompaction(FileMetaData *f) {
+            auto c = new Compaction(version_, &icmp_, &options_, 0, 1);
+            c->inputs_[0].push_back(f);
+            return c;
+        }
+
+        InternalKeyComparator icmp_;
+        Options options_;
+        Version *version_ = nullptr;
+        uint32_t fn_ = 0;
+        uint32_t seq_id_ = 100;
+    };
+
+    TEST(CompactionTest, MemTableSmallestSequence) {
+        MemTable *mem = new MemTable(icmp_, 1, nullptr, true);
+        mem->Ref();
+        ASSERT_EQ(kMaxSequenceNumber, mem->smallest_sequence());
+        mem->Add(7, kTypeValue, "10", "v");
+        mem->Add(5, kTypeValue, "11", "v");
+        mem->Add(9, kTypeDeletion, "12", "");
+        ASSERT_EQ(5, mem->smallest_sequence());
+        mem->Unref();
+
+        mem = new MemTable(icmp_, 2, nullptr, true);
+        mem->Ref();
+        mem->BulkAdd({{8, kTypeValue, "10", "v"}, {3, kTypeValue, "11", "v"}});
+        ASSERT_EQ(3, mem->smallest_sequence());
+        mem->Unref();
+    }
+
+    // A Delete is compacted while an older Put of the same key is still in
+    // an unflushed memtable. The Delete must survive so that the Put stays
+    // deleted once the memtable is flushed.
+    TEST(CompactionTest, KeepDeletionOfUnflushedPut) {
+        MemTable *mem = new MemTable(icmp_, 1, nullptr, true);
+        mem->Ref();
+        mem->Add(5, kTypeValue, "15", "v");
+
+        // The Delete of "15" at sequence 8 is in an L0 file.
+        Compaction *c = NewCompaction(CreateFileMetaData(0, 10, 20));
+        version_->ComputeDeeperRanges(c, mem->smallest_sequence());
+        ASSERT_TRUE(c->drop_obsolete_deletions_);
+        ASSERT_TRUE(c->deeper_ranges_.empty());
+        ASSERT_TRUE(!c->IsObsoleteDeletion("15", 8));
+        // Deletions older than every unflushed entry shadow nothing.
+        ASSERT_TRUE(c->IsObsoleteDeletion("16", 4));
+        delete c;
+
+        // The memtable is flushed.
+        c = NewCompaction(version_->files_[0][0]);
+        version_->ComputeDeeperRanges(c, kMaxSequenceNumber);
+        ASSERT_TRUE(c->IsObsoleteDeletion("15", 8));
+        delete c;
+        mem->Unref();
+    }
+
+    TEST(CompactionTest, KeepDeletionOfDeeperFiles) {
+        FileMetaData *f = CreateFileMetaData(0, 10, 20);
+        CreateFileMetaData(1, 14, 16);
+        Compaction *c = NewCompaction(f);
+        version_->ComputeDeeperRanges(c, kMaxSequenceNumber);
+        ASSERT_EQ(1, c->deeper_ranges_.size());
+        ASSERT_TRUE(c->IsObsoleteDeletion("12", 8));
+        ASSERT_TRUE(!c->IsObsoleteDeletion("15", 8));
+        ASSERT_TRUE(c->IsObsoleteDeletion("18", 8));
+        delete c;
+    }
+
+    TEST(CompactionTest, EncodeSmallestUnflushedSequence) {
+        CompactionRequest req;
+        req.dbname = "db";
+        req.smallest_snapshot = 100;
+        req.drop_obsolete_deletions = true;
+        req.deeper_ranges.emplace_back("14", "16");
+        req.smallest_unflushed_sequence = 42;
+        char buf[4096];
+        uint32_t size = req.EncodeRequest(buf);
+
+        CompactionRequest decoded;
+        decoded.DecodeRequest(buf, size);
+        ASSERT_EQ(100, decoded.smallest_snapshot);
+        ASSERT_TRUE(decoded.drop_obsolete_deletions);
+        ASSERT_EQ(1, decoded.deeper_ranges.size());
+        ASSERT_EQ(42, decoded.smallest_unflushed_sequence);
+    }
+}  // namespace leveldb
+
+using namespace nova;
+
+NovaConfig *NovaConfig::config;
+std::atomic_int_fast32_t leveldb::EnvBGThread::bg_flush_memtable_thread_id_seq;
+std::atomic_int_fast32_t nova::RDMAServerImpl::bg_storage_worker_seq_id_;
+std::atomic_int_fast32_t leveldb::StoCBlockClient::rdma_worker_seq_id_;
+std::unordered_map<uint64_t, leveldb::FileMetaData *> leveldb::Version::last_fnfile;
+nova::NovaGlobalVariables nova::NovaGlobalVariables::global;
+std::atomic<nova::Servers *> leveldb::StorageSelector::available_stoc_servers;
+std::atomic_int_fast32_t leveldb::StorageSelector::stoc_for_compaction_seq_id;
+
+int main(int argc, char **argv) {
+    NovaConfig::config = new NovaConfig;
+    return leveldb::test::RunAllTests();
+}
@@ -22,6 +22,7 @@
 #include "db/log_reader.h"
 #include "leveldb/log_writer.h"
 #include "db/memtable.h"
+#include "db/pruned_iterator.h"
 #include "db/table_cache.h"
 #include "db/version_set.h"
 #include "db/write_batch_internal.h"
@@ -32,6 +33,7 @@
 #include "leveldb/table_builder.h"
 #include "port/port.h"
 #include "table/block.h"
+#include "table/filter_block.h"
 #include "table/merger.h"
 #include "table/two_level_iterator.h"
 #include "util/coding.h"
@@ -141,14 +143,18 @@ namespace leveldb {
         terminate_coordinated_compaction_ = false;
         start_compaction_ = true;
         if (options_.enable_lookup_index) {
-            //So big!
             lookup_index_ = new LookupIndex(
                     options_.upper_key - options_.lower_key);
-            for (int i = 0; i < options_.upper_key - options_.lower_key; i++) {
-                lookup_index_->Insert(Slice(), i, 0);
-            }
+        }
+        for (int i = 0; i < MAX_ACTIVE_MEMTABLE_SLOTS; i++) {
+            active_memtable_slots_[i] = nullptr;
         }
         nova::ParseDBIndexFromDBName(dbname_, &dbid_);
+        if (options_.log_group_commit_max_batch_size > 1) {
+            log_group_commit_ = new LogGroupCommit(env_, dbid_,
+                                                   options_.log_group_commit_max_batch_size,
+                                                   options_.log_group_commit_max_delay_us);
+        }
     }
 
     DBImpl::~DBImpl() {
@@ -159,6 +165,7 @@ namespace leveldb {
 
         delete versions_;
         delete table_cache_;
+        delete log_group_commit_;
 
         if (owns_info_log_) {
             delete options_.info_log;
@@ -270,7 +277,8 @@ namespace leveldb {
             auto metadata = it.second;
             edit.AddFile(level, metadata.memtable_ids, metadata.number, metadata.file_size,
                          metadata.converted_file_size, metadata.flush_timestamp, metadata.smallest,
-                         metadata.largest, metadata.block_replica_handles, metadata.parity_block_handle);
+                         metadata.largest, metadata.block_replica_handles, metadata.parity_block_handles,
+                         metadata.num_entries, metadata.num_deletions);
         }
 
         NOVA_LOG(rdmaio::INFO)
@@ -291,8 +299,9 @@ namespace leveldb {
         versions_->AppendChangesToManifest(&edit, manifest_file_, options_.manifest_stoc_ids);
     }
 
-    uint32_t DBImpl::EncodeDBMetadata(char *buf, nova::StoCInMemoryLogFileManager *log_manager, uint32_t cfg_id) {
-        // dump the latest version, subranges, log files, range index, lookup index, and table id mapping.
+    uint32_t DBImpl::EncodeDBMetadata(char *buf, nova::StoCInMemoryLogFileManager *log_manager, uint32_t cfg_id,
+                                      std::vector<uint64_t> *lookup_index_entries) {
+        // dump the latest version, subranges, log files, range index, and table id mapping.
         uint32_t msg_size = 1 + 4 + 4 + 4 + 8 + 8 + 8;
         // Lock the database and all memtable partitions.
         // This ensures a consistent snapshot of the database.
@@ -321,9 +330,11 @@ namespace leveldb {
         uint32_t logfile_size = log_manager->EncodeLogFiles(buf + msg_size, dbid_);
         msg_size += logfile_size;
 
-        // lookup index
-        uint32_t lookup_index_size = lookup_index_->Encode(buf + msg_size);
-        msg_size += lookup_index_size;
+        // lookup index is streamed after this message.
+        if (lookup_index_) {
+            lookup_index_->Export(lookup_index_entries);
+        }
+        uint32_t lookup_index_size = lookup_index_entries->size();
         uint32_t tableid_mapping_size = versions_->EncodeTableIdMapping(
                 buf + msg_size, memtable_id_seq_);
         msg_size += tableid_mapping_size;
@@ -350,12 +361,12 @@ namespace leveldb {
         }
         mutex_.Unlock();
         NOVA_LOG(rdmaio::INFO)
-            << fmt::format("{}-{}: v:{} srs:{} mp:{} log:{} lookupidx:{} tid:{} rangeidx:{} {} {} {} {}", msg_size,
+            << fmt::format("{}-{}: v:{} srs:{} mp:{} log:{} lookupidx-entries:{} tid:{} rangeidx:{} {} {} {} {}", msg_size,
                            options_.max_stoc_file_size, version_size, srs_size, memtables_size, logfile_size,
                            lookup_index_size, tableid_mapping_size, range_index_size, dbid_, v->version_id_,
                            versions_->last_sequence_, versions_->next_file_number_);
         NOVA_ASSERT(msg_size < options_.max_stoc_file_size)
-            << fmt::format("{}-{}: v:{} srs:{} mp:{} log:{} lookupidx:{} tid:{} rangeidx:{}", msg_size,
+            << fmt::format("{}-{}: v:{} srs:{} mp:{} log:{} lookupidx-entries:{} tid:{} rangeidx:{}", msg_size,
                            options_.max_stoc_file_size, version_size, srs_size, memtables_size, logfile_size,
                            lookup_index_size, tableid_mapping_size, range_index_size);
         return msg_size;
@@ -390,9 +401,9 @@ namespace leveldb {
         NOVA_LOG(rdmaio::INFO) << fmt::format("Decoded {} bytes: db:{}, Log manager", size - tmp.size(), dbid_);
         size = tmp.size();
 
-        lookup_index_->Decode(&tmp);
-        NOVA_LOG(rdmaio::INFO) << fmt::format("Decoded {} bytes: db:{}, Lookup index", size - tmp.size(), dbid_);
-        size = tmp.size();
+        if (lookup_index_) {
+            lookup_index_complete_ = false;
+        }
 
         versions_->DecodeTableIdMapping(&tmp, internal_comparator_, mid_table_map);
         NOVA_LOG(rdmaio::INFO) << fmt::format("Decoded {} bytes: db:{}, TableIdMapping", size - tmp.size(), dbid_);
@@ -446,14 +457,67 @@ namespace leveldb {
         }
     }
 
+    uint32_t DBImpl::EncodeLookupIndexChunk(char *buf, uint32_t max_size, uint32_t cfg_id,
+                                            const std::vector<uint64_t> &lookup_index_entries, uint64_t *next) {
+        if (!lookup_index_) {
+            return 0;
+        }
+        uint32_t msg_size = 1;
+        buf[0] = StoCRequestType::LTC_MIGRATION_LOOKUP_INDEX;
+        msg_size += EncodeFixed32(buf + msg_size, cfg_id);
+        msg_size += EncodeFixed32(buf + msg_size, dbid_);
+        uint32_t last_offset = msg_size;
+        msg_size += 1;
+        msg_size += LookupIndex::EncodeEntries(lookup_index_entries, next, buf + msg_size, max_size - msg_size);
+        EncodeBool(buf + last_offset, *next == lookup_index_entries.size());
+        return msg_size;
+    }
+
+    void DBImpl::RecoverLookupIndexChunk(Slice *buf, bool last) {
+        NOVA_ASSERT(lookup_index_);
+        lookup_index_->DecodeEntries(buf);
+        if (!last) {
+            return;
+        }
+        std::vector<uint32_t> obsolete_mids;
+        lookup_index_migration_mutex_.Lock();
+        lookup_index_complete_ = true;
+        obsolete_mids.swap(pending_obsolete_mids_);
+        lookup_index_migration_mutex_.Unlock();
+        if (!obsolete_mids.empty()) {
+            lookup_index_->MarkObsolete(obsolete_mids);
+            lookup_index_->GarbageCollect();
+        }
+        NOVA_LOG(rdmaio::INFO)
+            << fmt::format("DB[{}]: Lookup index complete: {}", dbid_, lookup_index_->DebugString());
+    }
+
     void
     DBImpl::UpdateLookupIndex(uint32_t version_id,
                               const std::unordered_map<uint32_t, MemTableL0FilesEdit> &edits) {
+        std::vector<uint32_t> obsolete_mids;
         for (const auto &it : edits) {
             NOVA_LOG(rdmaio::DEBUG)
                 << fmt::format("update lookup index mid:{} {}", it.first,
                                it.second.DebugString());
-            versions_->mid_table_mapping_[it.first]->UpdateL0Files(version_id, it.second);
+            if (versions_->mid_table_mapping_[it.first]->UpdateL0Files(version_id, it.second)) {
+                obsolete_mids.push_back(it.first);
+            }
+        }
+        if (lookup_index_ && !obsolete_mids.empty() && !lookup_index_complete_) {
+            lookup_index_migration_mutex_.Lock();
+            if (!lookup_index_complete_) {
+                pending_obsolete_mids_.insert(pending_obsolete_mids_.end(), obsolete_mids.begin(),
+                                              obsolete_mids.end());
+                obsolete_mids.clear();
+            }
+            lookup_index_migration_mutex_.Unlock();
+        }
+        if (lookup_index_ && !obsolete_mids.empty()) {
+            // Gets of these keys search L1 and above directly. The entries
+            // are removed by the compaction coordinator after it releases
+            // the mutex.
+            lookup_index_->MarkObsolete(obsolete_mids);
         }
     }
 
@@ -539,11 +603,14 @@ namespace leveldb {
         }
         // Delete parity file.
         if (nova::NovaConfig::config->use_parity_for_sstable_data_blocks) {
-            auto handle = meta.parity_block_handle;
-            SSTableStoCFilePair pair = {};
-            pair.sstable_name = TableFileName(this->dbname_, meta.number, FileInternalType::kFileParity, 0);
-            pair.stoc_file_id = handle.stoc_file_id;
-            (*server_pairs)[handle.server_id].push_back(pair);
+            for (int parity_id = 0; parity_id < meta.parity_block_handles.size(); parity_id++) {
+                auto handle = meta.parity_block_handles[parity_id];
+                SSTableStoCFilePair pair = {};
+                pair.sstable_name = TableFileName(this->dbname_, meta.number, FileInternalType::kFileParity,
+                                                  parity_id);
+                pair.stoc_file_id = handle.stoc_file_id;
+                (*server_pairs)[handle.server_id].push_back(pair);
+            }
         }
     }
 
@@ -578,7 +645,7 @@ namespace leveldb {
             leveldb::LevelDBLogRecord record;
             while (nova::DecodeLogRecord(&slice, &record)) {
                 memtable->Add(record.sequence_number,
-                              leveldb::ValueType::kTypeValue, record.key, record.value);
+                              record.type, record.key, record.value);
                 recovered_log_records += 1;
                 max_sequence_number = std::max(max_sequence_number,
                                                record.sequence_number);
@@ -670,9 +737,11 @@ namespace leveldb {
                         }
                     }
                 }
-                if (meta->parity_block_handle.stoc_file_id != 0) {
-                    std::string filename = TableFileName(dbname_, meta->number, FileInternalType::kFileParity, 0);
-                    stoc_fn_stocfileid[meta->parity_block_handle.server_id][filename] = meta->parity_block_handle.stoc_file_id;
+                for (int parity_id = 0; parity_id < meta->parity_block_handles.size(); parity_id++) {
+                    const StoCBlockHandle &handle = meta->parity_block_handles[parity_id];
+                    std::string filename = TableFileName(dbname_, meta->number, FileInternalType::kFileParity,
+                                                         parity_id);
+                    stoc_fn_stocfileid[handle.server_id][filename] = handle.stoc_file_id;
                 }
             }
         }
@@ -726,11 +795,9 @@ namespace leveldb {
                     meta->SelectReplica(), 0, meta->converted_file_size);
             it->SeekToFirst();
             while (it->Valid()) {
-                uint64_t hash;
                 Slice user_key = ExtractUserKey(it->key());
-                nova::str_to_int(user_key.data(), &hash, user_key.size());
                 if (lookup_index_) {
-                    lookup_index_->Insert(user_key, hash, memtableid);
+                    lookup_index_->Insert(user_key, memtableid);
                 }
 
                 AtomicMemTable *mem = versions_->mid_table_mapping_[memtableid];
@@ -790,8 +857,8 @@ namespace leveldb {
                 }
             } else {
                 Range r = {};
-                r.lower = std::to_string(options_.lower_key);
-                r.upper = std::to_string(options_.upper_key);
+                r.lower = nova::int_to_user_key(options_.lower_key);
+                r.upper = nova::int_to_user_key(options_.upper_key);
                 init->ranges_.push_back(r);
                 RangeTables tables = {};
                 for (int i = 0; i < partitioned_active_memtables_.size(); i++) {
@@ -1006,7 +1073,7 @@ namespace leveldb {
                              meta.flush_timestamp,
                              meta.smallest,
                              meta.largest,
-                             meta.block_replica_handles, meta.parity_block_handle);
+                             meta.block_replica_handles, meta.parity_block_handles);
             }
         }
         versions_->AppendChangesToManifest(&edit, manifest_file_,
@@ -1081,7 +1148,8 @@ namespace leveldb {
                           meta.flush_timestamp,
                           meta.smallest,
                           meta.largest,
-                          meta.block_replica_handles, meta.parity_block_handle);
+                          meta.block_replica_handles, meta.parity_block_handles,
+                          meta.num_entries, meta.num_deletions);
             nova::NovaGlobalVariables::global.written_memtable_sizes += meta.file_size;
         }
     }
@@ -1103,7 +1171,7 @@ namespace leveldb {
             immids.insert(imm->memtableid());
             nova::NovaGlobalVariables::global.generated_memtable_sizes += imm->ApproximateMemoryUsage();
         }
-        Iterator *it = NewMergingIterator(&internal_comparator_, &iterators[0], iterators.size());
+        Iterator *it = NewCompactionMergingIterator(&internal_comparator_, &iterators[0], iterators.size());
         SubRanges *subranges = nullptr;
         if (subrange_manager_) {
             subranges = subrange_manager_->latest_subranges_;
@@ -1121,23 +1189,28 @@ namespace leveldb {
         atomic_output_memtable->SetMemTable(flush_order_->latest_generation_id, output_memtable);
 
         std::vector<LevelDBLogRecord> log_records;
+        std::vector<MemTable::BulkEntry> entries;
         auto fn_add_to_memtable = [&](const ParsedInternalKey &ikey, const Slice &value) {
-            output_memtable->Add(ikey.sequence, ValueType::kTypeValue, ikey.user_key, value);
-            if (nova::NovaConfig::config->cfgs.size() == 1) {
-                uint64_t key;
-                nova::str_to_int(ikey.user_key.data(), &key, ikey.user_key.size());
-                uint32_t current_mid = lookup_index_->Lookup(ikey.user_key, key);
-                if (immids.find(current_mid) != immids.end()) {
-                    lookup_index_->CAS(ikey.user_key, key, current_mid, memtable_id);
-                }
-            }
+            entries.push_back({ikey.sequence, ikey.type, ikey.user_key, value});
             LevelDBLogRecord log_record = {};
             log_record.sequence_number = ikey.sequence;
             log_record.key = ikey.user_key;
             log_record.value = value;
+            log_record.type = ikey.type;
             log_records.push_back(std::move(log_record));
         };
         job.CompactTables(state, it, &stats, true, kCompactInputMemTables, kCompactOutputMemTables, fn_add_to_memtable);
+        // The merged entries are sorted. Link them into the output memtable
+        // in one pass before the lookup index references it.
+        output_memtable->BulkAdd(entries);
+        if (nova::NovaConfig::config->cfgs.size() == 1) {
+            for (const auto &entry : entries) {
+                uint32_t current_mid = lookup_index_->Lookup(entry.key);
+                if (immids.find(current_mid) != immids.end()) {
+                    lookup_index_->CAS(entry.key, current_mid, memtable_id);
+                }
+            }
+        }
         {
             leveldb::WriteOptions wo;
             wo.stoc_client = bg_thread->stoc_client();
@@ -1174,11 +1247,9 @@ namespace leveldb {
                     while (new_memtable_it->Valid()) {
                         Slice ukey = ExtractUserKey(new_memtable_it->key());
                         // Update lookup index.
-                        uint64_t key;
-                        nova::str_to_int(ukey.data(), &key, ukey.size());
-                        uint32_t current_mid = lookup_index_->Lookup(ukey, key);
+                        uint32_t current_mid = lookup_index_->Lookup(ukey);
                         if (immids.find(current_mid) != immids.end()) {
-                            lookup_index_->CAS(ukey, key, current_mid, memtable_id);
+                            lookup_index_->CAS(ukey, current_mid, memtable_id);
                         }
                         new_memtable_it->Next();
                     }
@@ -1204,6 +1275,11 @@ namespace leveldb {
             atomic_imm->is_immutable_ = true;
             atomic_imm->SetFlushed(dbname_, {}, 0);
         }
+        if (lookup_index_) {
+            // Entries that still point to the merged memtables are stale.
+            lookup_index_->MarkObsolete(
+                    std::vector<uint32_t>(immids.begin(), immids.end()));
+        }
 
         if (nova::NovaConfig::config->cfgs.size() == 1) {
             p->mutex.Lock();
@@ -1238,6 +1314,9 @@ namespace leveldb {
             p->background_work_finished_signal_.SignalAll();
         }
         p->mutex.Unlock();
+        if (lookup_index_) {
+            lookup_index_->GarbageCollect();
+        }
         delete state;
         return true;
     }
@@ -1278,7 +1357,7 @@ namespace leveldb {
                              meta.flush_timestamp,
                              meta.smallest,
                              meta.largest,
-                             meta.block_replica_handles, meta.parity_block_handle);
+                             meta.block_replica_handles, meta.parity_block_handles);
             }
             NOVA_LOG(rdmaio::INFO)
                 << fmt::format(
@@ -1291,17 +1370,20 @@ namespace leveldb {
         Version *v = new Version(&internal_comparator_, table_cache_, &options_,
                                  versions_->version_id_seq_.fetch_add(1),
                                  versions_);
+        uint32_t version_id = v->version_id();
+        NOVA_ASSERT(v->version_id() < MAX_LIVE_MEMTABLES);
+        mutex_.Lock();
+        Status s = versions_->LogAndApply(&edit, v, true);
+        NOVA_ASSERT(s.ok());
+        // A memtable is flushed once its L0 file is in the current version.
+        // SmallestUnflushedSequence relies on this order.
         for (auto &task : tasks) {
             MemTable *imm = reinterpret_cast<MemTable *>(task.memtable);
             versions_->mid_table_mapping_[imm->memtableid()]->SetFlushed(
                     dbname_,
                     {imm->meta().number},
-                    v->version_id());
+                    version_id);
         }
-        NOVA_ASSERT(v->version_id() < MAX_LIVE_MEMTABLES);
-        mutex_.Lock();
-        Status s = versions_->LogAndApply(&edit, v, true);
-        NOVA_ASSERT(s.ok());
         mutex_.Unlock();
 
         uint32_t num_available = 0;
@@ -1549,7 +1631,24 @@ namespace leveldb {
         }
     }
 
+    SequenceNumber DBImpl::SmallestUnflushedSequence() {
+        mutex_.AssertHeld();
+        SequenceNumber smallest = kMaxSequenceNumber;
+        uint32_t memtable_id_seq = memtable_id_seq_;
+        for (uint32_t i = 0; i < memtable_id_seq && i < MAX_LIVE_MEMTABLES; i++) {
+            AtomicMemTable *mem = versions_->mid_table_mapping_[i];
+            mem->mutex_.lock();
+            if (mem->memtable_ && !mem->is_flushed_) {
+                smallest = std::min(smallest,
+                                    mem->memtable_->smallest_sequence());
+            }
+            mem->mutex_.unlock();
+        }
+        return smallest;
+    }
+
     bool DBImpl::ComputeCompactions(leveldb::Version *current,
+                                    SequenceNumber smallest_unflushed_sequence,
                                     std::vector<leveldb::Compaction *> *compactions,
                                     VersionEdit *edit,
                                     RangeIndexVersionEdit *range_edit,
@@ -1636,7 +1735,8 @@ namespace leveldb {
                           f->flush_timestamp,
                           f->smallest,
                           f->largest,
-                          f->block_replica_handles, f->parity_block_handle);
+                          f->block_replica_handles, f->parity_block_handles,
+                          f->num_entries, f->num_deletions);
             std::string output = fmt::format(
                     "Moved #{}@{} to level-{} {} bytes\n",
                     f->number, c->level(), c->target_level(), f->file_size);
@@ -1659,6 +1759,9 @@ namespace leveldb {
             delete c;
             it = compactions->erase(it);
         }
+        for (auto c : *compactions) {
+            current->ComputeDeeperRanges(c, smallest_unflushed_sequence);
+        }
         return moves;
     }
 
@@ -1696,6 +1799,7 @@ namespace leveldb {
             NOVA_ASSERT(versions_->versions_[current->version_id()]->Ref() == current);
             NOVA_LOG(rdmaio::DEBUG)
                 << fmt::format("comv-init {} {}", current->version_id_, current->refs_);
+            SequenceNumber smallest_unflushed_sequence = SmallestUnflushedSequence();
             mutex_.Unlock();
 
             std::vector<Compaction *> compactions;
@@ -1712,7 +1816,8 @@ namespace leveldb {
                 VersionEdit edit;
                 RangeIndexVersionEdit range_edit;
                 std::unordered_map<uint32_t, MemTableL0FilesEdit> edits;
-                if (ComputeCompactions(current, &compactions, &edit, &range_edit, &delete_due_to_low_overlap, &edits)) {
+                if (ComputeCompactions(current, smallest_unflushed_sequence, &compactions, &edit, &range_edit,
+                                       &delete_due_to_low_overlap, &edits)) {
                     // Contain moves. Cleanup LSM immediately.
                     CleanupLSMCompaction(nullptr, edit, range_edit, edits, nullptr, current->version_id_);
                 }
@@ -1814,6 +1919,9 @@ namespace leveldb {
                             req->inputs[which] = compaction->inputs_[which];
                         }
                         req->guides = compaction->grandparents_;
+                        req->drop_obsolete_deletions = compaction->drop_obsolete_deletions_;
+                        req->deeper_ranges = compaction->deeper_ranges_;
+                        req->smallest_unflushed_sequence = compaction->smallest_unflushed_sequence_;
                         uint32_t req_id = client->InitiateCompaction(
                                 selected_storages[i], req);
                         reqs.push_back(req_id);
@@ -2004,6 +2112,11 @@ namespace leveldb {
         }
         mutex_.Unlock();
         DeleteFiles(compaction_coordinator_thread_, files_to_delete, server_pairs);
+        if (lookup_index_) {
+            // An entry of an obsolete memtable has no L0 SSTables and only
+            // sends a get to L1. Scan the index once many are obsolete.
+            lookup_index_->GarbageCollect(options_.num_memtables);
+        }
 
         for (int i = 0; i < partitioned_active_memtables_.size(); i++) {
             partitioned_active_memtables_[i]->background_work_finished_signal_.SignalAll();
@@ -2030,7 +2143,8 @@ namespace leveldb {
                           versions_->last_sequence_,
                           out.smallest, out.largest,
                           out.block_replica_handles,
-                          out.parity_block_handle);
+                          out.parity_block_handles,
+                          out.num_entries, out.num_deletions);
         }
         return Status::OK();
     }
@@ -2063,11 +2177,45 @@ namespace leveldb {
         NOVA_ASSERT(range_index);
         auto atomic_version = versions_->versions_[range_index->lsm_version_id_];
         NOVA_ASSERT(atomic_version) << range_index->lsm_version_id_;
-        atomic_version->version->AddIterators(options, range_index, &list,
-                                              &scan_stats);
-        Iterator *internal_iter =
-                NewMergingIterator(&internal_comparator_, &list[0],
-                                   list.size());
+        Version *version = atomic_version->version;
+        // Keys are integers for scans. Expect the scan to read the keys in
+        // [start, start + length) and only open the levels that overlap it.
+        uint64_t start = 0;
+        std::string upper;
+        if (options.scan_length > 0 &&
+            user_comparator_->KeyToInt(options.scan_start_key, &start)) {
+            uint64_t end = start + options.scan_length;
+            if (end < start) {
+                end = UINT64_MAX;
+            }
+            upper = nova::int_to_user_key(end);
+        }
+        Iterator *internal_iter;
+        if (upper.empty()) {
+            version->AddIterators(options, range_index, &list, &scan_stats);
+            internal_iter = NewMergingIterator(&internal_comparator_, &list[0],
+                                               list.size());
+        } else {
+            Slice lower = options.scan_start_key;
+            Slice upper_key = upper;
+            version->AddIterators(options, range_index, &list, &scan_stats,
+                                  &lower, &upper_key);
+            Iterator *pruned_iter = NewMergingIterator(&internal_comparator_,
+                                                       &list[0], list.size());
+            // The full iterator reads the same range index and version.
+            ReadOptions full_options = options;
+            auto new_full_iterator = [this, full_options, version, range_index]() {
+                std::vector<Iterator *> full_list;
+                version->AddIterators(full_options, range_index, &full_list,
+                                      &scan_stats);
+                scan_stats.number_of_scan_full_iterators_ += 1;
+                return NewMergingIterator(&internal_comparator_, &full_list[0],
+                                          full_list.size());
+            };
+            internal_iter = NewPrunedIterator(&internal_comparator_,
+                                              pruned_iter, lower, upper_key,
+                                              new_full_iterator);
+        }
         IterState *cleanup = new IterState(range_index, versions_);
         internal_iter->RegisterCleanup(CleanupIteratorState, cleanup, nullptr);
         return internal_iter;
@@ -2076,7 +2224,7 @@ namespace leveldb {
     Status DBImpl::Get(const ReadOptions &options, const Slice &key,
                        std::string *value) {
         number_of_gets_ += 1;
-        if (lookup_index_) {
+        if (lookup_index_ && lookup_index_complete_) {
 //            if (GetWithLookupIndex(options, key, value).ok()) {
 //                return Status::OK();
 //            }
@@ -2085,6 +2233,86 @@ namespace leveldb {
         return GetWithRangeIndex(options, key, value);
     }
 
+    Status DBImpl::MultiGet(const ReadOptions &options,
+                            const std::vector<Slice> &keys,
+                            std::vector<std::string> *values,
+                            std::vector<Status> *statuses) {
+        values->clear();
+        values->resize(keys.size());
+        statuses->clear();
+        statuses->resize(keys.size());
+        // Keys that share a data block are looked up one after another.
+        std::vector<uint32_t> order(keys.size());
+        for (uint32_t i = 0; i < keys.size(); i++) {
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            return user_comparator_->Compare(keys[a], keys[b]) < 0;
+        });
+        if (options_.block_cache != nullptr && keys.size() > 1) {
+            PrefetchDataBlocks(options, keys, order);
+        }
+        Status s;
+        for (uint32_t i : order) {
+            (*statuses)[i] = Get(options, keys[i], &(*values)[i]);
+            if (!(*statuses)[i].ok() && !(*statuses)[i].IsNotFound()) {
+                s = (*statuses)[i];
+            }
+        }
+        return s;
+    }
+
+    void DBImpl::PrefetchDataBlocks(const ReadOptions &options,
+                                    const std::vector<Slice> &keys,
+                                    const std::vector<uint32_t> &order) {
+        Version *current = nullptr;
+        uint32_t vid = 0;
+        while (current == nullptr) {
+            vid = versions_->current_version_id();
+            NOVA_ASSERT(vid < MAX_LIVE_MEMTABLES) << vid;
+            current = versions_->versions_[vid]->Ref();
+        }
+        // Internal keys referenced by the tables.
+        std::vector<std::string> ikeys;
+        ikeys.reserve(keys.size());
+        std::map<uint64_t, MultiGetTable> tables;
+        std::vector<std::pair<int, FileMetaData *>> files;
+        for (uint32_t i : order) {
+            GetSearchScope scope = GetSearchScope::kAllLevels;
+            if (lookup_index_ && lookup_index_complete_) {
+                uint32_t memtableid = lookup_index_->Lookup(keys[i]);
+                if (memtableid == 0) {
+                    scope = GetSearchScope::kL1AndAbove;
+                } else {
+                    AtomicMemTable *memtable = versions_->mid_table_mapping_[memtableid]->RefMemTable();
+                    if (memtable != nullptr) {
+                        // Served by the memtable.
+                        memtable->Unref(dbname_);
+                        continue;
+                    }
+                }
+            }
+            LookupKey lkey(keys[i], kMaxSequenceNumber);
+            ikeys.push_back(lkey.internal_key().ToString());
+            files.clear();
+            current->AddCandidateFiles(lkey.user_key(), lkey.internal_key(),
+                                       scope, &files);
+            for (const auto &file : files) {
+                MultiGetTable &table = tables[file.second->number];
+                table.meta = file.second;
+                table.level = file.first;
+                table.keys.emplace_back(ikeys.back());
+            }
+        }
+        std::vector<MultiGetTable> list;
+        list.reserve(tables.size());
+        for (auto &it : tables) {
+            list.push_back(std::move(it.second));
+        }
+        table_cache_->PrefetchDataBlocks(options, list);
+        versions_->versions_[vid]->Unref(dbname_);
+    }
+
     Status
     DBImpl::GetWithRangeIndex(const ReadOptions &options, const Slice &key,
                               std::string *value) {
@@ -2101,28 +2329,119 @@ namespace leveldb {
         NOVA_ASSERT(BinarySearch(range_index->ranges_, key, &index,
                                  user_comparator_));
         const RangeTables &range_table = range_index->range_tables_[index];
-        // Search memtables.
+        // Search memtables and L0 SSTables. The newest entry wins.
+        bool found = false;
+        SequenceNumber latest_seq = 0;
         for (uint32_t memtableid : range_table.memtable_ids) {
-            versions_->mid_table_mapping_[memtableid]->memtable_->Get(lkey, value, &s);
+            std::string tmp;
+            Status tmp_s;
+            SequenceNumber seq = 0;
+            if (versions_->mid_table_mapping_[memtableid]->memtable_->Get(
+                    lkey, &tmp, &tmp_s, &seq) &&
+                (!found || seq > latest_seq)) {
+                found = true;
+                latest_seq = seq;
+                s = tmp_s;
+                value->swap(tmp);
+            }
         }
         std::vector<uint64_t> l0fns;
         l0fns.insert(l0fns.begin(), range_table.l0_sstable_ids.begin(),
                      range_table.l0_sstable_ids.end());
-        // Search SSTables.
-        SequenceNumber latest_seq = 0;
-        atomic_version->version->Get(options, l0fns, lkey, &latest_seq,
-                                     value,
-                                     &number_of_files_to_search_for_get_);
-        Version::GetStats stats = {};
-        atomic_version->version->Get(options, lkey, &latest_seq, value,
-                                     &stats, GetSearchScope::kL1AndAbove,
-                                     &number_of_files_to_search_for_get_);
+        std::string l0val;
+        SequenceNumber l0seq = 0;
+        bool deleted = false;
+        Status l0s = atomic_version->version->Get(options, l0fns, lkey, &l0seq,
+                                                  &l0val,
+                                                  &number_of_files_to_search_for_get_,
+                                                  &deleted);
+        if ((l0s.ok() || deleted) && (!found || l0seq > latest_seq)) {
+            found = true;
+            latest_seq = l0seq;
+            s = deleted ? Status::NotFound(Slice()) : Status::OK();
+            value->swap(l0val);
+        }
+        if (!found) {
+            // Search L1 and above.
+            Version::GetStats stats = {};
+            s = atomic_version->version->Get(options, lkey, &latest_seq, value,
+                                             &stats, GetSearchScope::kL1AndAbove,
+                                             &number_of_files_to_search_for_get_);
+        }
         range_index->UnRef();
         versions_->versions_[range_index->lsm_version_id_]->Unref(dbname_);
-        if (!value->empty()) {
-            return Status::OK();
+        return s;
+    }
+
+    Status
+    DBImpl::GetFromAllTables(const ReadOptions &options, const Slice &key,
+                             std::string *value) {
+        if (range_index_manager_) {
+            return GetWithRangeIndex(options, key, value);
+        }
+        LookupKey lkey(key, kMaxSequenceNumber);
+        Status s = Status::NotFound(Slice());
+        bool found = false;
+        SequenceNumber latest_seq = 0;
+        // Search all live memtables. The newest entry wins.
+        std::vector<uint32_t> memtableids;
+        for (auto partition : partitioned_active_memtables_) {
+            partition->mutex.Lock();
+            for (const auto &gen : partition->generation_num_memtables_) {
+                memtableids.insert(memtableids.end(), gen.second.begin(),
+                                   gen.second.end());
+            }
+            partition->mutex.Unlock();
+        }
+        for (uint32_t memtableid : memtableids) {
+            AtomicMemTable *memtable = versions_->mid_table_mapping_[memtableid]->RefMemTable();
+            if (memtable == nullptr) {
+                // Flushed. Its SSTables are searched below.
+                continue;
+            }
+            std::string tmp;
+            Status tmp_s;
+            SequenceNumber seq = 0;
+            if (memtable->memtable_->Get(lkey, &tmp, &tmp_s, &seq) &&
+                (!found || seq > latest_seq)) {
+                found = true;
+                latest_seq = seq;
+                s = tmp_s;
+                value->swap(tmp);
+            }
+            versions_->mid_table_mapping_[memtableid]->Unref(dbname_);
+        }
+
+        Version *current = nullptr;
+        uint32_t vid = 0;
+        while (current == nullptr) {
+            vid = versions_->current_version_id();
+            NOVA_ASSERT(vid < MAX_LIVE_MEMTABLES) << vid;
+            current = versions_->versions_[vid]->Ref();
         }
-        return Status::NotFound("");
+        std::vector<uint64_t> l0fns;
+        for (auto file : current->files_[0]) {
+            l0fns.push_back(file->number);
+        }
+        std::string l0val;
+        SequenceNumber l0seq = 0;
+        bool deleted = false;
+        Status l0s = current->Get(options, l0fns, lkey, &l0seq, &l0val,
+                                  &number_of_files_to_search_for_get_,
+                                  &deleted);
+        if ((l0s.ok() || deleted) && (!found || l0seq > latest_seq)) {
+            found = true;
+            s = deleted ? Status::NotFound(Slice()) : Status::OK();
+            value->swap(l0val);
+        }
+        if (!found) {
+            Version::GetStats stats = {};
+            s = current->Get(options, lkey, &latest_seq, value, &stats,
+                             GetSearchScope::kL1AndAbove,
+                             &number_of_files_to_search_for_get_);
+        }
+        versions_->versions_[vid]->Unref(dbname_);
+        return s;
     }
 
     Status
@@ -2135,7 +2454,9 @@ namespace leveldb {
         std::vector<uint64_t> l0fns;
 
         NOVA_ASSERT(lookup_index_);
-        uint32_t memtableid = lookup_index_->Lookup(key, options.hash);
+        // A hit is verified by the key fingerprint. A miss means the key
+        // is not in any memtable or L0 SSTable.
+        uint32_t memtableid = lookup_index_->Lookup(key);
         if (memtableid != 0) {
             NOVA_ASSERT(memtableid < MAX_LIVE_MEMTABLES) << memtableid;
             memtable = versions_->mid_table_mapping_[memtableid]->RefMemTable();
@@ -2149,14 +2470,18 @@ namespace leveldb {
 //                               memtable->memtable_->memtableid(),
 //                               s.ToString());
 
-            bool found = memtable->memtable_->Get(lkey, value, &s);
+            Status memtable_s;
+            bool found = memtable->memtable_->Get(lkey, value, &memtable_s);
             versions_->mid_table_mapping_[memtableid]->Unref(dbname_);
             if (found) {
+                // The value or the deletion of the key.
                 number_of_memtable_hits_ += 1;
-                return Status::OK();
-            } else {
-                return Status::NotFound("");
+                return memtable_s;
             }
+            // Another key with the same fingerprint has replaced the entry
+            // of this key. The key may be in any memtable or L0 SSTable.
+            lookup_index_->RecordFalsePositive();
+            return GetFromAllTables(options, key, value);
         }
 
         Version *current = nullptr;
@@ -2185,12 +2510,19 @@ namespace leveldb {
             versions_->versions_[vid]->Unref(dbname_);
         }
 
+        bool deleted = false;
         if (!l0fns.empty()) {
-            s = current->Get(options, l0fns, lkey, &latest_seq, value, &number_of_files_to_search_for_get_);
+            s = current->Get(options, l0fns, lkey, &latest_seq, value, &number_of_files_to_search_for_get_,
+                             &deleted);
+            if (s.IsNotFound() && !deleted) {
+                lookup_index_->RecordFalsePositive();
+                versions_->versions_[vid]->Unref(dbname_);
+                return GetFromAllTables(options, key, value);
+            }
         }
         NOVA_ASSERT(!s.IsIOError())
             << fmt::format("v:{} status:{} mid:{} version:{}", vid, s.ToString(), memtableid, current->DebugString());
-        if (s.IsNotFound()) {
+        if (s.IsNotFound() && !deleted) {
             // Search L1 files.
             Version::GetStats stats = {};
             SequenceNumber l1seq;
@@ -2230,9 +2562,12 @@ namespace leveldb {
 
     Iterator *DBImpl::NewIterator(const ReadOptions &options) {
         scan_stats.number_of_scans_ += 1;
+        ReadOptions scan_options = options;
+        scan_options.scan_stats = &scan_stats;
         SequenceNumber latest_snapshot;
         uint32_t seed;
-        Iterator *iter = NewInternalIterator(options, &latest_snapshot, &seed);
+        Iterator *iter = NewInternalIterator(scan_options, &latest_snapshot,
+                                             &seed);
         return NewDBIterator(this, user_comparator(), iter, latest_snapshot, seed,
                              nova::NovaConfig::config->cfgs[options.cfg_id]->fragments[dbid_]->range);
     }
@@ -2250,18 +2585,23 @@ namespace leveldb {
 // Convenience methods
     Status
     DBImpl::Put(const WriteOptions &o, const Slice &key, const Slice &val) {
+        return WriteEntry(o, key, val, ValueType::kTypeValue);
+    }
+
+    Status DBImpl::Delete(const WriteOptions &options, const Slice &key) {
+        return WriteEntry(options, key, Slice(), ValueType::kTypeDeletion);
+    }
+
+    Status DBImpl::WriteEntry(const WriteOptions &o, const Slice &key,
+                              const Slice &val, ValueType type) {
         processed_writes_ += 1;
         if (options_.memtable_type == MemTableType::kStaticPartition) {
             if (o.is_loading_db || !options_.enable_subranges) {
-                return WriteStaticPartition(o, key, val);
+                return WriteStaticPartition(o, key, val, type);
             }
-            return WriteSubrange(o, key, val);
+            return WriteSubrange(o, key, val, type);
         }
-        return WriteMemTablePool(o, key, val);
-    }
-
-    Status DBImpl::Delete(const WriteOptions &options, const Slice &key) {
-        return DB::Delete(options, key);
+        return WriteMemTablePool(o, key, val, type);
     }
 
     void DBImpl::StealMemTable(const leveldb::WriteOptions &options) {
@@ -2322,6 +2662,7 @@ namespace leveldb {
                                     dbid_,
                                     steal_table->memtable_->memtableid(),
                                     steal_from_range->dbid_);
+                        steal_from_range->RetireActiveMemTable(steal_table);
                         steal_from_range->active_memtables_.erase(
                                 steal_from_range->active_memtables_.begin() +
                                 memtable_index);
@@ -2353,6 +2694,68 @@ namespace leveldb {
         }
     }
 
+    AtomicMemTable *DBImpl::SelectActiveMemTableLockFree(const WriteOptions &options) {
+        uint32_t slot_id = options.thread_id % MAX_ACTIVE_MEMTABLE_SLOTS;
+        for (int i = 0; i < MAX_ACTIVE_MEMTABLE_SLOTS; i++) {
+            AtomicMemTable *memtable = active_memtable_slots_[slot_id].load();
+            if (memtable != nullptr) {
+                break;
+            }
+            slot_id = (slot_id + 1) % MAX_ACTIVE_MEMTABLE_SLOTS;
+        }
+
+        for (int i = 0; i < LOCKFREE_MEMTABLE_SELECTION_RETRIES; i++) {
+            AtomicMemTable *memtable = active_memtable_slots_[slot_id].load();
+            uint32_t current_slot_id = slot_id;
+            slot_id = (slot_id + 1) % MAX_ACTIVE_MEMTABLE_SLOTS;
+            if (memtable == nullptr) {
+                continue;
+            }
+            if (!memtable->mutex_.try_lock()) {
+                continue;
+            }
+            // An AtomicMemTable is never reused for another memtable. It is
+            // removed from the pool only after it is marked as immutable.
+            if (memtable->is_immutable_ || memtable->is_flushed_ ||
+                memtable->memtable_ == nullptr) {
+                memtable->mutex_.unlock();
+                continue;
+            }
+            if (memtable->memtable_size_ > options_.write_buffer_size) {
+                // The table is full. Retire it so that other writers do not
+                // pick it. The writer that filled it marks it as immutable.
+                active_memtable_slots_[current_slot_id].compare_exchange_strong(
+                        memtable, nullptr);
+                memtable->mutex_.unlock();
+                continue;
+            }
+            return memtable;
+        }
+        return nullptr;
+    }
+
+    void DBImpl::PublishActiveMemTable(AtomicMemTable *memtable) {
+        for (int i = 0; i < MAX_ACTIVE_MEMTABLE_SLOTS; i++) {
+            AtomicMemTable *expected = nullptr;
+            if (active_memtable_slots_[i].compare_exchange_strong(expected,
+                                                                  memtable)) {
+                return;
+            }
+        }
+        // All slots are taken. The memtable is only reachable through
+        // active_memtables_.
+    }
+
+    void DBImpl::RetireActiveMemTable(AtomicMemTable *memtable) {
+        for (int i = 0; i < MAX_ACTIVE_MEMTABLE_SLOTS; i++) {
+            AtomicMemTable *expected = memtable;
+            if (active_memtable_slots_[i].compare_exchange_strong(expected,
+                                                                  nullptr)) {
+                return;
+            }
+        }
+    }
+
     uint32_t DBImpl::EncodeMemTablePartitions(char *buf) {
         // All partitions are locked already.
         uint32_t msg_size = 0;
@@ -2535,19 +2938,20 @@ namespace leveldb {
     }
 
     bool DBImpl::WriteStaticPartition(const leveldb::WriteOptions &options,
-                                      const leveldb::Slice &key,
-                                      const leveldb::Slice &value,
+                                      const MemTable::BulkEntry *entries,
+                                      size_t n,
                                       uint32_t partition_id,
                                       bool should_wait,
-                                      uint64_t last_sequence,
                                       SubRange *subrange) {
         MemTablePartition *partition = partitioned_active_memtables_[partition_id];
         partition->mutex.Lock();
         if (subrange != nullptr) {
-            int tinyrange_id;
-            NOVA_ASSERT(BinarySearch(subrange->tiny_ranges, key, &tinyrange_id, user_comparator_))
-                << fmt::format("key:{} range:{}", key.ToString(), subrange->DebugString());
-            subrange->tiny_ranges[tinyrange_id].ninserts++;
+            for (size_t i = 0; i < n; i++) {
+                int tinyrange_id;
+                NOVA_ASSERT(BinarySearch(subrange->tiny_ranges, entries[i].key, &tinyrange_id, user_comparator_))
+                    << fmt::format("key:{} range:{}", entries[i].key.ToString(), subrange->DebugString());
+                subrange->tiny_ranges[tinyrange_id].ninserts++;
+            }
         }
 
         MemTable *table = nullptr;
@@ -2672,21 +3076,46 @@ namespace leveldb {
         uint32_t memtable_id = table->memtableid();
         auto atomic_mem = versions_->mid_table_mapping_[memtable_id];
         atomic_mem->number_of_pending_writes_ += 1;
-        atomic_mem->memtable_size_ += (key.size() + value.size());
-        if (nova::NovaConfig::config->log_record_mode ==
-            nova::NovaLogRecordMode::LOG_RDMA && !options.local_write) {
+        for (size_t i = 0; i < n; i++) {
+            atomic_mem->memtable_size_ += (entries[i].key.size() + entries[i].value.size());
+        }
+        bool log_rdma = nova::NovaConfig::config->log_record_mode ==
+                        nova::NovaLogRecordMode::LOG_RDMA &&
+                        !options.local_write;
+        if (options_.enable_concurrent_memtable_writes) {
+            // The pending write prevents the memtable from becoming
+            // immutable while we insert into it without the lock.
             partition->mutex.Unlock();
-            GenerateLogRecord(options, last_sequence, key, value, memtable_id);
+            if (log_rdma) {
+                GenerateLogRecord(options, entries, n, memtable_id);
+            }
+            for (size_t i = 0; i < n; i++) {
+                const MemTable::BulkEntry &entry = entries[i];
+                table->AddConcurrently(entry.seq, entry.type, entry.key, entry.value);
+                if (lookup_index_) {
+                    lookup_index_->Insert(entry.key, table->memtableid());
+                }
+            }
+            atomic_mem->nentries_ += n;
             partition->mutex.Lock();
+            atomic_mem->number_of_pending_writes_ -= 1;
+        } else {
+            if (log_rdma) {
+                partition->mutex.Unlock();
+                GenerateLogRecord(options, entries, n, memtable_id);
+                partition->mutex.Lock();
+            }
+            for (size_t i = 0; i < n; i++) {
+                const MemTable::BulkEntry &entry = entries[i];
+                table->Add(entry.seq, entry.type, entry.key, entry.value);
+                if (lookup_index_) {
+                    lookup_index_->Insert(entry.key, table->memtableid());
+                }
+            }
+            atomic_mem->number_of_pending_writes_ -= 1;
+            atomic_mem->nentries_ += n;
         }
-        table->Add(last_sequence, ValueType::kTypeValue, key, value);
-        atomic_mem->number_of_pending_writes_ -= 1;
-        versions_->mid_table_mapping_[memtable_id]->nentries_ += 1;
-        if (lookup_index_) {
-            lookup_index_->Insert(key, options.hash, table->memtableid());
-        }
-        if (nova::NovaConfig::config->log_record_mode ==
-            nova::NovaLogRecordMode::LOG_RDMA && !options.local_write) {
+        if (log_rdma || options_.enable_concurrent_memtable_writes) {
             if (atomic_mem->number_of_pending_writes_ == 0 &&
                 atomic_mem->memtable_size_ > options_.write_buffer_size) {
                 // Wake up other threads that are waiting on pending.
@@ -2717,10 +3146,11 @@ namespace leveldb {
     }
 
     Status DBImpl::WriteStaticPartition(const WriteOptions &options,
-                                        const Slice &key, const Slice &val) {
-        uint64_t last_sequence = versions_->last_sequence_.fetch_add(1);
+                                        const Slice &key, const Slice &val,
+                                        ValueType type) {
+        MemTable::BulkEntry entry = {versions_->last_sequence_.fetch_add(1), type, key, val};
         if (options.is_loading_db) {
-            NOVA_ASSERT(WriteStaticPartition(options, key, val, 0, true, last_sequence, nullptr));
+            NOVA_ASSERT(WriteStaticPartition(options, &entry, 1, 0, true, nullptr));
             return Status::OK();
         }
 
@@ -2729,7 +3159,7 @@ namespace leveldb {
             int tries = 2;
             int i = 0;
             while (i < tries) {
-                if (WriteStaticPartition(options, key, val, partition_id, false, last_sequence, nullptr)) {
+                if (WriteStaticPartition(options, &entry, 1, partition_id, false, nullptr)) {
                     return Status::OK();
                 }
                 i++;
@@ -2737,7 +3167,7 @@ namespace leveldb {
             }
         }
         partition_id = (partition_id + 1) % partitioned_active_memtables_.size();
-        NOVA_ASSERT(WriteStaticPartition(options, key, val, partition_id, true, last_sequence, nullptr));
+        NOVA_ASSERT(WriteStaticPartition(options, &entry, 1, partition_id, true, nullptr));
         return Status::OK();
     }
 
@@ -2749,31 +3179,131 @@ namespace leveldb {
 
     Status DBImpl::WriteSubrange(const leveldb::WriteOptions &options,
                                  const leveldb::Slice &key,
-                                 const leveldb::Slice &val) {
-        uint64_t last_sequence = versions_->last_sequence_.fetch_add(1);
+                                 const leveldb::Slice &val,
+                                 ValueType type) {
+        MemTable::BulkEntry entry = {versions_->last_sequence_.fetch_add(1), type, key, val};
+        MaybeScheduleSubRangeReorg(1);
+        SubRange *subrange = nullptr;
+        int subrange_id = subrange_manager_->SearchSubranges(options, key, val,
+                                                             &subrange);
+        NOVA_ASSERT(subrange_id >= 0);
+        NOVA_ASSERT(WriteStaticPartition(options, &entry, 1, subrange_id,
+                                         true,
+                                         subrange));
+        return Status::OK();
+    }
+
+    void DBImpl::MaybeScheduleSubRangeReorg(uint64_t nwrites) {
+        // Wake up the reorg thread when processed_writes_ crosses a multiple
+        // of the interval. processed_writes_ includes the nwrites.
         if (processed_writes_ > SUBRANGE_WARMUP_NPUTS && processed_writes_ < 2*SUBRANGE_WARMUP_NPUTS &&
-            processed_writes_ % SUBRANGE_REORG_INTERVAL == 0 &&
+            processed_writes_ / SUBRANGE_REORG_INTERVAL !=
+            (processed_writes_ - nwrites) / SUBRANGE_REORG_INTERVAL &&
             options_.enable_subrange_reorg) {
             // wake up reorg thread.
             EnvBGTask task = {};
             task.db = this;
             reorg_thread_->Schedule(task);
         }
-        SubRange *subrange = nullptr;
-        int subrange_id = subrange_manager_->SearchSubranges(options, key, val,
-                                                             &subrange);
-        NOVA_ASSERT(subrange_id >= 0);
-        NOVA_ASSERT(WriteStaticPartition(options, key, val, subrange_id,
-                                         true,
-                                         last_sequence,
-                                         subrange));
+    }
+
+    Status DBImpl::Write(const WriteOptions &options, WriteBatch *updates) {
+        struct Collector : public WriteBatch::Handler {
+            std::vector<MemTable::BulkEntry> entries;
+
+            void Put(const Slice &key, const Slice &value) override {
+                entries.push_back({0, ValueType::kTypeValue, key, value});
+            }
+
+            void Delete(const Slice &key) override {
+                entries.push_back({0, ValueType::kTypeDeletion, key, Slice()});
+            }
+        };
+        Collector collector;
+        collector.entries.reserve(WriteBatchInternal::Count(updates));
+        Status s = updates->Iterate(&collector);
+        if (!s.ok() || collector.entries.empty()) {
+            return s;
+        }
+        std::vector<MemTable::BulkEntry> &entries = collector.entries;
+        size_t n = entries.size();
+        if (nova::NovaConfig::config->log_record_mode ==
+            nova::NovaLogRecordMode::LOG_RDMA && !options.local_write) {
+            // A log record is replicated from the RDMA backing memory.
+            for (const auto &entry : entries) {
+                LevelDBLogRecord record = {};
+                record.key = entry.key;
+                record.value = entry.value;
+                if (nova::LogRecordSize(record) > options.rdma_backing_mem_size) {
+                    return Status::InvalidArgument(
+                            "log record exceeds rdma_backing_mem_size",
+                            entry.key);
+                }
+            }
+        }
+        processed_writes_ += n;
+        // The batch takes a contiguous range of sequence numbers.
+        SequenceNumber first_sequence = versions_->last_sequence_.fetch_add(n);
+        WriteBatchInternal::SetSequence(updates, first_sequence);
+        for (size_t i = 0; i < n; i++) {
+            entries[i].seq = first_sequence + i;
+        }
+
+        if (options_.memtable_type != MemTableType::kStaticPartition) {
+            return WriteMemTablePool(options, entries.data(), n);
+        }
+        if (options.is_loading_db || !options_.enable_subranges) {
+            uint32_t partition_id = 0;
+            if (!options.is_loading_db) {
+                partition_id = rand_r(options.rand_seed) % partitioned_active_memtables_.size();
+            }
+            if (!WriteStaticPartition(options, entries.data(), n, partition_id, true, nullptr)) {
+                return Status::IOError("no memtable for partition", std::to_string(partition_id));
+            }
+            return Status::OK();
+        }
+
+        // Group the entries by subrange. Each group takes its partition lock
+        // and replicates its log records once. The groups are not atomic
+        // with respect to each other. See DB::Write.
+        MaybeScheduleSubRangeReorg(n);
+        std::map<int, std::pair<SubRange *, std::vector<MemTable::BulkEntry>>> groups;
+        for (const auto &entry : entries) {
+            SubRange *subrange = nullptr;
+            int subrange_id = subrange_manager_->SearchSubranges(options, entry.key, entry.value,
+                                                                 &subrange);
+            NOVA_ASSERT(subrange_id >= 0);
+            auto &group = groups[subrange_id];
+            group.first = subrange;
+            group.second.push_back(entry);
+        }
+        for (auto &it : groups) {
+            auto &group = it.second;
+            if (!WriteStaticPartition(options, group.second.data(), group.second.size(), it.first,
+                                      true, group.first)) {
+                return Status::IOError("no memtable for subrange", std::to_string(it.first));
+            }
+        }
         return Status::OK();
     }
 
     Status DBImpl::WriteMemTablePool(const WriteOptions &options,
                                      const Slice &key,
                                      const Slice &val) {
-        uint64_t last_sequence = versions_->last_sequence_.fetch_add(1);
+        return WriteMemTablePool(options, key, val, ValueType::kTypeValue);
+    }
+
+    Status DBImpl::WriteMemTablePool(const WriteOptions &options,
+                                     const Slice &key,
+                                     const Slice &val, ValueType type) {
+        MemTable::BulkEntry entry = {versions_->last_sequence_.fetch_add(1), type, key, val};
+        return WriteMemTablePool(options, &entry, 1);
+    }
+
+    Status DBImpl::WriteMemTablePool(const WriteOptions &options,
+                                     const MemTable::BulkEntry *entries,
+                                     size_t n) {
+        const Slice &key = entries[0].key;
 
         std::vector<MemTable *> full_memtables;
         AtomicMemTable *atomic_memtable = nullptr;
@@ -2781,7 +3311,17 @@ namespace leveldb {
         bool all_busy = true;
         bool enable_stickness = true;
 
-        range_lock_.Lock();
+        if (options_.enable_lockfree_memtable_selection) {
+            atomic_memtable = SelectActiveMemTableLockFree(options);
+        }
+        // Fall back to selecting a memtable under range_lock_.
+        bool selected = atomic_memtable != nullptr;
+        if (selected) {
+            number_of_puts_no_wait_.fetch_add(1, std::memory_order_relaxed);
+            number_of_lockfree_memtable_selections_.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            range_lock_.Lock();
+        }
         int expected_share =
                 round(((double) processed_writes_ /
                        (double) options.total_writes) *
@@ -2792,7 +3332,7 @@ namespace leveldb {
         int emptiest_index = 0;
 
         uint32_t atomic_memtable_index = 0;
-        while (true) {
+        while (!selected) {
             emptiest_memtable = nullptr;
             smallest_size = UINT64_MAX;
             emptiest_index = -1;
@@ -2864,6 +3404,7 @@ namespace leveldb {
                         full_memtables.push_back(atomic_memtable->memtable_);
                         closed_memtable_log_files_.push_back(
                                 atomic_memtable->memtable_->memtableid());
+                        RetireActiveMemTable(atomic_memtable);
                         active_memtables_.erase(
                                 active_memtables_.begin() +
                                 atomic_memtable_index);
@@ -2921,6 +3462,7 @@ namespace leveldb {
                         full_memtables.push_back(atomic_memtable->memtable_);
                         closed_memtable_log_files_.push_back(
                                 atomic_memtable->memtable_->memtableid());
+                        RetireActiveMemTable(atomic_memtable);
                         active_memtables_.erase(
                                 active_memtables_.begin() +
                                 atomic_memtable_index);
@@ -2975,6 +3517,7 @@ namespace leveldb {
                 versions_->mid_table_mapping_[memtable_id]->SetMemTable(flush_order_->latest_generation_id, new_table);
                 atomic_memtable = versions_->mid_table_mapping_[memtable_id];
                 active_memtables_.push_back(atomic_memtable);
+                PublishActiveMemTable(atomic_memtable);
 
                 atomic_memtable->mutex_.lock();
                 range_lock_.Unlock();
@@ -3008,6 +3551,7 @@ namespace leveldb {
                                     atomic_memtable->memtable_);
                             closed_memtable_log_files_.push_back(
                                     atomic_memtable->memtable_->memtableid());
+                            RetireActiveMemTable(atomic_memtable);
                             active_memtables_.erase(
                                     active_memtables_.begin() +
                                     emptiest_index);
@@ -3064,7 +3608,9 @@ namespace leveldb {
         NOVA_ASSERT(!atomic_memtable->is_immutable_);
         NOVA_ASSERT(!atomic_memtable->is_flushed_);
         NOVA_ASSERT(atomic_memtable->memtable_);
-        atomic_memtable->memtable_size_ += (key.size() + val.size());
+        for (size_t i = 0; i < n; i++) {
+            atomic_memtable->memtable_size_ += (entries[i].key.size() + entries[i].value.size());
+        }
 
         if (nova::NovaConfig::config->log_record_mode ==
             nova::NovaLogRecordMode::LOG_RDMA && !options.local_write) {
@@ -3072,19 +3618,21 @@ namespace leveldb {
             // Increment the pending writes counter.
             atomic_memtable->number_of_pending_writes_ += 1;
             atomic_memtable->mutex_.unlock();
-            GenerateLogRecord(options, last_sequence, key, val,
+            GenerateLogRecord(options, entries, n,
                               atomic_memtable->memtable_->memtableid());
             atomic_memtable->mutex_.lock();
             atomic_memtable->number_of_pending_writes_ -= 1;
         }
 
-        atomic_memtable->memtable_->Add(last_sequence, ValueType::kTypeValue,
-                                        key, val);
-        atomic_memtable->nentries_ += 1;
-        if (lookup_index_) {
-            lookup_index_->Insert(key, options.hash,
-                                  atomic_memtable->memtable_->memtableid());
+        for (size_t i = 0; i < n; i++) {
+            const MemTable::BulkEntry &entry = entries[i];
+            atomic_memtable->memtable_->Add(entry.seq, entry.type, entry.key, entry.value);
+            if (lookup_index_) {
+                lookup_index_->Insert(entry.key,
+                                      atomic_memtable->memtable_->memtableid());
+            }
         }
+        atomic_memtable->nentries_ += n;
         uint32_t full_memtable_id = 0;
         if (atomic_memtable->number_of_pending_writes_ == 0) {
             if (atomic_memtable->memtable_size_ >
@@ -3106,6 +3654,7 @@ namespace leveldb {
                     full_memtables.push_back(atomic_memtable->memtable_);
                     closed_memtable_log_files_.push_back(
                             atomic_memtable->memtable_->memtableid());
+                    RetireActiveMemTable(atomic_memtable);
                     active_memtables_.erase(
                             active_memtables_.begin() + atomic_memtable_index);
                     number_of_active_memtables_ -= 1;
@@ -3142,10 +3691,51 @@ namespace leveldb {
         }
     }
 
+    void DBImpl::GenerateLogRecord(const WriteOptions &options,
+                                   const MemTable::BulkEntry *entries, size_t n,
+                                   uint32_t memtable_id) {
+        if (n == 1) {
+            GenerateLogRecord(options, entries[0].seq, entries[0].key,
+                              entries[0].value, entries[0].type, memtable_id);
+            return;
+        }
+        if (nova::NovaConfig::config->log_record_mode !=
+            nova::NovaLogRecordMode::LOG_RDMA || options.local_write) {
+            return;
+        }
+        std::vector<LevelDBLogRecord> log_records(n);
+        for (size_t i = 0; i < n; i++) {
+            log_records[i].sequence_number = entries[i].seq;
+            log_records[i].key = entries[i].key;
+            log_records[i].value = entries[i].value;
+            log_records[i].type = entries[i].type;
+        }
+        // Replicate the records in groups that fit into the RDMA backing
+        // memory. DB::Write rejects a record that does not fit alone. The
+        // groups are replicated one after another and are not atomic.
+        std::vector<uint32_t> group_ends;
+        NOVA_ASSERT(nova::SplitLogRecords(log_records,
+                                          options.rdma_backing_mem_size,
+                                          &group_ends));
+        if (group_ends.size() == 1) {
+            GenerateLogRecord(options, log_records, memtable_id);
+            return;
+        }
+        uint32_t start = 0;
+        for (uint32_t end : group_ends) {
+            GenerateLogRecord(options,
+                              std::vector<LevelDBLogRecord>(
+                                      log_records.begin() + start,
+                                      log_records.begin() + end),
+                              memtable_id);
+            start = end;
+        }
+    }
+
     void DBImpl::GenerateLogRecord(const WriteOptions &options,
                                    SequenceNumber last_sequence,
                                    const Slice &key, const Slice &val,
-                                   uint32_t memtable_id) {
+                                   ValueType type, uint32_t memtable_id) {
         if (nova::NovaConfig::config->log_record_mode ==
             nova::NovaLogRecordMode::LOG_RDMA && !options.local_write) {
             auto stoc = reinterpret_cast<leveldb::StoCBlockClient *>(options.stoc_client);
@@ -3154,8 +3744,13 @@ namespace leveldb {
             log_record.sequence_number = last_sequence;
             log_record.key = key;
             log_record.value = val;
+            log_record.type = type;
             NOVA_ASSERT(8 + key.size() + val.size() + 4 + 4 + 1 <=
                         options.rdma_backing_mem_size);
+            if (log_group_commit_) {
+                log_group_commit_->Replicate(options, memtable_id, log_record);
+                return;
+            }
             options.stoc_client->InitiateReplicateLogRecords(
                     nova::LogFileName(dbid_, memtable_id),
                     options.thread_id, dbid_, memtable_id,
@@ -3289,6 +3884,34 @@ namespace leveldb {
             return true;
         } else if (in == "approximate-memory-usage") {
             return true;
+        } else if (in == "log-group-commit") {
+            if (!log_group_commit_) {
+                return false;
+            }
+            LogGroupCommitStats stats = {};
+            log_group_commit_->QueryStats(&stats);
+            *value = stats.DebugString();
+            return true;
+        } else if (in == "block-cache-stats") {
+            *value = db_profiler_->BlockCacheStats();
+            return true;
+        } else if (in == "stoc-load") {
+            *value = StoCLoadTable::global.DebugString();
+            return true;
+        } else if (in == "filter-stats") {
+            if (!options_.filter_stats) {
+                return false;
+            }
+            *value = options_.filter_stats->DebugString();
+            return true;
+        } else if (in == "lookup-index") {
+            if (!lookup_index_) {
+                return false;
+            }
+            LookupIndexStats stats = {};
+            lookup_index_->QueryStats(&stats);
+            *value = stats.DebugString();
+            return true;
         }
 
         return false;
@@ -3354,6 +3977,8 @@ namespace leveldb {
                 impl->versions_->mid_table_mapping_[memtable_id]->SetMemTable(INIT_GEN_ID, new_table);
                 impl->active_memtables_.push_back(
                         impl->versions_->mid_table_mapping_[memtable_id]);
+                impl->PublishActiveMemTable(
+                        impl->versions_->mid_table_mapping_[memtable_id]);
                 NOVA_ASSERT(
                         options.memtable_pool->num_available_memtables_ >= 1);
                 options.memtable_pool->num_available_memtables_ -= 1;
@@ -36,6 +36,10 @@
 #include "range_index.h"
 
 #include "log/log_recovery.h"
+#include "log/log_group_commit.h"
+
+#define MAX_ACTIVE_MEMTABLE_SLOTS 64
+#define LOCKFREE_MEMTABLE_SELECTION_RETRIES 3
 
 namespace leveldb {
 
@@ -75,20 +79,30 @@ namespace leveldb {
 
         Status Delete(const WriteOptions &, const Slice &key) override;
 
+        Status Write(const WriteOptions &options, WriteBatch *updates) override;
+
         Status WriteMemTablePool(const WriteOptions &options, const Slice &key,
                                  const Slice &val) override;
 
+        Status WriteMemTablePool(const WriteOptions &options, const Slice &key,
+                                 const Slice &val, ValueType type);
+
         Status WriteStaticPartition(const WriteOptions &options,
                                     const Slice &key,
-                                    const Slice &val);
+                                    const Slice &val, ValueType type);
 
         Status WriteSubrange(const WriteOptions &options,
                              const Slice &key,
-                             const Slice &val);
+                             const Slice &val, ValueType type);
 
         Status Get(const ReadOptions &options, const Slice &key,
                    std::string *value) override;
 
+        Status MultiGet(const ReadOptions &options,
+                        const std::vector<Slice> &keys,
+                        std::vector<std::string> *values,
+                        std::vector<Status> *statuses) override;
+
         void TestCompact(EnvBGThread *bg_thread,
                          const std::vector<EnvBGTask> &tasks) override;
 
@@ -126,7 +140,7 @@ namespace leveldb {
         void GenerateLogRecord(const WriteOptions &options,
                                SequenceNumber last_sequence,
                                const Slice &key, const Slice &val,
-                               uint32_t memtable_id);
+                               ValueType type, uint32_t memtable_id);
 
         void GenerateLogRecord(const WriteOptions &options,
                                const std::vector<LevelDBLogRecord> &log_records,
@@ -145,13 +159,26 @@ namespace leveldb {
 
         const std::string &dbname() override;
 
-        uint32_t EncodeDBMetadata(char *buf, nova::StoCInMemoryLogFileManager *log_manager, uint32_t cfg_id);
+        // Encode the metadata of the database except the lookup index. The
+        // entries of the lookup index of the same snapshot are exported to
+        // "lookup_index_entries" and sent by EncodeLookupIndexChunk.
+        uint32_t EncodeDBMetadata(char *buf, nova::StoCInMemoryLogFileManager *log_manager, uint32_t cfg_id,
+                                  std::vector<uint64_t> *lookup_index_entries);
 
         void
         RecoverDBMetadata(const Slice &buf, uint32_t version_id, uint64_t last_sequence, uint64_t next_file_number,
                           uint64_t memtable_id_seq, nova::StoCInMemoryLogFileManager *log_manager,
                           std::unordered_map<uint32_t, leveldb::MemTableLogFilePair> *mid_table_map);
 
+        // Encode lookup index entries[*next, ...) into a migration message
+        // of at most "max_size" bytes and advance *next. Returns 0 if the
+        // database has no lookup index.
+        uint32_t EncodeLookupIndexChunk(char *buf, uint32_t max_size, uint32_t cfg_id,
+                                        const std::vector<uint64_t> &lookup_index_entries, uint64_t *next);
+
+        // Gets use the range index until the last chunk is recovered.
+        void RecoverLookupIndexChunk(Slice *buf, bool last);
+
         void ScheduleFlushMemTableTask(
                 int thread_id,
                 uint32_t memtable_id,
@@ -181,6 +208,17 @@ namespace leveldb {
         Status GetWithRangeIndex(const ReadOptions &options, const Slice &key,
                                  std::string *value);
 
+        // Search all memtables and SSTables for a key whose lookup index
+        // entry is stale.
+        Status GetFromAllTables(const ReadOptions &options, const Slice &key,
+                                std::string *value);
+
+        // Read the uncached data blocks of the keys in "order" into the block
+        // cache in parallel.
+        void PrefetchDataBlocks(const ReadOptions &options,
+                                const std::vector<Slice> &keys,
+                                const std::vector<uint32_t> &order);
+
         std::atomic_bool start_compaction_;
         std::atomic_bool start_coordinated_compaction_;
         std::atomic_bool terminate_coordinated_compaction_;
@@ -193,12 +231,18 @@ namespace leveldb {
                                   uint32_t compacting_version_id);
 
         bool ComputeCompactions(Version *current,
+                                SequenceNumber smallest_unflushed_sequence,
                                 std::vector<Compaction *> *compactions,
                                 VersionEdit *edit,
                                 RangeIndexVersionEdit *range_edit,
                                 bool *delete_due_to_low_overlap,
                                 std::unordered_map<uint32_t, leveldb::MemTableL0FilesEdit> *memtableid_l0fns);
 
+        // Smallest sequence number of the memtables that are not flushed.
+        // REQUIRES: mutex_ is held so that the entries of a flushed
+        // memtable are in the current version.
+        SequenceNumber SmallestUnflushedSequence();
+
         class NovaCCRecoveryThread {
         public:
             NovaCCRecoveryThread(
@@ -243,6 +287,18 @@ namespace leveldb {
 
         void StealMemTable(const WriteOptions &options);
 
+        // Lock-free selection of an active memtable in the memtable pool.
+        // Returns a memtable with its mutex held or nullptr if the caller
+        // should fall back to selecting a memtable under range_lock_.
+        AtomicMemTable *SelectActiveMemTableLockFree(const WriteOptions &options);
+
+        // Make the active memtable visible to lock-free selection.
+        // REQUIRES: range_lock_ is held.
+        void PublishActiveMemTable(AtomicMemTable *memtable);
+
+        // Remove the memtable from lock-free selection.
+        void RetireActiveMemTable(AtomicMemTable *memtable);
+
         // Information for a manual compaction
         struct ManualCompaction {
             int level;
@@ -335,12 +391,24 @@ namespace leveldb {
 
         SubRangeManager *subrange_manager_ = nullptr;
 
+        // Group commit of log records. Null if disabled.
+        LogGroupCommit *log_group_commit_ = nullptr;
+
         // key -> memtable-id.
         LookupIndex *lookup_index_ = nullptr;
+        // False while the lookup index of a migrated database is streamed
+        // in. Memtables flushed meanwhile are marked obsolete once it is
+        // complete so that a late entry cannot replace a newer one.
+        std::atomic_bool lookup_index_complete_{true};
+        port::Mutex lookup_index_migration_mutex_;
+        std::vector<uint32_t> pending_obsolete_mids_;
         RangeIndexManager *range_index_manager_ = nullptr;
 
         // memtable pool.
         std::vector<AtomicMemTable *> active_memtables_;
+        // Active memtables published for lock-free selection. A writer
+        // prefers the slot of its thread id.
+        std::atomic<AtomicMemTable *> active_memtable_slots_[MAX_ACTIVE_MEMTABLE_SLOTS];
         // partitioned memtables.
         std::vector<MemTablePartition *> partitioned_active_memtables_ GUARDED_BY(mutex_);
         std::vector<uint32_t> partitioned_imms_ GUARDED_BY(mutex_);  // Memtable being compacted
@@ -366,13 +434,30 @@ namespace leveldb {
         std::string current_log_file_name_ GUARDED_BY(mutex_);
         std::vector<uint32_t> closed_memtable_log_files_  GUARDED_BY(range_lock_);
 
+        // Insert a value or a deletion of "key" into the memtable partition.
+        Status WriteEntry(const WriteOptions &options, const Slice &key,
+                          const Slice &val, ValueType type);
+
+        // Insert "n" entries with assigned sequence numbers into the active
+        // memtable of a partition. The entries are replicated as one set of
+        // log records.
         bool WriteStaticPartition(const leveldb::WriteOptions &options,
-                                  const leveldb::Slice &key,
-                                  const leveldb::Slice &value,
+                                  const MemTable::BulkEntry *entries,
+                                  size_t n,
                                   uint32_t partition_id,
-                                  bool should_wait, uint64_t last_sequence,
+                                  bool should_wait,
                                   SubRange *subrange);
 
+        Status WriteMemTablePool(const WriteOptions &options,
+                                 const MemTable::BulkEntry *entries,
+                                 size_t n);
+
+        void GenerateLogRecord(const WriteOptions &options,
+                               const MemTable::BulkEntry *entries, size_t n,
+                               uint32_t memtable_id);
+
+        void MaybeScheduleSubRangeReorg(uint64_t nwrites);
+
         StoCWritableFileClient *manifest_file_ = nullptr;
         unsigned int rand_seed_ = 0;
     };
@@ -185,7 +185,7 @@ namespace leveldb {
                 SaveKey(ikey, &saved_ikey_);
                 uint64_t key = 0;
                 Slice ukey = ExtractUserKey(ikey);
-                nova::str_to_int(ukey.data(), &key, ukey.size());
+                key = nova::user_key_to_int(ukey.data(), ukey.size());
                 if (key == range_partition_.key_end - 1) {
 //                    NOVA_LOG(rdmaio::INFO)
 //                        << fmt::format("Stop iterating since reaching the end of range partition {}:{}:{}",
@@ -50,6 +50,16 @@ namespace leveldb {
         for (auto &guide : guides) {
             msg_size += guide->Encode(sendbuf + msg_size);
         }
+        sendbuf[msg_size] = drop_obsolete_deletions ? 1 : 0;
+        msg_size += 1;
+        msg_size += leveldb::EncodeFixed32(sendbuf + msg_size,
+                                           deeper_ranges.size());
+        for (const auto &range : deeper_ranges) {
+            msg_size += EncodeStr(sendbuf + msg_size, range.first);
+            msg_size += EncodeStr(sendbuf + msg_size, range.second);
+        }
+        msg_size += leveldb::EncodeFixed64(sendbuf + msg_size,
+                                           smallest_unflushed_sequence);
         msg_size += leveldb::EncodeFixed32(sendbuf + msg_size,
                                            subranges.size());
         for (int i = 0; i < subranges.size(); i++) {
@@ -85,6 +95,18 @@ namespace leveldb {
             NOVA_ASSERT(meta->Decode(&input, false));
             guides.push_back(meta);
         }
+        NOVA_ASSERT(!input.empty());
+        drop_obsolete_deletions = input[0] == 1;
+        input.remove_prefix(1);
+        uint32_t num_deeper_ranges = 0;
+        NOVA_ASSERT(DecodeFixed32(&input, &num_deeper_ranges));
+        for (int i = 0; i < num_deeper_ranges; i++) {
+            std::pair<std::string, std::string> range;
+            NOVA_ASSERT(DecodeStr(&input, &range.first));
+            NOVA_ASSERT(DecodeStr(&input, &range.second));
+            deeper_ranges.push_back(std::move(range));
+        }
+        NOVA_ASSERT(DecodeFixed64(&input, &smallest_unflushed_sequence));
         NOVA_ASSERT(DecodeFixed32(&input, &num_subranges));
         for (int i = 0; i < num_subranges; i++) {
             SubRange sr = {};
@@ -132,8 +154,13 @@ namespace leveldb {
                 msg_size += StoCBlockHandle::HandleSize();
             }
         }
-        parity_block_handle.EncodeHandle(dst + msg_size);
-        msg_size += StoCBlockHandle::HandleSize();
+        msg_size += EncodeFixed32(dst + msg_size, parity_block_handles.size());
+        for (auto &handle : parity_block_handles) {
+            handle.EncodeHandle(dst + msg_size);
+            msg_size += StoCBlockHandle::HandleSize();
+        }
+        msg_size += EncodeFixed64(dst + msg_size, num_entries);
+        msg_size += EncodeFixed64(dst + msg_size, num_deletions);
         return msg_size;
     }
 
@@ -189,7 +216,9 @@ namespace leveldb {
                GetInternalKey(input, &largest, copy) &&
                DecodeFixed64(input, &flush_timestamp) &&
                DecodeFixed32(input, &level) && DecodeMemTableIds(input) && DecodeReplicas(input) &&
-               StoCBlockHandle::DecodeHandle(input, &parity_block_handle);
+               StoCBlockHandle::DecodeHandles(input, &parity_block_handles) &&
+               DecodeFixed64(input, &num_entries) &&
+               DecodeFixed64(input, &num_deletions);
     }
 
     uint32_t ReplicationPair::Encode(char *buf) const {
@@ -243,13 +272,20 @@ namespace leveldb {
         if (block_replica_handles.size() == 1) {
             return 0;
         }
+        // Pick the least loaded replica on an available StoC.
         int replica_id = -1;
+        double best_score = 0;
+        uint64_t now_us = StoCLoadTable::NowMicros();
         auto servers = leveldb::StorageSelector::available_stoc_servers.load();
         for (int i = 0; i < block_replica_handles.size(); i++) {
-            if (servers->server_ids.find(block_replica_handles[i].meta_block_handle.server_id) !=
-                servers->server_ids.end()) {
+            uint32_t server_id = block_replica_handles[i].meta_block_handle.server_id;
+            if (servers->server_ids.find(server_id) == servers->server_ids.end()) {
+                continue;
+            }
+            double score = StoCLoadTable::global.Score(server_id, now_us);
+            if (replica_id == -1 || score < best_score) {
                 replica_id = i;
-                break;
+                best_score = score;
             }
         }
         NOVA_ASSERT(replica_id != -1);
@@ -295,6 +331,10 @@ namespace leveldb {
         AppendNumberTo(&r, flush_timestamp);
         r.append(" level:");
         AppendNumberTo(&r, level);
+        r.append(" entries:");
+        AppendNumberTo(&r, num_entries);
+        r.append(" deletions:");
+        AppendNumberTo(&r, num_deletions);
         r.append(" replicas:");
         for (int i = 0; i < block_replica_handles.size(); i++) {
             r.append(fmt::format("r[{}]: m-{} d-", i,
@@ -305,7 +345,10 @@ namespace leveldb {
             }
         }
         r.append(" parity:");
-        r.append(parity_block_handle.DebugString());
+        for (auto &parity : parity_block_handles) {
+            r.append(parity.DebugString());
+            r.append(" ");
+        }
         return r;
     }
 
@@ -450,6 +493,17 @@ namespace leveldb {
         user_policy_->CreateFilter(keys, n, dst);
     }
 
+    void InternalFilterPolicy::CreateFilterWithBitsPerKey(const Slice *keys,
+                                                          int n,
+                                                          int bits_per_key,
+                                                          std::string *dst) const {
+        Slice *mkey = const_cast<Slice *>(keys);
+        for (int i = 0; i < n; i++) {
+            mkey[i] = ExtractUserKey(keys[i]);
+        }
+        user_policy_->CreateFilterWithBitsPerKey(keys, n, bits_per_key, dst);
+    }
+
     bool
     InternalFilterPolicy::KeyMayMatch(const Slice &key, const Slice &f) const {
         return user_policy_->KeyMayMatch(ExtractUserKey(key), f);
@@ -88,6 +88,13 @@ namespace leveldb {
         return Slice(internal_key.data(), internal_key.size() - 8);
     }
 
+// Returns the value type of an internal key.
+    inline ValueType ExtractValueType(const Slice &internal_key) {
+        assert(internal_key.size() >= 8);
+        uint64_t num = DecodeFixed64(internal_key.data() + internal_key.size() - 8);
+        return static_cast<ValueType>(num & 0xff);
+    }
+
 // A comparator for internal keys that uses a specified comparator for
 // the user key portion and breaks ties by decreasing sequence number.
     class InternalKeyComparator : public Comparator {
@@ -126,6 +133,10 @@ namespace leveldb {
         void
         CreateFilter(const Slice *keys, int n, std::string *dst) const override;
 
+        void CreateFilterWithBitsPerKey(const Slice *keys, int n,
+                                        int bits_per_key,
+                                        std::string *dst) const override;
+
         bool KeyMayMatch(const Slice &key, const Slice &filter) const override;
     };
 
@@ -0,0 +1,109 @@
+//
+// Copyright (c) 2020 University of Southern California. All rights reserved.
+//
+
+#include "l0_interval_index.h"
+
+#include <algorithm>
+
+namespace leveldb {
+    L0IntervalIndex::L0IntervalIndex(const Comparator *ucmp,
+                                     const std::vector<FileMetaData *> &files)
+            : ucmp_(ucmp), files_(files) {
+        std::vector<uint32_t> positions(files.size());
+        for (uint32_t i = 0; i < files.size(); i++) {
+            positions[i] = i;
+            numbers_.emplace_back(files[i]->number, i);
+        }
+        std::sort(numbers_.begin(), numbers_.end());
+        std::sort(positions.begin(), positions.end(),
+                  [&](uint32_t a, uint32_t b) {
+                      return ucmp_->Compare(smallest(a), smallest(b)) < 0;
+                  });
+        by_smallest_.reserve(files.size());
+        by_largest_.reserve(files.size());
+        root_ = Build(positions);
+    }
+
+    int L0IntervalIndex::Build(const std::vector<uint32_t> &positions) {
+        if (positions.empty()) {
+            return -1;
+        }
+        // The median smallest key. The median file contains it, so both
+        // subtrees have at most half of the files.
+        Slice center = smallest(positions[positions.size() / 2]);
+        std::vector<uint32_t> left;
+        std::vector<uint32_t> right;
+        Node node;
+        node.center = center;
+        node.begin = by_smallest_.size();
+        for (uint32_t pos : positions) {
+            if (ucmp_->Compare(largest(pos), center) < 0) {
+                left.push_back(pos);
+            } else if (ucmp_->Compare(smallest(pos), center) > 0) {
+                right.push_back(pos);
+            } else {
+                by_smallest_.push_back(pos);
+            }
+        }
+        node.end = by_smallest_.size();
+        by_largest_.insert(by_largest_.end(), by_smallest_.begin() + node.begin,
+                           by_smallest_.end());
+        std::sort(by_largest_.begin() + node.begin, by_largest_.end(),
+                  [&](uint32_t a, uint32_t b) {
+                      return ucmp_->Compare(largest(a), largest(b)) > 0;
+                  });
+        int id = nodes_.size();
+        nodes_.push_back(node);
+        // Both subtrees remain sorted by smallest key.
+        int l = Build(left);
+        int r = Build(right);
+        nodes_[id].left = l;
+        nodes_[id].right = r;
+        return id;
+    }
+
+    void L0IntervalIndex::Overlapping(const Slice &user_key,
+                                      std::vector<uint32_t> *positions) const {
+        size_t start = positions->size();
+        int id = root_;
+        while (id != -1) {
+            const Node &node = nodes_[id];
+            int c = ucmp_->Compare(user_key, node.center);
+            if (c < 0) {
+                // All files of the node end at or after the key.
+                for (uint32_t i = node.begin; i < node.end; i++) {
+                    if (ucmp_->Compare(smallest(by_smallest_[i]), user_key) > 0) {
+                        break;
+                    }
+                    positions->push_back(by_smallest_[i]);
+                }
+                id = node.left;
+            } else if (c > 0) {
+                // All files of the node start at or before the key.
+                for (uint32_t i = node.begin; i < node.end; i++) {
+                    if (ucmp_->Compare(largest(by_largest_[i]), user_key) < 0) {
+                        break;
+                    }
+                    positions->push_back(by_largest_[i]);
+                }
+                id = node.right;
+            } else {
+                positions->insert(positions->end(),
+                                  by_smallest_.begin() + node.begin,
+                                  by_smallest_.begin() + node.end);
+                break;
+            }
+        }
+        std::sort(positions->begin() + start, positions->end());
+    }
+
+    int L0IntervalIndex::Position(uint64_t fn) const {
+        auto it = std::lower_bound(numbers_.begin(), numbers_.end(),
+                                   std::make_pair(fn, (uint32_t) 0));
+        if (it == numbers_.end() || it->first != fn) {
+            return -1;
+        }
+        return it->second;
+    }
+}
@@ -0,0 +1,72 @@
+//
+// Copyright (c) 2020 University of Southern California. All rights reserved.
+//
+// An interval tree over the user key ranges of the L0 SSTables of a version.
+// It returns the files that contain a key in O(log n + k) comparisons
+// instead of comparing the key with the boundaries of every L0 file.
+
+#ifndef LEVELDB_L0_INTERVAL_INDEX_H
+#define LEVELDB_L0_INTERVAL_INDEX_H
+
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+#include "leveldb/comparator.h"
+#include "leveldb/db_types.h"
+#include "leveldb/slice.h"
+
+namespace leveldb {
+    class L0IntervalIndex {
+    public:
+        // "files" must outlive the index.
+        L0IntervalIndex(const Comparator *ucmp,
+                        const std::vector<FileMetaData *> &files);
+
+        // Append the positions in "files" of the files whose key range
+        // contains "user_key" to *positions in ascending order.
+        void Overlapping(const Slice &user_key,
+                         std::vector<uint32_t> *positions) const;
+
+        // Returns the position of file "fn" in "files" or -1.
+        int Position(uint64_t fn) const;
+
+    private:
+        // The files in the node contain "center". Files that end before it
+        // are in the left subtree and files that start after it are in the
+        // right subtree.
+        struct Node {
+            Slice center;
+            // The files of the node are by_smallest_[begin, end) and
+            // by_largest_[begin, end).
+            uint32_t begin = 0;
+            uint32_t end = 0;
+            int left = -1;
+            int right = -1;
+        };
+
+        // "positions" is sorted by smallest key.
+        int Build(const std::vector<uint32_t> &positions);
+
+        const Slice smallest(uint32_t pos) const {
+            return files_[pos]->smallest.user_key();
+        }
+
+        const Slice largest(uint32_t pos) const {
+            return files_[pos]->largest.user_key();
+        }
+
+        const Comparator *ucmp_;
+        const std::vector<FileMetaData *> &files_;
+        std::vector<Node> nodes_;
+        // Sorted by smallest key ascending within a node.
+        std::vector<uint32_t> by_smallest_;
+        // Sorted by largest key descending within a node.
+        std::vector<uint32_t> by_largest_;
+        int root_ = -1;
+        // (file number, position) sorted by file number.
+        std::vector<std::pair<uint64_t, uint32_t>> numbers_;
+    };
+}
+
+#endif //LEVELDB_L0_INTERVAL_INDEX_H
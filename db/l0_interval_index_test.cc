@@ -0,0 +1,122 @@
+//
+// Copyright (c) 2020 University of Southern California. All rights reserved.
+//
+
+#include "db/l0_interval_index.h"
+#include "db/version_set.h"
+#include "ltc/db_helper.h"
+#include "ltc/storage_selector.h"
+#include "util/random.h"
+#include "util/testharness.h"
+
+namespace leveldb {
+
+    class L0IntervalIndexTest {
+    public:
+        L0IntervalIndexTest() : icmp_(new YCSBKeyComparator) {
+            options_.level = 2;
+            version_ = new Version(&icmp_, nullptr, &options_, 1, nullptr);
+        }
+
+        void CreateFileMetaData(int level, int smallest, int largest) {
+            FileMetaData *f = new FileMetaData();
+            f->number = fn_++;
+            f->smallest = InternalKey(std::to_string(smallest), seq_id_++,
+                                      ValueType::kTypeValue);
+            f->largest = InternalKey(std::to_string(largest), seq_id_++,
+                                     ValueType::kTypeValue);
+            version_->files_[level].push_back(f);
+            version_->fn_files_[f->number] = f;
+        }
+
+        // The L0 files that contain "key" in L0 order.
+        std::vector<FileMetaData *> LinearScan(const std::string &key) {
+            const Comparator *ucmp = icmp_.user_comparator();
+            std::vector<FileMetaData *> files;
+            for (FileMetaData *f : version_->files_[0]) {
+                if (ucmp->Compare(key, f->smallest.user_key()) >= 0 &&
+                    ucmp->Compare(key, f->largest.user_key()) <= 0) {
+                    files.push_back(f);
+                }
+            }
+            return files;
+        }
+
+        // Compare the index with a linear scan of L0 for "key".
+        void Check(const std::string &key) {
+            std::vector<FileMetaData *> expected = LinearScan(key);
+            std::vector<uint32_t> positions;
+            version_->l0_index()->Overlapping(key, &positions);
+            ASSERT_EQ(expected.size(), positions.size());
+            for (int i = 0; i < expected.size(); i++) {
+                ASSERT_EQ(expected[i], version_->files_[0][positions[i]]);
+            }
+
+            LookupKey lkey(key, kMaxSequenceNumber);
+            std::vector<std::pair<int, FileMetaData *>> files;
+            version_->AddCandidateFiles(lkey.user_key(), lkey.internal_key(),
+                                        GetSearchScope::kAllLevels, &files);
+            ASSERT_EQ(expected.size(), files.size());
+            for (int i = 0; i < expected.size(); i++) {
+                ASSERT_EQ(0, files[i].first);
+                ASSERT_EQ(expected[i], files[i].second);
+            }
+        }
+
+        InternalKeyComparator icmp_;
+        Options options_;
+        Version *version_ = nullptr;
+        uint32_t fn_ = 0;
+        uint32_t seq_id_ = 0;
+    };
+
+    TEST(L0IntervalIndexTest, Empty) {
+        Check("10");
+        ASSERT_EQ(-1, version_->l0_index()->Position(0));
+    }
+
+    TEST(L0IntervalIndexTest, Boundaries) {
+        CreateFileMetaData(0, 10, 20);
+        CreateFileMetaData(0, 15, 30);
+        CreateFileMetaData(0, 30, 40);
+        CreateFileMetaData(0, 50, 50);
+        for (int key = 0; key <= 60; key++) {
+            Check(std::to_string(key));
+        }
+    }
+
+    // Hundreds of wide, overlapping L0 files.
+    TEST(L0IntervalIndexTest, WideFiles) {
+        const int kFiles = 500;
+        const int kKeys = 1000000;
+        Random rnd(301);
+        for (int i = 0; i < kFiles; i++) {
+            int smallest = rnd.Uniform(kKeys);
+            CreateFileMetaData(0, smallest, smallest + rnd.Uniform(kKeys / 10));
+        }
+        for (int i = 0; i < 1000; i++) {
+            Check(std::to_string(rnd.Uniform(kKeys + kKeys / 10)));
+        }
+        for (FileMetaData *f : version_->files_[0]) {
+            ASSERT_EQ(f, version_->files_[0][version_->l0_index()->Position(
+                    f->number)]);
+        }
+        ASSERT_EQ(-1, version_->l0_index()->Position(kFiles));
+    }
+}  // namespace leveldb
+
+using namespace nova;
+
+NovaConfig *NovaConfig::config;
+std::atomic_int_fast32_t leveldb::EnvBGThread::bg_flush_memtable_thread_id_seq;
+std::atomic_int_fast32_t nova::RDMAServerImpl::bg_storage_worker_seq_id_;
+std::atomic_int_fast32_t leveldb::StoCBlockClient::rdma_worker_seq_id_;
+std::unordered_map<uint64_t, leveldb::FileMetaData *> leveldb::Version::last_fnfile;
+nova::NovaGlobalVariables nova::NovaGlobalVariables::global;
+std::atomic<nova::Servers *> leveldb::StorageSelector::available_stoc_servers;
+std::atomic_int_fast32_t leveldb::StorageSelector::stoc_for_compaction_seq_id;
+
+int main(int argc, char **argv) {
+    NovaConfig::config = new NovaConfig;
+    return leveldb::test::RunAllTests();
+}
@@ -0,0 +1,81 @@
+//
+// Copyright (c) 2020 University of Southern California. All rights reserved.
+//
+
+#include "common/nova_common.h"
+
+#include "util/testharness.h"
+
+namespace leveldb {
+
+    class LogRecordsTest {
+    public:
+        // Add a record whose encoded size is "size".
+        void Add(uint32_t size) {
+            keys_.emplace_back(size - nova::LogRecordSize({}), 'k');
+            LevelDBLogRecord record = {};
+            record.sequence_number = records_.size();
+            records_.push_back(record);
+        }
+
+        void Finish() {
+            // Slices must point to the final strings.
+            for (uint32_t i = 0; i < records_.size(); i++) {
+                records_[i].key = keys_[i];
+            }
+        }
+
+        std::vector<std::string> keys_;
+        std::vector<LevelDBLogRecord> records_;
+        std::vector<uint32_t> ends_;
+    };
+
+    TEST(LogRecordsTest, Empty) {
+        ASSERT_TRUE(nova::SplitLogRecords(records_, 100, &ends_));
+        ASSERT_EQ(0, ends_.size());
+    }
+
+    TEST(LogRecordsTest, OneGroup) {
+        for (int i = 0; i < 4; i++) {
+            Add(25);
+        }
+        Finish();
+        ASSERT_TRUE(nova::SplitLogRecords(records_, 100, &ends_));
+        ASSERT_EQ(1, ends_.size());
+        ASSERT_EQ(4, ends_[0]);
+    }
+
+    TEST(LogRecordsTest, SplitAtLimit) {
+        Add(40);
+        Add(40);
+        Add(40);
+        // Fills the second group exactly.
+        Add(60);
+        Add(30);
+        Finish();
+        ASSERT_TRUE(nova::SplitLogRecords(records_, 100, &ends_));
+        ASSERT_EQ(3, ends_.size());
+        ASSERT_EQ(2, ends_[0]);
+        ASSERT_EQ(4, ends_[1]);
+        ASSERT_EQ(5, ends_[2]);
+        // Each group fits.
+        uint32_t start = 0;
+        for (uint32_t end : ends_) {
+            std::vector<LevelDBLogRecord> group(records_.begin() + start,
+                                                records_.begin() + end);
+            ASSERT_LE(nova::LogRecordsSize(group), 100);
+            start = end;
+        }
+    }
+
+    TEST(LogRecordsTest, RecordTooLarge) {
+        Add(40);
+        Add(101);
+        Finish();
+        ASSERT_TRUE(!nova::SplitLogRecords(records_, 100, &ends_));
+    }
+}  // namespace leveldb
+
+nova::NovaGlobalVariables nova::NovaGlobalVariables::global;
+
+int main(int argc, char **argv) { return leveldb::test::RunAllTests(); }
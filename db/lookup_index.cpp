@@ -6,59 +6,410 @@
 
 #include "lookup_index.h"
 
+#include <algorithm>
 #include <fmt/core.h>
 #include "common/nova_console_logging.h"
 #include "util/coding.h"
+#include "util/hash.h"
 
 namespace leveldb {
 
-    LookupIndex::LookupIndex(uint32_t size) : size_(size) {
-        table_locator_ = new TableLocation[size_];
+    namespace {
+        uint64_t NextPowerOfTwo(uint64_t n) {
+            uint64_t p = 1;
+            while (p < n) {
+                p <<= 1;
+            }
+            return p;
+        }
+    }
+
+    std::string LookupIndexStats::DebugString() const {
+        double bytes_per_entry = 0;
+        double hit_rate = 0;
+        double false_positive_rate = 0;
+        if (nentries > 0) {
+            bytes_per_entry = (double) memory_bytes / (double) nentries;
+        }
+        if (nlookups > 0) {
+            hit_rate = (double) nhits / (double) nlookups;
+        }
+        if (nhits > 0) {
+            false_positive_rate = (double) nfalse_positives / (double) nhits;
+        }
+        return fmt::format("{},{},{},{},{:.2f},{},{},{:.4f},{},{:.6f},{},{}",
+                           nslots, nentries, ntombstones, memory_bytes,
+                           bytes_per_entry, nlookups, nhits, hit_rate,
+                           nfalse_positives, false_positive_rate, nresizes,
+                           ngc_entries);
+    }
+
+    LookupIndex::LookupIndex(uint32_t size) {
+        uint64_t nbuckets = NextPowerOfTwo(
+                (size + kNumSegments * kSlotsPerBucket - 1) /
+                (kNumSegments * kSlotsPerBucket));
+        for (int i = 0; i < kNumSegments; i++) {
+            Segment &segment = segments_[i];
+            segment.buckets = new Bucket[nbuckets];
+            segment.nbuckets = nbuckets;
+            segment.nused = 0;
+            segment.ntombstones = 0;
+            for (uint64_t b = 0; b < nbuckets; b++) {
+                for (int s = 0; s < kSlotsPerBucket; s++) {
+                    segment.buckets[b].slots[s] = kEmptySlot;
+                }
+            }
+        }
+        nlookups_ = 0;
+        nhits_ = 0;
+        nfalse_positives_ = 0;
+        nresizes_ = 0;
+        ngc_entries_ = 0;
         NOVA_LOG(rdmaio::INFO)
-            << fmt::format("Create lookup index of size {}", size);
+            << fmt::format("Create lookup index of size {} with {} slots",
+                           size,
+                           nbuckets * kSlotsPerBucket * kNumSegments);
+    }
+
+    LookupIndex::~LookupIndex() {
+        for (int i = 0; i < kNumSegments; i++) {
+            delete[] segments_[i].buckets;
+        }
     }
 
-    uint64_t LookupIndex::Lookup(const leveldb::Slice &key, uint64_t hash) {
-//        NOVA_ASSERT(hash >= 0 && hash <= size_);
-        TableLocation &loc = table_locator_[hash % size_];
-        return loc.memtable_id.load();
+    uint64_t LookupIndex::Tag(const leveldb::Slice &key) {
+        uint64_t hash =
+                ((uint64_t) Hash(key.data(), key.size(), 0xbc9f1d34) << 32) |
+                Hash(key.data(), key.size(), 0x9ae16a3b);
+        uint64_t tag = hash >> kMemTableIdBits;
+        if (tag == 0) {
+            tag = 1;
+        }
+        return tag;
+    }
+
+    uint32_t LookupIndex::Lookup(const leveldb::Slice &key) {
+        uint64_t tag = Tag(key);
+        Segment *segment = GetSegment(tag);
+        uint32_t memtableid = 0;
+        nlookups_.fetch_add(1, std::memory_order_relaxed);
+
+        std::shared_lock<std::shared_mutex> lock(segment->mutex);
+        uint64_t mask = segment->nbuckets - 1;
+        for (uint64_t p = 0; p < segment->nbuckets; p++) {
+            Bucket &bucket = segment->buckets[(tag + p) & mask];
+            for (int i = 0; i < kSlotsPerBucket; i++) {
+                uint64_t slot = bucket.slots[i].load(std::memory_order_acquire);
+                if (slot == kEmptySlot) {
+                    return 0;
+                }
+                if ((slot >> kMemTableIdBits) == tag) {
+                    memtableid = slot & kTombstone;
+                    nhits_.fetch_add(1, std::memory_order_relaxed);
+                    return memtableid;
+                }
+            }
+        }
+        return 0;
+    }
+
+    bool LookupIndex::TryInsert(Segment *segment, uint64_t tag,
+                                uint32_t memtableid, bool overwrite) {
+        uint64_t value = (tag << kMemTableIdBits) | memtableid;
+        uint64_t mask = segment->nbuckets - 1;
+        uint64_t max_used = segment->nbuckets * kSlotsPerBucket * 3 / 4;
+        uint64_t nprobes = std::min((uint64_t) kMaxProbeBuckets,
+                                    segment->nbuckets);
+        // A key is always placed before the first empty slot of its probe
+        // sequence. Tombstones are reclaimed by Resize.
+        for (uint64_t p = 0; p < nprobes; p++) {
+            Bucket &bucket = segment->buckets[(tag + p) & mask];
+            for (int i = 0; i < kSlotsPerBucket; i++) {
+                std::atomic<uint64_t> &slot = bucket.slots[i];
+                uint64_t current = slot.load(std::memory_order_acquire);
+                while (true) {
+                    if (current == kEmptySlot) {
+                        if (segment->nused.load(std::memory_order_relaxed) >=
+                            max_used) {
+                            return false;
+                        }
+                        if (slot.compare_exchange_strong(current, value)) {
+                            segment->nused.fetch_add(1);
+                            return true;
+                        }
+                        // Another writer claimed the slot. Check it again.
+                        continue;
+                    }
+                    if ((current >> kMemTableIdBits) == tag) {
+                        if (!overwrite) {
+                            return true;
+                        }
+                        if (slot.compare_exchange_strong(current, value)) {
+                            return true;
+                        }
+                        continue;
+                    }
+                    break;
+                }
+            }
+        }
+        return false;
+    }
+
+    void LookupIndex::Resize(Segment *segment, uint64_t observed_nbuckets) {
+        std::unique_lock<std::shared_mutex> lock(segment->mutex);
+        if (segment->nbuckets != observed_nbuckets) {
+            // Another thread has resized the segment.
+            return;
+        }
+        uint64_t nentries = segment->nused - segment->ntombstones;
+        uint64_t new_nbuckets = segment->nbuckets;
+        // Rehash in place if most used slots are tombstones.
+        if (segment->ntombstones < segment->nused / 2) {
+            new_nbuckets *= 2;
+        }
+        Bucket *new_buckets = new Bucket[new_nbuckets];
+        for (uint64_t b = 0; b < new_nbuckets; b++) {
+            for (int s = 0; s < kSlotsPerBucket; s++) {
+                new_buckets[b].slots[s] = kEmptySlot;
+            }
+        }
+        uint64_t mask = new_nbuckets - 1;
+        for (uint64_t b = 0; b < segment->nbuckets; b++) {
+            for (int s = 0; s < kSlotsPerBucket; s++) {
+                uint64_t slot = segment->buckets[b].slots[s];
+                if (slot == kEmptySlot || slot == kTombstone) {
+                    continue;
+                }
+                uint64_t tag = slot >> kMemTableIdBits;
+                bool placed = false;
+                for (uint64_t p = 0; p < new_nbuckets && !placed; p++) {
+                    Bucket &bucket = new_buckets[(tag + p) & mask];
+                    for (int i = 0; i < kSlotsPerBucket; i++) {
+                        if (bucket.slots[i] == kEmptySlot) {
+                            bucket.slots[i] = slot;
+                            placed = true;
+                            break;
+                        }
+                    }
+                }
+                NOVA_ASSERT(placed);
+            }
+        }
+        delete[] segment->buckets;
+        segment->buckets = new_buckets;
+        segment->nbuckets = new_nbuckets;
+        segment->nused = nentries;
+        segment->ntombstones = 0;
+        nresizes_.fetch_add(1, std::memory_order_relaxed);
     }
 
-    void LookupIndex::Insert(const leveldb::Slice &key, uint64_t hash,
-                             uint32_t memtableid) {
-//        NOVA_ASSERT(hash >= 0 && hash <= size_) << hash;
-        TableLocation &loc = table_locator_[hash % size_];
-        loc.memtable_id.store(memtableid);
+    void LookupIndex::Insert(const leveldb::Slice &key, uint32_t memtableid) {
+        NOVA_ASSERT(memtableid < kTombstone) << memtableid;
+        uint64_t tag = Tag(key);
+        Segment *segment = GetSegment(tag);
+        while (true) {
+            uint64_t nbuckets = 0;
+            {
+                std::shared_lock<std::shared_mutex> lock(segment->mutex);
+                if (TryInsert(segment, tag, memtableid)) {
+                    return;
+                }
+                nbuckets = segment->nbuckets;
+            }
+            Resize(segment, nbuckets);
+        }
     }
 
-    void LookupIndex::CAS(const leveldb::Slice &key, uint64_t hash,
+    void LookupIndex::CAS(const leveldb::Slice &key,
                           uint32_t current_memtableid,
                           uint32_t new_memtableid) {
-//        NOVA_ASSERT(hash >= 0 && hash <= size_) << hash;
-        TableLocation &loc = table_locator_[hash % size_];
-        loc.memtable_id.compare_exchange_strong(current_memtableid,
-                                                new_memtableid);
+        uint64_t tag = Tag(key);
+        Segment *segment = GetSegment(tag);
+        uint64_t expected = (tag << kMemTableIdBits) | current_memtableid;
+        uint64_t value = (tag << kMemTableIdBits) | new_memtableid;
+
+        std::shared_lock<std::shared_mutex> lock(segment->mutex);
+        uint64_t mask = segment->nbuckets - 1;
+        for (uint64_t p = 0; p < segment->nbuckets; p++) {
+            Bucket &bucket = segment->buckets[(tag + p) & mask];
+            for (int i = 0; i < kSlotsPerBucket; i++) {
+                uint64_t slot = bucket.slots[i].load(std::memory_order_acquire);
+                if (slot == kEmptySlot) {
+                    return;
+                }
+                if ((slot >> kMemTableIdBits) == tag) {
+                    bucket.slots[i].compare_exchange_strong(expected, value);
+                    return;
+                }
+            }
+        }
+    }
+
+    void LookupIndex::RecordFalsePositive() {
+        nfalse_positives_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void LookupIndex::MarkObsolete(const std::vector<uint32_t> &memtableids) {
+        obsolete_mutex_.Lock();
+        obsolete_memtableids_.insert(memtableids.begin(), memtableids.end());
+        obsolete_mutex_.Unlock();
+    }
+
+    uint64_t LookupIndex::GarbageCollect(uint32_t min_obsolete_memtables) {
+        std::unordered_set<uint32_t> obsolete;
+        obsolete_mutex_.Lock();
+        if (obsolete_memtableids_.size() < min_obsolete_memtables) {
+            obsolete_mutex_.Unlock();
+            return 0;
+        }
+        obsolete.swap(obsolete_memtableids_);
+        obsolete_mutex_.Unlock();
+        if (obsolete.empty()) {
+            return 0;
+        }
+
+        uint64_t nremoved = 0;
+        for (int i = 0; i < kNumSegments; i++) {
+            Segment &segment = segments_[i];
+            std::shared_lock<std::shared_mutex> lock(segment.mutex);
+            for (uint64_t b = 0; b < segment.nbuckets; b++) {
+                for (int s = 0; s < kSlotsPerBucket; s++) {
+                    std::atomic<uint64_t> &slot = segment.buckets[b].slots[s];
+                    uint64_t current = slot.load(std::memory_order_acquire);
+                    if (current == kEmptySlot || current == kTombstone) {
+                        continue;
+                    }
+                    if (obsolete.find(current & kTombstone) == obsolete.end()) {
+                        continue;
+                    }
+                    // Fails if a writer has updated the entry.
+                    if (slot.compare_exchange_strong(current, kTombstone)) {
+                        segment.ntombstones.fetch_add(1);
+                        nremoved++;
+                    }
+                }
+            }
+        }
+        ngc_entries_.fetch_add(nremoved, std::memory_order_relaxed);
+        return nremoved;
+    }
+
+    void LookupIndex::QueryStats(LookupIndexStats *stats) {
+        *stats = {};
+        for (int i = 0; i < kNumSegments; i++) {
+            Segment &segment = segments_[i];
+            std::shared_lock<std::shared_mutex> lock(segment.mutex);
+            stats->nslots += segment.nbuckets * kSlotsPerBucket;
+            stats->nentries += segment.nused - segment.ntombstones;
+            stats->ntombstones += segment.ntombstones;
+            stats->memory_bytes += segment.nbuckets * sizeof(Bucket);
+        }
+        stats->nlookups = nlookups_;
+        stats->nhits = nhits_;
+        stats->nfalse_positives = nfalse_positives_;
+        stats->nresizes = nresizes_;
+        stats->ngc_entries = ngc_entries_;
     }
 
-    uint32_t LookupIndex::Encode(char *buf) {
-        uint32_t msg_size = 0;
-        msg_size += EncodeFixed32(buf + msg_size, size_);
-        NOVA_LOG(rdmaio::INFO) << fmt::format("Lookup index size: {}", size_);
-        for (int i = 0; i < size_; i++) {
-            TableLocation &loc = table_locator_[i];
-            msg_size += EncodeFixed32(buf + msg_size, loc.memtable_id);
+    void LookupIndex::Export(std::vector<uint64_t> *entries) {
+        size_t start = entries->size();
+        for (int i = 0; i < kNumSegments; i++) {
+            Segment &segment = segments_[i];
+            std::shared_lock<std::shared_mutex> lock(segment.mutex);
+            for (uint64_t b = 0; b < segment.nbuckets; b++) {
+                for (int s = 0; s < kSlotsPerBucket; s++) {
+                    uint64_t slot = segment.buckets[b].slots[s];
+                    if (slot == kEmptySlot || slot == kTombstone) {
+                        continue;
+                    }
+                    entries->push_back(slot);
+                }
+            }
         }
+        std::sort(entries->begin() + start, entries->end(),
+                  [](uint64_t a, uint64_t b) {
+                      if ((a & kTombstone) != (b & kTombstone)) {
+                          return (a & kTombstone) < (b & kTombstone);
+                      }
+                      return a < b;
+                  });
+        NOVA_LOG(rdmaio::INFO)
+            << fmt::format("Lookup index entries: {}", entries->size() - start);
+    }
+
+    uint32_t LookupIndex::EncodeEntries(const std::vector<uint64_t> &entries,
+                                        uint64_t *next, char *buf,
+                                        uint32_t max_size) {
+        // A delta of a fingerprint has at most kTagBits bits.
+        const uint32_t kMaxDeltaSize = (kTagBits + 6) / 7;
+        // The memtable id and the number of its entries.
+        const uint32_t kMaxGroupHeaderSize = 5 + 4;
+        uint32_t msg_size = 4;
+        uint32_t ngroups = 0;
+        uint64_t i = *next;
+        while (i < entries.size() &&
+               msg_size + kMaxGroupHeaderSize + kMaxDeltaSize <= max_size) {
+            uint32_t memtableid = entries[i] & kTombstone;
+            msg_size = EncodeVarint32(buf + msg_size, memtableid) - buf;
+            uint32_t count_offset = msg_size;
+            msg_size += 4;
+            uint32_t count = 0;
+            uint64_t last_tag = 0;
+            while (i < entries.size() &&
+                   (entries[i] & kTombstone) == memtableid &&
+                   msg_size + kMaxDeltaSize <= max_size) {
+                uint64_t tag = entries[i] >> kMemTableIdBits;
+                msg_size = EncodeVarint64(buf + msg_size, tag - last_tag) - buf;
+                last_tag = tag;
+                count++;
+                i++;
+            }
+            EncodeFixed32(buf + count_offset, count);
+            ngroups++;
+        }
+        EncodeFixed32(buf, ngroups);
+        *next = i;
         return msg_size;
     }
 
-    void LookupIndex::Decode(Slice *buf) {
-        uint32_t size = 0;
-        NOVA_ASSERT(DecodeFixed32(buf, &size));
-        NOVA_LOG(rdmaio::INFO) << fmt::format("Lookup index size: {}", size);
-        for (int i = 0; i < size; i++) {
-            uint32_t id;
-            NOVA_ASSERT(DecodeFixed32(buf, &id));
-            table_locator_[i].memtable_id = id;
+    void LookupIndex::DecodeEntries(Slice *buf) {
+        uint32_t ngroups = 0;
+        uint64_t nentries = 0;
+        NOVA_ASSERT(DecodeFixed32(buf, &ngroups));
+        for (uint32_t g = 0; g < ngroups; g++) {
+            uint32_t memtableid = 0;
+            uint32_t count = 0;
+            NOVA_ASSERT(GetVarint32(buf, &memtableid));
+            NOVA_ASSERT(DecodeFixed32(buf, &count));
+            uint64_t tag = 0;
+            for (uint32_t i = 0; i < count; i++) {
+                uint64_t delta = 0;
+                NOVA_ASSERT(GetVarint64(buf, &delta));
+                tag += delta;
+                Segment *segment = GetSegment(tag);
+                while (true) {
+                    uint64_t nbuckets = 0;
+                    {
+                        std::shared_lock<std::shared_mutex> lock(
+                                segment->mutex);
+                        if (TryInsert(segment, tag, memtableid, false)) {
+                            break;
+                        }
+                        nbuckets = segment->nbuckets;
+                    }
+                    Resize(segment, nbuckets);
+                }
+            }
+            nentries += count;
         }
+        NOVA_LOG(rdmaio::DEBUG)
+            << fmt::format("Lookup index decoded entries: {}", nentries);
+    }
+
+    std::string LookupIndex::DebugString() {
+        LookupIndexStats stats;
+        QueryStats(&stats);
+        return stats.DebugString();
     }
-}
\ No newline at end of file
+}
@@ -2,41 +2,137 @@
 //
 // Created by Haoyu Huang on 5/19/20.
 // Copyright (c) 2020 University of Southern California. All rights reserved.
-// It assumes a fixed size lookup index. One may swap it with any implementation of concurrent hash map.
-// TODO: Support cleaning up the lookup index to remove entries that point to obsolete memtable ids.
+// The lookup index maps a key to the id of the memtable that contains its
+// latest value. It is an open-addressing hash table partitioned into
+// segments. Each bucket is a cache line of slots. A slot stores a key
+// fingerprint and a memtable id. A segment doubles its buckets online when
+// it is full. Entries that point to obsolete memtables are removed by
+// GarbageCollect.
 // TODO: Support repairing lookup index upon recovery from a crash.
 
 #ifndef LEVELDB_LOOKUP_INDEX_H
 #define LEVELDB_LOOKUP_INDEX_H
 
 #include <atomic>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+#include <unordered_set>
+
 #include "leveldb/slice.h"
+#include "port/port.h"
 
 namespace leveldb {
-    struct TableLocation {
-        std::atomic<uint32_t> memtable_id;
+    struct LookupIndexStats {
+        uint64_t nslots = 0;
+        uint64_t nentries = 0;
+        uint64_t ntombstones = 0;
+        uint64_t memory_bytes = 0;
+        uint64_t nlookups = 0;
+        uint64_t nhits = 0;
+        uint64_t nfalse_positives = 0;
+        uint64_t nresizes = 0;
+        uint64_t ngc_entries = 0;
+
+        std::string DebugString() const;
     };
 
     class LookupIndex {
     public:
+        // "size" is the expected number of keys.
         LookupIndex(uint32_t size);
 
-        uint64_t Lookup(const Slice &key, uint64_t hash);
+        ~LookupIndex();
+
+        // Returns the memtable id of the key or 0 if the key is not indexed.
+        uint32_t Lookup(const Slice &key);
 
-        void Insert(const Slice &key, uint64_t hash, uint32_t memtableid);
+        void Insert(const Slice &key, uint32_t memtableid);
 
-        void CAS(const Slice &key, uint64_t hash, uint32_t current_memtableid,
+        void CAS(const Slice &key, uint32_t current_memtableid,
                  uint32_t new_memtableid);
 
-        uint32_t Encode(char *buf);
+        // The caller found that the memtable returned by Lookup does not
+        // contain the key.
+        void RecordFalsePositive();
+
+        // Entries pointing to these memtables are removed by the next
+        // GarbageCollect.
+        void MarkObsolete(const std::vector<uint32_t> &memtableids);
+
+        // Remove entries that point to obsolete memtables. Returns the number
+        // of removed entries. It scans the whole table and does nothing until
+        // at least "min_obsolete_memtables" memtables are obsolete.
+        uint64_t GarbageCollect(uint32_t min_obsolete_memtables = 1);
 
-        void Decode(Slice *buf);
+        void QueryStats(LookupIndexStats *stats);
+
+        // Append the live entries to "entries", grouped by memtable id.
+        void Export(std::vector<uint64_t> *entries);
+
+        // Encode entries[*next, ...) exported by Export into at most
+        // "max_size" bytes of "buf" and advance *next. The fingerprints of
+        // a memtable are encoded as varint deltas.
+        static uint32_t EncodeEntries(const std::vector<uint64_t> &entries,
+                                      uint64_t *next, char *buf,
+                                      uint32_t max_size);
+
+        // Insert the entries encoded by EncodeEntries. An existing entry of
+        // a key is kept since it is newer than the exported one.
+        void DecodeEntries(Slice *buf);
 
         std::string DebugString();
 
     private:
-        uint32_t size_ = 0;
-        TableLocation *table_locator_ = nullptr;
+        enum {
+            kSegmentBits = 6,
+            kNumSegments = 1 << kSegmentBits,
+            kSlotsPerBucket = 8,
+            kMaxProbeBuckets = 8,
+            kMemTableIdBits = 24,
+            kTagBits = 64 - kMemTableIdBits
+        };
+
+        // A slot is empty, a tombstone, or (tag << kMemTableIdBits) | memtable id.
+        static const uint64_t kEmptySlot = 0;
+        static const uint64_t kTombstone = (1ul << kMemTableIdBits) - 1;
+
+        struct alignas(64) Bucket {
+            std::atomic<uint64_t> slots[kSlotsPerBucket];
+        };
+
+        struct alignas(64) Segment {
+            std::shared_mutex mutex;
+            Bucket *buckets = nullptr;
+            uint64_t nbuckets = 0;
+            // Slots that are not empty, including tombstones.
+            std::atomic<uint64_t> nused;
+            std::atomic<uint64_t> ntombstones;
+        };
+
+        static uint64_t Tag(const Slice &key);
+
+        // Returns false if the key does not fit into its probe sequence.
+        // An existing entry of the key is replaced if "overwrite" is true.
+        bool TryInsert(Segment *segment, uint64_t tag, uint32_t memtableid,
+                       bool overwrite = true);
+
+        void Resize(Segment *segment, uint64_t observed_nbuckets);
+
+        Segment *GetSegment(uint64_t tag) {
+            return &segments_[tag >> (kTagBits - kSegmentBits)];
+        }
+
+        Segment segments_[kNumSegments];
+
+        std::atomic<uint64_t> nlookups_;
+        std::atomic<uint64_t> nhits_;
+        std::atomic<uint64_t> nfalse_positives_;
+        std::atomic<uint64_t> nresizes_;
+        std::atomic<uint64_t> ngc_entries_;
+
+        port::Mutex obsolete_mutex_;
+        std::unordered_set<uint32_t> obsolete_memtableids_;
     };
 }
 
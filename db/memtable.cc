@@ -5,6 +5,7 @@
 #include <leveldb/db_profiler.h>
 #include <common/nova_console_logging.h>
 #include <fmt/core.h>
+#include <algorithm>
 #include "common/nova_config.h"
 #include "db/memtable.h"
 #include "db/dbformat.h"
@@ -23,6 +24,78 @@ namespace leveldb {
         return Slice(p, len);
     }
 
+    namespace {
+        size_t EncodedEntryLength(const Slice &key, const Slice &value) {
+            size_t internal_key_size = key.size() + 8;
+            return VarintLength(internal_key_size) + internal_key_size +
+                   VarintLength(value.size()) + value.size();
+        }
+
+        void EncodeEntry(char *buf, SequenceNumber s, ValueType type,
+                         const Slice &key, const Slice &value) {
+            // Format of an entry is concatenation of:
+            //  key_size     : varint32 of internal_key.size()
+            //  key bytes    : char[internal_key.size()]
+            //  value_size   : varint32 of value.size()
+            //  value bytes  : char[value.size()]
+            char *p = EncodeVarint32(buf, key.size() + 8);
+            memcpy(p, key.data(), key.size());
+            p += key.size();
+            EncodeFixed64(p, (s << 8) | type);
+            p += 8;
+            p = EncodeVarint32(p, value.size());
+            memcpy(p, value.data(), value.size());
+        }
+
+        // An encoded entry with its sort key. Entries are ordered by user key
+        // ascending and then by tag descending, the same as the internal key
+        // order.
+        struct SortEntry {
+            uint64_t user_key = 0;
+            uint64_t inverted_tag = 0;
+            const char *entry = nullptr;
+        };
+
+        // LSD radix sort on (user_key, inverted_tag), one byte per pass.
+        // Passes where all entries have the same byte are skipped, e.g., the
+        // high bytes of sequence numbers and small integer keys.
+        void RadixSort(std::vector<SortEntry> *entries) {
+            const int kPasses = 16;
+            std::vector<uint32_t> counts(kPasses * 256, 0);
+            auto digit = [](const SortEntry &e, int pass) -> uint32_t {
+                uint64_t v = pass < 8 ? e.inverted_tag : e.user_key;
+                return (v >> ((pass % 8) * 8)) & 0xff;
+            };
+            for (const SortEntry &e : *entries) {
+                for (int pass = 0; pass < kPasses; pass++) {
+                    counts[pass * 256 + digit(e, pass)]++;
+                }
+            }
+            std::vector<SortEntry> tmp(entries->size());
+            std::vector<SortEntry> *from = entries;
+            std::vector<SortEntry> *to = &tmp;
+            for (int pass = 0; pass < kPasses; pass++) {
+                uint32_t *count = &counts[pass * 256];
+                if (count[digit((*from)[0], pass)] == from->size()) {
+                    continue;
+                }
+                uint32_t offset = 0;
+                for (int d = 0; d < 256; d++) {
+                    uint32_t c = count[d];
+                    count[d] = offset;
+                    offset += c;
+                }
+                for (const SortEntry &e : *from) {
+                    (*to)[count[digit(e, pass)]++] = e;
+                }
+                std::swap(from, to);
+            }
+            if (from != entries) {
+                entries->swap(tmp);
+            }
+        }
+    }
+
     MemTable::MemTable(const InternalKeyComparator &comparator,
                        uint32_t memtable_id,
                        DBProfiler *db_profiler,
@@ -30,7 +103,8 @@ namespace leveldb {
             : comparator_(comparator), memtable_id_(memtable_id), refs_(0),
               table_(comparator_, &arena_),
               db_profiler_(db_profiler), is_ready_(is_ready),
-              is_ready_signal_(&is_ready_mutex_) {
+              is_ready_signal_(&is_ready_mutex_),
+              smallest_sequence_(kMaxSequenceNumber) {
     }
 
     void MemTable::WaitUntilReady() {
@@ -138,12 +212,11 @@ namespace leveldb {
             }
             auto userkey = ExtractUserKey(target);
             uint64_t userkeyint;
-            nova::str_to_int(userkey.data(), &userkeyint, userkey.size());
+            userkeyint = nova::user_key_to_int(userkey.data(), userkey.size());
             while (Valid()) {
                 auto current_key = ExtractUserKey(key());
                 uint64_t pivot = 0;
-                nova::str_to_int(current_key.data(), &pivot,
-                                 current_key.size());
+                pivot = nova::user_key_to_int(current_key.data(), current_key.size());
                 NOVA_LOG(rdmaio::DEBUG)
                     << fmt::format("memtable skip:{} {}", userkeyint, pivot);
                 if (userkeyint != pivot) {
@@ -186,32 +259,75 @@ namespace leveldb {
         return new MemTableIterator(this, trace_type, caller, sample_size);
     }
 
+    void MemTable::UpdateSmallestSequence(SequenceNumber s) {
+        uint_fast64_t smallest = smallest_sequence_.load(
+                std::memory_order_relaxed);
+        while (s < smallest &&
+               !smallest_sequence_.compare_exchange_weak(
+                       smallest, s, std::memory_order_relaxed)) {
+        }
+    }
+
     void MemTable::Add(SequenceNumber s, ValueType type, const Slice &key,
                        const Slice &value) {
-        // Format of an entry is concatenation of:
-        //  key_size     : varint32 of internal_key.size()
-        //  key bytes    : char[internal_key.size()]
-        //  value_size   : varint32 of value.size()
-        //  value bytes  : char[value.size()]
-        size_t key_size = key.size();
-        size_t val_size = value.size();
-        size_t internal_key_size = key_size + 8;
-        const size_t encoded_len = VarintLength(internal_key_size) +
-                                   internal_key_size + VarintLength(val_size) +
-                                   val_size;
-        char *buf = arena_.Allocate(encoded_len);
-        char *p = EncodeVarint32(buf, internal_key_size);
-        memcpy(p, key.data(), key_size);
-        p += key_size;
-        EncodeFixed64(p, (s << 8) | type);
-        p += 8;
-        p = EncodeVarint32(p, val_size);
-        memcpy(p, value.data(), val_size);
-        assert(p + val_size == buf + encoded_len);
+        UpdateSmallestSequence(s);
+        char *buf = arena_.Allocate(EncodedEntryLength(key, value));
+        EncodeEntry(buf, s, type, key, value);
         table_.Insert(buf);
     }
 
-    bool MemTable::Get(const LookupKey &key, std::string *value, Status *s) {
+    void MemTable::AddConcurrently(SequenceNumber s, ValueType type,
+                                   const Slice &key, const Slice &value) {
+        UpdateSmallestSequence(s);
+        char *buf = arena_.AllocateAlignedConcurrent(
+                EncodedEntryLength(key, value));
+        EncodeEntry(buf, s, type, key, value);
+        table_.InsertConcurrently(buf);
+    }
+
+    void MemTable::BulkAdd(const std::vector<BulkEntry> &entries) {
+        if (entries.empty()) {
+            return;
+        }
+        const Comparator *user_comparator = comparator_.comparator.user_comparator();
+        std::vector<SortEntry> sort_entries(entries.size());
+        bool int_keys = true;
+        bool sorted = true;
+        for (size_t i = 0; i < entries.size(); i++) {
+            const BulkEntry &e = entries[i];
+            UpdateSmallestSequence(e.seq);
+            char *buf = arena_.Allocate(EncodedEntryLength(e.key, e.value));
+            EncodeEntry(buf, e.seq, e.type, e.key, e.value);
+            SortEntry &se = sort_entries[i];
+            se.entry = buf;
+            // Larger tags sort first.
+            se.inverted_tag = ~((e.seq << 8) | e.type);
+            if (int_keys) {
+                int_keys = user_comparator->KeyToInt(e.key, &se.user_key);
+            }
+            if (i > 0 && sorted) {
+                sorted = comparator_(sort_entries[i - 1].entry, buf) < 0;
+            }
+        }
+
+        std::vector<const char *> keys(entries.size());
+        if (!sorted && int_keys) {
+            RadixSort(&sort_entries);
+        }
+        for (size_t i = 0; i < sort_entries.size(); i++) {
+            keys[i] = sort_entries[i].entry;
+        }
+        if (!sorted && !int_keys) {
+            std::sort(keys.begin(), keys.end(),
+                      [&](const char *a, const char *b) {
+                          return comparator_(a, b) < 0;
+                      });
+        }
+        table_.InsertSorted(keys.data(), keys.size());
+    }
+
+    bool MemTable::Get(const LookupKey &key, std::string *value, Status *s,
+                       SequenceNumber *seq) {
         WaitUntilReady();
         Slice memkey = key.memtable_key();
         Table::Iterator iter(&table_);
@@ -233,6 +349,9 @@ namespace leveldb {
                     Slice(key_ptr, key_length - 8), key.user_key()) == 0) {
                 // Correct user key
                 const uint64_t tag = DecodeFixed64(key_ptr + key_length - 8);
+                if (seq) {
+                    *seq = tag >> 8;
+                }
                 switch (static_cast<ValueType>(tag & 0xff)) {
                     case kTypeValue: {
                         Slice v = GetLengthPrefixedSlice(key_ptr + key_length);
@@ -356,7 +475,7 @@ namespace leveldb {
         return memtable_exists;
     }
 
-    void AtomicMemTable::UpdateL0Files(uint32_t version_id, const MemTableL0FilesEdit &edit) {
+    bool AtomicMemTable::UpdateL0Files(uint32_t version_id, const MemTableL0FilesEdit &edit) {
         mutex_.lock();
         NOVA_ASSERT(is_immutable_) << fmt::format("{}:{},{}", memtable_id_, memtable_size_, edit.DebugString());
         NOVA_ASSERT(is_flushed_);
@@ -367,7 +486,9 @@ namespace leveldb {
         for (auto rm : edit.remove_fns) {
             l0_file_numbers_.erase(rm);
         }
+        bool no_l0_files = l0_file_numbers_.empty();
         mutex_.unlock();
+        return no_l0_files;
     }
 
     void AtomicMemTable::Unref(const std::string &dbname, uint32_t unrefcount) {
@@ -72,22 +72,51 @@ namespace leveldb {
         void Add(SequenceNumber seq, ValueType type, const Slice &key,
                  const Slice &value);
 
+        // Same as Add() but may be called by multiple writers concurrently.
+        // REQUIRES: All writers to this memtable use AddConcurrently().
+        void AddConcurrently(SequenceNumber seq, ValueType type,
+                             const Slice &key, const Slice &value);
+
+        struct BulkEntry {
+            SequenceNumber seq;
+            ValueType type;
+            Slice key;
+            Slice value;
+        };
+
+        // Add "entries" in any order. The entries are sorted in a flat array
+        // and linked into the skiplist in one pass, which avoids searching
+        // the skiplist for every entry.
+        // REQUIRES: The memtable is empty and has no concurrent writers.
+        void BulkAdd(const std::vector<BulkEntry> &entries);
+
         // If memtable contains a value for key, store it in *value and return true.
         // If memtable contains a deletion for key, store a NotFound() error
         // in *status and return true.
         // Else, return false.
-        bool Get(const LookupKey &key, std::string *value, Status *s);
+        // If "seq" is not null, store the sequence number of the entry in
+        // *seq when it returns true.
+        bool Get(const LookupKey &key, std::string *value, Status *s,
+                 SequenceNumber *seq = nullptr);
 
         FileMetaData &meta() {
             return flushed_meta_;
         }
 
+        // Smallest sequence number of the entries in the memtable.
+        // kMaxSequenceNumber if it is empty.
+        SequenceNumber smallest_sequence() const {
+            return smallest_sequence_.load(std::memory_order_relaxed);
+        }
+
         ~MemTable();  // Private since only Unref() should be used to delete it
 
         bool is_pinned_ = false;
     private:
         void WaitUntilReady();
 
+        void UpdateSmallestSequence(SequenceNumber s);
+
         friend class MemTableIterator;
 
         friend class MemTableBackwardIterator;
@@ -112,6 +141,7 @@ namespace leveldb {
         Arena arena_;
         Table table_;
         FileMetaData flushed_meta_;
+        std::atomic_uint_fast64_t smallest_sequence_;
     };
 
     struct MemTableL0FilesEdit {
@@ -132,7 +162,9 @@ namespace leveldb {
 
         AtomicMemTable *RefMemTable();
 
-        void UpdateL0Files(uint32_t version_id, const MemTableL0FilesEdit &edit);
+        // Returns true if the memtable has no L0 files after the edit, i.e.,
+        // all of its entries are compacted into L1 and above.
+        bool UpdateL0Files(uint32_t version_id, const MemTableL0FilesEdit &edit);
 
         void Unref(const std::string &dbname, uint32_t unrefcnt = 1);
 
@@ -0,0 +1,144 @@
+//
+// Copyright (c) 2020 University of Southern California. All rights reserved.
+//
+
+#include "pruned_iterator.h"
+
+#include "db/dbformat.h"
+
+namespace leveldb {
+    namespace {
+        class PrunedIterator : public Iterator {
+        public:
+            PrunedIterator(const InternalKeyComparator *icmp, Iterator *pruned,
+                           const Slice &lower, const Slice &upper,
+                           std::function<Iterator *()> new_full_iterator)
+                    : ucmp_(icmp->user_comparator()), pruned_(pruned),
+                      current_(pruned), lower_(lower.ToString()),
+                      upper_(upper.ToString()),
+                      upper_seek_key_(upper, kMaxSequenceNumber,
+                                      kValueTypeForSeek),
+                      new_full_iterator_(std::move(new_full_iterator)) {
+            }
+
+            ~PrunedIterator() override {
+                delete pruned_;
+                delete full_;
+            }
+
+            bool Valid() const override { return current_->Valid(); }
+
+            void SeekToFirst() override {
+                current_ = full();
+                current_->SeekToFirst();
+            }
+
+            void SeekToLast() override {
+                current_ = full();
+                current_->SeekToLast();
+            }
+
+            void Seek(const Slice &target) override {
+                if (!InRange(ExtractUserKey(target))) {
+                    current_ = full();
+                    current_->Seek(target);
+                    return;
+                }
+                current_ = pruned_;
+                current_->Seek(target);
+                MaybeLeaveRange();
+            }
+
+            void SkipToNextUserKey(const Slice &target) override {
+                current_->SkipToNextUserKey(target);
+                MaybeLeaveRange();
+            }
+
+            void Next() override {
+                current_->Next();
+                MaybeLeaveRange();
+            }
+
+            void Prev() override {
+                if (current_ != pruned_) {
+                    current_->Prev();
+                    return;
+                }
+                std::string key = pruned_->key().ToString();
+                pruned_->Prev();
+                if (pruned_->Valid() &&
+                    InRange(ExtractUserKey(pruned_->key()))) {
+                    return;
+                }
+                // Entries before "lower" may be in the pruned tables.
+                current_ = full();
+                current_->Seek(key);
+                if (current_->Valid()) {
+                    current_->Prev();
+                } else {
+                    current_->SeekToLast();
+                }
+            }
+
+            Slice key() const override { return current_->key(); }
+
+            Slice value() const override { return current_->value(); }
+
+            Status status() const override {
+                Status s = pruned_->status();
+                if (s.ok() && full_) {
+                    s = full_->status();
+                }
+                return s;
+            }
+
+        private:
+            bool InRange(const Slice &user_key) const {
+                return ucmp_->Compare(user_key, lower_) >= 0 &&
+                       ucmp_->Compare(user_key, upper_) < 0;
+            }
+
+            Iterator *full() {
+                if (!full_) {
+                    full_ = new_full_iterator_();
+                }
+                return full_;
+            }
+
+            // Continue from "upper" with all tables once the pruned
+            // iterator moves past the range.
+            void MaybeLeaveRange() {
+                if (current_ != pruned_) {
+                    return;
+                }
+                if (pruned_->Valid() &&
+                    ucmp_->Compare(ExtractUserKey(pruned_->key()), upper_) <
+                    0) {
+                    return;
+                }
+                if (!pruned_->status().ok()) {
+                    return;
+                }
+                current_ = full();
+                current_->Seek(upper_seek_key_.Encode());
+            }
+
+            const Comparator *ucmp_;
+            Iterator *pruned_;
+            Iterator *full_ = nullptr;
+            Iterator *current_;
+            const std::string lower_;
+            const std::string upper_;
+            const InternalKey upper_seek_key_;
+            std::function<Iterator *()> new_full_iterator_;
+        };
+    }
+
+    Iterator *
+    NewPrunedIterator(const InternalKeyComparator *icmp, Iterator *pruned,
+                      const Slice &lower, const Slice &upper,
+                      std::function<Iterator *()> new_full_iterator) {
+        return new PrunedIterator(icmp, pruned, lower, upper,
+                                  std::move(new_full_iterator));
+    }
+}
@@ -0,0 +1,31 @@
+//
+// Copyright (c) 2020 University of Southern California. All rights reserved.
+//
+
+#ifndef LEVELDB_PRUNED_ITERATOR_H
+#define LEVELDB_PRUNED_ITERATOR_H
+
+#include <functional>
+
+#include "leveldb/iterator.h"
+#include "leveldb/slice.h"
+
+namespace leveldb {
+
+    class InternalKeyComparator;
+
+    // Return an iterator that yields the same entries as the iterator
+    // returned by "new_full_iterator". Entries whose user keys are in
+    // [lower, upper) are read from "pruned", which only merges the tables
+    // that overlap [lower, upper). "new_full_iterator" is invoked only when
+    // the iterator leaves [lower, upper), so that a short scan does not pay
+    // for the tables that it does not read.
+    //
+    // Takes ownership of "pruned" and the full iterator.
+    Iterator *
+    NewPrunedIterator(const InternalKeyComparator *icmp, Iterator *pruned,
+                      const Slice &lower, const Slice &upper,
+                      std::function<Iterator *()> new_full_iterator);
+}
+
+#endif //LEVELDB_PRUNED_ITERATOR_H
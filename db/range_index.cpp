@@ -129,7 +129,7 @@ namespace leveldb {
     void RangeIndexIterator::SkipToNextUserKey(const Slice &target) {
         Slice userkey = ExtractUserKey(target);
         uint64_t ukey = 0;
-        nova::str_to_int(userkey.data(), &ukey, userkey.size());
+        ukey = nova::user_key_to_int(userkey.data(), userkey.size());
         ukey += 1;
         if (!Valid()) {
             Seek(target);
@@ -8,7 +8,8 @@
 // Thread safety
 // -------------
 //
-// Writes require external synchronization, most likely a mutex.
+// Writes require external synchronization, most likely a mutex, unless
+// all writers use InsertConcurrently().
 // Reads require a guarantee that the SkipList will not be destroyed
 // while the read is in progress.  Apart from that, reads progress
 // without any internal locking or synchronization.
@@ -30,6 +31,7 @@
 #include <atomic>
 #include <cassert>
 #include <cstdlib>
+#include <thread>
 #include "common/nova_console_logging.h"
 #include "common/nova_common.h"
 
@@ -59,6 +61,17 @@ namespace leveldb {
         // REQUIRES: nothing that compares equal to key is currently in the list.
         void Insert(const Key &key);
 
+        // Like Insert(), but allows concurrent calls from multiple writers.
+        // Nodes are linked with CAS, one level at a time from the bottom up.
+        // REQUIRES: nothing that compares equal to key is currently in the
+        // list. Insert() is not called concurrently.
+        void InsertConcurrently(const Key &key);
+
+        // Link "n" keys into the list in one pass without searching the list.
+        // REQUIRES: The list is empty. keys[0..n-1] are in strictly ascending
+        // order. Insert() and InsertConcurrently() are not called concurrently.
+        void InsertSorted(const Key *keys, size_t n);
+
         // Returns true iff an entry that compares equal to key is in the list.
         bool Contains(const Key &key) const;
 
@@ -112,10 +125,17 @@ namespace leveldb {
             return max_height_.load(std::memory_order_relaxed);
         }
 
-        Node *NewNode(const Key &key, int height);
+        Node *NewNode(const Key &key, int height, bool concurrent = false);
 
         int RandomHeight();
 
+        int RandomHeightConcurrent();
+
+        // Find the nodes before and after key at "level" starting from
+        // "before".
+        void FindSpliceForLevel(const Key &key, Node *before, int level,
+                                Node **out_prev, Node **out_next) const;
+
         bool Equal(const Key &a, const Key &b) const {
             return (compare_(a, b) == 0);
         }
@@ -189,6 +209,11 @@ namespace leveldb {
             next_[n].store(x, std::memory_order_relaxed);
         }
 
+        bool CASNext(int n, Node *expected, Node *x) {
+            assert(n >= 0);
+            return next_[n].compare_exchange_strong(expected, x);
+        }
+
     private:
         // Array of length equal to the node height.  next_[0] is lowest level link.
         std::atomic<Node *> next_[1];
@@ -197,9 +222,11 @@ namespace leveldb {
     template<typename Key, class Comparator>
     typename SkipList<Key, Comparator>::Node *
     SkipList<Key, Comparator>::NewNode(
-            const Key &key, int height) {
-        char *const node_memory = arena_->AllocateAligned(
-                sizeof(Node) + sizeof(std::atomic<Node *>) * (height - 1));
+            const Key &key, int height, bool concurrent) {
+        size_t size = sizeof(Node) + sizeof(std::atomic<Node *>) * (height - 1);
+        char *const node_memory = concurrent ?
+                                  arena_->AllocateAlignedConcurrent(size) :
+                                  arena_->AllocateAligned(size);
         return new(node_memory) Node(key);
     }
 
@@ -290,6 +317,19 @@ namespace leveldb {
         return height;
     }
 
+    template<typename Key, class Comparator>
+    int SkipList<Key, Comparator>::RandomHeightConcurrent() {
+        // rnd_ is not thread safe. Each writer thread uses its own generator.
+        static const unsigned int kBranching = 4;
+        static thread_local Random rnd(
+                std::hash<std::thread::id>{}(std::this_thread::get_id()));
+        int height = 1;
+        while (height < kMaxHeight && ((rnd.Next() % kBranching) == 0)) {
+            height++;
+        }
+        return height;
+    }
+
     template<typename Key, class Comparator>
     bool
     SkipList<Key, Comparator>::KeyIsAfterNode(const Key &key, Node *n) const {
@@ -410,6 +450,93 @@ namespace leveldb {
         }
     }
 
+    template<typename Key, class Comparator>
+    void SkipList<Key, Comparator>::FindSpliceForLevel(const Key &key,
+                                                       Node *before, int level,
+                                                       Node **out_prev,
+                                                       Node **out_next) const {
+        while (true) {
+            Node *next = before->Next(level);
+            if (KeyIsAfterNode(key, next)) {
+                before = next;
+            } else {
+                *out_prev = before;
+                *out_next = next;
+                return;
+            }
+        }
+    }
+
+    template<typename Key, class Comparator>
+    void SkipList<Key, Comparator>::InsertConcurrently(const Key &key) {
+        int height = RandomHeightConcurrent();
+        int max_height = GetMaxHeight();
+        while (height > max_height) {
+            // Readers that observe the new height see nullptr links from
+            // head_ and drop to the next level.
+            if (max_height_.compare_exchange_weak(max_height, height)) {
+                max_height = height;
+                break;
+            }
+        }
+
+        Node *prev[kMaxHeight];
+        Node *next[kMaxHeight];
+        Node *before = head_;
+        for (int level = max_height - 1; level >= 0; level--) {
+            FindSpliceForLevel(key, before, level, &prev[level], &next[level]);
+            before = prev[level];
+        }
+
+        // Our data structure does not allow duplicate insertion
+        assert(next[0] == nullptr || !Equal(key, next[0]->key));
+
+        Node *x = NewNode(key, height, /*concurrent=*/true);
+        for (int i = 0; i < height; i++) {
+            while (true) {
+                x->NoBarrier_SetNext(i, next[i]);
+                if (prev[i]->CASNext(i, next[i], x)) {
+                    break;
+                }
+                // Another writer linked a node between prev[i] and next[i].
+                FindSpliceForLevel(key, prev[i], i, &prev[i], &next[i]);
+            }
+            nputs_per_level[i].fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    template<typename Key, class Comparator>
+    void SkipList<Key, Comparator>::InsertSorted(const Key *keys, size_t n) {
+        assert(head_->NoBarrier_Next(0) == nullptr);
+        // last[i] is the last node linked at level i.
+        Node *last[kMaxHeight];
+        for (int i = 0; i < kMaxHeight; i++) {
+            last[i] = head_;
+        }
+        int max_height = GetMaxHeight();
+        uint32_t nputs[kMaxHeight] = {};
+        for (size_t k = 0; k < n; k++) {
+            assert(k == 0 || compare_(keys[k - 1], keys[k]) < 0);
+            int height = RandomHeight();
+            if (height > max_height) {
+                // Same as Insert(), readers that observe the new height see
+                // nullptr links from head_ and drop to the next level.
+                max_height = height;
+                max_height_.store(height, std::memory_order_relaxed);
+            }
+            Node *x = NewNode(keys[k], height);
+            for (int i = 0; i < height; i++) {
+                x->NoBarrier_SetNext(i, nullptr);
+                last[i]->SetNext(i, x);
+                last[i] = x;
+                nputs[i]++;
+            }
+        }
+        for (int i = 0; i < kMaxHeight; i++) {
+            nputs_per_level[i].fetch_add(nputs[i], std::memory_order_relaxed);
+        }
+    }
+
     template<typename Key, class Comparator>
     bool SkipList<Key, Comparator>::Contains(const Key &key) const {
         Node *x = FindGreaterOrEqual(key, nullptr);
@@ -6,6 +6,8 @@
 
 #include <atomic>
 #include <set>
+#include <thread>
+#include <vector>
 
 #include "leveldb/env.h"
 #include "port/port.h"
@@ -19,7 +21,7 @@ namespace leveldb {
 
     typedef uint64_t Key;
 
-    struct Comparator {
+    struct TestComparator {
         int operator()(const Key &a, const Key &b) const {
             if (a < b) {
                 return -1;
@@ -36,11 +38,11 @@ namespace leveldb {
 
     TEST(SkipTest, Empty) {
         Arena arena;
-        Comparator cmp;
-        SkipList<Key, Comparator> list(cmp, &arena);
+        TestComparator cmp;
+        SkipList<Key, TestComparator> list(cmp, &arena);
         ASSERT_TRUE(!list.Contains(10));
 
-        SkipList<Key, Comparator>::Iterator iter(&list);
+        SkipList<Key, TestComparator>::Iterator iter(&list);
         ASSERT_TRUE(!iter.Valid());
         iter.SeekToFirst();
         ASSERT_TRUE(!iter.Valid());
@@ -56,8 +58,8 @@ namespace leveldb {
         Random rnd(1000);
         std::set<Key> keys;
         Arena arena;
-        Comparator cmp;
-        SkipList<Key, Comparator> list(cmp, &arena);
+        TestComparator cmp;
+        SkipList<Key, TestComparator> list(cmp, &arena);
         for (int i = 0; i < N; i++) {
             Key key = rnd.Next() % R;
             if (keys.insert(key).second) {
@@ -75,7 +77,7 @@ namespace leveldb {
 
         // Simple iterator tests
         {
-            SkipList<Key, Comparator>::Iterator iter(&list);
+            SkipList<Key, TestComparator>::Iterator iter(&list);
             ASSERT_TRUE(!iter.Valid());
 
             iter.Seek(0);
@@ -93,7 +95,7 @@ namespace leveldb {
 
         // Forward iteration test
         for (int i = 0; i < R; i++) {
-            SkipList<Key, Comparator>::Iterator iter(&list);
+            SkipList<Key, TestComparator>::Iterator iter(&list);
             iter.Seek(i);
 
             // Compare against model iterator
@@ -113,7 +115,7 @@ namespace leveldb {
 
         // Backward iteration test
         {
-            SkipList<Key, Comparator>::Iterator iter(&list);
+            SkipList<Key, TestComparator>::Iterator iter(&list);
             iter.SeekToLast();
 
             // Compare against model iterator
@@ -218,10 +220,10 @@ namespace leveldb {
 
         // SkipList is not protected by mu_.  We just use a single writer
         // thread to modify it.
-        SkipList<Key, Comparator> list_;
+        SkipList<Key, TestComparator> list_;
 
     public:
-        ConcurrentTest() : list_(Comparator(), &arena_) {}
+        ConcurrentTest() : list_(TestComparator(), &arena_) {}
 
         // REQUIRES: External synchronization
         void WriteStep(Random *rnd) {
@@ -240,7 +242,7 @@ namespace leveldb {
             }
 
             Key pos = RandomTarget(rnd);
-            SkipList<Key, Comparator>::Iterator iter(&list_);
+            SkipList<Key, TestComparator>::Iterator iter(&list_);
             iter.Seek(pos);
             while (true) {
                 Key current;
@@ -361,13 +363,14 @@ namespace leveldb {
                 fprintf(stderr, "Run %d of %d\n", i, N);
             }
             TestState state(seed + 1);
-//            Env::Default()->Schedule(ConcurrentReader, &state);
+            std::thread reader(ConcurrentReader, &state);
             state.Wait(TestState::RUNNING);
             for (int i = 0; i < kSize; i++) {
                 state.t_.WriteStep(&rnd);
             }
             state.quit_flag_.store(true, std::memory_order_release);
             state.Wait(TestState::DONE);
+            reader.join();
         }
     }
 
@@ -381,6 +384,97 @@ namespace leveldb {
 
     TEST(SkipTest, Concurrent5) { RunConcurrent(5); }
 
+    TEST(SkipTest, InsertConcurrently) {
+        const int kThreads = 8;
+        const int kKeysPerThread = 10000;
+        Arena arena;
+        TestComparator cmp;
+        SkipList<Key, TestComparator> list(cmp, &arena);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < kThreads; t++) {
+            threads.emplace_back([&list, t]() {
+                for (int i = 0; i < kKeysPerThread; i++) {
+                    list.InsertConcurrently(i * kThreads + t);
+                }
+            });
+        }
+        for (auto &t : threads) {
+            t.join();
+        }
+
+        SkipList<Key, TestComparator>::Iterator iter(&list);
+        iter.SeekToFirst();
+        for (Key k = 0; k < kThreads * kKeysPerThread; k++) {
+            ASSERT_TRUE(iter.Valid());
+            ASSERT_EQ(k, iter.key());
+            iter.Next();
+        }
+        ASSERT_TRUE(!iter.Valid());
+    }
+
+    TEST(SkipTest, InsertSorted) {
+        const int N = 10000;
+        Arena arena;
+        TestComparator cmp;
+        SkipList<Key, TestComparator> list(cmp, &arena);
+        std::vector<Key> keys;
+        for (int i = 0; i < N; i++) {
+            keys.push_back(i * 2);
+        }
+        list.InsertSorted(keys.data(), keys.size());
+
+        for (int i = 0; i < 2 * N; i++) {
+            ASSERT_EQ(i % 2 == 0, list.Contains(i));
+        }
+        SkipList<Key, TestComparator>::Iterator iter(&list);
+        iter.Seek(7);
+        ASSERT_TRUE(iter.Valid());
+        ASSERT_EQ(8, iter.key());
+        iter.SeekToLast();
+        ASSERT_TRUE(iter.Valid());
+        ASSERT_EQ(keys.back(), iter.key());
+        iter.SeekToFirst();
+        for (int i = 0; i < N; i++) {
+            ASSERT_TRUE(iter.Valid());
+            ASSERT_EQ(keys[i], iter.key());
+            iter.Next();
+        }
+        ASSERT_TRUE(!iter.Valid());
+    }
+
+    TEST(SkipTest, InsertAfterInsertSorted) {
+        const int N = 10000;
+        Arena arena;
+        TestComparator cmp;
+        SkipList<Key, TestComparator> list(cmp, &arena);
+        std::vector<Key> keys;
+        for (int i = 0; i < N; i++) {
+            keys.push_back(i * 2);
+        }
+        list.InsertSorted(keys.data(), keys.size());
+        // The links built by InsertSorted are searched by Insert.
+        Random rnd(301);
+        std::vector<Key> odd;
+        for (int i = 0; i < N; i++) {
+            odd.push_back(i * 2 + 1);
+        }
+        for (int i = N - 1; i > 0; i--) {
+            std::swap(odd[i], odd[rnd.Uniform(i + 1)]);
+        }
+        for (Key k : odd) {
+            list.Insert(k);
+        }
+
+        SkipList<Key, TestComparator>::Iterator iter(&list);
+        iter.SeekToFirst();
+        for (Key k = 0; k < 2 * N; k++) {
+            ASSERT_TRUE(iter.Valid());
+            ASSERT_EQ(k, iter.key());
+            iter.Next();
+        }
+        ASSERT_TRUE(!iter.Valid());
+    }
+
 }  // namespace leveldb
 
 int main(int argc, char **argv) { return leveldb::test::RunAllTests(); }
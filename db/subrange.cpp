@@ -12,13 +12,13 @@ namespace leveldb {
 
     uint64_t Range::lower_int() const {
         uint64_t low = 0;
-        nova::str_to_int(lower.data(), &low, lower.size());
+        low = nova::user_key_to_int(lower.data(), lower.size());
         return low;
     }
 
     uint64_t Range::upper_int() const {
         uint64_t up = 0;
-        nova::str_to_int(upper.data(), &up, upper.size());
+        up = nova::user_key_to_int(upper.data(), upper.size());
         return up;
     }
 
@@ -44,17 +44,19 @@ namespace leveldb {
         std::string output;
         uint64_t low;
         uint64_t up;
-        nova::str_to_int(lower.data(), &low, lower.size());
-        nova::str_to_int(upper.data(), &up, upper.size());
+        low = nova::user_key_to_int(lower.data(), lower.size());
+        up = nova::user_key_to_int(upper.data(), upper.size());
         if (lower_inclusive) {
             output += "[";
         } else {
             low++;
             output += "(";
         }
-        output += lower;
+        output += std::to_string(
+                nova::user_key_to_int(lower.data(), lower.size()));
         output += ",";
-        output += upper;
+        output += std::to_string(
+                nova::user_key_to_int(upper.data(), upper.size()));
         if (upper_inclusive) {
             up++;
             output += "]";
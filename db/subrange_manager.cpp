@@ -43,8 +43,8 @@ namespace leveldb {
             for (int i = 0; i < options_.num_memtable_partitions; i++) {
                 SubRange nsr;
                 Range r;
-                r.lower = std::to_string(lower);
-                r.upper = std::to_string(upper);
+                r.lower = nova::int_to_user_key(lower);
+                r.upper = nova::int_to_user_key(upper);
                 if (num_duplicates == 1) {
                     r.num_duplicates = 0;
                     nsr.num_duplicates = 0;
@@ -68,8 +68,8 @@ namespace leveldb {
             // Construct one subrange.
             SubRange nsr;
             Range r;
-            r.lower = std::to_string(lower_bound_);
-            r.upper = std::to_string(upper_bound_);
+            r.lower = nova::int_to_user_key(lower_bound_);
+            r.upper = nova::int_to_user_key(upper_bound_);
             nsr.tiny_ranges.push_back(r);
             sr->subranges.push_back(nsr);
         }
@@ -189,13 +189,13 @@ namespace leveldb {
                     SubRange &sr = new_subranges->last();
                     Range &last = sr.last();
                     uint64_t k;
-                    nova::str_to_int(key.data(), &k, key.size());
-                    last.upper.assign(std::to_string(k + 1));
+                    k = nova::user_key_to_int(key.data(), key.size());
+                    last.upper.assign(nova::int_to_user_key(k + 1));
                     for (int i = 1; i < sr.num_duplicates; i++) {
                         SubRange &dup = new_subranges->subranges[
                                 new_subranges->subranges.size() - i - 1];
                         Range &dup_last = dup.last();
-                        dup_last.upper.assign(std::to_string(k + 1));
+                        dup_last.upper.assign(nova::int_to_user_key(k + 1));
                     }
                     subrange_id = new_subranges->subranges.size() - 1;
                 }
@@ -209,7 +209,7 @@ namespace leveldb {
                 Range new_range = {};
                 new_range.lower.assign(key.ToString());
                 new_range.upper.assign(
-                        std::to_string(new_range.lower_int() + 1));
+                        nova::int_to_user_key(new_range.lower_int() + 1));
                 sr.tiny_ranges.push_back(std::move(new_range));
                 new_subranges->subranges.push_back(std::move(sr));
                 subrange_id = 0;
@@ -225,8 +225,8 @@ namespace leveldb {
                 } else {
                     Range &last = new_subranges->first().last();
                     uint64_t u = 0;
-                    nova::str_to_int(key.data(), &u, key.size());
-                    last.upper.assign(std::to_string(u + 1));
+                    u = nova::user_key_to_int(key.data(), key.size());
+                    last.upper.assign(nova::int_to_user_key(u + 1));
                 }
                 subrange_id = 0;
                 break;
@@ -253,8 +253,8 @@ namespace leveldb {
                 Range new_range = {};
                 new_range.lower.assign(new_subranges->last().last().upper);
                 uint64_t u = 0;
-                nova::str_to_int(key.data(), &u, key.size());
-                new_range.upper.assign(std::to_string(u + 1));
+                u = nova::user_key_to_int(key.data(), key.size());
+                new_range.upper.assign(nova::int_to_user_key(u + 1));
                 sr.tiny_ranges.push_back(std::move(new_range));
                 new_subranges->subranges.push_back(std::move(sr));
                 subrange_id = new_subranges->subranges.size() - 1;
@@ -359,7 +359,7 @@ namespace leveldb {
                 while (it->Valid() && samples < sample_size) {
                     Slice userkey = ExtractUserKey(it->key());
                     uint64_t k = 0;
-                    nova::str_to_int(userkey.data(), &k, userkey.size());
+                    k = nova::user_key_to_int(userkey.data(), userkey.size());
                     userkey_rate[k] += insertion_ratio;
                     total_rate += insertion_ratio;
                     samples += 1;
@@ -508,8 +508,8 @@ namespace leveldb {
                 if (current_lower < it.first) {
                     current_upper = it.first;
                     Range r = {};
-                    r.lower = std::to_string(current_lower);
-                    r.upper = std::to_string((current_upper));
+                    r.lower = nova::int_to_user_key(current_lower);
+                    r.upper = nova::int_to_user_key((current_upper));
                     r.insertion_ratio = current_rate / total;
                     (*ranges).push_back(std::move(r));
                 }
@@ -517,8 +517,8 @@ namespace leveldb {
                 int num_duplicates = (int) std::ceil(rate / fair_rate);
                 for (int i = 0; i < num_duplicates; i++) {
                     Range r = {};
-                    r.lower = std::to_string(it.first);
-                    r.upper = std::to_string(it.first + 1);
+                    r.lower = nova::int_to_user_key(it.first);
+                    r.upper = nova::int_to_user_key(it.first + 1);
                     r.num_duplicates = num_duplicates;
                     r.insertion_ratio = rate / num_duplicates;
                     (*ranges).push_back(std::move(r));
@@ -535,8 +535,8 @@ namespace leveldb {
                 if (current_lower == it.first) {
                     current_upper = it.first + 1;
                     Range r = {};
-                    r.lower = std::to_string(current_lower);
-                    r.upper = std::to_string(current_upper);
+                    r.lower = nova::int_to_user_key(current_lower);
+                    r.upper = nova::int_to_user_key(current_upper);
                     r.insertion_ratio = current_rate / total;
                     (*ranges).push_back(std::move(r));
 
@@ -552,8 +552,8 @@ namespace leveldb {
                 } else {
                     current_upper = it.first;
                     Range r = {};
-                    r.lower = std::to_string(current_lower);
-                    r.upper = std::to_string(current_upper);
+                    r.lower = nova::int_to_user_key(current_lower);
+                    r.upper = nova::int_to_user_key(current_upper);
                     r.insertion_ratio = current_rate / total;
                     (*ranges).push_back(std::move(r));
 
@@ -572,20 +572,20 @@ namespace leveldb {
 
         if (is_constructing_subranges) {
             Range r = {};
-            r.lower = std::to_string(current_lower);
+            r.lower = nova::int_to_user_key(current_lower);
             ranges->push_back(std::move(r));
             NOVA_ASSERT(ranges->size() == num_ranges_to_construct);
         } else {
             if (current_lower < upper) {
                 Range r = {};
-                r.lower = std::to_string(current_lower);
+                r.lower = nova::int_to_user_key(current_lower);
                 ranges->push_back(std::move(r));
             }
             NOVA_ASSERT(ranges->size() <= num_ranges_to_construct);
         }
 
-        (*ranges)[0].lower = std::to_string(lower);
-        (*ranges->rbegin()).upper = std::to_string(upper);
+        (*ranges)[0].lower = nova::int_to_user_key(lower);
+        (*ranges->rbegin()).upper = nova::int_to_user_key(upper);
     }
 
     bool
@@ -676,8 +676,8 @@ namespace leveldb {
         for (int i = 0; i < new_num_duplicates; i++) {
             SubRange new_sr = {};
             Range tinyrange = {};
-            tinyrange.lower = std::to_string(lower);
-            tinyrange.upper = std::to_string(upper);
+            tinyrange.lower = nova::int_to_user_key(lower);
+            tinyrange.upper = nova::int_to_user_key(upper);
             tinyrange.ninserts = total_inserts / (new_num_duplicates + 1);
             tinyrange.insertion_ratio =
                     tinyrange.ninserts / total_num_inserts_since_last_major_;
@@ -943,7 +943,7 @@ namespace leveldb {
                     }
 
                     uint64_t k = 0;
-                    nova::str_to_int(uk.data(), &k, uk.size());
+                    k = nova::user_key_to_int(uk.data(), uk.size());
                     userkey_freq[k] += 1;
                     total_accesses += 1;
                     it->Next();
@@ -1225,8 +1225,8 @@ namespace leveldb {
             for (int i = 0; i < options_.num_memtable_partitions; i++) {
                 SubRange nsr;
                 Range r;
-                r.lower = std::to_string(lower);
-                r.upper = std::to_string(upper);
+                r.lower = nova::int_to_user_key(lower);
+                r.upper = nova::int_to_user_key(upper);
                 if (num_duplicates == 1) {
                     r.num_duplicates = 0;
                     nsr.num_duplicates = 0;
@@ -1257,8 +1257,8 @@ namespace leveldb {
                 }
                 SubRange nsr;
                 Range r;
-                r.lower = std::to_string(lower);
-                r.upper = std::to_string(upper);
+                r.lower = nova::int_to_user_key(lower);
+                r.upper = nova::int_to_user_key(upper);
                 nsr.tiny_ranges.push_back(r);
                 sr->subranges.push_back(nsr);
                 lower = upper;
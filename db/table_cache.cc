@@ -3,12 +3,15 @@
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 
 #include <fmt/core.h>
+#include <map>
+#include <semaphore.h>
 #include "db/table_cache.h"
 
 #include "ltc/stoc_file_client_impl.h"
 #include "db/filename.h"
 #include "leveldb/env.h"
 #include "leveldb/table.h"
+#include "table/two_level_iterator.h"
 #include "util/coding.h"
 
 namespace leveldb {
@@ -31,12 +34,169 @@ namespace leveldb {
         cache->Release(h);
     }
 
+    namespace {
+        // Reads the data blocks of a table ahead of a scan into the block
+        // cache. Each read posts its own semaphore so that a scan waits
+        // for the block it consumes and not for any other outstanding read
+        // of the StoC client. The window is bounded by "window_limit",
+        // which adapts to how many prefetched blocks scans use.
+        class DataBlockPrefetcher : public BlockPrefetcher {
+        public:
+            DataBlockPrefetcher(Table *table, const ReadOptions &options,
+                                std::atomic_uint_fast32_t *window_limit,
+                                uint32_t max_window)
+                    : table_(table), options_(options),
+                      window_limit_(window_limit), max_window_(max_window),
+                      client_(reinterpret_cast<StoCBlockClient *>(options.stoc_client)),
+                      iiter_(table->NewIndexIterator()) {
+                scid_ = options_.mem_manager->slabclassid(options_.thread_id,
+                                                          MAX_BLOCK_SIZE);
+            }
+
+            ~DataBlockPrefetcher() override {
+                // The StoC may still write into the buffers.
+                for (auto &it : reads_) {
+                    PrefetchRead *read = it.second;
+                    NOVA_ASSERT(sem_wait(&read->sem) == 0);
+                    Finish(read);
+                    if (options_.scan_stats) {
+                        options_.scan_stats->number_of_wasted_prefetches_ += 1;
+                    }
+                }
+                if (!reads_.empty()) {
+                    AdjustWindowLimit(false);
+                } else if (hits_ > 0) {
+                    AdjustWindowLimit(true);
+                }
+                delete iiter_;
+            }
+
+            void Prefetch(const Slice &index_key, uint32_t window) override {
+                iiter_->Seek(index_key);
+                for (uint32_t i = 0; i < window; i++) {
+                    iiter_->Next();
+                    if (!iiter_->Valid() || reads_.size() >= max_window()) {
+                        return;
+                    }
+                    Read(iiter_->value());
+                }
+            }
+
+            void Complete(const Slice &index_value) override {
+                auto it = reads_.find(index_value.ToString());
+                if (it == reads_.end()) {
+                    return;
+                }
+                PrefetchRead *read = it->second;
+                reads_.erase(it);
+                bool stall = false;
+                if (sem_trywait(&read->sem) != 0) {
+                    stall = true;
+                    NOVA_ASSERT(sem_wait(&read->sem) == 0);
+                }
+                Finish(read);
+                hits_ += 1;
+                if (options_.scan_stats) {
+                    options_.scan_stats->number_of_prefetch_hits_ += 1;
+                    if (stall) {
+                        options_.scan_stats->number_of_prefetch_stalls_ += 1;
+                    }
+                }
+            }
+
+            uint32_t max_window() const override {
+                return window_limit_->load(std::memory_order_relaxed);
+            }
+
+        private:
+            // Halve the window limit or double it up to max_window_.
+            void AdjustWindowLimit(bool grow) {
+                uint_fast32_t limit = window_limit_->load(
+                        std::memory_order_relaxed);
+                uint_fast32_t new_limit;
+                do {
+                    if (grow) {
+                        new_limit = std::min<uint_fast32_t>(limit * 2,
+                                                            max_window_);
+                    } else {
+                        new_limit = std::max<uint_fast32_t>(limit / 2, 1);
+                    }
+                } while (new_limit != limit &&
+                         !window_limit_->compare_exchange_weak(
+                                 limit, new_limit,
+                                 std::memory_order_relaxed));
+            }
+
+            struct PrefetchRead {
+                DataBlockPrefetch block;
+                char *buf = nullptr;
+                sem_t sem;
+            };
+
+            void Read(const Slice &index_value) {
+                std::string key = index_value.ToString();
+                if (reads_.find(key) != reads_.end()) {
+                    return;
+                }
+                auto read = new PrefetchRead;
+                if (!table_->UncachedDataBlock(index_value, &read->block)) {
+                    delete read;
+                    return;
+                }
+                uint64_t n = read->block.handle.size + kBlockTrailerSize;
+                NOVA_ASSERT(n < MAX_BLOCK_SIZE);
+                read->buf = options_.mem_manager->ItemAlloc(options_.thread_id,
+                                                            scid_);
+                NOVA_ASSERT(read->buf);
+                NOVA_ASSERT(sem_init(&read->sem, 0, 0) == 0);
+                client_->InitiateReadDataBlock(read->block.handle,
+                                               read->block.handle.offset, n,
+                                               read->buf, n, "", true,
+                                               &read->sem);
+                reads_[key] = read;
+                if (options_.scan_stats) {
+                    options_.scan_stats->number_of_prefetched_blocks_ += 1;
+                }
+            }
+
+            // Insert the block of a completed read into the block cache.
+            void Finish(PrefetchRead *read) {
+                uint64_t n = read->block.handle.size + kBlockTrailerSize;
+                NOVA_ASSERT(nova::IsRDMAWRITEComplete(read->buf, n))
+                    << fmt::format("t[{}]: {}", options_.thread_id,
+                                   read->block.handle.DebugString());
+                // Scan blocks must not evict the blocks of point lookups.
+                Status s = table_->InsertDataBlock(options_, read->block,
+                                                   read->buf,
+                                                   Cache::Priority::kLow);
+                NOVA_ASSERT(s.ok()) << s.ToString();
+                options_.mem_manager->FreeItem(options_.thread_id, read->buf,
+                                               scid_);
+                sem_destroy(&read->sem);
+                delete read;
+            }
+
+            Table *table_ = nullptr;
+            const ReadOptions options_;
+            std::atomic_uint_fast32_t *window_limit_ = nullptr;
+            const uint32_t max_window_ = 0;
+            // Number of prefetched blocks the scan used.
+            uint32_t hits_ = 0;
+            StoCBlockClient *client_ = nullptr;
+            Iterator *iiter_ = nullptr;
+            uint32_t scid_ = 0;
+            // Outstanding reads keyed by the index value of the block.
+            std::map<std::string, PrefetchRead *> reads_;
+        };
+    }
+
     TableCache::TableCache(const std::string &dbname, const Options &options,
                            int entries, DBProfiler *db_profiler)
             : env_(options.env),
               dbname_(dbname),
               options_(options),
-              cache_(NewLRUCache(entries)), db_profiler_(db_profiler) {}
+              cache_(NewLRUCache(entries)), db_profiler_(db_profiler),
+              prefetch_window_limit_(options.scan_prefetch_max_blocks) {}
 
     TableCache::~TableCache() { delete cache_; }
 
@@ -174,7 +334,16 @@ namespace leveldb {
         Table *table = reinterpret_cast<TableAndFile *>(cache_->Value(
                 handle))->table;
 
-        Iterator *result = table->NewIterator(caller, options);
+        BlockPrefetcher *prefetcher = nullptr;
+        if (caller == AccessCaller::kUserIterator &&
+            options_.scan_prefetch_max_blocks > 0 &&
+            options_.block_cache != nullptr &&
+            options.stoc_client != nullptr && options.mem_manager != nullptr) {
+            prefetcher = new DataBlockPrefetcher(table, options,
+                                                 &prefetch_window_limit_,
+                                                 options_.scan_prefetch_max_blocks);
+        }
+        Iterator *result = table->NewIterator(caller, options, prefetcher);
         result->RegisterCleanup(&UnrefEntry, cache_, handle);
         if (tableptr != nullptr) {
             *tableptr = table;
@@ -201,6 +370,81 @@ namespace leveldb {
         return s;
     }
 
+    void TableCache::PrefetchDataBlocks(const ReadOptions &options,
+                                        const std::vector<MultiGetTable> &tables) {
+        if (options.stoc_client == nullptr || options.mem_manager == nullptr) {
+            return;
+        }
+        std::vector<Cache::Handle *> handles;
+        std::vector<DataBlockPrefetch> blocks;
+        for (const auto &t : tables) {
+            Cache::Handle *handle = nullptr;
+            Status s = FindTable(AccessCaller::kUserGet, options, t.meta,
+                                 t.meta->number, t.meta->SelectReplica(),
+                                 t.meta->converted_file_size, t.level,
+                                 &handle);
+            if (!s.ok()) {
+                continue;
+            }
+            Table *table = reinterpret_cast<TableAndFile *>(cache_->Value(
+                    handle))->table;
+            table->CollectUncachedDataBlocks(t.keys, &blocks);
+            handles.push_back(handle);
+        }
+
+        auto client = reinterpret_cast<StoCBlockClient *>(options.stoc_client);
+        uint32_t scid = options.mem_manager->slabclassid(options.thread_id,
+                                                         MAX_BLOCK_SIZE);
+        // Read at most kMaxInflightBlockReads blocks at a time. Each read
+        // holds a MAX_BLOCK_SIZE buffer until it completes.
+        const uint32_t kMaxInflightBlockReads = 32;
+        std::vector<char *> bufs;
+        uint32_t next = 0;
+        while (next < blocks.size()) {
+            uint32_t start = next;
+            bufs.clear();
+            while (next < blocks.size() &&
+                   bufs.size() < kMaxInflightBlockReads) {
+                const auto &block = blocks[next];
+                uint64_t n = block.handle.size + kBlockTrailerSize;
+                NOVA_ASSERT(n < MAX_BLOCK_SIZE);
+                char *buf = options.mem_manager->ItemAlloc(options.thread_id,
+                                                           scid);
+                if (buf == nullptr) {
+                    break;
+                }
+                client->InitiateReadDataBlock(block.handle,
+                                              block.handle.offset, n, buf, n,
+                                              "", true);
+                bufs.push_back(buf);
+                next++;
+            }
+            if (bufs.empty()) {
+                // Out of memory. Get reads the remaining blocks.
+                break;
+            }
+            for (int i = 0; i < bufs.size(); i++) {
+                client->Wait();
+            }
+            for (int i = 0; i < bufs.size(); i++) {
+                const auto &block = blocks[start + i];
+                uint64_t n = block.handle.size + kBlockTrailerSize;
+                NOVA_ASSERT(nova::IsRDMAWRITEComplete(bufs[i], n))
+                    << fmt::format("t[{}]: {}", options.thread_id,
+                                   block.handle.DebugString());
+                Status s = block.table->InsertDataBlock(options, block,
+                                                        bufs[i],
+                                                        Cache::Priority::kHigh);
+                NOVA_ASSERT(s.ok()) << s.ToString();
+                options.mem_manager->FreeItem(options.thread_id, bufs[i],
+                                              scid);
+            }
+        }
+        for (auto handle : handles) {
+            cache_->Release(handle);
+        }
+    }
+
     void TableCache::Evict(uint64_t file_number, bool compaction_file_only) {
         char buf[1 + 8 + 4];
         buf[0] = 'c';
@@ -9,7 +9,9 @@
 
 #include <stdint.h>
 
+#include <atomic>
 #include <string>
+#include <vector>
 
 #include "db/dbformat.h"
 #include "leveldb/cache.h"
@@ -20,6 +22,13 @@ namespace leveldb {
 
     class Env;
 
+    // The sorted internal keys to look up in one table.
+    struct MultiGetTable {
+        const FileMetaData *meta = nullptr;
+        int level = 0;
+        std::vector<Slice> keys;
+    };
+
     class TableCache {
     public:
         TableCache(const std::string &dbname, const Options &options,
@@ -47,6 +56,11 @@ namespace leveldb {
                    uint64_t file_size, int level, const Slice &k, void *arg,
                    void (*handle_result)(void *, const Slice &, const Slice &));
 
+        // Read the data blocks that may contain the keys into the block cache.
+        // The reads of all blocks are issued before waiting for any of them.
+        void PrefetchDataBlocks(const ReadOptions &options,
+                                const std::vector<MultiGetTable> &tables);
+
         // Evict any entry for the specified file number
         void
         Evict(uint64_t file_number, bool compaction_file_only);
@@ -65,6 +79,10 @@ namespace leveldb {
         const std::string dbname_;
         const Options options_;
         DBProfiler *db_profiler_ = nullptr;
+        // Read-ahead window limit shared by all scans. It halves when a
+        // scan leaves prefetched blocks unused and doubles up to
+        // scan_prefetch_max_blocks when a scan uses all of them.
+        std::atomic_uint_fast32_t prefetch_window_limit_;
     };
 
 }  // namespace leveldb
@@ -70,7 +70,9 @@ namespace leveldb {
                 const InternalKey &smallest,
                 const InternalKey &largest,
                 const std::vector<FileReplicaMetaData>& replicas,
-                StoCBlockHandle parity_block_handle) {
+                const std::vector<StoCBlockHandle>& parity_block_handles,
+                uint64_t num_entries = 0,
+                uint64_t num_deletions = 0) {
             FileMetaData f;
             f.level = level;
             f.memtable_ids = memtable_ids;
@@ -81,7 +83,9 @@ namespace leveldb {
             f.smallest = smallest;
             f.largest = largest;
             f.block_replica_handles = replicas;
-            f.parity_block_handle = parity_block_handle;
+            f.parity_block_handles = parity_block_handles;
+            f.num_entries = num_entries;
+            f.num_deletions = num_deletions;
             new_files_.emplace_back(std::make_pair(level, f));
         }
 
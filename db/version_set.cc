@@ -50,7 +50,14 @@ namespace leveldb {
     }
 
     Version::~Version() {
+        delete l0_index_;
+    }
 
+    const L0IntervalIndex *Version::l0_index() {
+        std::call_once(l0_index_once_, [this]() {
+            l0_index_ = new L0IntervalIndex(icmp_->user_comparator(), files_[0]);
+        });
+        return l0_index_;
     }
 
     int FindFile(const InternalKeyComparator &icmp,
@@ -164,12 +171,11 @@ namespace leveldb {
 
             auto userkey = ExtractUserKey(target);
             uint64_t userkeyint;
-            nova::str_to_int(userkey.data(), &userkeyint, userkey.size());
+            userkeyint = nova::user_key_to_int(userkey.data(), userkey.size());
             while (Valid()) {
                 auto current_key = ExtractUserKey(key());
                 uint64_t pivot = 0;
-                nova::str_to_int(current_key.data(), &pivot,
-                                 current_key.size());
+                pivot = nova::user_key_to_int(current_key.data(), current_key.size());
                 NOVA_LOG(rdmaio::DEBUG)
                     << fmt::format("Level file skip:{} {}", userkeyint, pivot);
 
@@ -262,7 +268,9 @@ namespace leveldb {
     void Version::AddIterators(const ReadOptions &options,
                                const RangeIndex *range_index,
                                std::vector<Iterator *> *iters,
-                               ScanStats *stats) {
+                               ScanStats *stats,
+                               const Slice *smallest_user_key,
+                               const Slice *largest_user_key) {
         NOVA_ASSERT(range_index);
         NOVA_ASSERT(iters);
         BlockReadContext context = {
@@ -278,10 +286,19 @@ namespace leveldb {
         // walks through the non-overlapping files in the level, opening them
         // lazily.
         for (int level = 1; level < options_->level; level++) {
-            if (!files_[level].empty()) {
-                iters->push_back(
-                        NewConcatenatingIterator(options, level, stats));
+            if (files_[level].empty()) {
+                continue;
+            }
+            if (smallest_user_key && largest_user_key &&
+                !SomeFileOverlapsRange(*icmp_, true, files_[level],
+                                       smallest_user_key, largest_user_key)) {
+                if (stats) {
+                    stats->number_of_scan_pruned_levels_ += 1;
+                }
+                continue;
             }
+            iters->push_back(
+                    NewConcatenatingIterator(options, level, stats));
         }
     }
 
@@ -311,8 +328,8 @@ namespace leveldb {
                 s->state = (parsed_key.type == kTypeValue) ? kFound : kDeleted;
                 if (s->state == kFound) {
                     s->value->assign(v.data(), v.size());
-                    *s->seq = parsed_key.sequence;
                 }
+                *s->seq = parsed_key.sequence;
             }
         }
     }
@@ -328,17 +345,10 @@ namespace leveldb {
         const Comparator *ucmp = icmp_->user_comparator();
         // Search level-0 first.
         if (search_scope == GetSearchScope::kAllLevels) {
-            std::vector<FileMetaData *> tmp;
-            tmp.reserve(files_[0].size());
-            for (uint32_t i = 0; i < files_[0].size(); i++) {
-                FileMetaData *f = files_[0][i];
-                if (ucmp->Compare(user_key, f->smallest.user_key()) >= 0 &&
-                    ucmp->Compare(user_key, f->largest.user_key()) <= 0) {
-                    tmp.push_back(f);
-                }
-            }
+            std::vector<uint32_t> tmp;
+            l0_index()->Overlapping(user_key, &tmp);
             for (uint32_t i = 0; i < tmp.size(); i++) {
-                if (nova::NovaConfig::config->use_ordered_flush && !(*func)(arg, 0, tmp[i])) {
+                if (nova::NovaConfig::config->use_ordered_flush && !(*func)(arg, 0, files_[0][tmp[i]])) {
                     return;
                 }
             }
@@ -370,37 +380,77 @@ namespace leveldb {
         }
     }
 
+    void Version::AddCandidateFiles(const Slice &user_key,
+                                    const Slice &internal_key,
+                                    GetSearchScope search_scope,
+                                    std::vector<std::pair<int, FileMetaData *>> *files) {
+        const Comparator *ucmp = icmp_->user_comparator();
+        if (search_scope != GetSearchScope::kL1AndAbove) {
+            std::vector<uint32_t> positions;
+            l0_index()->Overlapping(user_key, &positions);
+            for (uint32_t pos : positions) {
+                files->emplace_back(0, files_[0][pos]);
+            }
+        }
+        for (int level = 1; level < options_->level; level++) {
+            uint32_t index = FindFile(*icmp_, files_[level], internal_key);
+            if (index < files_[level].size()) {
+                FileMetaData *f = files_[level][index];
+                if (ucmp->Compare(user_key, f->smallest.user_key()) >= 0) {
+                    files->emplace_back(level, f);
+                }
+            }
+        }
+    }
+
     Status Version::Get(const leveldb::ReadOptions &options,
                         std::vector<uint64_t> &fns,
                         const leveldb::LookupKey &key,
                         SequenceNumber *seq,
-                        std::string *val, uint64_t *num_searched_files) {
+                        std::string *val, uint64_t *num_searched_files,
+                        bool *deleted) {
         bool found = false;
+        *deleted = false;
+        SequenceNumber newest_seq = 0;
+        std::string tmp_val;
+        // The L0 files that contain the key. A file in "fns" is skipped
+        // without comparing keys if it is in L0 but not in "overlapping".
+        const L0IntervalIndex *index = l0_index();
+        std::vector<uint32_t> overlapping;
+        index->Overlapping(key.user_key(), &overlapping);
         for (int i = fns.size() - 1; i >= 0; i--) {
             auto fn = fns[i];
-            if (fn_files_.find(fn) == fn_files_.end()) {
-                return Status::IOError(fmt::format("fn {} not found", fn));
+            FileMetaData *file = nullptr;
+            int pos = index->Position(fn);
+            if (pos != -1) {
+                if (!std::binary_search(overlapping.begin(), overlapping.end(), (uint32_t) pos)) {
+                    continue;
+                }
+                file = files_[0][pos];
+            } else {
+                // Not in L0.
+                if (fn_files_.find(fn) == fn_files_.end()) {
+                    return Status::IOError(fmt::format("fn {} not found", fn));
+                }
+                file = fn_files_[fn];
+                NOVA_ASSERT(file) << fn;
+                if (icmp_->user_comparator()->Compare(
+                        file->smallest.user_key(), key.user_key()) > 0) {
+                    continue;
+                }
+                if (icmp_->user_comparator()->Compare(
+                        file->largest.user_key(), key.user_key()) < 0) {
+                    continue;
+                }
             }
-
-            FileMetaData *file = fn_files_[fn];
-            NOVA_ASSERT(file) << fn;
             NOVA_ASSERT(file->number == fn);
-
-            if (icmp_->user_comparator()->Compare(
-                    file->smallest.user_key(), key.user_key()) > 0) {
-                continue;
-            }
-            if (icmp_->user_comparator()->Compare(
-                    file->largest.user_key(), key.user_key()) < 0) {
-                continue;
-            }
             *num_searched_files += 1;
             SequenceNumber tmp_seq;
             Saver saver;
             saver.state = kNotFound;
             saver.ucmp = icmp_->user_comparator();
             saver.user_key = key.user_key();
-            saver.value = val;
+            saver.value = &tmp_val;
             saver.seq = &tmp_seq;
             Status s = table_cache_->Get(options,
                                          file,
@@ -411,14 +461,22 @@ namespace leveldb {
                                          key.internal_key(),
                                          &saver,
                                          SaveValue);
-            if (saver.state == kFound) {
-                found = true;
-                if (tmp_seq > *seq) {
-                    // A newer value.
-                    *seq = tmp_seq;
-//                    val->assign(tmp_val);
-                }
+            if (saver.state != kFound && saver.state != kDeleted) {
+                continue;
             }
+            if ((found || *deleted) && tmp_seq <= newest_seq) {
+                continue;
+            }
+            // A newer value or deletion.
+            newest_seq = tmp_seq;
+            found = saver.state == kFound;
+            *deleted = saver.state == kDeleted;
+            if (found) {
+                val->swap(tmp_val);
+            }
+        }
+        if ((found || *deleted) && newest_seq > *seq) {
+            *seq = newest_seq;
         }
         if (found) {
             return Status::OK();
@@ -537,8 +595,8 @@ namespace leveldb {
             OverlappingStats stats = {};
             stats.num_overlapping_tables = 1;
             stats.total_size = pivot_it->second->file_size;
-            nova::str_to_int(lower.data(), &stats.smallest, lower.size());
-            nova::str_to_int(upper.data(), &stats.largest, upper.size());
+            stats.smallest = nova::user_key_to_int(lower.data(), lower.size());
+            stats.largest = nova::user_key_to_int(upper.data(), upper.size());
 
             for (auto comp_it = files->begin();
                  comp_it != files->end(); comp_it++) {
@@ -713,8 +771,8 @@ namespace leveldb {
                 it = files->erase(it);
                 it = files->begin();
             }
-            nova::str_to_int(lower.data(), &stats.smallest, lower.size());
-            nova::str_to_int(upper.data(), &stats.largest, upper.size());
+            stats.smallest = nova::user_key_to_int(lower.data(), lower.size());
+            stats.largest = nova::user_key_to_int(upper.data(), upper.size());
             num_overlapping->push_back(stats);
         }
 
@@ -1238,6 +1296,20 @@ namespace leveldb {
                     score = static_cast<double>(level_bytes) / MaxBytesForLevel(*options_, level);
                 }
             }
+            if (options_->tombstone_compaction_density > 0) {
+                // A level full of deletion markers is worth compacting
+                // before it reaches its size limit.
+                uint64_t entries = 0;
+                uint64_t deletions = 0;
+                for (auto f : v->files_[level]) {
+                    entries += f->num_entries;
+                    deletions += f->num_deletions;
+                }
+                if (entries > 0) {
+                    double density = static_cast<double>(deletions) / entries;
+                    score = std::max(score, density / options_->tombstone_compaction_density);
+                }
+            }
             if (score > best_score) {
                 best_level = level;
                 best_score = score;
@@ -1476,7 +1548,7 @@ namespace leveldb {
             }
         }
         assert(num <= space);
-        Iterator *result = NewMergingIterator(icmp_, list, num);
+        Iterator *result = NewCompactionMergingIterator(icmp_, list, num);
         delete[] list;
         return result;
     }
@@ -1733,6 +1805,53 @@ namespace leveldb {
         }
     }
 
+    void Version::ComputeDeeperRanges(Compaction *c,
+                                      SequenceNumber smallest_unflushed_sequence) {
+        std::set<uint64_t> input_files;
+        std::vector<FileMetaData *> tables;
+        for (int which = 0; which < 2; which++) {
+            for (auto f : c->inputs_[which]) {
+                input_files.insert(f->number);
+                tables.push_back(f);
+            }
+        }
+        if (tables.empty()) {
+            return;
+        }
+        Slice smallest;
+        Slice largest;
+        GetRange(tables, &smallest, &largest);
+        // L0 files that are not inputs may overlap the inputs too.
+        std::vector<FileMetaData *> overlaps;
+        for (int level = c->level(); level < options_->level; level++) {
+            GetOverlappingInputs(files_[level], smallest, largest, &overlaps,
+                                 UINT32_MAX, input_files);
+        }
+        const Comparator *user_cmp = icmp_->user_comparator();
+        std::sort(overlaps.begin(), overlaps.end(),
+                  [&](FileMetaData *f1, FileMetaData *f2) {
+                      return user_cmp->Compare(f1->smallest.user_key(),
+                                               f2->smallest.user_key()) < 0;
+                  });
+        c->deeper_ranges_.clear();
+        for (auto f : overlaps) {
+            if (!c->deeper_ranges_.empty() &&
+                user_cmp->Compare(f->smallest.user_key(),
+                                  c->deeper_ranges_.back().second) <= 0) {
+                // Merge with the previous range.
+                if (user_cmp->Compare(f->largest.user_key(),
+                                      c->deeper_ranges_.back().second) > 0) {
+                    c->deeper_ranges_.back().second = f->largest.user_key().ToString();
+                }
+                continue;
+            }
+            c->deeper_ranges_.emplace_back(f->smallest.user_key().ToString(),
+                                           f->largest.user_key().ToString());
+        }
+        c->smallest_unflushed_sequence_ = smallest_unflushed_sequence;
+        c->drop_obsolete_deletions_ = true;
+    }
+
     void Version::GetOverlappingInputs(
             std::vector<leveldb::FileMetaData *> &inputs,
             const leveldb::Slice &begin, const leveldb::Slice &end,
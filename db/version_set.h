@@ -16,6 +16,7 @@
 #define STORAGE_LEVELDB_DB_VERSION_SET_H_
 
 #include <map>
+#include <mutex>
 #include <set>
 #include <vector>
 #include <atomic>
@@ -28,6 +29,7 @@
 #include "ltc/stoc_file_client_impl.h"
 #include "table_cache.h"
 #include "range_index.h"
+#include "l0_interval_index.h"
 
 // Maintain this many live memtables.
 // The program exits when the number of memtables exceeds this threshold.
@@ -123,18 +125,33 @@ namespace leveldb {
         // Append to *iters a sequence of iterators that will
         // yield the contents of this Version when merged together.
         // REQUIRES: This version has been saved (see VersionSet::SaveTo)
+        // If "smallest_user_key" and "largest_user_key" are non-null, only
+        // levels with a file that overlaps [*smallest_user_key,
+        // *largest_user_key] are added.
         void AddIterators(const ReadOptions &, const RangeIndex *range_index,
-                          std::vector<Iterator *> *iters, ScanStats *stats);
+                          std::vector<Iterator *> *iters, ScanStats *stats,
+                          const Slice *smallest_user_key = nullptr,
+                          const Slice *largest_user_key = nullptr);
 
         Status
         Get(const ReadOptions &, const LookupKey &key, SequenceNumber *seq,
             std::string *val, GetStats *stats, GetSearchScope search_scope,
             uint64_t *num_searched_files);
 
+        // Search the L0 files "fns" for the newest entry of "key". Return
+        // NotFound and set *deleted if the newest entry is a deletion.
         Status Get(const ReadOptions &, std::vector<uint64_t> &fns,
                    const LookupKey &key,
                    SequenceNumber *seq,
-                   std::string *val, uint64_t *num_searched_files);
+                   std::string *val, uint64_t *num_searched_files,
+                   bool *deleted);
+
+        // Append (level, file) of every file that may contain user_key to
+        // *files. Unlike Get, it does not stop at the first file that
+        // contains the key.
+        void AddCandidateFiles(const Slice &user_key, const Slice &internal_key,
+                               GetSearchScope search_scope,
+                               std::vector<std::pair<int, FileMetaData *>> *files);
 
         // Reference count management (so Versions do not disappear out from
         // under live iterators)
@@ -177,6 +194,13 @@ namespace leveldb {
 
         void ComputeNonOverlappingSet(std::vector<Compaction *> *compactions, bool *delete_due_to_low_overlap);
 
+        // Collect the key ranges of the files that may hold older entries
+        // of the keys in "c" so that "c" drops obsolete deletions.
+        // "smallest_unflushed_sequence" is the smallest sequence number of
+        // the memtables whose entries are not in this version.
+        void ComputeDeeperRanges(Compaction *c,
+                                 SequenceNumber smallest_unflushed_sequence);
+
         bool
         AssertNonOverlappingSet(const std::vector<Compaction *> &compactions,
                                 std::string *reason);
@@ -221,6 +245,10 @@ namespace leveldb {
 
         int refs_ = 0;          // Number of live refs to this version
 
+        // The interval index of files_[0]. It is built by the first lookup
+        // since a version is immutable once installed.
+        const L0IntervalIndex *l0_index();
+
     private:
         friend class Compaction;
 
@@ -232,6 +260,9 @@ namespace leveldb {
 
         Version &operator=(const Version &) = delete;
 
+        std::once_flag l0_index_once_;
+        L0IntervalIndex *l0_index_ = nullptr;
+
         void GetOverlappingInputs(
                 std::vector<FileMetaData *> &inputs,
                 const Slice &begin,  // nullptr means before all keys
@@ -31,6 +31,13 @@ namespace leveldb {
 // of Cache uses a least-recently-used eviction policy.
     LEVELDB_EXPORT Cache *NewLRUCache(size_t capacity);
 
+// Create a new cache with a fixed size capacity that uses a segmented LRU
+// eviction policy. An entry that is hit after its insertion moves to a
+// protected segment of "protected_ratio" of the capacity. Entries that are
+// read only once, e.g., by a scan, are evicted before protected entries.
+    LEVELDB_EXPORT Cache *NewSegmentedLRUCache(size_t capacity,
+                                               double protected_ratio);
+
     class LEVELDB_EXPORT Cache {
     public:
         Cache() = default;
@@ -47,6 +54,12 @@ namespace leveldb {
         struct Handle {
         };
 
+        // Low priority entries are evicted before other unreferenced
+        // entries until they are looked up.
+        enum class Priority {
+            kHigh, kLow
+        };
+
         // Insert a mapping from key->value into the cache and assign it
         // the specified charge against the total cache capacity.
         //
@@ -60,6 +73,14 @@ namespace leveldb {
                                void (*deleter)(const Slice &key,
                                                void *value)) = 0;
 
+        // Same as above but inserts the entry with "priority". The default
+        // ignores the priority.
+        virtual Handle *Insert(const Slice &key, void *value, size_t charge,
+                               void (*deleter)(const Slice &key, void *value),
+                               Priority priority) {
+            return Insert(key, value, charge, deleter);
+        }
+
         // If the cache has no mapping for "key", returns nullptr.
         //
         // Else return a handle that corresponds to the mapping.  The caller
@@ -5,6 +5,7 @@
 #ifndef STORAGE_LEVELDB_INCLUDE_COMPARATOR_H_
 #define STORAGE_LEVELDB_INCLUDE_COMPARATOR_H_
 
+#include <stdint.h>
 #include <string>
 
 #include "leveldb/export.h"
@@ -52,6 +53,13 @@ namespace leveldb {
         // Simple comparator implementations may return with *key unchanged,
         // i.e., an implementation of this method that does nothing is correct.
         virtual void FindShortSuccessor(std::string *key) const = 0;
+
+        // Optional. If the order of "key" is the order of an unsigned 64-bit
+        // integer, store the integer in *value and return true. It allows
+        // sorting keys with a radix sort instead of comparisons.
+        virtual bool KeyToInt(const Slice &key, uint64_t *value) const {
+            return false;
+        }
     };
 
 // Return a builtin comparator that uses lexicographic byte-wise
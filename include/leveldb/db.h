@@ -141,6 +141,19 @@ namespace leveldb {
         virtual Status
         Delete(const WriteOptions &options, const Slice &key) = 0;
 
+        // Apply the updates in "updates" to the database. The updates get
+        // consecutive sequence numbers.
+        //
+        // The batch is not atomic as a whole. With subranges its entries
+        // are grouped by the subrange they belong to, and each group is
+        // logged and inserted into its own memtable separately. A group
+        // whose log records exceed rdma_backing_mem_size is replicated in
+        // several parts. Concurrent readers may see part of the batch, and
+        // recovery restores the parts whose log records were replicated.
+        // Returns OK on success, non-OK on failure.
+        virtual Status
+        Write(const WriteOptions &options, WriteBatch *updates) = 0;
+
         // Apply the specified updates to the database.
         // Returns OK on success, non-OK on failure.
         // Note: consider setting options.sync = true.
@@ -158,6 +171,17 @@ namespace leveldb {
         virtual Status Get(const ReadOptions &options, const Slice &key,
                            std::string *value) = 0;
 
+        // Look up all keys. (*values)[i] and (*statuses)[i] are the result of
+        // Get(options, keys[i], ...). The data blocks of all keys are read in
+        // parallel into the block cache. Without a block cache the keys are
+        // looked up one by one.
+        //
+        // Returns OK if no lookup failed with an error other than NotFound.
+        virtual Status MultiGet(const ReadOptions &options,
+                                const std::vector<Slice> &keys,
+                                std::vector<std::string> *values,
+                                std::vector<Status> *statuses) = 0;
+
         virtual void StartTracing() = 0;
 
         virtual void TestCompact(EnvBGThread *bg_thread,
@@ -199,6 +223,13 @@ namespace leveldb {
         //     of the sstables that make up the db contents.
         //  "leveldb.approximate-memory-usage" - returns the approximate number of
         //     bytes of memory in use by the DB.
+        //  "leveldb.log-group-commit" - returns the number of group commits,
+        //     log records, bytes, average batch size and the batch size
+        //     histogram of log record replication.
+        //  "leveldb.lookup-index" - returns the number of slots, entries,
+        //     tombstones, bytes, bytes per entry, lookups, hits, hit rate,
+        //     false positives, false positive rate, resizes and garbage
+        //     collected entries of the lookup index.
         virtual bool GetProperty(const Slice &property, std::string *value) = 0;
 
         // For each i in [0,n-1], store in "sizes[i]", the approximate
@@ -247,8 +278,9 @@ namespace leveldb {
         uint64_t number_of_steals_ = 0;
         uint64_t number_of_wait_due_to_contention_ = 0;
         uint64_t processed_writes_ = 0;
-        uint64_t number_of_puts_no_wait_ = 0;
+        std::atomic_int_fast64_t number_of_puts_no_wait_{0};
         uint64_t number_of_puts_wait_ = 0;
+        std::atomic_int_fast64_t number_of_lockfree_memtable_selections_{0};
     };
 
 // Destroy the contents of the specified database.
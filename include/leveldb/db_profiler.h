@@ -9,7 +9,9 @@
 
 #include "leveldb/export.h"
 #include "port/port.h"
+#include <atomic>
 #include <fstream>
+#include <string>
 #include <vector>
 
 namespace leveldb {
@@ -30,6 +32,8 @@ namespace leveldb {
         kApproximateSize = 5,
     };
 
+#define NUM_ACCESS_CALLERS 6
+
     struct BlockReadContext {
         AccessCaller caller;
         uint64_t file_number;
@@ -74,6 +78,14 @@ namespace leveldb {
 
         void Trace(CompactionProfiler compaction);
 
+        // Record a block cache lookup of a data block by "caller". It is
+        // recorded even if tracing is disabled.
+        void RecordBlockCacheAccess(AccessCaller caller, bool hit);
+
+        // Block cache hit ratio of data blocks per access caller:
+        // caller,lookups,hits,hit ratio. One line per caller.
+        std::string BlockCacheStats() const;
+
         void Close();
 
     private:
@@ -89,6 +101,9 @@ namespace leveldb {
 
         Access *accesses_ GUARDED_BY(mutex_);
         uint32_t index_ GUARDED_BY(mutex_) = 0;
+
+        std::atomic_uint_fast64_t block_cache_lookups_[NUM_ACCESS_CALLERS];
+        std::atomic_uint_fast64_t block_cache_hits_[NUM_ACCESS_CALLERS];
     };
 }
 
@@ -64,12 +64,34 @@ namespace leveldb {
         uint64_t number_of_scan_memtables_ = 0;
         uint64_t number_of_scan_l0_sstables_ = 0;
         uint64_t number_of_scan_sstables_ = 0;
+        // Data blocks read by scans.
+        uint64_t number_of_scan_data_blocks_ = 0;
+        // Data blocks read ahead from StoCs.
+        uint64_t number_of_prefetched_blocks_ = 0;
+        // Prefetched data blocks that a scan consumed.
+        uint64_t number_of_prefetch_hits_ = 0;
+        // Prefetched data blocks that a scan had to wait for.
+        uint64_t number_of_prefetch_stalls_ = 0;
+        // Prefetched data blocks that no scan consumed.
+        uint64_t number_of_wasted_prefetches_ = 0;
+        // Levels that scans did not open since they do not overlap the
+        // expected scan range.
+        uint64_t number_of_scan_pruned_levels_ = 0;
+        // Scans that read past the expected scan range and opened all tables.
+        uint64_t number_of_scan_full_iterators_ = 0;
 
         std::string DebugString() {
-            return fmt::format("{}-{}-{}-{}", number_of_scans_,
+            return fmt::format("{}-{}-{}-{}-{}-{}-{}-{}-{}-{}-{}", number_of_scans_,
                                number_of_scan_memtables_,
                                number_of_scan_l0_sstables_,
-                               number_of_scan_sstables_);
+                               number_of_scan_sstables_,
+                               number_of_scan_data_blocks_,
+                               number_of_prefetched_blocks_,
+                               number_of_prefetch_hits_,
+                               number_of_prefetch_stalls_,
+                               number_of_wasted_prefetches_,
+                               number_of_scan_pruned_levels_,
+                               number_of_scan_full_iterators_);
         }
     };
 
@@ -191,7 +213,11 @@ namespace leveldb {
         InternalKey largest;   // Largest internal key served by table
         FileCompactionStatus compaction_status;
         std::vector<FileReplicaMetaData> block_replica_handles = {};
-        StoCBlockHandle parity_block_handle;
+        // One handle per parity fragment of the data block groups.
+        std::vector<StoCBlockHandle> parity_block_handles = {};
+        // Number of entries and deletion markers in the table.
+        uint64_t num_entries = 0;
+        uint64_t num_deletions = 0;
     };
 
     class LEVELDB_EXPORT MemManager {
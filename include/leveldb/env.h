@@ -303,6 +303,10 @@ namespace leveldb {
         virtual Status Flush() = 0;
 
         virtual Status Sync() = 0;
+
+        // Returns the file descriptor of the file or -1 if the file is not
+        // backed by one.
+        virtual int fd() { return -1; }
     };
 
 // A file abstraction for sequential writing.  The implementation
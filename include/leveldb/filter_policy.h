@@ -43,6 +43,16 @@ namespace leveldb {
         virtual void CreateFilter(const Slice *keys, int n,
                                   std::string *dst) const = 0;
 
+        // Same as CreateFilter() but uses approximately "bits_per_key" bits
+        // per key instead of the policy's default. The filter must remain
+        // readable by KeyMayMatch() of this policy. The default ignores
+        // "bits_per_key".
+        virtual void CreateFilterWithBitsPerKey(const Slice *keys, int n,
+                                                int bits_per_key,
+                                                std::string *dst) const {
+            CreateFilter(keys, n, dst);
+        }
+
         // "filter" contains the data appended by a preceding call to
         // CreateFilter() on this class.  This method must return true if
         // the key was in the list of keys passed to CreateFilter().
@@ -68,6 +78,13 @@ namespace leveldb {
 // trailing spaces in keys.
     LEVELDB_EXPORT const FilterPolicy *NewBloomFilterPolicy(int bits_per_key);
 
+// Return a new filter policy that uses a cache-line-blocked bloom filter.
+// All probes of a key fall into one 64-byte block, so a probe touches one
+// cache line. It needs slightly more bits per key than
+// NewBloomFilterPolicy() for the same false positive rate.
+    LEVELDB_EXPORT const FilterPolicy *
+    NewBlockedBloomFilterPolicy(int bits_per_key);
+
 }  // namespace leveldb
 
 #endif  // STORAGE_LEVELDB_INCLUDE_FILTER_POLICY_H_
@@ -24,10 +24,14 @@ namespace leveldb {
 
     class FilterPolicy;
 
+    class FilterStats;
+
     class Logger;
 
     class Snapshot;
 
+    struct ScanStats;
+
 // DB contents are stored in a set of blocks, each of which holds a
 // sequence of key,value pairs.  Each block may be compressed before
 // being stored in a file.  The following enum describes which
@@ -134,6 +138,15 @@ namespace leveldb {
 
         MemTableType memtable_type = MemTableType::kStaticPartition;
 
+        // Select an active memtable in the memtable pool without acquiring
+        // the range lock. Only creating and retiring memtables take the lock.
+        bool enable_lockfree_memtable_selection = false;
+
+        // Writers of a static partition insert into its active memtable
+        // without holding the partition lock. The lock only protects
+        // selecting and rotating the active memtable.
+        bool enable_concurrent_memtable_writes = false;
+
         bool enable_subranges = false;
         bool enable_detailed_stats = true;
 
@@ -141,6 +154,9 @@ namespace leveldb {
         uint64_t l0bytes_start_compaction_trigger = 4l * 1024 * 1024 * 1024;
         uint64_t l0bytes_stop_writes_trigger = 0;
         uint64_t l0nfiles_start_compaction_trigger = 4;
+        // A level is compacted once this fraction of its entries are
+        // deletion markers. 0 disables it.
+        double tombstone_compaction_density = 0;
         int level = 0;
 
         uint32_t num_memtable_partitions = 1;
@@ -148,9 +164,27 @@ namespace leveldb {
         bool enable_lookup_index = false;
         bool enable_range_index = false;
 
+        // A scan that reads consecutive data blocks of an SSTable reads up
+        // to this many of the following data blocks from StoCs in the
+        // background. 0 disables read-ahead. Prefetched blocks are inserted
+        // into block_cache, so read-ahead is disabled without a block cache.
+        uint32_t scan_prefetch_max_blocks = 0;
+
+        // If > 0, the index and filter blocks of an SSTable are split into
+        // partitions of about this many bytes. A table pins only its
+        // top-level index and reads partitions through the block cache.
+        uint32_t metadata_partition_size = 0;
+
         uint32_t subrange_no_flush_num_keys = 100;
         uint32_t num_compaction_threads = 0;
 
+        // Group commit of log records replicated through RDMA.
+        // A leader replicates up to this many log records of a memtable in
+        // one request. 0 or 1 disables group commit.
+        uint32_t log_group_commit_max_batch_size = 0;
+        // The time a leader waits for concurrent writers to join its batch.
+        uint64_t log_group_commit_max_delay_us = 0;
+
         uint64_t lower_key = 0;
         uint64_t upper_key = 0;
 
@@ -232,6 +266,14 @@ namespace leveldb {
         // NewBloomFilterPolicy() here.
         const FilterPolicy *filter_policy = nullptr;
 
+        // Bits per key of the filters of SSTables written to level i. The
+        // last entry applies to deeper levels. Empty uses the default of
+        // filter_policy.
+        std::vector<int> filter_bits_per_key_per_level;
+
+        // If non-null, SSTable reads record per-level filter probe stats here.
+        FilterStats *filter_stats = nullptr;
+
         MemTablePool *memtable_pool = nullptr;
     };
 
@@ -258,6 +300,15 @@ namespace leveldb {
 
         uint64_t hash = 0;
 
+        // Scans report their read-ahead statistics here if non-null.
+        ScanStats *scan_stats = nullptr;
+
+        // If scan_length > 0, an iterator expects to read about scan_length
+        // keys starting at scan_start_key. It opens the tables beyond the
+        // expected range only when the scan reaches them.
+        Slice scan_start_key;
+        uint64_t scan_length = 0;
+
         // If "snapshot" is non-null, read as of the supplied snapshot
         // (which must belong to the DB that is being read and which must
         // not have been released).  If "snapshot" is null, use an implicit
@@ -36,6 +36,12 @@ namespace leveldb {
         uint64_t smallest_snapshot;
         std::vector<FileMetaData *> inputs[2];
         std::vector<FileMetaData *> guides;
+        // Key ranges of the files that may hold older entries of the
+        // compacted keys. See Compaction::deeper_ranges_.
+        bool drop_obsolete_deletions = false;
+        std::vector<std::pair<std::string, std::string>> deeper_ranges;
+        // See Compaction::smallest_unflushed_sequence_.
+        uint64_t smallest_unflushed_sequence = 0;
         std::vector<SubRange> subranges;
         uint32_t source_level = 0;
         uint32_t target_level = 0;
@@ -77,6 +83,7 @@ namespace leveldb {
         RDMA_WRITE_REQUEST = 'D',
         RDMA_WRITE_REMOTE_BUF_ALLOCATED = 'E',
         LTC_MIGRATION = 'F',
+        LTC_MIGRATION_LOOKUP_INDEX = 'I',
         STOC_REPLICATE_SSTABLES = 'G',
         STOC_REPLICATE_SSTABLES_RESPONSE = 'H',
     };
@@ -98,6 +105,9 @@ namespace leveldb {
         uint64_t stoc_queue_depth = 0;
         uint64_t stoc_pending_read_bytes = 0;
         uint64_t stoc_pending_write_bytes = 0;
+        // Time the request is sent. Measures the latency of reads and
+        // writes for the StoC load table.
+        uint64_t issue_time_us = 0;
 
         // log records.
         char *log_record_mem = nullptr;
@@ -153,6 +163,7 @@ namespace leveldb {
         Slice key;
         Slice value;
         uint64_t sequence_number = 0;
+        ValueType type = ValueType::kTypeValue;
     };
 
     struct RDMARequestTask {
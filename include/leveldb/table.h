@@ -6,8 +6,11 @@
 #define STORAGE_LEVELDB_INCLUDE_TABLE_H_
 
 #include <stdint.h>
+#include <string>
+#include <vector>
 #include "table/format.h"
 
+#include "leveldb/cache.h"
 #include "leveldb/export.h"
 #include "leveldb/iterator.h"
 #include "db_profiler.h"
@@ -18,6 +21,8 @@ namespace leveldb {
 
     class BlockHandle;
 
+    class BlockPrefetcher;
+
     class Footer;
 
     struct Options;
@@ -30,6 +35,15 @@ namespace leveldb {
 
     class BlockContents;
 
+    class Table;
+
+    // A data block that is not in the block cache.
+    struct DataBlockPrefetch {
+        Table *table = nullptr;
+        StoCBlockHandle handle = {};
+        std::string cache_key;
+    };
+
 // A Table is a sorted map from strings to strings.  Tables are
 // immutable and persistent.  A Table may be safely accessed from
 // multiple threads without external synchronization.
@@ -69,7 +83,14 @@ namespace leveldb {
         // Returns a new iterator over the table contents.
         // The result of NewIterator() is initially invalid (caller must
         // call one of the Seek methods on the iterator before using it).
-        Iterator *NewIterator(AccessCaller caller, const ReadOptions &) const;
+        // The iterator takes ownership of "prefetcher" if non-null.
+        Iterator *NewIterator(AccessCaller caller, const ReadOptions &,
+                              BlockPrefetcher *prefetcher = nullptr) const;
+
+        // Returns a new iterator over the index. Its values are the handles
+        // of the data blocks.
+        Iterator *NewIndexIterator(
+                AccessCaller caller = AccessCaller::kUserIterator) const;
 
         // Given a key, return an approximate byte offset in the file where
         // the data for that key begins (or would begin if the key were
@@ -90,6 +111,22 @@ namespace leveldb {
                   const ReadOptions &options,
                   const StoCBlockHandle &handle, BlockContents *result);
 
+        // Append the data blocks that may contain the sorted internal keys
+        // and are neither in the block cache nor stored locally to *blocks.
+        void CollectUncachedDataBlocks(const std::vector<Slice> &keys,
+                                       std::vector<DataBlockPrefetch> *blocks);
+
+        // Returns true and sets *block if the data block at "index_value" is
+        // neither in the block cache nor stored locally.
+        bool UncachedDataBlock(const Slice &index_value,
+                               DataBlockPrefetch *block);
+
+        // Parse the raw data block in "buf" that was read for "block" and
+        // insert it into the block cache with "priority".
+        Status InsertDataBlock(const ReadOptions &options,
+                               const DataBlockPrefetch &block,
+                               const char *buf, Cache::Priority priority);
+
     private:
 
         friend class TableCache;
@@ -99,8 +136,28 @@ namespace leveldb {
                         const ReadOptions &options,
                         const Slice &index_value, std::string *next_key);
 
+        // Returns an iterator over the index partition of a top-level
+        // index entry.
+        static Iterator *
+        IndexPartitionReader(void *arg, void *arg2, BlockReadContext context,
+                             const ReadOptions &options,
+                             const Slice &index_value, std::string *next_key);
+
         explicit Table() {}
 
+        // Block cache key of an index ('i') or filter ('f') partition.
+        static const size_t kMetadataPartitionCacheKeySize = 8 + 1 + 8;
+
+        Slice MetadataPartitionCacheKey(char type, const BlockHandle &handle,
+                                        char *buf) const;
+
+        Status ReadMetadataPartition(const BlockHandle &handle,
+                                     BlockContents *contents) const;
+
+        // Returns false if the filter of the data block at
+        // "data_block_offset" rules out "key".
+        bool KeyMayMatch(const Slice &key, uint64_t data_block_offset);
+
         // Calls (*handle_result)(arg, ...) with the entry found after a call
         // to Seek(key).  May not make such a call if filter policy says
         // that key is not present.
@@ -32,7 +32,8 @@ namespace leveldb {
         // Create a builder that will store the contents of the table it is
         // building in *file.  Does not close the file.  It is up to the
         // caller to close the file after calling Finish().
-        TableBuilder(const Options &options, WritableFile *file);
+        // "level" is the level the table is written to.
+        TableBuilder(const Options &options, WritableFile *file, int level = 0);
 
         TableBuilder(const TableBuilder &) = delete;
 
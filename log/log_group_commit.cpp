@@ -0,0 +1,159 @@
+//
+// Copyright (c) 2020 University of Southern California. All rights reserved.
+//
+
+#include "log_group_commit.h"
+
+#include <fmt/core.h>
+
+#include "common/nova_common.h"
+#include "common/nova_config.h"
+#include "ltc/stoc_client_impl.h"
+
+#define LOG_GROUP_COMMIT_SLOTS 64
+
+namespace leveldb {
+
+    std::string LogGroupCommitStats::DebugString() const {
+        std::string hist;
+        for (int i = 0; i < LOG_GROUP_COMMIT_HIST_SIZE; i++) {
+            hist += std::to_string(batch_size_hist[i]);
+            hist += ",";
+        }
+        double avg = 0;
+        if (nbatches > 0) {
+            avg = (double) nrecords / (double) nbatches;
+        }
+        return fmt::format("{},{},{},{:.2f},{}", nbatches, nrecords, nbytes,
+                           avg, hist);
+    }
+
+    LogGroupCommit::LogGroupCommit(Env *env, uint32_t dbid,
+                                   uint32_t max_batch_size,
+                                   uint64_t max_batch_delay_us)
+            : env_(env), dbid_(dbid), max_batch_size_(max_batch_size),
+              max_batch_delay_us_(max_batch_delay_us) {
+        NOVA_ASSERT(max_batch_size_ > 0);
+        for (int i = 0; i < LOG_GROUP_COMMIT_SLOTS; i++) {
+            auto slot = new Slot;
+            slot->nwriters = 0;
+            slots_.push_back(slot);
+        }
+    }
+
+    LogGroupCommit::~LogGroupCommit() {
+        for (auto slot : slots_) {
+            NOVA_ASSERT(slot->writers.empty());
+            delete slot;
+        }
+    }
+
+    void LogGroupCommit::Replicate(const WriteOptions &options,
+                                   uint32_t memtable_id,
+                                   const LevelDBLogRecord &log_record) {
+        Slot *slot = slots_[memtable_id % slots_.size()];
+        slot->mutex.Lock();
+        Writer w(&slot->mutex);
+        w.log_record = log_record;
+        w.memtable_id = memtable_id;
+        slot->writers.push_back(&w);
+        uint32_t nwriters_in_slot = slot->nwriters.fetch_add(1) + 1;
+        // Wake up a leader waiting for its batch to fill.
+        if (nwriters_in_slot == max_batch_size_ &&
+            &w != slot->writers.front()) {
+            slot->writers.front()->cv.Signal();
+        }
+        while (!w.done && &w != slot->writers.front()) {
+            w.cv.Wait();
+        }
+        if (w.done) {
+            slot->mutex.Unlock();
+            return;
+        }
+
+        // I am the leader. Give concurrent writers a chance to join the batch.
+        // Sleep until the batch is full or the delay expires.
+        if (max_batch_delay_us_ > 0) {
+            uint64_t start = env_->NowMicros();
+            uint64_t elapsed = 0;
+            while (slot->nwriters < max_batch_size_ &&
+                   elapsed < max_batch_delay_us_) {
+                w.cv.WaitForMicros(max_batch_delay_us_ - elapsed);
+                elapsed = env_->NowMicros() - start;
+            }
+        }
+
+        // Gather the log records of the same memtable that fit into my
+        // backing memory.
+        std::vector<LevelDBLogRecord> log_records;
+        uint32_t batch_bytes = 0;
+        uint32_t nwriters = 0;
+        for (auto writer : slot->writers) {
+            if (nwriters == max_batch_size_) {
+                break;
+            }
+            if (writer->memtable_id != memtable_id) {
+                break;
+            }
+            uint32_t size = nova::LogRecordSize(writer->log_record);
+            if (nwriters > 0 &&
+                batch_bytes + size > options.rdma_backing_mem_size) {
+                break;
+            }
+            log_records.push_back(writer->log_record);
+            batch_bytes += size;
+            nwriters++;
+        }
+        NOVA_ASSERT(batch_bytes <= options.rdma_backing_mem_size);
+        slot->mutex.Unlock();
+
+        // Followers are blocked until the batch completes so their keys and
+        // values remain valid.
+        auto stoc = reinterpret_cast<leveldb::StoCBlockClient *>(options.stoc_client);
+        NOVA_ASSERT(stoc);
+        options.stoc_client->InitiateReplicateLogRecords(
+                nova::LogFileName(dbid_, memtable_id),
+                options.thread_id, dbid_, memtable_id,
+                options.rdma_backing_mem, log_records,
+                options.replicate_log_record_states);
+        stoc->Wait();
+
+        slot->mutex.Lock();
+        for (uint32_t i = 0; i < nwriters; i++) {
+            Writer *ready = slot->writers.front();
+            slot->writers.pop_front();
+            ready->done = true;
+            if (ready != &w) {
+                ready->cv.Signal();
+            }
+        }
+        slot->nwriters.fetch_sub(nwriters);
+        // Notify the new head of the queue.
+        if (!slot->writers.empty()) {
+            slot->writers.front()->cv.Signal();
+        }
+        slot->mutex.Unlock();
+        RecordBatch(nwriters, batch_bytes);
+    }
+
+    void LogGroupCommit::RecordBatch(uint32_t nrecords, uint32_t nbytes) {
+        uint32_t bucket = 0;
+        uint32_t upper = 1;
+        while (upper < nrecords && bucket < LOG_GROUP_COMMIT_HIST_SIZE - 1) {
+            upper <<= 1;
+            bucket++;
+        }
+        stats_mutex_.Lock();
+        stats_.nbatches += 1;
+        stats_.nrecords += nrecords;
+        stats_.nbytes += nbytes;
+        stats_.batch_size_hist[bucket] += 1;
+        stats_mutex_.Unlock();
+    }
+
+    void LogGroupCommit::QueryStats(LogGroupCommitStats *stats) {
+        stats_mutex_.Lock();
+        *stats = stats_;
+        stats_mutex_.Unlock();
+    }
+}
@@ -0,0 +1,83 @@
+//
+// Copyright (c) 2020 University of Southern California. All rights reserved.
+//
+
+#ifndef LEVELDB_LOG_GROUP_COMMIT_H
+#define LEVELDB_LOG_GROUP_COMMIT_H
+
+#include <atomic>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "leveldb/env.h"
+#include "leveldb/options.h"
+#include "leveldb/stoc_client.h"
+#include "port/port.h"
+
+#define LOG_GROUP_COMMIT_HIST_SIZE 10
+
+namespace leveldb {
+
+    struct LogGroupCommitStats {
+        uint64_t nbatches = 0;
+        uint64_t nrecords = 0;
+        uint64_t nbytes = 0;
+        // Bucket i counts batches that contain (2^(i-1), 2^i] records.
+        uint64_t batch_size_hist[LOG_GROUP_COMMIT_HIST_SIZE] = {};
+
+        std::string DebugString() const;
+    };
+
+    // Group commit for replicating log records of a memtable.
+    // Writers of the same memtable queue up. The writer at the head of the
+    // queue becomes the leader. It gathers the log records of the writers
+    // behind it into one batch, replicates the batch using its own StoC
+    // client and wakes up all writers in the batch upon completion.
+    class LogGroupCommit {
+    public:
+        LogGroupCommit(Env *env, uint32_t dbid, uint32_t max_batch_size,
+                       uint64_t max_batch_delay_us);
+
+        ~LogGroupCommit();
+
+        // Replicate the log record. Returns once the record is replicated.
+        // The caller may be the leader that replicates the records of other
+        // writers.
+        void Replicate(const WriteOptions &options, uint32_t memtable_id,
+                       const LevelDBLogRecord &log_record);
+
+        void QueryStats(LogGroupCommitStats *stats);
+
+    private:
+        struct Writer {
+            explicit Writer(port::Mutex *mu) : cv(mu) {}
+
+            LevelDBLogRecord log_record;
+            uint32_t memtable_id = 0;
+            bool done = false;
+            port::CondVar cv;
+        };
+
+        // Writers of memtables mapped to the same slot share a queue. A batch
+        // only contains log records of one memtable.
+        struct Slot {
+            port::Mutex mutex;
+            std::deque<Writer *> writers;
+            std::atomic_int_fast32_t nwriters;
+        };
+
+        void RecordBatch(uint32_t nrecords, uint32_t nbytes);
+
+        Env *env_ = nullptr;
+        const uint32_t dbid_;
+        const uint32_t max_batch_size_;
+        const uint64_t max_batch_delay_us_;
+        std::vector<Slot *> slots_;
+
+        port::Mutex stats_mutex_;
+        LogGroupCommitStats stats_;
+    };
+}
+
+#endif //LEVELDB_LOG_GROUP_COMMIT_H
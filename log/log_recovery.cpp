@@ -5,6 +5,10 @@
 //
 
 #include "log_recovery.h"
+
+#include <algorithm>
+#include <thread>
+
 #include "db/db_impl.h"
 #include "common/nova_config.h"
 
@@ -14,74 +18,221 @@ namespace leveldb {
             return (t2.tv_sec - t1.tv_sec) * 1000000 +
                    (t2.tv_usec - t1.tv_usec);
         }
+
+        // Size of the first chunk fetched from a log file.
+        const uint64_t kInitialLogFetchSize = 256 * 1024;
+        // Minimum distance between the recorded record boundaries. It is
+        // the smallest shard replayed by a thread.
+        const uint64_t kShardBoundaryInterval = 64 * 1024;
+
+        double PerSecond(uint64_t n, uint64_t duration_us) {
+            if (duration_us == 0) {
+                return 0;
+            }
+            return (double) n * 1000000.0 / (double) duration_us;
+        }
     }
 
     LogRecovery::LogRecovery(leveldb::MemManager *mem_manager, leveldb::StoCBlockClient *client) : mem_manager_(
             mem_manager), client_(client) {
     }
 
+    void LogRecovery::Scan(RecoveredLog *log) {
+        uint64_t max_size = nova::NovaConfig::config->max_stoc_file_size;
+        while (true) {
+            leveldb::Slice slice(log->buf + log->scanned,
+                                 log->fetched - log->scanned);
+            // A record is decoded only if all of its bytes are fetched.
+            if (slice.size() < 4 ||
+                slice.size() < leveldb::DecodeFixed32(slice.data())) {
+                if (log->fetched == max_size) {
+                    log->complete = true;
+                }
+                return;
+            }
+            leveldb::LevelDBLogRecord record = {};
+            leveldb::Slice input = slice;
+            if (!nova::DecodeLogRecord(&input, &record)) {
+                log->complete = true;
+                return;
+            }
+            if (log->scanned - log->boundaries.back() >=
+                kShardBoundaryInterval) {
+                log->boundaries.push_back(log->scanned);
+            }
+            log->scanned += slice.size() - input.size();
+            log->records += 1;
+        }
+    }
+
+    void LogRecovery::Replay(const std::vector<ReplayShard> *shards,
+                             std::atomic_int_fast32_t *next_shard,
+                             std::atomic_int_fast64_t *records) {
+        uint64_t replayed_records = 0;
+        while (true) {
+            int i = next_shard->fetch_add(1);
+            if (i >= shards->size()) {
+                break;
+            }
+            const ReplayShard &shard = (*shards)[i];
+            leveldb::MemTable *memtable = shard.log->pair->memtable;
+            leveldb::Slice slice(shard.log->buf + shard.begin,
+                                 shard.end - shard.begin);
+            leveldb::LevelDBLogRecord record = {};
+            if (shard.log->concurrent) {
+                while (nova::DecodeLogRecord(&slice, &record)) {
+                    memtable->AddConcurrently(record.sequence_number,
+                                              record.type,
+                                              record.key, record.value);
+                    replayed_records += 1;
+                }
+            } else {
+                // The shard is the whole log. Sort its records and build the
+                // memtable in one pass.
+                std::vector<leveldb::MemTable::BulkEntry> entries;
+                entries.reserve(shard.log->records);
+                while (nova::DecodeLogRecord(&slice, &record)) {
+                    entries.push_back({record.sequence_number,
+                                       record.type,
+                                       record.key, record.value});
+                }
+                memtable->BulkAdd(entries);
+                replayed_records += entries.size();
+            }
+            NOVA_ASSERT(slice.empty());
+        }
+        records->fetch_add(replayed_records);
+    }
+
     void
     LogRecovery::Recover(const std::unordered_map<uint32_t, leveldb::MemTableLogFilePair> &memtables_to_recover,
                          uint32_t cfg_id, uint32_t dbid) {
         if (memtables_to_recover.empty()) {
             return;
         }
-        std::vector<char *> rdma_bufs;
-        std::vector<uint32_t> reqs;
+        uint64_t max_size = nova::NovaConfig::config->max_stoc_file_size;
+        uint32_t scid = mem_manager_->slabclassid(0, max_size);
         timeval start = {};
         gettimeofday(&start, nullptr);
+
+        std::vector<RecoveredLog> logs(memtables_to_recover.size());
+        int index = 0;
         for (const auto &replica : memtables_to_recover) {
-            uint32_t scid = mem_manager_->slabclassid(0, nova::NovaConfig::config->max_stoc_file_size);
-            char *rdma_buf = mem_manager_->ItemAlloc(0, scid);
-            NOVA_ASSERT(rdma_buf);
-            rdma_bufs.push_back(rdma_buf);
+            RecoveredLog &log = logs[index];
+            log.pair = &replica.second;
+            log.buf = mem_manager_->ItemAlloc(0, scid);
+            NOVA_ASSERT(log.buf);
             NOVA_ASSERT(!replica.second.server_logbuf.empty());
-
-            uint32_t server_id = replica.second.server_logbuf.begin()->first;
-            uint64_t remote_offset = replica.second.server_logbuf.begin()->second;
-            uint32_t reqid = client_->InitiateReadInMemoryLogFile(rdma_buf, server_id, remote_offset,
-                                                                  nova::NovaConfig::config->max_stoc_file_size);
+            log.server_id = replica.second.server_logbuf.begin()->first;
+            log.remote_offset = replica.second.server_logbuf.begin()->second;
+            log.boundaries.push_back(0);
             NOVA_LOG(rdmaio::INFO)
-                << fmt::format("Restore memtable-{} from server-{} offset:{}", replica.first, server_id,
-                               remote_offset);
-            reqs.push_back(reqid);
-        }
-
-        // Wait for all RDMA READ to complete.
-        for (const auto &replica : memtables_to_recover) {
-            client_->Wait();
+                << fmt::format("Restore memtable-{} from server-{} offset:{}", replica.first, log.server_id,
+                               log.remote_offset);
+            index++;
         }
 
-        for (int i = 0; i < reqs.size(); i++) {
-            leveldb::StoCResponse response;
-            NOVA_ASSERT(client_->IsDone(reqs[i], &response, nullptr));
+        // Fetch the log files in rounds. Each round doubles the fetched
+        // bytes of the log files that are not complete.
+        uint32_t fetch_rounds = 0;
+        uint64_t fetched_bytes = 0;
+        while (true) {
+            std::vector<uint32_t> reqs;
+            for (auto &log : logs) {
+                if (log.complete) {
+                    continue;
+                }
+                uint64_t size = std::max(log.fetched, kInitialLogFetchSize);
+                size = std::min(size, max_size - log.fetched);
+                reqs.push_back(client_->InitiateReadInMemoryLogFile(
+                        log.buf + log.fetched, log.server_id,
+                        log.remote_offset + log.fetched, size));
+                log.fetched += size;
+                fetched_bytes += size;
+            }
+            if (reqs.empty()) {
+                break;
+            }
+            fetch_rounds += 1;
+            // Wait for all RDMA READ to complete.
+            for (int i = 0; i < reqs.size(); i++) {
+                client_->Wait();
+            }
+            for (int i = 0; i < reqs.size(); i++) {
+                leveldb::StoCResponse response;
+                NOVA_ASSERT(client_->IsDone(reqs[i], &response, nullptr));
+            }
+            for (auto &log : logs) {
+                if (!log.complete) {
+                    Scan(&log);
+                }
+            }
         }
 
         timeval rdma_read_complete;
         gettimeofday(&rdma_read_complete, nullptr);
-        uint32_t recovered_log_records = 0;
-        int index = 0;
-        leveldb::DBImpl *dbimpl = reinterpret_cast<leveldb::DBImpl *>(nova::NovaConfig::config->cfgs[cfg_id]->fragments[dbid]->db);
-        uint32_t rand_seed = 0;
-        for (const auto &replica : memtables_to_recover) {
-            char *buf = rdma_bufs[index];
-            leveldb::Slice slice(buf, nova::NovaConfig::config->max_stoc_file_size);
 
-            leveldb::MemTable *memtable = replica.second.memtable;
-            leveldb::LevelDBLogRecord record = {};
-            uint32_t log_records = 0;
-            while (nova::DecodeLogRecord(&slice, &record)) {
-                memtable->Add(record.sequence_number, leveldb::ValueType::kTypeValue, record.key, record.value);
-                recovered_log_records += 1;
-                log_records += 1;
+        // Split the log files into shards at record boundaries.
+        uint32_t nthreads = std::max(
+                nova::NovaConfig::config->number_of_recovery_threads, 1u);
+        uint64_t log_bytes = 0;
+        uint64_t log_records = 0;
+        for (const auto &log : logs) {
+            log_bytes += log.scanned;
+            log_records += log.records;
+        }
+        uint64_t shard_size = std::max(log_bytes / nthreads,
+                                       kShardBoundaryInterval);
+        std::vector<ReplayShard> shards;
+        for (auto &log : logs) {
+            uint64_t begin = 0;
+            for (int i = 1; i < log.boundaries.size(); i++) {
+                if (log.boundaries[i] - begin >= shard_size) {
+                    shards.push_back({&log, begin, log.boundaries[i]});
+                    begin = log.boundaries[i];
+                    log.concurrent = true;
+                }
             }
+            if (begin < log.scanned) {
+                shards.push_back({&log, begin, log.scanned});
+            }
+        }
+        // Replay large shards first.
+        std::sort(shards.begin(), shards.end(),
+                  [](const ReplayShard &a, const ReplayShard &b) {
+                      return a.end - a.begin > b.end - b.begin;
+                  });
+        nthreads = std::min(nthreads, (uint32_t) shards.size());
+        std::atomic_int_fast32_t next_shard;
+        std::atomic_int_fast64_t recovered_log_records;
+        next_shard = 0;
+        recovered_log_records = 0;
+        std::vector<std::thread> threads;
+        for (int i = 1; i < nthreads; i++) {
+            threads.emplace_back(&LogRecovery::Replay, this, &shards,
+                                 &next_shard, &recovered_log_records);
+        }
+        Replay(&shards, &next_shard, &recovered_log_records);
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        NOVA_ASSERT(recovered_log_records == log_records);
+
+        timeval replay_complete;
+        gettimeofday(&replay_complete, nullptr);
+
+        leveldb::DBImpl *dbimpl = reinterpret_cast<leveldb::DBImpl *>(nova::NovaConfig::config->cfgs[cfg_id]->fragments[dbid]->db);
+        uint32_t rand_seed = 0;
+        for (auto &log : logs) {
+            const leveldb::MemTableLogFilePair &pair = *log.pair;
+            leveldb::MemTable *memtable = pair.memtable;
             memtable->SetReadyToProcessRequests();
             // Schedule for compaction.
-            if (replica.second.is_immutable) {
+            if (pair.is_immutable) {
                 int thread_id = -1;
                 bool merge_memtables_without_flushing = false;
-                if (replica.second.subrange) {
-                    thread_id = replica.second.subrange->GetCompactionThreadId(
+                if (pair.subrange) {
+                    thread_id = pair.subrange->GetCompactionThreadId(
                             &EnvBGThread::bg_flush_memtable_thread_id_seq,
                             &merge_memtables_without_flushing);
                 } else {
@@ -90,24 +241,36 @@ namespace leveldb {
                                     1, std::memory_order_relaxed) %
                             dbimpl->bg_flush_memtable_threads_.size();
                 }
-                dbimpl->ScheduleFlushMemTableTask(thread_id, memtable->memtableid(), memtable, replica.second.partition_id,
-                                                  replica.second.imm_slot, &rand_seed,
+                dbimpl->ScheduleFlushMemTableTask(thread_id, memtable->memtableid(), memtable, pair.partition_id,
+                                                  pair.imm_slot, &rand_seed,
                                                   merge_memtables_without_flushing);
             }
-            index++;
             NOVA_LOG(rdmaio::INFO)
-                << fmt::format("Recovery memtable-{} with {} log records", memtable->memtableid(), log_records);
-            uint32_t scid = mem_manager_->slabclassid(0, nova::NovaConfig::config->max_stoc_file_size);
-            mem_manager_->FreeItem(0, buf, scid);
+                << fmt::format("Recovery memtable-{} with {} log records {} bytes", memtable->memtableid(),
+                               log.records, log.scanned);
+            mem_manager_->FreeItem(0, log.buf, scid);
         }
 
         timeval end{};
         gettimeofday(&end, nullptr);
+        uint64_t fetch_duration = time_diff(start, rdma_read_complete);
+        uint64_t replay_duration = time_diff(rdma_read_complete, replay_complete);
+        NOVA_LOG(rdmaio::INFO)
+            << fmt::format("memtable recovery fetch: rounds:{} bytes:{} log-bytes:{} duration:{} bytes/s:{:.0f}",
+                           fetch_rounds, fetched_bytes, log_bytes,
+                           fetch_duration,
+                           PerSecond(fetched_bytes, fetch_duration));
+        NOVA_LOG(rdmaio::INFO)
+            << fmt::format("memtable recovery replay: threads:{} shards:{} records:{} bytes:{} duration:{} records/s:{:.0f} bytes/s:{:.0f}",
+                           nthreads, shards.size(), log_records, log_bytes,
+                           replay_duration,
+                           PerSecond(log_records, replay_duration),
+                           PerSecond(log_bytes, replay_duration));
         NOVA_LOG(rdmaio::INFO)
             << fmt::format("memtable recovery duration: {},{},{},{}",
                            memtables_to_recover.size(),
-                           recovered_log_records,
-                           time_diff(start, rdma_read_complete),
+                           log_records,
+                           fetch_duration,
                            time_diff(start, end));
     }
-}
\ No newline at end of file
+}
@@ -7,12 +7,23 @@
 #ifndef LEVELDB_LOG_RECOVERY_H
 #define LEVELDB_LOG_RECOVERY_H
 
+#include <atomic>
+#include <vector>
+
 #include "db/memtable.h"
 #include "ltc/stoc_client_impl.h"
 
 namespace leveldb {
     class StoCBlockClient;
 
+    // Recover memtables from their in-memory log files at StoCs.
+    //
+    // The StoC does not know the used length of a log file since log
+    // records are written with one-sided RDMA WRITEs. Recovery fetches each
+    // log file in chunks that double in size until its record stream ends
+    // within the fetched bytes. It then replays the records with
+    // "number_of_recovery_threads" threads. A large log file is split into
+    // shards at record boundaries that are replayed concurrently.
     class LogRecovery {
     public:
         LogRecovery(leveldb::MemManager *mem_manager,
@@ -23,6 +34,37 @@ namespace leveldb {
                 uint32_t dbid);
 
     private:
+        struct RecoveredLog {
+            const MemTableLogFilePair *pair = nullptr;
+            char *buf = nullptr;
+            uint32_t server_id = 0;
+            uint64_t remote_offset = 0;
+            // Number of fetched bytes.
+            uint64_t fetched = 0;
+            // Number of bytes of complete log records.
+            uint64_t scanned = 0;
+            uint64_t records = 0;
+            bool complete = false;
+            // Offsets of record boundaries that are at least
+            // kShardBoundaryInterval bytes apart.
+            std::vector<uint64_t> boundaries;
+            // Set if the log is replayed by more than one thread.
+            bool concurrent = false;
+        };
+
+        struct ReplayShard {
+            RecoveredLog *log;
+            uint64_t begin;
+            uint64_t end;
+        };
+
+        // Scan the newly fetched bytes of "log" for complete log records.
+        void Scan(RecoveredLog *log);
+
+        void Replay(const std::vector<ReplayShard> *shards,
+                    std::atomic_int_fast32_t *next_shard,
+                    std::atomic_int_fast64_t *records);
+
         leveldb::MemManager *mem_manager_;
         leveldb::StoCBlockClient *client_;
     };
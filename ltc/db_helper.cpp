@@ -14,6 +14,7 @@
 
 #include "leveldb/write_batch.h"
 #include "db/filename.h"
+#include "table/filter_block.h"
 #include "ltc/stoc_file_client_impl.h"
 #include "util/env_posix.h"
 
@@ -29,6 +30,25 @@
 
 
 namespace leveldb {
+    leveldb::Comparator *NewUserKeyComparator() {
+        if (nova::NovaGlobalVariables::global.binary_keys) {
+            return new BinaryKeyComparator();
+        }
+        return new YCSBKeyComparator();
+    }
+
+    const leveldb::FilterPolicy *NewConfiguredFilterPolicy() {
+        if (nova::NovaConfig::config->enable_blocked_bloom_filter) {
+            return leveldb::NewBlockedBloomFilterPolicy(10);
+        }
+        return leveldb::NewBloomFilterPolicy(10);
+    }
+
+    std::vector<int> FilterBitsPerKeyPerLevel() {
+        const auto &bits = nova::NovaConfig::config->bloom_bits_per_key_per_level;
+        return std::vector<int>(bits.begin(), bits.end());
+    }
+
     leveldb::Options
     BuildDBOptions(int cfg_id, int db_index, leveldb::Cache *cache,
                    leveldb::MemTablePool *memtable_pool,
@@ -60,26 +80,38 @@ namespace leveldb {
         options.num_memtables = nova::NovaConfig::config->num_memtables;
         options.l0bytes_start_compaction_trigger = nova::NovaConfig::config->l0_start_compaction_mb * 1024 * 1024;
         options.l0bytes_stop_writes_trigger = nova::NovaConfig::config->l0_stop_write_mb * 1024 * 1024;
+        options.tombstone_compaction_density = nova::NovaConfig::config->tombstone_compaction_density;
         options.max_open_files = 100000;
         options.enable_lookup_index = nova::NovaConfig::config->enable_lookup_index;
         options.enable_range_index = nova::NovaConfig::config->enable_range_index;
+        options.scan_prefetch_max_blocks = nova::NovaConfig::config->scan_prefetch_max_blocks;
+        options.metadata_partition_size = nova::NovaConfig::config->metadata_partition_size;
         options.num_recovery_thread = nova::NovaConfig::config->number_of_recovery_threads;
         options.num_compaction_threads = bg_flush_memtable_threads.size();
+        options.log_group_commit_max_batch_size = nova::NovaConfig::config->log_group_commit_max_batch_size;
+        options.log_group_commit_max_delay_us = nova::NovaConfig::config->log_group_commit_max_delay_us;
         options.max_stoc_file_size = std::max(options.write_buffer_size, options.max_file_size) +
                                      LEVELDB_TABLE_PADDING_SIZE_MB * 1024 * 1024;
         options.env = env;
         options.create_if_missing = true;
         options.compression = leveldb::kNoCompression;
-        options.filter_policy = leveldb::NewBloomFilterPolicy(10);
+        options.filter_policy = NewConfiguredFilterPolicy();
+        options.filter_bits_per_key_per_level = FilterBitsPerKeyPerLevel();
+        if (nova::NovaConfig::config->enable_detailed_db_stats) {
+            // Timing every filter probe costs two clock reads per Get.
+            options.filter_stats = new leveldb::FilterStats;
+        }
         options.bg_compaction_threads = bg_compaction_threads;
         options.bg_flush_memtable_threads = bg_flush_memtable_threads;
         options.enable_tracing = false;
-        options.comparator = new YCSBKeyComparator();
+        options.comparator = NewUserKeyComparator();
         if (nova::NovaConfig::config->memtable_type == "pool") {
             options.memtable_type = leveldb::MemTableType::kMemTablePool;
         } else {
             options.memtable_type = leveldb::MemTableType::kStaticPartition;
         }
+        options.enable_lockfree_memtable_selection = nova::NovaConfig::config->enable_lockfree_memtable_selection;
+        options.enable_concurrent_memtable_writes = nova::NovaConfig::config->enable_concurrent_memtable_writes;
         options.enable_subranges = nova::NovaConfig::config->enable_subrange;
         options.subrange_reorg_sampling_ratio = 1.0;
         options.reorg_thread = reorg_thread;
@@ -118,6 +150,13 @@ namespace leveldb {
         return options;
     }
 
+    leveldb::Cache *NewBlockCache(uint64_t size) {
+        if (nova::NovaConfig::config->block_cache_policy == "slru") {
+            return leveldb::NewSegmentedLRUCache(size, 0.8);
+        }
+        return leveldb::NewLRUCache(size);
+    }
+
     leveldb::Options BuildStorageOptions(leveldb::MemManager *mem_manager, leveldb::Env *env) {
         leveldb::Options options;
         options.block_cache = nullptr;
@@ -141,10 +180,11 @@ namespace leveldb {
         options.env = env;
         options.create_if_missing = true;
         options.compression = leveldb::kNoCompression;
-        leveldb::InternalFilterPolicy *filter = new leveldb::InternalFilterPolicy(leveldb::NewBloomFilterPolicy(10));
+        leveldb::InternalFilterPolicy *filter = new leveldb::InternalFilterPolicy(NewConfiguredFilterPolicy());
         options.filter_policy = filter;
+        options.filter_bits_per_key_per_level = FilterBitsPerKeyPerLevel();
         options.enable_tracing = false;
-        options.comparator = new YCSBKeyComparator();
+        options.comparator = NewUserKeyComparator();
         if (nova::NovaConfig::config->memtable_type == "pool") {
             options.memtable_type = leveldb::MemTableType::kMemTablePool;
         } else {
@@ -35,6 +35,12 @@ namespace leveldb {
         // Ignore the following methods for now:
         const char *Name() const { return "YCSBKeyComparator"; }
 
+        bool KeyToInt(const leveldb::Slice &key, uint64_t *value) const {
+            *value = 0;
+            nova::str_to_int(key.data(), value, key.size());
+            return true;
+        }
+
         void
         FindShortestSeparator(std::string *,
                               const leveldb::Slice &) const {}
@@ -42,6 +48,50 @@ namespace leveldb {
         void FindShortSuccessor(std::string *) const {}
     };
 
+    // Compares big-endian fixed-width integer keys, see
+    // nova::NovaGlobalVariables::binary_keys.
+    class BinaryKeyComparator : public leveldb::Comparator {
+    public:
+        int
+        Compare(const leveldb::Slice &a, const leveldb::Slice &b) const {
+            if (a.size() != BINARY_KEY_SIZE || b.size() != BINARY_KEY_SIZE) {
+                return a.compare(b);
+            }
+            uint64_t ai;
+            uint64_t bi;
+            memcpy(&ai, a.data(), BINARY_KEY_SIZE);
+            memcpy(&bi, b.data(), BINARY_KEY_SIZE);
+            ai = __builtin_bswap64(ai);
+            bi = __builtin_bswap64(bi);
+            if (ai < bi) {
+                return -1;
+            } else if (ai > bi) {
+                return 1;
+            }
+            return 0;
+        }
+
+        const char *Name() const { return "BinaryKeyComparator"; }
+
+        bool KeyToInt(const leveldb::Slice &key, uint64_t *value) const {
+            if (key.size() != BINARY_KEY_SIZE) {
+                return false;
+            }
+            memcpy(value, key.data(), BINARY_KEY_SIZE);
+            *value = __builtin_bswap64(*value);
+            return true;
+        }
+
+        void
+        FindShortestSeparator(std::string *,
+                              const leveldb::Slice &) const {}
+
+        void FindShortSuccessor(std::string *) const {}
+    };
+
+    // Returns the comparator of the configured user key encoding.
+    leveldb::Comparator *NewUserKeyComparator();
+
     leveldb::Options
     BuildDBOptions(int cfg_id, int db_index, leveldb::Cache *cache,
                    leveldb::MemTablePool *memtable_pool,
@@ -56,6 +106,9 @@ namespace leveldb {
     leveldb::Options BuildStorageOptions(leveldb::MemManager *mem_manager,
                                          leveldb::Env *env);
 
+    // Create the block cache of "size" bytes with the configured policy.
+    leveldb::Cache *NewBlockCache(uint64_t size);
+
     leveldb::DB *CreateDatabase(int cfg_id, int db_index, leveldb::Cache *cache,
                                 leveldb::MemTablePool *memtable_pool,
                                 leveldb::MemManager *mem_manager,
@@ -186,7 +186,11 @@ namespace nova {
                 MigrateDB(source_migrates);
             }
             for (auto dbmeta : dest_migrates) {
-                RecoverDBMeta(dbmeta);
+                if (dbmeta.buf[0] == leveldb::StoCRequestType::LTC_MIGRATION) {
+                    RecoverDBMeta(dbmeta);
+                } else {
+                    RecoverLookupIndex(dbmeta);
+                }
             }
             if (!removed_stocs.empty()) {
                 for (auto frag : frags) {
@@ -200,18 +204,26 @@ namespace nova {
         // bump up the configuration id.
         std::vector<char *> bufs;
         std::vector<uint32_t> msg_sizes;
+        std::vector<std::vector<uint64_t>> lookup_index_entries;
         uint32_t cfg_id = NovaConfig::config->current_cfg_id;
         auto cfg = NovaConfig::config->cfgs[cfg_id];
         uint32_t scid = mem_manager_->slabclassid(0, NovaConfig::config->max_stoc_file_size);
-        for (auto frag : migrate_frags) {
+        lookup_index_entries.resize(migrate_frags.size());
+        for (int i = 0; i < migrate_frags.size(); i++) {
+            auto frag = migrate_frags[i];
             NOVA_LOG(rdmaio::INFO) << fmt::format("Start Migrate {}", frag->dbid);
             leveldb::DBImpl *db = reinterpret_cast<leveldb::DBImpl *>(frag->db);
             char *buf = mem_manager_->ItemAlloc(0, scid);
             bufs.push_back(buf);
-            msg_sizes.push_back(db->EncodeDBMetadata(buf, log_manager_, cfg_id));
+            msg_sizes.push_back(db->EncodeDBMetadata(buf, log_manager_, cfg_id, &lookup_index_entries[i]));
+            NOVA_ASSERT(msg_sizes.back() <= NovaConfig::config->max_stoc_file_size)
+                << fmt::format("db:{} metadata:{}", frag->dbid, msg_sizes.back());
         }
 
-        // Inform the destination of the database metadata.
+        // Inform the destination of the database metadata. The destination
+        // serves requests once it has recovered the metadata. Unlike the
+        // lookup index, the metadata is sent as a single message so it must
+        // fit in max_stoc_file_size.
         for (int i = 0; i < migrate_frags.size(); i++) {
             auto frag = migrate_frags[i];
             NOVA_LOG(rdmaio::INFO)
@@ -224,9 +236,62 @@ namespace nova {
         for (int i = 0; i < migrate_frags.size(); i++) {
             mem_manager_->FreeItem(0, bufs[i], scid);
         }
+        NOVA_LOG(rdmaio::INFO) << fmt::format("!!!Migration metadata complete");
+
+        // Stream the lookup indexes in chunks.
+        uint32_t chunk_size = NovaConfig::config->ltc_migration_chunk_size;
+        NOVA_ASSERT(chunk_size <= NovaConfig::config->max_stoc_file_size) << chunk_size;
+        uint32_t chunk_scid = mem_manager_->slabclassid(0, chunk_size);
+        char *chunk = mem_manager_->ItemAlloc(0, chunk_scid);
+        NOVA_ASSERT(chunk) << "Running out of memory";
+        for (int i = 0; i < migrate_frags.size(); i++) {
+            auto frag = migrate_frags[i];
+            leveldb::DBImpl *db = reinterpret_cast<leveldb::DBImpl *>(frag->db);
+            const std::vector<uint64_t> &entries = lookup_index_entries[i];
+            uint64_t next = 0;
+            uint32_t nchunks = 0;
+            while (true) {
+                uint64_t start = next;
+                uint32_t msg_size = db->EncodeLookupIndexChunk(chunk, chunk_size, cfg_id, entries, &next);
+                if (msg_size == 0) {
+                    break;
+                }
+                NOVA_ASSERT(next > start || entries.empty()) << chunk_size;
+                client_->InitiateRDMAWRITE(cfg->fragments[frag->dbid]->ltc_server_id, chunk, msg_size);
+                client_->Wait();
+                nchunks++;
+                if (next == entries.size()) {
+                    break;
+                }
+            }
+            NOVA_LOG(rdmaio::INFO)
+                << fmt::format("Migrate {} lookup index entries:{} chunks:{}", frag->dbid, entries.size(), nchunks);
+        }
+        mem_manager_->FreeItem(0, chunk, chunk_scid);
         NOVA_LOG(rdmaio::INFO) << fmt::format("!!!Migration complete");
     }
 
+    void DBMigration::RecoverLookupIndex(DBMeta dbmeta) {
+        NOVA_ASSERT(dbmeta.buf[0] == leveldb::StoCRequestType::LTC_MIGRATION_LOOKUP_INDEX);
+        leveldb::Slice buf(dbmeta.buf + 1, dbmeta.msg_size - 1);
+        uint32_t cfg_id = 0;
+        uint32_t dbindex = 0;
+        bool last = false;
+        NOVA_ASSERT(DecodeFixed32(&buf, &cfg_id));
+        NOVA_ASSERT(DecodeFixed32(&buf, &dbindex));
+        NOVA_ASSERT(DecodeBool(&buf, &last));
+        auto frag = nova::NovaConfig::config->cfgs[cfg_id]->fragments[dbindex];
+        NOVA_ASSERT(frag->db) << fmt::format("{} {}", cfg_id, dbindex);
+        auto dbimpl = reinterpret_cast<leveldb::DBImpl *>(frag->db);
+        dbimpl->RecoverLookupIndexChunk(&buf, last);
+        uint32_t scid = mem_manager_->slabclassid(0, dbmeta.msg_size);
+        mem_manager_->FreeItem(0, dbmeta.buf, scid);
+        if (last) {
+            NOVA_LOG(rdmaio::INFO)
+                << fmt::format("!!!!!Recover lookup index {} {} complete", cfg_id, dbindex);
+        }
+    }
+
     void
     DBMigration::RecoverDBMeta(DBMeta dbmeta) {
         // Open the new database.
@@ -298,28 +363,55 @@ namespace nova {
             }
             actual_memtables_to_recover[memtable.first] = memtable.second;
         }
-        // The database is ready to process requests immediately.
+        // The database is ready to process requests immediately. A request
+        // that reads a memtable being replayed waits for it.
         if (nova::NovaConfig::config->ltc_migration_policy == LTCMigrationPolicy::IMMEDIATE) {
             frag->is_ready_mutex_.Lock();
             frag->is_ready_ = true;
             frag->is_ready_signal_.SignalAll();
             frag->is_ready_mutex_.Unlock();
         }
-        leveldb::LogRecovery recover(mem_manager_, client_);
-        recover.Recover(actual_memtables_to_recover, cfg_id, dbindex);
+        // Coordinated compaction does not start until the replay completes.
         threads_for_new_dbs_.emplace_back(std::thread(&leveldb::LTCCompactionThread::Start, reorg));
         threads_for_new_dbs_.emplace_back(std::thread(&leveldb::LTCCompactionThread::Start, coord));
-        db->StartCoordinatedCompaction();
 
+        // Replay the memtables in the background so that this thread
+        // proceeds to the lookup index and the next database.
+        DBReplay replay = {};
+        replay.cfg_id = cfg_id;
+        replay.dbindex = dbindex;
+        replay.db = db;
+        replay.frag = frag;
+        replay.memtables_to_recover = std::move(actual_memtables_to_recover);
+        replay.close_log_files = std::move(close_log_files);
+        replay.buf = dbmeta.buf;
+        replay.msg_size = dbmeta.msg_size;
+        threads_for_new_dbs_.emplace_back(std::thread(&DBMigration::ReplayDB, this, std::move(replay)));
+        NOVA_LOG(rdmaio::INFO)
+            << fmt::format("!!!!!Recover {} {} metadata complete", cfg_id, dbindex);
+    }
+
+    void DBMigration::ReplayDB(DBReplay replay) {
+        // The client of this migration thread is not thread-safe.
+        auto recovery_client = new leveldb::StoCBlockClient(replay.dbindex, stoc_file_manager_);
+        recovery_client->rdma_msg_handlers_ = bg_rdma_msg_handlers_;
+        leveldb::LogRecovery recover(mem_manager_, recovery_client);
+        recover.Recover(replay.memtables_to_recover, replay.cfg_id, replay.dbindex);
+        replay.db->StartCoordinatedCompaction();
+
+        auto frag = replay.frag;
         frag->is_ready_mutex_.Lock();
         frag->is_ready_ = true;
         frag->is_complete_ = true;
         frag->is_ready_signal_.SignalAll();
         frag->is_ready_mutex_.Unlock();
-        uint32_t scid = mem_manager_->slabclassid(0, dbmeta.msg_size);
-        mem_manager_->FreeItem(0, dbmeta.buf, scid);
-        client->InitiateCloseLogFiles(close_log_files, dbindex);
+        uint32_t scid = mem_manager_->slabclassid(0, replay.msg_size);
+        mem_manager_->FreeItem(0, replay.buf, scid);
+        recovery_client->InitiateCloseLogFiles(replay.close_log_files, replay.dbindex);
+        // Closing log files does not wait on the client.
+        delete recovery_client;
         NOVA_LOG(rdmaio::INFO)
-            << fmt::format("!!!!!Recover {} {} complete: log files:{}", cfg_id, dbindex, close_log_files.size());
+            << fmt::format("!!!!!Recover {} {} complete: log files:{}", replay.cfg_id, replay.dbindex,
+                           replay.close_log_files.size());
     }
 }
\ No newline at end of file
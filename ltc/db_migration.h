@@ -22,6 +22,8 @@
 
 namespace leveldb {
     class StoCBlockClient;
+
+    class LTCCompactionThread;
 }
 
 namespace nova {
@@ -52,7 +54,6 @@ namespace nova {
 
         void AddStoCMigration(nova::LTCFragment * frag, const std::vector<uint32_t>& removed_stocs);
 
-        static std::atomic_int_fast32_t migration_seq_id_;
     private:
         void MigrateDB(const std::vector<nova::LTCFragment *> &migrate_frags);
 
@@ -64,8 +65,25 @@ namespace nova {
             std::vector<uint32_t> removed_stocs;
         };
 
+        // A migrated database whose memtables are replayed from their log
+        // files in the background.
+        struct DBReplay {
+            uint32_t cfg_id = 0;
+            uint32_t dbindex = 0;
+            leveldb::DB *db = nullptr;
+            nova::LTCFragment *frag = nullptr;
+            std::unordered_map<uint32_t, leveldb::MemTableLogFilePair> memtables_to_recover;
+            std::vector<std::string> close_log_files;
+            char *buf = nullptr;
+            uint32_t msg_size = 0;
+        };
+
         void RecoverDBMeta(DBMeta dbmeta);
 
+        void ReplayDB(DBReplay replay);
+
+        void RecoverLookupIndex(DBMeta dbmeta);
+
         void MigrateStoC(nova::LTCFragment * frag, const std::vector<uint32_t>& removed_stocs);
 
         std::mutex mu;
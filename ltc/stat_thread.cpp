@@ -5,6 +5,7 @@
 //
 
 #include "stat_thread.h"
+#include "stoc_load_table.h"
 
 namespace nova {
     namespace {
@@ -78,6 +79,36 @@ namespace nova {
             (*storage_stats)[i].write_bytes = tasks;
         }
         output->append("\n");
+        output->append(prefix + "-storage-rejected,");
+        for (int i = 0; i < storage_workers.size(); i++) {
+            output->append(
+                    std::to_string(storage_workers[i]->stat_rejected_tasks_));
+            output->append(",");
+        }
+        output->append("\n");
+
+        // class:count:average:p50:p99 latency in microseconds.
+        leveldb::Histogram hists[kNumStorageTaskClasses];
+        for (int c = 0; c < kNumStorageTaskClasses; c++) {
+            hists[c].Clear();
+        }
+        for (int i = 0; i < storage_workers.size(); i++) {
+            storage_workers[i]->CollectLatencyHistograms(hists);
+        }
+        output->append(prefix + "-storage-latency,");
+        for (int c = 0; c < kNumStorageTaskClasses; c++) {
+            if (hists[c].num() == 0) {
+                continue;
+            }
+            output->append(fmt::format("{}:{}:{:.0f}:{:.0f}:{:.0f},",
+                                       StorageTaskClassName(
+                                               (StorageTaskClass) c),
+                                       (uint64_t) hists[c].num(),
+                                       hists[c].Average(),
+                                       hists[c].Percentile(50),
+                                       hists[c].Percentile(99)));
+        }
+        output->append("\n");
     }
 
     void NovaStatThread::Start() {
@@ -145,6 +176,23 @@ namespace nova {
             }
             output += "\n";
 
+            if (mem_manager_) {
+                // scid:size:slabs:slab-items:free-items:contended-locks:depot-refills:stolen-items
+                std::vector<SlabClassStats> slab_class_stats;
+                mem_manager_->GetSlabClassStats(&slab_class_stats);
+                output += "slab-classes,";
+                for (const auto &s : slab_class_stats) {
+                    if (s.nslabs == 0) {
+                        continue;
+                    }
+                    output += fmt::format("{}:{}:{}:{}:{}:{}:{}:{},", s.scid,
+                                          s.size, s.nslabs, s.nslab_items,
+                                          s.nfree_items, s.ncontended_locks,
+                                          s.ndepot_refills, s.nstolen_items);
+                }
+                output += "\n";
+            }
+
             OutputStats("fg", &output, &fg_storage_stats, fg_storage_workers_);
             OutputStats("bg", &output, &bg_storage_stats, bg_storage_workers_);
             OutputStats("c", &output, &compaction_storage_stats,
@@ -179,6 +227,14 @@ namespace nova {
             }
             output += "\n";
 
+            output += "lockfree-memtable-selections,";
+            for (int i = 0; i < dbs.size(); i++) {
+                output += std::to_string(
+                        dbs[i]->number_of_lockfree_memtable_selections_);
+                output += ",";
+            }
+            output += "\n";
+
             output += "wait-due-to-contention,";
             for (int i = 0; i < dbs.size(); i++) {
                 output += std::to_string(
@@ -249,6 +305,38 @@ namespace nova {
             }
             output += "\n";
 
+            if (NovaConfig::config->log_group_commit_max_batch_size > 1) {
+                std::string group_commit;
+                for (int i = 0; i < dbs.size(); i++) {
+                    if (!dbs[i]->GetProperty("leveldb.log-group-commit",
+                                             &group_commit)) {
+                        continue;
+                    }
+                    output += "log-group-commit-" + std::to_string(i) + ",";
+                    output += group_commit;
+                    output += "\n";
+                }
+            }
+
+            if (NovaConfig::config->enable_lookup_index) {
+                std::string lookup_index;
+                for (int i = 0; i < dbs.size(); i++) {
+                    if (!dbs[i]->GetProperty("leveldb.lookup-index",
+                                             &lookup_index)) {
+                        continue;
+                    }
+                    output += "lookup-index-" + std::to_string(i) + ",";
+                    output += lookup_index;
+                    output += "\n";
+                }
+            }
+
+            std::string stoc_load = leveldb::StoCLoadTable::global.DebugString();
+            if (!stoc_load.empty()) {
+                output += "stoc-load\n";
+                output += stoc_load;
+            }
+
             // report overlapping sstables.
             leveldb::DBStats aggregated_stats = {};
             uint32_t size_dist[BUCKET_SIZE];
@@ -10,6 +10,7 @@
 #include <vector>
 
 #include "common/nova_common.h"
+#include "common/nova_mem_manager.h"
 #include "novalsm/rdma_msg_handler.h"
 #include "stoc/storage_worker.h"
 
@@ -24,6 +25,7 @@ namespace nova {
         std::vector<StorageWorker *> bg_storage_workers_;
         std::vector<StorageWorker *> compaction_storage_workers_;
         std::vector<leveldb::EnvBGThread *> bgs_;
+        NovaMemManager *mem_manager_ = nullptr;
     private:
         struct StorageWorkerStats {
             uint32_t tasks = 0;
@@ -10,6 +10,7 @@
 
 #include <fmt/core.h>
 #include "db/filename.h"
+#include "stoc_load_table.h"
 
 namespace leveldb {
     using namespace rdmaio;
@@ -410,6 +411,15 @@ namespace leveldb {
     uint32_t StoCBlockClient::InitiateReadDataBlock(
             const leveldb::StoCBlockHandle &block_handle, uint64_t offset, uint32_t size, char *result,
             uint32_t result_size, std::string filename, bool is_foreground_reads) {
+        return InitiateReadDataBlock(block_handle, offset, size, result,
+                                     result_size, filename,
+                                     is_foreground_reads, &sem_);
+    }
+
+    uint32_t StoCBlockClient::InitiateReadDataBlock(
+            const leveldb::StoCBlockHandle &block_handle, uint64_t offset, uint32_t size, char *result,
+            uint32_t result_size, std::string filename, bool is_foreground_reads,
+            sem_t *sem, StoCResponse *response) {
         NOVA_ASSERT(size <= result_size)
             << fmt::format("{} {} {} {}", block_handle.DebugString(), filename,
                            size, result_size);
@@ -431,7 +441,10 @@ namespace leveldb {
 //            RDMA_ASSERT(output.size() == converted_handle.size);
             NOVA_LOG(rdmaio::DEBUG)
                 << fmt::format("Wake up local read");
-            sem_post(&sem_);
+            if (response) {
+                response->is_complete.store(true, std::memory_order_release);
+            }
+            sem_post(sem);
             uint32_t reqid = req_id_;
             IncrementReqId();
             return reqid;
@@ -446,7 +459,8 @@ namespace leveldb {
         task.result = result;
         task.write_size = result_size;
         task.filename = filename;
-        task.sem = &sem_;
+        task.sem = sem;
+        task.response = response;
         task.is_foreground_reads = is_foreground_reads;
         AddAsyncTask(task);
 
@@ -592,10 +606,12 @@ namespace leveldb {
         uint32_t req_id = current_req_id_;
         StoCRequestContext context = {};
         context.req_type = StoCRequestType::STOC_READ_BLOCKS;
+        context.remote_server_id = block_handle.server_id;
         context.backing_mem = result;
         context.size = size;
         context.done = false;
         context.log_file_name = filename;
+        context.issue_time_us = StoCLoadTable::NowMicros();
 
         char *send_buf = rdma_broker_->GetSendBuf(block_handle.server_id);
         uint32_t msg_size = 1;
@@ -695,6 +711,8 @@ namespace leveldb {
         StoCRequestContext context = {};
         context.done = false;
         context.req_type = StoCRequestType::STOC_WRITE_SSTABLE;
+        context.remote_server_id = stoc_id;
+        context.issue_time_us = StoCLoadTable::NowMicros();
 
         char *send_buf = rdma_broker_->GetSendBuf(stoc_id);
         uint32_t msg_size = 2;
@@ -784,7 +802,6 @@ namespace leveldb {
 
         if (context_it->second.done) {
             if (response) {
-                response->is_complete = true;
                 response->stoc_file_id = context_it->second.stoc_file_id;
                 response->stoc_block_handles = context_it->second.stoc_block_handles;
                 response->replication_results = context_it->second.replication_results;
@@ -792,6 +809,9 @@ namespace leveldb {
                 response->stoc_pending_read_bytes = context_it->second.stoc_pending_read_bytes;
                 response->stoc_pending_write_bytes = context_it->second.stoc_pending_write_bytes;
                 response->is_ready_to_process_requests = context_it->second.is_ready_for_requests;
+                // Set last so that a reader observing it also observes the
+                // fields above and the data of a read.
+                response->is_complete.store(true, std::memory_order_release);
             }
             request_context_.erase(req_id);
             return true;
@@ -920,7 +940,8 @@ namespace leveldb {
                             NOVA_LOG(DEBUG) << fmt::format(
                                         "stocclient[{}]: Read StoC file blocks complete size:{} req:{}",
                                         stoc_client_id_, context.size, req_id);
-
+                            StoCLoadTable::global.RecordRead(context.remote_server_id,
+                                                             StoCLoadTable::NowMicros() - context.issue_time_us);
                             context.done = true;
                             processed = true;
                         } else {
@@ -944,6 +965,16 @@ namespace leveldb {
                             rids += fmt::format("{},", rh.stoc_file_id);
                         }
                         NOVA_ASSERT(stoc_block_handles == 1);
+                        // The StoC's load follows the handles.
+                        context.stoc_queue_depth = DecodeFixed64(buf + msg_size);
+                        context.stoc_pending_read_bytes = DecodeFixed64(buf + msg_size + 8);
+                        context.stoc_pending_write_bytes = DecodeFixed64(buf + msg_size + 16);
+                        StoCLoadTable::global.RecordLoad(context.remote_server_id,
+                                                         context.stoc_queue_depth,
+                                                         context.stoc_pending_read_bytes,
+                                                         context.stoc_pending_write_bytes);
+                        StoCLoadTable::global.RecordWrite(context.remote_server_id,
+                                                          StoCLoadTable::NowMicros() - context.issue_time_us);
                         context.done = true;
                         NOVA_LOG(DEBUG) << fmt::format(
                                     "stocclient[{}]: Persist StoC file received handles:{} rids:{} req:{}",
@@ -959,6 +990,10 @@ namespace leveldb {
                                 buf + 9);
                         context.stoc_pending_write_bytes = leveldb::DecodeFixed64(
                                 buf + 17);
+                        StoCLoadTable::global.RecordLoad(remote_server_id,
+                                                         context.stoc_queue_depth,
+                                                         context.stoc_pending_read_bytes,
+                                                         context.stoc_pending_write_bytes);
                         context.done = true;
                         processed = true;
                     }
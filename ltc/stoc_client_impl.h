@@ -61,6 +61,20 @@ namespace leveldb {
                               std::string filename,
                               bool is_foreground_reads) override;
 
+        // Same as above but posts "sem" instead of the semaphore of this
+        // client when the read completes. It allows a caller to wait for
+        // a specific read. If "response" is not nullptr, its is_complete is
+        // set before "sem" is posted so that reads sharing "sem" can be told
+        // apart.
+        uint32_t
+        InitiateReadDataBlock(const StoCBlockHandle &block_handle,
+                              uint64_t offset, uint32_t size,
+                              char *result,
+                              uint32_t result_size,
+                              std::string filename,
+                              bool is_foreground_reads, sem_t *sem,
+                              StoCResponse *response = nullptr);
+
         uint32_t
         InitiateInstallFileNameStoCFileMapping(uint32_t stoc_id,
                                                const std::unordered_map<std::string, uint32_t> &fn_stocfnid) override;
@@ -4,18 +4,67 @@
 // Copyright (c) 2020 University of Southern California. All rights reserved.
 //
 
+#include <errno.h>
 #include <semaphore.h>
+#include <time.h>
+#include <list>
 #include <leveldb/table.h>
 #include <table/block.h>
 #include <table/block_builder.h>
+#include <table/filter_block.h>
 #include <util/crc32c.h>
 
 #include "stoc_file_client_impl.h"
 #include "storage_selector.h"
 #include "db/filename.h"
+#include "util/erasure_code.h"
 #include "common/nova_config.h"
 
 namespace leveldb {
+    namespace {
+        // Two reads of the same block that post one semaphore.
+        struct HedgedRead {
+            sem_t sem;
+            StoCResponse responses[2];
+            char *bufs[2] = {};
+            uint32_t scid = 0;
+            uint64_t thread_id = 0;
+            MemManager *mem_manager = nullptr;
+            // Number of reads that have not posted "sem".
+            int outstanding = 0;
+        };
+
+        // Hedged reads of this thread whose slower read is not complete.
+        // They are freed once it completes.
+        thread_local std::list<HedgedRead *> incomplete_hedged_reads;
+
+        void FreeHedgedRead(HedgedRead *h) {
+            for (char *buf : h->bufs) {
+                if (buf) {
+                    h->mem_manager->FreeItem(h->thread_id, buf, h->scid);
+                }
+            }
+            sem_destroy(&h->sem);
+            delete h;
+        }
+
+        void FreeCompleteHedgedReads() {
+            auto it = incomplete_hedged_reads.begin();
+            while (it != incomplete_hedged_reads.end()) {
+                HedgedRead *h = *it;
+                while (h->outstanding > 0 && sem_trywait(&h->sem) == 0) {
+                    h->outstanding--;
+                }
+                if (h->outstanding == 0) {
+                    FreeHedgedRead(h);
+                    it = incomplete_hedged_reads.erase(it);
+                } else {
+                    it++;
+                }
+            }
+        }
+    }
+
     StoCWritableFileClient::StoCWritableFileClient(Env *env,
                                                    const Options &options,
                                                    uint64_t file_number,
@@ -60,13 +109,16 @@ namespace leveldb {
                         "Free remote memory file tid:{} fn:{} size:{}",
                         thread_id_, fname_debug_only_, allocated_size_);
         }
-        if (parity_block_backing_mem_) {
+        if (!parity_block_backing_mems_.empty()) {
             uint32_t scid = mem_manager_->slabclassid(thread_id_,
                                                       parity_block_size_);
-            mem_manager_->FreeItem(thread_id_, parity_block_backing_mem_, scid);
+            for (char *parity_block_backing_mem : parity_block_backing_mems_) {
+                mem_manager_->FreeItem(thread_id_, parity_block_backing_mem, scid);
+            }
             NOVA_LOG(rdmaio::DEBUG) << fmt::format(
-                        "Free parity memory file tid:{} fn:{} size:{}",
-                        thread_id_, fname_debug_only_, parity_block_size_);
+                        "Free parity memory file tid:{} fn:{} size:{} fragments:{}",
+                        thread_id_, fname_debug_only_, parity_block_size_,
+                        parity_block_backing_mems_.size());
         }
         if (index_block_) {
             delete index_block_;
@@ -257,15 +309,14 @@ namespace leveldb {
         } else {
             num_stocs_to_select = nblocks_in_group_.size();
             if (nova::NovaConfig::config->use_parity_for_sstable_data_blocks) {
-                num_stocs_to_select += 1;
+                num_stocs_to_select += nova::NovaConfig::config->number_of_sstable_parity_fragments;
             }
             num_stocs_to_select = std::max(num_stocs_to_select,
                                            nova::NovaConfig::config->number_of_sstable_metadata_replicas);
         }
 
         StorageSelector selector(rand_seed_);
-        selector.SelectStorageServers(client,
-                                      nova::NovaConfig::config->scatter_policy,
+        selector.SelectStorageServers(nova::NovaConfig::config->scatter_policy,
                                       num_stocs_to_select,
                                       &stocs_to_store_fragments_);
         uint32_t dbid = 0;
@@ -327,41 +378,46 @@ namespace leveldb {
             }
         }
         if (nova::NovaConfig::config->use_parity_for_sstable_data_blocks) {
-            NOVA_ASSERT(group_id < stocs_to_store_fragments_.size());
-            // figure out max size.
-            // allocate memory.
-            // do xor.
-            for (const auto &data_fragment : data_fragments) {
-                if (data_fragment.size() > parity_block_size_) {
-                    parity_block_size_ = data_fragment.size();
-                }
+            uint32_t num_parity_fragments = nova::NovaConfig::config->number_of_sstable_parity_fragments;
+            NOVA_ASSERT(group_id + num_parity_fragments <= stocs_to_store_fragments_.size());
+            // The parity fragments are as large as the largest data fragment.
+            // Shorter data fragments are padded with zeros.
+            std::vector<const char *> data(data_fragments.size());
+            std::vector<size_t> data_sizes(data_fragments.size());
+            for (int i = 0; i < data_fragments.size(); i++) {
+                data[i] = backing_mem_ + data_fragments[i].offset();
+                data_sizes[i] = data_fragments[i].size();
+                parity_block_size_ = std::max(parity_block_size_, data_fragments[i].size());
+            }
+            auto scid = mem_manager_->slabclassid(thread_id_, parity_block_size_);
+            for (int j = 0; j < num_parity_fragments; j++) {
+                char *parity_block_backing_mem = mem_manager_->ItemAlloc(thread_id_, scid);
+                NOVA_ASSERT(parity_block_backing_mem) << "Running out of memory " << parity_block_size_;
+                parity_block_backing_mems_.push_back(parity_block_backing_mem);
+            }
+            ErasureCoder coder(data_fragments.size(), num_parity_fragments);
+            coder.Encode(data.data(), data_sizes.data(), parity_block_size_,
+                         parity_block_backing_mems_.data());
+
+            for (int j = 0; j < num_parity_fragments; j++) {
+                uint32_t remote_stoc_id = stocs_to_store_fragments_[group_id + j];
+                uint32_t stoc_file_id = 0;
+                uint32_t req_id = client->InitiateAppendBlock(
+                        remote_stoc_id, thread_id_, &stoc_file_id,
+                        parity_block_backing_mems_[j],
+                        dbname_, file_number_, j,
+                        parity_block_size_, FileInternalType::kFileParity);
+                NOVA_LOG(rdmaio::DEBUG)
+                    << fmt::format(
+                            "t[{}]: Initiated WRITE parity blocks {} s:{} req:{} db:{} fn:{} parity:{}",
+                            thread_id_, parity_block_size_, remote_stoc_id, req_id,
+                            dbname_, file_number_, j);
+                PersistStatus status = {};
+                status.remote_server_id = remote_stoc_id;
+                status.WRITE_req_id = req_id;
+                status.result_handle = {};
+                parity_persist_statuses_.push_back(status);
             }
-            auto scid = mem_manager_->slabclassid(0, parity_block_size_);
-            parity_block_backing_mem_ = mem_manager_->ItemAlloc(0, scid);
-            for (int i = 0; i < parity_block_size_; i++) {
-                uint8_t byte = 0;
-                for (const auto &data_fragment : data_fragments) {
-                    if (data_fragment.size() <= parity_block_size_) {
-                        byte ^= (uint8_t) backing_mem_[data_fragment.offset() + i];
-                    }
-                }
-                parity_block_backing_mem_[i] = byte;
-            }
-            uint32_t remote_stoc_id = stocs_to_store_fragments_[group_id];
-            uint32_t stoc_file_id = 0;
-            uint32_t req_id = client->InitiateAppendBlock(
-                    remote_stoc_id, thread_id_, &stoc_file_id,
-                    parity_block_backing_mem_,
-                    dbname_, file_number_, 0,
-                    parity_block_size_, FileInternalType::kFileParity);
-            NOVA_LOG(rdmaio::DEBUG)
-                << fmt::format(
-                        "t[{}]: Initiated WRITE parity blocks {} s:{} req:{} db:{} fn:{} replica:{}",
-                        thread_id_, parity_block_size_, remote_stoc_id, req_id,
-                        dbname_, file_number_, 0);
-            parity_persist_status_.remote_server_id = remote_stoc_id;
-            parity_persist_status_.WRITE_req_id = req_id;
-            parity_persist_status_.result_handle = {};
         }
 
         NOVA_ASSERT(group_id == nblocks_in_group_.size()) << fmt::format(
@@ -376,14 +432,18 @@ namespace leveldb {
         delete it;
     }
 
-    StoCBlockHandle StoCWritableFileClient::parity_block_handle() {
-        return parity_persist_status_.result_handle;
+    std::vector<StoCBlockHandle> StoCWritableFileClient::parity_block_handles() {
+        std::vector<StoCBlockHandle> handles;
+        for (const auto &status : parity_persist_statuses_) {
+            handles.push_back(status.result_handle);
+        }
+        return handles;
     }
 
     void StoCWritableFileClient::Validate(const std::vector<leveldb::FileReplicaMetaData> &replicas,
-                                          const StoCBlockHandle &parity_block_handle) {
+                                          const std::vector<StoCBlockHandle> &parity_block_handles) {
         StorageSelector selector(rand_seed_);
-        selector.ValidateReplicas(replicas, parity_block_handle);
+        selector.ValidateReplicas(replicas, parity_block_handles);
     }
 
     std::vector<leveldb::FileReplicaMetaData>
@@ -409,7 +469,7 @@ namespace leveldb {
         for (int i = 0; i < nblocks_in_group_.size() * data_replica_status_.size(); i++) {
             client->Wait();
         }
-        if (nova::NovaConfig::config->use_parity_for_sstable_data_blocks) {
+        for (int i = 0; i < parity_persist_statuses_.size(); i++) {
             client->Wait();
         }
     }
@@ -431,13 +491,13 @@ namespace leveldb {
             }
         }
 
-        if (nova::NovaConfig::config->use_parity_for_sstable_data_blocks) {
-            uint32_t req_id = parity_persist_status_.WRITE_req_id;
+        for (auto &status : parity_persist_statuses_) {
+            uint32_t req_id = status.WRITE_req_id;
             StoCResponse response = {};
             NOVA_ASSERT(client->IsDone(req_id, &response, nullptr));
             NOVA_ASSERT(response.stoc_block_handles.size() == 1)
                 << fmt::format("{} {}", req_id, response.stoc_block_handles.size());
-            parity_persist_status_.result_handle = response.stoc_block_handles[0];
+            status.result_handle = response.stoc_block_handles[0];
         }
 
         struct MetaBlockStatus {
@@ -453,8 +513,7 @@ namespace leveldb {
         if (scatter_policy != nova::ScatterPolicy::LOCAL) {
             scatter_policy = nova::ScatterPolicy::RANDOM;
         }
-        selector.SelectStorageServers(client,
-                                      scatter_policy,
+        selector.SelectStorageServers(scatter_policy,
                                       meta_block_handles_.size(),
                                       &random_metablock_stocs);
 
@@ -521,6 +580,14 @@ namespace leveldb {
         int n = 0;
         char handle_buf[StoCBlockHandle::HandleSize()];
         uint64_t filter_block_start_offset = 0;
+        // Index entries of the partitioned index.
+        struct IndexEntry {
+            std::string key;
+            std::string handle;
+            uint64_t data_block_offset;
+        };
+        const bool partitioned = options_.metadata_partition_size > 0;
+        std::vector<IndexEntry> index_entries;
         while (it->Valid()) {
             Slice key = it->key();
             Slice value = it->value();
@@ -540,6 +607,12 @@ namespace leveldb {
             index_handle.EncodeHandle(handle_buf);
             index_block_builder.Add(key, Slice(handle_buf,
                                                StoCBlockHandle::HandleSize()));
+            if (partitioned) {
+                index_entries.push_back(
+                        {key.ToString(),
+                         std::string(handle_buf, StoCBlockHandle::HandleSize()),
+                         handle.offset()});
+            }
             it->Next();
             n++;
             if (n == nblocks_in_group_[group_id]) {
@@ -566,7 +639,7 @@ namespace leveldb {
         uint32_t filter_block_size =
                 footer.metaindex_handle().offset() - filter_block_start_offset -
                 kBlockTrailerSize;
-        uint64_t new_file_size = filter_block_size + kBlockTrailerSize;
+        uint64_t new_file_size = 0;
         // point to start of filter block.
         const uint64_t rewrite_start_offset = filter_block_start_offset;
 
@@ -579,22 +652,71 @@ namespace leveldb {
 
         uint64_t allocated_size = metablock_size;
         uint64_t used_size = 0;
-        // Copy filter block.
-        memcpy(backing_mem, backing_mem_ + rewrite_start_offset, new_file_size);
-
         BlockHandle new_filter_handle = {};
-        new_filter_handle.set_offset(0);
-        new_filter_handle.set_size(filter_block_size);
         BlockHandle new_metaindex_handle = {};
         BlockHandle new_idx_handle = {};
+        BlockBuilder top_index_block_builder(&opt);
+        if (!partitioned) {
+            // Copy filter block.
+            new_file_size = filter_block_size + kBlockTrailerSize;
+            memcpy(backing_mem, backing_mem_ + rewrite_start_offset,
+                   new_file_size);
+            new_filter_handle.set_offset(0);
+            new_filter_handle.set_size(filter_block_size);
+        } else {
+            // Write an index partition and its filter partition every
+            // "metadata_partition_size" bytes of index entries.
+            Slice filter_block(backing_mem_ + rewrite_start_offset,
+                               filter_block_size);
+            BlockBuilder partition_builder(&opt);
+            uint64_t first_data_block_offset = 0;
+            for (int i = 0; i < index_entries.size(); i++) {
+                const IndexEntry &entry = index_entries[i];
+                if (partition_builder.empty()) {
+                    first_data_block_offset = entry.data_block_offset;
+                }
+                partition_builder.Add(entry.key, entry.handle);
+                if (partition_builder.CurrentSizeEstimate() <
+                    options_.metadata_partition_size &&
+                    i + 1 < index_entries.size()) {
+                    continue;
+                }
+                MetadataPartitionHandle partition;
+                std::string filter_partition;
+                ExtractFilterPartition(filter_block, first_data_block_offset,
+                                       entry.data_block_offset,
+                                       &filter_partition,
+                                       &partition.filter_base_offset);
+                uint32_t size = WriteRawBlock(filter_partition, kNoCompression,
+                                              new_file_size, backing_mem,
+                                              allocated_size, &used_size);
+                partition.filter_handle.set_offset(new_file_size);
+                partition.filter_handle.set_size(size - kBlockTrailerSize);
+                new_file_size += size;
+                size = WriteBlock(&partition_builder, new_file_size,
+                                  backing_mem, allocated_size, &used_size);
+                partition.index_handle.set_offset(new_file_size);
+                partition.index_handle.set_size(size - kBlockTrailerSize);
+                new_file_size += size;
+                std::string handle_encoding;
+                partition.EncodeTo(&handle_encoding);
+                top_index_block_builder.Add(entry.key, handle_encoding);
+            }
+        }
         {
             // rewrite meta index block.
             BlockBuilder meta_index_block(&options_);
-            // Add mapping from "filter.Name" to location of filter data
-            std::string key = "filter.";
-            key.append(options_.filter_policy->Name());
             std::string handle_encoding;
-            new_filter_handle.EncodeTo(&handle_encoding);
+            std::string key;
+            if (partitioned) {
+                // The filter is stored in partitions.
+                key = kPartitionedFilterPrefix;
+            } else {
+                // Add mapping from "filter.Name" to location of filter data
+                key = "filter.";
+                new_filter_handle.EncodeTo(&handle_encoding);
+            }
+            key.append(options_.filter_policy->Name());
             meta_index_block.Add(key, handle_encoding);
             uint32_t size = WriteBlock(&meta_index_block,
                                        new_file_size, backing_mem,
@@ -605,7 +727,8 @@ namespace leveldb {
         }
         //Rewrite index block.
         {
-            uint32_t size = WriteBlock(&index_block_builder,
+            uint32_t size = WriteBlock(partitioned ? &top_index_block_builder
+                                                   : &index_block_builder,
                                        new_file_size, backing_mem,
                                        allocated_size, &used_size);
             new_idx_handle.set_offset(new_file_size);
@@ -789,6 +912,26 @@ namespace leveldb {
             *result = Slice(scratch, n);
         } else {
             NOVA_ASSERT(n < MAX_BLOCK_SIZE);
+            // Reclaim buffers of earlier hedged reads that have completed
+            // since.
+            FreeCompleteHedgedReads();
+            if (!meta_->parity_block_handles.empty()) {
+                nova::Servers *available_stocs = StorageSelector::available_stoc_servers;
+                if (available_stocs->server_ids.find(block_handle.server_id) ==
+                    available_stocs->server_ids.end()) {
+                    return ReadDegraded(read_options, block_handle, offset, n,
+                                        result, scratch);
+                }
+            }
+            StoCBlockHandle hedge_handle = {};
+            uint64_t hedge_offset = 0;
+            uint64_t delay_us = 0;
+            if (FindHedgeTarget(block_handle, offset, &hedge_handle,
+                                &hedge_offset, &delay_us)) {
+                return ReadHedged(read_options, block_handle, offset,
+                                  hedge_handle, hedge_offset, delay_us, n,
+                                  result, scratch);
+            }
             char *backing_mem_block = read_options.rdma_backing_mem;
             if (block_handle.server_id == nova::NovaConfig::config->my_server_id) {
                 backing_mem_block = scratch;
@@ -817,6 +960,200 @@ namespace leveldb {
         return Status::OK();
     }
 
+    Status StoCRandomAccessFileClientImpl::ReadDegraded(
+            const leveldb::ReadOptions &read_options,
+            const leveldb::StoCBlockHandle &block_handle, uint64_t offset,
+            size_t n, leveldb::Slice *result, char *scratch) {
+        const std::vector<StoCBlockHandle> &data_handles = meta_->block_replica_handles[0].data_block_group_handles;
+        const std::vector<StoCBlockHandle> &parity_handles = meta_->parity_block_handles;
+        uint32_t k = data_handles.size();
+        uint32_t m = parity_handles.size();
+        uint32_t index = k;
+        for (uint32_t i = 0; i < k; i++) {
+            if (data_handles[i].server_id == block_handle.server_id &&
+                data_handles[i].stoc_file_id == block_handle.stoc_file_id) {
+                index = i;
+                break;
+            }
+        }
+        NOVA_ASSERT(index < k) << fmt::format("db:{} fn:{} {}", dbid_, file_number_, block_handle.DebugString());
+        // Byte r of a data fragment is encoded in byte r of every parity
+        // fragment.
+        NOVA_ASSERT(offset >= data_handles[index].offset);
+        uint64_t r = offset - data_handles[index].offset;
+
+        // Read the same range from k of the surviving fragments.
+        nova::Servers *available_stocs = StorageSelector::available_stoc_servers;
+        auto stoc_client = reinterpret_cast<leveldb::StoCBlockClient *>(read_options.stoc_client);
+        uint32_t scid = mem_manager_->slabclassid(read_options.thread_id, n);
+        std::vector<const char *> fragments(k + m, nullptr);
+        std::vector<char *> bufs;
+        uint32_t reads = 0;
+        for (uint32_t f = 0; f < k + m && bufs.size() < k; f++) {
+            const StoCBlockHandle &handle = f < k ? data_handles[f] : parity_handles[f - k];
+            if (f == index || available_stocs->server_ids.find(handle.server_id) ==
+                              available_stocs->server_ids.end()) {
+                continue;
+            }
+            char *buf = mem_manager_->ItemAlloc(read_options.thread_id, scid);
+            NOVA_ASSERT(buf) << "Running out of memory";
+            // A data fragment shorter than the range is padded with zeros.
+            memset(buf, 0, n);
+            if (r < handle.size) {
+                uint64_t size = std::min((uint64_t) n, handle.size - r);
+                stoc_client->InitiateReadDataBlock(handle, handle.offset + r, size, buf, size, "", true);
+                reads++;
+            }
+            fragments[f] = buf;
+            bufs.push_back(buf);
+        }
+        for (uint32_t i = 0; i < reads; i++) {
+            stoc_client->Wait();
+        }
+        ErasureCoder coder(k, m);
+        bool reconstructed = coder.Reconstruct(fragments.data(), n, index, scratch);
+        for (char *buf : bufs) {
+            mem_manager_->FreeItem(read_options.thread_id, buf, scid);
+        }
+        NOVA_LOG(rdmaio::DEBUG)
+            << fmt::format("t[{}]: Degraded read db:{} fn:{} fragment:{} s:{} survivors:{}",
+                           read_options.thread_id, dbid_, file_number_, index, n, bufs.size());
+        if (!reconstructed) {
+            return Status::IOError(fmt::format("fn:{} fragment {} has fewer than {} surviving fragments",
+                                               file_number_, index, k));
+        }
+        *result = Slice(scratch, n);
+        return Status::OK();
+    }
+
+    bool StoCRandomAccessFileClientImpl::FindHedgeTarget(
+            const leveldb::StoCBlockHandle &block_handle, uint64_t offset,
+            leveldb::StoCBlockHandle *hedge_handle, uint64_t *hedge_offset,
+            uint64_t *delay_us) {
+        double percentile = nova::NovaConfig::config->hedged_read_percentile;
+        // With one data replica, all replicas share the same data blocks.
+        if (percentile <= 0 ||
+            nova::NovaConfig::config->number_of_sstable_data_replicas <= 1 ||
+            meta_->block_replica_handles.size() <= 1 ||
+            block_handle.server_id == nova::NovaConfig::config->my_server_id) {
+            return false;
+        }
+        *delay_us = StoCLoadTable::global.ReadLatencyPercentile(percentile);
+        if (*delay_us == 0) {
+            return false;
+        }
+        // Locate the data fragment of the block.
+        int replica_id = -1;
+        int frag_id = -1;
+        for (int i = 0; i < meta_->block_replica_handles.size() && replica_id == -1; i++) {
+            const auto &handles = meta_->block_replica_handles[i].data_block_group_handles;
+            for (int j = 0; j < handles.size(); j++) {
+                if (handles[j].server_id == block_handle.server_id &&
+                    handles[j].stoc_file_id == block_handle.stoc_file_id) {
+                    replica_id = i;
+                    frag_id = j;
+                    break;
+                }
+            }
+        }
+        if (replica_id == -1) {
+            return false;
+        }
+        const StoCBlockHandle &fragment = meta_->block_replica_handles[replica_id].data_block_group_handles[frag_id];
+        // Hedge to the least loaded replica on another available StoC.
+        nova::Servers *available_stocs = StorageSelector::available_stoc_servers;
+        uint64_t now_us = StoCLoadTable::NowMicros();
+        double best_score = 0;
+        bool found = false;
+        for (int i = 0; i < meta_->block_replica_handles.size(); i++) {
+            const auto &handles = meta_->block_replica_handles[i].data_block_group_handles;
+            if (i == replica_id || frag_id >= handles.size()) {
+                continue;
+            }
+            const StoCBlockHandle &candidate = handles[frag_id];
+            if (candidate.server_id == block_handle.server_id ||
+                available_stocs->server_ids.find(candidate.server_id) ==
+                available_stocs->server_ids.end()) {
+                continue;
+            }
+            double score = StoCLoadTable::global.Score(candidate.server_id, now_us);
+            if (!found || score < best_score) {
+                found = true;
+                best_score = score;
+                *hedge_handle = candidate;
+            }
+        }
+        if (!found) {
+            return false;
+        }
+        *hedge_offset = hedge_handle->offset + (offset - fragment.offset);
+        return true;
+    }
+
+    Status StoCRandomAccessFileClientImpl::ReadHedged(
+            const leveldb::ReadOptions &read_options,
+            const leveldb::StoCBlockHandle &block_handle, uint64_t offset,
+            const leveldb::StoCBlockHandle &hedge_handle,
+            uint64_t hedge_offset, uint64_t delay_us, size_t n,
+            leveldb::Slice *result, char *scratch) {
+        auto stoc_client = reinterpret_cast<leveldb::StoCBlockClient *>(read_options.stoc_client);
+        // The slower read may complete after this function returns. So both
+        // reads use their own buffers instead of rdma_backing_mem.
+        HedgedRead *h = new HedgedRead;
+        sem_init(&h->sem, 0, 0);
+        h->mem_manager = mem_manager_;
+        h->thread_id = read_options.thread_id;
+        h->scid = mem_manager_->slabclassid(h->thread_id, n);
+        h->bufs[0] = mem_manager_->ItemAlloc(h->thread_id, h->scid);
+        NOVA_ASSERT(h->bufs[0]) << "Running out of memory";
+        stoc_client->InitiateReadDataBlock(block_handle, offset, n, h->bufs[0], n, "", true,
+                                           &h->sem, &h->responses[0]);
+        h->outstanding = 1;
+
+        timespec deadline = {};
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        uint64_t nsec = deadline.tv_nsec + delay_us * 1000;
+        deadline.tv_sec += nsec / 1000000000;
+        deadline.tv_nsec = nsec % 1000000000;
+        int ret;
+        while ((ret = sem_timedwait(&h->sem, &deadline)) != 0 && errno == EINTR) {
+        }
+        int winner = 0;
+        if (ret == 0) {
+            h->outstanding = 0;
+        } else {
+            NOVA_ASSERT(errno == ETIMEDOUT) << errno;
+            h->bufs[1] = mem_manager_->ItemAlloc(h->thread_id, h->scid);
+            NOVA_ASSERT(h->bufs[1]) << "Running out of memory";
+            stoc_client->InitiateReadDataBlock(hedge_handle, hedge_offset, n, h->bufs[1], n, "", true,
+                                               &h->sem, &h->responses[1]);
+            h->outstanding = 2;
+            NOVA_ASSERT(sem_wait(&h->sem) == 0);
+            h->outstanding = 1;
+            // is_complete is stored after the data of a read lands in its
+            // buffer. The acquire load makes the buffer of the winner
+            // visible even if the other read posted "sem".
+            if (!h->responses[0].is_complete.load(std::memory_order_acquire)) {
+                NOVA_ASSERT(h->responses[1].is_complete.load(std::memory_order_acquire));
+                winner = 1;
+            }
+            StoCLoadTable::global.RecordHedgedRead(block_handle.server_id, winner == 1);
+            NOVA_LOG(rdmaio::DEBUG)
+                << fmt::format("t[{}]: Hedged read db:{} fn:{} s:{} from:{} to:{} delay:{} winner:{}",
+                               read_options.thread_id, dbid_, file_number_, n,
+                               block_handle.server_id, hedge_handle.server_id,
+                               delay_us, winner);
+        }
+        memcpy(scratch, h->bufs[winner], n);
+        *result = Slice(scratch, n);
+        if (h->outstanding == 0) {
+            FreeHedgedRead(h);
+        } else {
+            incomplete_hedged_reads.push_back(h);
+        }
+        return Status::OK();
+    }
+
     StoCRandomAccessFileClientImpl::~StoCRandomAccessFileClientImpl() {
         if (prefetch_all_) {
             NOVA_LOG(rdmaio::DEBUG) << fmt::format("close file {}", filename);
@@ -77,9 +77,10 @@ namespace leveldb {
 
         std::vector<leveldb::FileReplicaMetaData> replicas();
 
-        StoCBlockHandle parity_block_handle();
+        std::vector<StoCBlockHandle> parity_block_handles();
 
-        void Validate(const std::vector<leveldb::FileReplicaMetaData>& replicas, const StoCBlockHandle& parity_block_handle);
+        void Validate(const std::vector<leveldb::FileReplicaMetaData>& replicas,
+                      const std::vector<StoCBlockHandle>& parity_block_handles);
 
     private:
         struct PersistStatus {
@@ -123,10 +124,11 @@ namespace leveldb {
         const uint64_t allocated_size_;
         uint64_t used_size_ = 0;
         std::vector<int> nblocks_in_group_;
-        char *parity_block_backing_mem_ = nullptr;
+        // One buffer per parity fragment. All of them are parity_block_size_.
+        std::vector<char *> parity_block_backing_mems_;
         uint64_t parity_block_size_ = 0;
 
-        PersistStatus parity_persist_status_;
+        std::vector<PersistStatus> parity_persist_statuses_;
 
         struct FileReplicaPersistStatus {
             std::vector<PersistStatus> persist_statuses;
@@ -167,6 +169,32 @@ namespace leveldb {
         Status ReadAll(StoCClient *stoc_client);
 
     private:
+        // Reconstruct [offset, offset+n) of a data fragment stored on a
+        // failed StoC from the surviving data fragments and the parity
+        // fragments.
+        Status ReadDegraded(const ReadOptions &read_options,
+                            const StoCBlockHandle &block_handle,
+                            uint64_t offset, size_t n,
+                            Slice *result, char *scratch);
+
+        // Find the block at the same position in another replica to hedge
+        // a read of [offset, offset+n) to. Returns false if hedged reads are
+        // disabled or there is no such replica.
+        bool FindHedgeTarget(const StoCBlockHandle &block_handle,
+                             uint64_t offset,
+                             StoCBlockHandle *hedge_handle,
+                             uint64_t *hedge_offset, uint64_t *delay_us);
+
+        // Read the block from "block_handle". If it does not complete within
+        // "delay_us", read it from "hedge_handle" as well and take whichever
+        // completes first.
+        Status ReadHedged(const ReadOptions &read_options,
+                          const StoCBlockHandle &block_handle,
+                          uint64_t offset,
+                          const StoCBlockHandle &hedge_handle,
+                          uint64_t hedge_offset, uint64_t delay_us,
+                          size_t n, Slice *result, char *scratch);
+
         struct DataBlockStoCFileLocalBuf {
             uint64_t offset;
             uint32_t size;
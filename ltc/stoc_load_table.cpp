@@ -0,0 +1,205 @@
+//
+// Copyright (c) 2020 University of Southern California. All rights reserved.
+//
+
+#include "stoc_load_table.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fmt/core.h>
+
+namespace leveldb {
+    namespace {
+        // Weight of a new latency sample.
+        const double kEWMAWeight = 0.2;
+        // A StoC without a sample in the last second is probed again.
+        const uint64_t kStaleSampleUs = 1000000;
+        // Minimum number of read latency samples to compute a percentile.
+        const uint64_t kMinLatencySamples = 1000;
+        // The read latency histogram is halved every this many samples so
+        // that it follows recent latencies.
+        const uint64_t kLatencyDecaySamples = 1 << 16;
+    }
+
+    StoCLoadTable StoCLoadTable::global;
+
+    StoCLoadTable::StoCLoadTable() {
+        for (uint32_t i = 0; i < kMaxStoCs; i++) {
+            Entry &e = entries_[i];
+            e.read_latency_us = 0;
+            e.write_latency_us = 0;
+            e.queue_depth = 0;
+            e.pending_read_bytes = 0;
+            e.pending_write_bytes = 0;
+            e.last_update_us = 0;
+            e.selections = 0;
+            e.hedged_reads = 0;
+            e.hedged_reads_won = 0;
+        }
+        for (int i = 0; i < kLatencyBuckets; i++) {
+            read_latency_buckets_[i] = 0;
+        }
+        read_latency_samples_ = 0;
+    }
+
+    uint64_t StoCLoadTable::NowMicros() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void StoCLoadTable::UpdateEWMA(std::atomic<double> *ewma, uint64_t sample) {
+        double old = ewma->load(std::memory_order_relaxed);
+        if (old == 0) {
+            ewma->store(sample, std::memory_order_relaxed);
+            return;
+        }
+        ewma->store(kEWMAWeight * sample + (1 - kEWMAWeight) * old,
+                    std::memory_order_relaxed);
+    }
+
+    void StoCLoadTable::RecordRead(uint32_t stoc_id, uint64_t latency_us) {
+        if (stoc_id >= kMaxStoCs) {
+            return;
+        }
+        UpdateEWMA(&entries_[stoc_id].read_latency_us, latency_us);
+        entries_[stoc_id].last_update_us.store(NowMicros(),
+                                               std::memory_order_relaxed);
+
+        int bucket = 63 - __builtin_clzll(latency_us | 1);
+        bucket = std::min(bucket, kLatencyBuckets - 1);
+        read_latency_buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+        uint64_t samples = read_latency_samples_.fetch_add(
+                1, std::memory_order_relaxed) + 1;
+        if (samples % kLatencyDecaySamples == 0) {
+            for (int i = 0; i < kLatencyBuckets; i++) {
+                read_latency_buckets_[i].store(
+                        read_latency_buckets_[i].load(
+                                std::memory_order_relaxed) / 2,
+                        std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void StoCLoadTable::RecordWrite(uint32_t stoc_id, uint64_t latency_us) {
+        if (stoc_id >= kMaxStoCs) {
+            return;
+        }
+        UpdateEWMA(&entries_[stoc_id].write_latency_us, latency_us);
+        entries_[stoc_id].last_update_us.store(NowMicros(),
+                                               std::memory_order_relaxed);
+    }
+
+    void StoCLoadTable::RecordLoad(uint32_t stoc_id, uint64_t queue_depth,
+                                   uint64_t pending_read_bytes,
+                                   uint64_t pending_write_bytes) {
+        if (stoc_id >= kMaxStoCs) {
+            return;
+        }
+        Entry &e = entries_[stoc_id];
+        e.queue_depth.store(queue_depth, std::memory_order_relaxed);
+        e.pending_read_bytes.store(pending_read_bytes,
+                                   std::memory_order_relaxed);
+        e.pending_write_bytes.store(pending_write_bytes,
+                                    std::memory_order_relaxed);
+        e.last_update_us.store(NowMicros(), std::memory_order_relaxed);
+    }
+
+    void StoCLoadTable::RecordSelection(uint32_t stoc_id) {
+        if (stoc_id >= kMaxStoCs) {
+            return;
+        }
+        entries_[stoc_id].selections.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void StoCLoadTable::RecordHedgedRead(uint32_t stoc_id, bool won) {
+        if (stoc_id >= kMaxStoCs) {
+            return;
+        }
+        entries_[stoc_id].hedged_reads.fetch_add(1, std::memory_order_relaxed);
+        if (won) {
+            entries_[stoc_id].hedged_reads_won.fetch_add(
+                    1, std::memory_order_relaxed);
+        }
+    }
+
+    uint64_t StoCLoadTable::ReadLatencyPercentile(double p) const {
+        uint64_t counts[kLatencyBuckets];
+        uint64_t total = 0;
+        for (int i = 0; i < kLatencyBuckets; i++) {
+            counts[i] = read_latency_buckets_[i].load(
+                    std::memory_order_relaxed);
+            total += counts[i];
+        }
+        if (total < kMinLatencySamples) {
+            return 0;
+        }
+        double threshold = total * p / 100.0;
+        double sum = 0;
+        for (int i = 0; i < kLatencyBuckets; i++) {
+            if (counts[i] == 0 || sum + counts[i] < threshold) {
+                sum += counts[i];
+                continue;
+            }
+            // Interpolate within the bucket.
+            double left = i == 0 ? 0 : (double) (1ull << i);
+            double right = (double) (2ull << i);
+            double pos = (threshold - sum) / counts[i];
+            return (uint64_t) (left + (right - left) * pos);
+        }
+        return 2ull << (kLatencyBuckets - 1);
+    }
+
+    double StoCLoadTable::Score(uint32_t stoc_id, uint64_t now_us) const {
+        if (stoc_id >= kMaxStoCs) {
+            return 0;
+        }
+        const Entry &e = entries_[stoc_id];
+        uint64_t last_update_us = e.last_update_us.load(
+                std::memory_order_relaxed);
+        if (last_update_us == 0 || now_us > last_update_us + kStaleSampleUs) {
+            return 0;
+        }
+        double latency_us = e.write_latency_us.load(std::memory_order_relaxed);
+        if (latency_us == 0) {
+            latency_us = e.read_latency_us.load(std::memory_order_relaxed);
+        }
+        // Requests queued at the StoC are served before this one.
+        return latency_us * (1 + e.queue_depth.load(std::memory_order_relaxed));
+    }
+
+    uint64_t StoCLoadTable::PendingBytes(uint32_t stoc_id) const {
+        if (stoc_id >= kMaxStoCs) {
+            return 0;
+        }
+        const Entry &e = entries_[stoc_id];
+        return e.pending_read_bytes.load(std::memory_order_relaxed) +
+               e.pending_write_bytes.load(std::memory_order_relaxed);
+    }
+
+    std::string StoCLoadTable::DebugString() const {
+        std::string result;
+        uint64_t now_us = NowMicros();
+        for (uint32_t i = 0; i < kMaxStoCs; i++) {
+            const Entry &e = entries_[i];
+            uint64_t last_update_us = e.last_update_us;
+            uint64_t selections = e.selections;
+            uint64_t hedged_reads = e.hedged_reads;
+            if (last_update_us == 0 && selections == 0 && hedged_reads == 0) {
+                continue;
+            }
+            uint64_t age_ms = 0;
+            if (last_update_us != 0 && now_us > last_update_us) {
+                age_ms = (now_us - last_update_us) / 1000;
+            }
+            result += fmt::format("{},{},{:.1f},{:.1f},{},{},{},{},{},{}\n", i,
+                                  selections, e.read_latency_us.load(),
+                                  e.write_latency_us.load(),
+                                  (uint64_t) e.queue_depth,
+                                  (uint64_t) e.pending_read_bytes,
+                                  (uint64_t) e.pending_write_bytes, age_ms,
+                                  hedged_reads,
+                                  (uint64_t) e.hedged_reads_won);
+        }
+        return result;
+    }
+}
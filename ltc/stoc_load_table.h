@@ -0,0 +1,86 @@
+//
+// Copyright (c) 2020 University of Southern California. All rights reserved.
+//
+// Load of each StoC observed by this server.
+
+#ifndef LEVELDB_STOC_LOAD_TABLE_H
+#define LEVELDB_STOC_LOAD_TABLE_H
+
+#include <atomic>
+#include <stdint.h>
+#include <string>
+
+namespace leveldb {
+    // The table is updated as responses of existing requests arrive: read and
+    // write latencies are measured by the StoC client and the StoC's queue
+    // depth and pending disk bytes are piggybacked on persist responses.
+    // StorageSelector reads it to place SSTable fragments without issuing
+    // requests of its own.
+    class StoCLoadTable {
+    public:
+        static const uint32_t kMaxStoCs = 256;
+
+        StoCLoadTable();
+
+        static StoCLoadTable global;
+
+        static uint64_t NowMicros();
+
+        void RecordRead(uint32_t stoc_id, uint64_t latency_us);
+
+        void RecordWrite(uint32_t stoc_id, uint64_t latency_us);
+
+        void RecordLoad(uint32_t stoc_id, uint64_t queue_depth,
+                        uint64_t pending_read_bytes,
+                        uint64_t pending_write_bytes);
+
+        void RecordSelection(uint32_t stoc_id);
+
+        // A read from "stoc_id" was hedged to another replica. "won" is true
+        // if the hedged read completed first.
+        void RecordHedgedRead(uint32_t stoc_id, bool won);
+
+        // The p-th percentile of read latencies across StoCs in
+        // microseconds. 0 if there are too few samples.
+        uint64_t ReadLatencyPercentile(double p) const;
+
+        // Expected time in microseconds for the StoC to serve a write. It is
+        // 0 for a StoC without a recent sample so that it receives traffic
+        // and gets measured again.
+        double Score(uint32_t stoc_id, uint64_t now_us) const;
+
+        // Pending disk bytes. Breaks ties between equal scores.
+        uint64_t PendingBytes(uint32_t stoc_id) const;
+
+        // One line per StoC:
+        // stoc,selections,read ewma us,write ewma us,queue depth,
+        // pending read bytes,pending write bytes,age ms,hedged reads,
+        // hedged reads won.
+        std::string DebugString() const;
+
+    private:
+        struct Entry {
+            std::atomic<double> read_latency_us;
+            std::atomic<double> write_latency_us;
+            std::atomic_uint_fast64_t queue_depth;
+            std::atomic_uint_fast64_t pending_read_bytes;
+            std::atomic_uint_fast64_t pending_write_bytes;
+            std::atomic_uint_fast64_t last_update_us;
+            std::atomic_uint_fast64_t selections;
+            std::atomic_uint_fast64_t hedged_reads;
+            std::atomic_uint_fast64_t hedged_reads_won;
+        };
+
+        // Bucket i holds read latencies in [2^i, 2^(i+1)) microseconds.
+        static const int kLatencyBuckets = 32;
+
+        // Racing updates may lose a sample. It is fine for an estimate.
+        static void UpdateEWMA(std::atomic<double> *ewma, uint64_t sample);
+
+        Entry entries_[kMaxStoCs];
+        std::atomic_uint_fast64_t read_latency_buckets_[kLatencyBuckets];
+        std::atomic_uint_fast64_t read_latency_samples_;
+    };
+}
+
+#endif //LEVELDB_STOC_LOAD_TABLE_H
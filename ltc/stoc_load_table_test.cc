@@ -0,0 +1,119 @@
+//
+// Copyright (c) 2020 University of Southern California. All rights reserved.
+//
+
+#include <common/nova_common.h>
+#include "ltc/stoc_load_table.h"
+#include "ltc/storage_selector.h"
+#include "db/version_set.h"
+
+#include "util/testharness.h"
+
+namespace leveldb {
+
+    class StoCLoadTableTest {
+    };
+
+    TEST(StoCLoadTableTest, ScoreWithoutSample) {
+        StoCLoadTable table;
+        uint64_t now_us = StoCLoadTable::NowMicros();
+        ASSERT_EQ(0, table.Score(0, now_us));
+        ASSERT_EQ(0, table.Score(StoCLoadTable::kMaxStoCs, now_us));
+    }
+
+    TEST(StoCLoadTableTest, Score) {
+        StoCLoadTable table;
+        // Without a write sample the read latency is used.
+        table.RecordRead(1, 50);
+        uint64_t now_us = StoCLoadTable::NowMicros();
+        ASSERT_EQ(50, table.Score(1, now_us));
+
+        table.RecordWrite(1, 100);
+        now_us = StoCLoadTable::NowMicros();
+        ASSERT_EQ(100, table.Score(1, now_us));
+        // 100 * 0.2 + 100 * 0.8.
+        table.RecordWrite(1, 100);
+        ASSERT_EQ(100, table.Score(1, now_us));
+
+        // Queued requests are served first.
+        table.RecordLoad(1, 3, 10, 20);
+        now_us = StoCLoadTable::NowMicros();
+        ASSERT_EQ(400, table.Score(1, now_us));
+        ASSERT_EQ(30, table.PendingBytes(1));
+
+        // A stale StoC is probed again.
+        ASSERT_EQ(0, table.Score(1, now_us + 2000000));
+    }
+
+    TEST(StoCLoadTableTest, ReadLatencyPercentile) {
+        StoCLoadTable table;
+        for (int i = 0; i < 999; i++) {
+            table.RecordRead(0, 100);
+        }
+        // Too few samples.
+        ASSERT_EQ(0, table.ReadLatencyPercentile(50));
+        table.RecordRead(0, 100);
+        uint64_t p50 = table.ReadLatencyPercentile(50);
+        ASSERT_GE(p50, 64);
+        ASSERT_LE(p50, 128);
+
+        for (int i = 0; i < 1000; i++) {
+            table.RecordRead(1, 10000);
+        }
+        uint64_t p25 = table.ReadLatencyPercentile(25);
+        ASSERT_GE(p25, 64);
+        ASSERT_LE(p25, 128);
+        uint64_t p99 = table.ReadLatencyPercentile(99);
+        ASSERT_GE(p99, 8192);
+        ASSERT_LE(p99, 16384);
+        ASSERT_LE(p25, table.ReadLatencyPercentile(50));
+        ASSERT_LE(table.ReadLatencyPercentile(50), p99);
+    }
+
+    TEST(StoCLoadTableTest, PowerOfTwoChoices) {
+        nova::Servers *stocs = new nova::Servers;
+        for (uint32_t i = 0; i < 4; i++) {
+            stocs->servers.push_back(i);
+            stocs->server_ids.insert(i);
+            StoCLoadTable::global.RecordWrite(i, i == 3 ? 1000 : 10);
+        }
+        StorageSelector::available_stoc_servers.store(stocs);
+        unsigned int rand_seed = 301;
+        StorageSelector selector(&rand_seed);
+        std::vector<uint32_t> selected;
+
+        // StoC 3 loses to every other candidate.
+        for (int i = 0; i < 1000; i++) {
+            selector.SelectStorageServers(nova::ScatterPolicy::POWER_OF_TWO,
+                                          1, &selected);
+            ASSERT_EQ(1, selected.size());
+            ASSERT_NE(3, selected[0]);
+        }
+
+        // Candidates are sampled without replacement.
+        for (int i = 0; i < 1000; i++) {
+            selector.SelectStorageServers(nova::ScatterPolicy::POWER_OF_TWO,
+                                          3, &selected);
+            std::set<uint32_t> distinct(selected.begin(), selected.end());
+            ASSERT_EQ(3, distinct.size());
+        }
+        StorageSelector::available_stoc_servers.store(nullptr);
+        delete stocs;
+    }
+}  // namespace leveldb
+
+using namespace nova;
+
+NovaConfig *NovaConfig::config;
+std::atomic_int_fast32_t leveldb::EnvBGThread::bg_flush_memtable_thread_id_seq;
+std::atomic_int_fast32_t nova::RDMAServerImpl::bg_storage_worker_seq_id_;
+std::atomic_int_fast32_t leveldb::StoCBlockClient::rdma_worker_seq_id_;
+std::unordered_map<uint64_t, leveldb::FileMetaData *> leveldb::Version::last_fnfile;
+nova::NovaGlobalVariables nova::NovaGlobalVariables::global;
+std::atomic<nova::Servers *> leveldb::StorageSelector::available_stoc_servers;
+std::atomic_int_fast32_t leveldb::StorageSelector::stoc_for_compaction_seq_id;
+
+int main(int argc, char **argv) {
+    NovaConfig::config = new NovaConfig;
+    return leveldb::test::RunAllTests();
+}
@@ -7,27 +7,13 @@
 #include "storage_selector.h"
 
 namespace leveldb {
-    namespace {
-        struct StoCStatsStatus {
-            uint32_t remote_stoc_id = 0;
-            uint32_t req_id = 0;
-            StoCResponse *response = nullptr;
-        };
-
-        bool stoc_stats_comparator(const StoCStatsStatus &s1,
-                                   const StoCStatsStatus &s2) {
-            return s1.response->stoc_queue_depth <
-                   s2.response->stoc_queue_depth;
-        }
-    }
-
     StorageSelector::StorageSelector(unsigned int *rand_seed) : rand_seed_(
             rand_seed) {
     }
 
     void StorageSelector::ValidateReplicas(
             const std::vector<leveldb::FileReplicaMetaData> &replicas,
-            const leveldb::StoCBlockHandle &parity_block_handle) {
+            const std::vector<leveldb::StoCBlockHandle> &parity_block_handles) {
         // Make sure all replicas are placed on a different StoC.
         {
             // Validate metadata blocks.
@@ -119,11 +105,12 @@ namespace leveldb {
                     NOVA_ASSERT(replica0handle.server_id == replicaihandle.server_id) << ReplicaDebugString(replicas);
                 }
             }
-            // Verify parity block is stored on a different server.
-            if (parity_block_handle.stoc_file_id != 0) {
+            // Verify parity blocks are stored on different servers.
+            for (const auto &parity_block_handle : parity_block_handles) {
                 NOVA_ASSERT(used_replicas.find(parity_block_handle.server_id) == used_replicas.end())
                     << fmt::format("Replicas:{} Parity:{}", ReplicaDebugString(replicas),
                                    parity_block_handle.DebugString());
+                used_replicas.insert(parity_block_handle.server_id);
             }
         }
     }
@@ -193,11 +180,9 @@ namespace leveldb {
     }
 
     void
-    StorageSelector::SelectStorageServers(StoCBlockClient *client,
-                                          nova::ScatterPolicy scatter_policy,
+    StorageSelector::SelectStorageServers(nova::ScatterPolicy scatter_policy,
                                           int num_storage_to_select,
                                           std::vector<uint32_t> *selected_storage) {
-        NOVA_ASSERT(client);
         selected_storage->clear();
         selected_storage->resize(num_storage_to_select);
         nova::Servers *available_stocs = available_stoc_servers;
@@ -210,58 +195,58 @@ namespace leveldb {
         if (num_storage_to_select == available_stocs->servers.size()) {
             for (int i = 0; i < num_storage_to_select; i++) {
                 (*selected_storage)[i] = available_stocs->servers[i];
+                StoCLoadTable::global.RecordSelection(available_stocs->servers[i]);
             }
             return;
         }
 
-        std::vector<uint32_t> candidate_storage_ids;
+        uint32_t d = 0;
         if (scatter_policy == nova::ScatterPolicy::POWER_OF_TWO) {
-            uint32_t start_storage_id = rand_r(rand_seed_) %
-                                        available_stocs->servers.size();
-            uint32_t candidates = 2 * num_storage_to_select;
-            if (candidates > available_stocs->servers.size()) {
-                candidates = available_stocs->servers.size();
-            }
-            for (int i = 0; i < candidates; i++) {
-                candidate_storage_ids.push_back(start_storage_id);
-                start_storage_id = (start_storage_id + 1) %
-                                   available_stocs->servers.size();
-            }
-        } else {
+            d = 2;
+        } else if (scatter_policy == nova::ScatterPolicy::POWER_OF_THREE) {
+            d = 3;
+        }
+        if (d == 0) {
             // Random.
             // Select the start storage id then round robin.
             uint32_t start_storage_id =
                     rand_r(rand_seed_) % available_stocs->servers.size();
             for (int i = 0; i < num_storage_to_select; i++) {
                 (*selected_storage)[i] = available_stocs->servers[start_storage_id];
+                StoCLoadTable::global.RecordSelection(available_stocs->servers[start_storage_id]);
                 start_storage_id = (start_storage_id + 1) % available_stocs->servers.size();
             }
+            return;
         }
-        if (!candidate_storage_ids.empty()) {
-            std::vector<StoCStatsStatus> storage_stats;
-            for (int i = 0; i < candidate_storage_ids.size(); i++) {
-                uint32_t server_id = available_stocs->servers[candidate_storage_ids[i]];
-                uint32_t req_id = client->InitiateReadStoCStats(server_id);
-                StoCStatsStatus status;
-                status.remote_stoc_id = server_id;
-                status.req_id = req_id;
-                status.response = new StoCResponse;
-                storage_stats.push_back(status);
-            }
-            for (int i = 0; i < storage_stats.size(); i++) {
-                client->Wait();
-            }
-            for (int i = 0; i < storage_stats.size(); i++) {
-                NOVA_ASSERT(client->IsDone(storage_stats[i].req_id, storage_stats[i].response, nullptr));
-            }
-            // sort the stoc stats.
-            std::sort(storage_stats.begin(), storage_stats.end(), stoc_stats_comparator);
-            for (int i = 0; i < num_storage_to_select; i++) {
-                (*selected_storage)[i] = storage_stats[i].remote_stoc_id;
-            }
-            for (int i = 0; i < storage_stats.size(); i++) {
-                delete storage_stats[i].response;
+
+        // Power of d choices. Each fragment samples d random StoCs that are
+        // not selected yet and takes the least loaded one according to the
+        // load table. remaining[0, nremaining) are the StoCs not selected.
+        std::vector<uint32_t> remaining = available_stocs->servers;
+        uint32_t nremaining = remaining.size();
+        uint64_t now_us = StoCLoadTable::NowMicros();
+        for (int i = 0; i < num_storage_to_select; i++) {
+            uint32_t candidates = std::min(d, nremaining);
+            // Move the candidates to remaining[0, candidates).
+            for (uint32_t c = 0; c < candidates; c++) {
+                uint32_t pick = c + rand_r(rand_seed_) % (nremaining - c);
+                std::swap(remaining[c], remaining[pick]);
+            }
+            uint32_t best = 0;
+            for (uint32_t c = 1; c < candidates; c++) {
+                double score = StoCLoadTable::global.Score(remaining[c], now_us);
+                double best_score = StoCLoadTable::global.Score(remaining[best], now_us);
+                if (score < best_score ||
+                    (score == best_score &&
+                     StoCLoadTable::global.PendingBytes(remaining[c]) <
+                     StoCLoadTable::global.PendingBytes(remaining[best]))) {
+                    best = c;
+                }
             }
+            (*selected_storage)[i] = remaining[best];
+            StoCLoadTable::global.RecordSelection(remaining[best]);
+            std::swap(remaining[best], remaining[nremaining - 1]);
+            nremaining--;
         }
     }
-}
\ No newline at end of file
+}
@@ -9,6 +9,7 @@
 
 #include "util/env_mem.h"
 #include "stoc_client_impl.h"
+#include "stoc_load_table.h"
 #include "leveldb/env.h"
 #include "leveldb/table.h"
 
@@ -17,8 +18,7 @@ namespace leveldb {
     public:
         StorageSelector(unsigned int *rand_seed);
 
-        void SelectStorageServers(StoCBlockClient *client,
-                                  nova::ScatterPolicy scatter_policy,
+        void SelectStorageServers(nova::ScatterPolicy scatter_policy,
                                   int num_storage_to_select,
                                   std::vector<uint32_t> *selected_storage);
 
@@ -31,7 +31,8 @@ namespace leveldb {
         void SelectAvailableStoCsForCompaction(std::vector<uint32_t> *selected_storages, uint32_t nstocs);
 
         void ValidateReplicas(
-                const std::vector<leveldb::FileReplicaMetaData> &replicas, const leveldb::StoCBlockHandle& parity_block_handle);
+                const std::vector<leveldb::FileReplicaMetaData> &replicas,
+                const std::vector<leveldb::StoCBlockHandle> &parity_block_handles);
 
         std::string ReplicaDebugString(
                 const std::vector<leveldb::FileReplicaMetaData> &replicas);
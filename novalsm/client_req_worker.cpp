@@ -169,7 +169,12 @@ namespace nova {
         uint64_t hv = keyhash(request_buf, nkey);
         worker->stats.nget_hits++;
 
+        // Clients always send decimal keys.
+        char keybuf[BINARY_KEY_SIZE];
         leveldb::Slice key(request_buf, nkey);
+        if (NovaGlobalVariables::global.binary_keys) {
+            key = leveldb::Slice(keybuf, int_to_user_key(keybuf, int_key));
+        }
         LTCFragment *frag = NovaConfig::home_fragment(hv, server_cfg_id);
         NOVA_ASSERT(frag) << fmt::format("cfg:{} key:{}", server_cfg_id, hv);
 
@@ -216,6 +221,114 @@ namespace nova {
         return true;
     }
 
+    // Request: the number of keys followed by the keys.
+    // Response: for each key in the order of the request, EXISTS followed by
+    // the size and the value of the key or MISS if the key is not found.
+    bool
+    process_socket_multi_get(int fd, Connection *conn, char *request_buf,
+                             uint32_t server_cfg_id) {
+        NICClientReqWorker *worker = (NICClientReqWorker *) conn->worker;
+        worker->stats.nmultigets++;
+        char *buf = request_buf;
+        uint64_t nkeys = 0;
+        buf += str_to_int(buf, &nkeys);
+        worker->stats.ngets += nkeys;
+
+        // Clients always send decimal keys.
+        std::vector<char> keybufs(nkeys * BINARY_KEY_SIZE);
+        std::vector<leveldb::Slice> keys(nkeys);
+        std::map<LTCFragment *, std::vector<uint32_t>> frag_keys;
+        for (uint32_t i = 0; i < nkeys; i++) {
+            uint64_t int_key = 0;
+            uint32_t nkey = str_to_int(buf, &int_key) - 1;
+            uint64_t hv = keyhash(buf, nkey);
+            keys[i] = leveldb::Slice(buf, nkey);
+            if (NovaGlobalVariables::global.binary_keys) {
+                char *keybuf = &keybufs[i * BINARY_KEY_SIZE];
+                keys[i] = leveldb::Slice(keybuf,
+                                         int_to_user_key(keybuf, int_key));
+            }
+            buf += nkey + 1;
+            LTCFragment *frag = NovaConfig::home_fragment(hv, server_cfg_id);
+            NOVA_ASSERT(frag) << fmt::format("cfg:{} key:{}", server_cfg_id, hv);
+            frag_keys[frag].push_back(i);
+        }
+
+        leveldb::ReadOptions read_options;
+        read_options.stoc_client = worker->stoc_client_;
+        read_options.mem_manager = worker->mem_manager_;
+        read_options.thread_id = worker->thread_id_;
+        read_options.rdma_backing_mem = worker->rdma_backing_mem;
+        read_options.rdma_backing_mem_size = worker->rdma_backing_mem_size;
+        read_options.cfg_id = server_cfg_id;
+
+        std::vector<std::string> values(nkeys);
+        std::vector<bool> found(nkeys, false);
+        for (auto &it : frag_keys) {
+            LTCFragment *frag = it.first;
+            if (!frag->is_ready_) {
+                frag->is_ready_mutex_.Lock();
+                while (!frag->is_ready_) {
+                    frag->is_ready_signal_.Wait();
+                }
+                frag->is_ready_mutex_.Unlock();
+            }
+            leveldb::DB *db = reinterpret_cast<leveldb::DB *>(frag->db);
+            NOVA_ASSERT(db);
+            std::vector<leveldb::Slice> db_keys;
+            for (uint32_t i : it.second) {
+                db_keys.push_back(keys[i]);
+            }
+            std::vector<std::string> db_values;
+            std::vector<leveldb::Status> statuses;
+            leveldb::Status s = db->MultiGet(read_options, db_keys, &db_values,
+                                             &statuses);
+            NOVA_ASSERT(s.ok()) << s.ToString();
+            for (uint32_t j = 0; j < it.second.size(); j++) {
+                if (statuses[j].ok()) {
+                    worker->stats.nget_hits++;
+                    found[it.second[j]] = true;
+                }
+                values[it.second[j]].swap(db_values[j]);
+            }
+        }
+
+        conn->response_buf = worker->buf;
+        uint32_t response_size = 0;
+        char *response_buf = conn->response_buf;
+        uint32_t cfg_size = int_to_str(response_buf, server_cfg_id);
+        response_size += cfg_size;
+        response_buf += cfg_size;
+        for (uint32_t i = 0; i < nkeys; i++) {
+            const std::string &value = values[i];
+            NOVA_ASSERT(response_size + 2 < NovaConfig::config->max_msg_size);
+            if (!found[i]) {
+                response_buf[0] = RequestType::MISS;
+                response_size += 1;
+                response_buf += 1;
+                continue;
+            }
+            response_buf[0] = RequestType::EXISTS;
+            response_size += 1;
+            response_buf += 1;
+            uint32_t value_size = int_to_str(response_buf, value.size());
+            response_size += value_size;
+            response_buf += value_size;
+            NOVA_ASSERT(response_size + value.size() + 1 <
+                        NovaConfig::config->max_msg_size);
+            memcpy(response_buf, value.data(), value.size());
+            response_size += value.size();
+            response_buf += value.size();
+        }
+        response_buf[0] = MSG_TERMINATER_CHAR;
+        response_size += 1;
+        conn->response_size = response_size;
+
+        NOVA_ASSERT(conn->response_size <
+                    NovaConfig::config->max_msg_size);
+        return true;
+    }
+
     bool
     process_reintialize_qps(int fd, Connection *conn) {
         NOVA_LOG(rdmaio::INFO) << "Reinitialize QPs";
@@ -237,6 +350,10 @@ namespace nova {
             }
         }
         for (int i = 0; i < worker->rdma_threads.size(); i++) {
+            if (NovaConfig::config->rdma_transport != RDMATransport::RC_TRANSPORT) {
+                // Shared memory channels have no QPs.
+                break;
+            }
             auto *thread = reinterpret_cast<RDMAMsgHandler *>(worker->rdma_threads[i]);
             auto *broker = reinterpret_cast<NovaRDMARCBroker *> (thread->rdma_broker_);
             broker->ReinitializeQPs(worker->ctrl_);
@@ -529,11 +646,25 @@ namespace nova {
 //                pivot_db_id += 1;
 //                continue;
 //            }
+            char keybuf[BINARY_KEY_SIZE];
+            leveldb::Slice seek_key(startkey, nkey);
+            if (NovaGlobalVariables::global.binary_keys) {
+                seek_key = leveldb::Slice(keybuf, int_to_user_key(keybuf, key));
+            }
+            read_options.scan_start_key = seek_key;
+            read_options.scan_length = nrecords - read_records;
             leveldb::Iterator *iterator = db->NewIterator(read_options);
-            iterator->Seek(startkey);
+            iterator->Seek(seek_key);
+            char decimal_keybuf[32];
             while (iterator->Valid() && read_records < nrecords) {
                 leveldb::Slice key = iterator->key();
                 leveldb::Slice value = iterator->value();
+                if (NovaGlobalVariables::global.binary_keys) {
+                    // Return decimal keys to clients.
+                    uint64_t ikey = user_key_to_int(key.data(), key.size());
+                    key = leveldb::Slice(decimal_keybuf,
+                                         int_to_str(decimal_keybuf, ikey) - 1);
+                }
                 scan_size += nint_to_str(key.size()) + 1;
                 scan_size += key.size();
                 scan_size += nint_to_str(value.size()) + 1;
@@ -547,6 +678,11 @@ namespace nova {
                 response_buf += value.size();
                 read_records++;
 //                NOVA_LOG(rdmaio::INFO) << fmt::format("Getting key {}", key.ToString());
+                if (read_records == nrecords) {
+                    // Moving past the last record may leave the range of
+                    // the pruned iterator and merge all tables.
+                    break;
+                }
                 iterator->Next();
             }
 //            NOVA_LOG(rdmaio::INFO) << fmt::format("Go to next range partition {}", pivot_db_id + 1);
@@ -581,7 +717,11 @@ namespace nova {
         char *val = buf;
         uint64_t hv = keyhash(ckey, nkey);
         // I'm the home.
+        char keybuf[BINARY_KEY_SIZE];
         leveldb::Slice dbkey(ckey, nkey);
+        if (NovaGlobalVariables::global.binary_keys) {
+            dbkey = leveldb::Slice(keybuf, int_to_user_key(keybuf, key));
+        }
         leveldb::Slice dbval(val, nval);
 
         worker->ResetReplicateState();
@@ -633,7 +773,8 @@ namespace nova {
         request_buf++;
         uint32_t server_cfg_id = NovaConfig::config->current_cfg_id;
         if (msg_type == RequestType::GET || msg_type == RequestType::REQ_SCAN ||
-            msg_type == RequestType::PUT) {
+            msg_type == RequestType::PUT ||
+            msg_type == RequestType::MULTI_GET) {
             uint64_t client_cfg_id = 0;
             request_buf += str_to_int(request_buf, &client_cfg_id);
             if (client_cfg_id != server_cfg_id) {
@@ -648,6 +789,9 @@ namespace nova {
         }
         if (msg_type == RequestType::GET) {
             return process_socket_get(fd, conn, request_buf, server_cfg_id);
+        } else if (msg_type == RequestType::MULTI_GET) {
+            return process_socket_multi_get(fd, conn, request_buf,
+                                            server_cfg_id);
         } else if (msg_type == RequestType::REQ_SCAN) {
             return process_socket_scan(fd, conn, request_buf, server_cfg_id);
         } else if (msg_type == RequestType::PUT) {
@@ -739,6 +883,7 @@ namespace nova {
                        << " w=" << diff.nwrites
                        << " wa=" << diff.nwritesagain
                        << " g=" << diff.ngets
+                       << " mg=" << diff.nmultigets
                        << " p=" << diff.nputs
                        << " range=" << diff.nscans
                        << " gh=" << diff.nget_hits
@@ -41,6 +41,7 @@ namespace nova {
 
         uint64_t ngets = 0;
         uint64_t nget_hits = 0;
+        uint64_t nmultigets = 0;
         uint64_t nget_lc = 0;
         uint64_t nget_lc_hits = 0;
 
@@ -73,6 +74,7 @@ namespace nova {
             diff.nwritesagain = nwritesagain - other.nwritesagain;
             diff.ngets = ngets - other.ngets;
             diff.nget_hits = nget_hits - other.nget_hits;
+            diff.nmultigets = nmultigets - other.nmultigets;
             diff.nget_lc = nget_lc - other.nget_lc;
             diff.nget_lc_hits = nget_lc_hits - other.nget_lc_hits;
             diff.nget_rdma = nget_rdma - other.nget_rdma;
@@ -100,7 +100,8 @@ namespace nova {
         mem_manager = new NovaMemManager(cache_buf,
                                          num_mem_partitions,
                                          NovaConfig::config->mem_pool_size_gb,
-                                         slab_size_mb);
+                                         slab_size_mb,
+                                         NovaConfig::config->mem_numa_aware);
         log_manager = new StoCInMemoryLogFileManager(mem_manager);
         NovaConfig::config->add_tid_mapping();
         int bg_thread_id = 0;
@@ -121,12 +122,13 @@ namespace nova {
             uint64_t cache_size =
                     (uint64_t) (NovaConfig::config->block_cache_mb) *
                     1024 * 1024;
-            block_cache = leveldb::NewLRUCache(cache_size);
+            block_cache = leveldb::NewBlockCache(cache_size);
 
             NOVA_LOG(INFO)
-                << fmt::format("Block cache size {}. Configured size {} MB",
+                << fmt::format("Block cache size {}. Configured size {} MB policy {}",
                                block_cache->TotalCapacity(),
-                               NovaConfig::config->block_cache_mb);
+                               NovaConfig::config->block_cache_mb,
+                               NovaConfig::config->block_cache_policy);
         }
         leveldb::MemTablePool *pool = new leveldb::MemTablePool;
         pool->num_available_memtables_ = NovaConfig::config->num_memtables;
@@ -190,7 +192,17 @@ namespace nova {
                 endpoints.push_back(qp);
             }
 
-            if (NovaConfig::config->enable_rdma) {
+            if (NovaConfig::config->enable_rdma &&
+                NovaConfig::config->rdma_transport == RDMATransport::SHM_TRANSPORT) {
+                broker = new NovaRDMAShmBroker(buf, worker_id, endpoints,
+                                               NovaConfig::config->servers.size(),
+                                               NovaConfig::config->rdma_max_num_sends,
+                                               NovaConfig::config->max_msg_size,
+                                               NovaConfig::config->my_server_id,
+                                               NovaConfig::config->shm_transport_dir,
+                                               NovaConfig::config->shm_transport_latency_us,
+                                               fg_rdma_msg_handlers[worker_id]);
+            } else if (NovaConfig::config->enable_rdma) {
                 broker = new NovaRDMARCBroker(buf, worker_id, endpoints,
                                               NovaConfig::config->servers.size(),
                                               NovaConfig::config->rdma_max_num_sends,
@@ -257,7 +269,17 @@ namespace nova {
                 endpoints.push_back(qp);
             }
 
-            if (NovaConfig::config->enable_rdma) {
+            if (NovaConfig::config->enable_rdma &&
+                NovaConfig::config->rdma_transport == RDMATransport::SHM_TRANSPORT) {
+                broker = new NovaRDMAShmBroker(buf, worker_id, endpoints,
+                                               NovaConfig::config->servers.size(),
+                                               NovaConfig::config->rdma_max_num_sends,
+                                               NovaConfig::config->max_msg_size,
+                                               NovaConfig::config->my_server_id,
+                                               NovaConfig::config->shm_transport_dir,
+                                               NovaConfig::config->shm_transport_latency_us,
+                                               cc);
+            } else if (NovaConfig::config->enable_rdma) {
                 broker = new NovaRDMARCBroker(buf, worker_id, endpoints,
                                               NovaConfig::config->servers.size(),
                                               NovaConfig::config->rdma_max_num_sends,
@@ -354,7 +376,7 @@ namespace nova {
         mem_env_option.sstable_mode = leveldb::NovaSSTableMode::SSTABLE_MEM;
         leveldb::PosixEnv *mem_env = new leveldb::PosixEnv;
         mem_env->set_env_option(mem_env_option);
-        auto user_comparator = new leveldb::YCSBKeyComparator();
+        auto user_comparator = leveldb::NewUserKeyComparator();
         leveldb::Options storage_options = BuildStorageOptions(mem_manager,
                                                                mem_env);
         storage_options.comparator = new leveldb::InternalKeyComparator(
@@ -550,6 +572,7 @@ namespace nova {
         stat_thread_->fg_storage_workers_ = fg_storage_workers;
         stat_thread_->compaction_storage_workers_ = compaction_storage_workers;
         stat_thread_->bgs_ = bg_flush_memtable_threads;
+        stat_thread_->mem_manager_ = mem_manager;
 
         stat_thread_->async_workers_ = fg_rdma_msg_handlers;
         stat_thread_->async_compaction_workers_ = bg_rdma_msg_handlers;
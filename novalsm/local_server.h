@@ -12,6 +12,7 @@
 #include "common/nova_config.h"
 #include "rdma/nova_rdma_broker.h"
 #include "rdma/nova_rdma_rc_broker.h"
+#include "rdma/nova_rdma_shm_broker.h"
 #include "rdma_msg_handler.h"
 #include "leveldb/db.h"
 #include "ltc/stoc_file_client_impl.h"
@@ -71,31 +71,41 @@ namespace nova {
             NOVA_LOG(INFO) << fmt::format("t[{}] Insert range {} to {}", tid_,
                                           frags[i]->range.key_start,
                                           frags[i]->range.key_end);
+            // Keys are loaded in batches of kLoadBatchSize.
+            const uint32_t kLoadBatchSize = 100;
+            leveldb::WriteBatch batch;
+            uint32_t batch_size = 0;
             for (uint64_t j = frags[i]->range.key_end - 1;
                  j >= frags[i]->range.key_start; j--) {
                 auto v = static_cast<char>((j % 10) + 'a');
 
-                std::string key(std::to_string(j));
+                std::string key(int_to_user_key(j));
                 std::string val(
                         NovaConfig::config->load_default_value_size, v);
-
-                for (int k = 0; k < NovaConfig::config->servers.size(); k++) {
-                    state[k].rdma_wr_id = -1;
-                    state[k].result = leveldb::StoCReplicateLogRecordResult::REPLICATE_LOG_RECORD_NONE;
-                }
-                leveldb::WriteOptions option;
-                option.hash = j;
-                option.rand_seed = &rand_seed;
-                option.stoc_client = client;
-                option.thread_id = tid_;
-                option.local_write = true;
-                option.replicate_log_record_states = state;
-                // DO NOT update subranges since this is not the actual workload.
-                option.is_loading_db = true;
-
-                leveldb::Status s = db->Put(option, key, val);
-                NOVA_ASSERT(s.ok());
+                batch.Put(key, val);
+                batch_size++;
                 loaded_keys++;
+                if (batch_size == kLoadBatchSize ||
+                    j == frags[i]->range.key_start) {
+                    for (int k = 0; k < NovaConfig::config->servers.size(); k++) {
+                        state[k].rdma_wr_id = -1;
+                        state[k].result = leveldb::StoCReplicateLogRecordResult::REPLICATE_LOG_RECORD_NONE;
+                    }
+                    leveldb::WriteOptions option;
+                    option.hash = j;
+                    option.rand_seed = &rand_seed;
+                    option.stoc_client = client;
+                    option.thread_id = tid_;
+                    option.local_write = true;
+                    option.replicate_log_record_states = state;
+                    // DO NOT update subranges since this is not the actual workload.
+                    option.is_loading_db = true;
+
+                    leveldb::Status s = db->Write(option, &batch);
+                    NOVA_ASSERT(s.ok());
+                    batch.Clear();
+                    batch_size = 0;
+                }
                 if (loaded_keys % 100000 == 0) {
                     timeval now{};
                     gettimeofday(&now, nullptr);
@@ -174,7 +184,7 @@ namespace nova {
             for (uint64_t j = frags[i]->range.key_end - 1;
                  j >= frags[i]->range.key_start; j--) {
                 auto v = static_cast<char>((j % 10) + 'a');
-                std::string key = std::to_string(j);
+                std::string key = int_to_user_key(j);
                 std::string expected_val(
                         NovaConfig::config->load_default_value_size, v
                 );
@@ -291,7 +301,8 @@ namespace nova {
         mem_manager = new NovaMemManager(cache_buf,
                                          num_mem_partitions,
                                          NovaConfig::config->mem_pool_size_gb,
-                                         slab_size_mb);
+                                         slab_size_mb,
+                                         NovaConfig::config->mem_numa_aware);
         log_manager = new StoCInMemoryLogFileManager(mem_manager);
         NovaConfig::config->add_tid_mapping();
         int bg_thread_id = 0;
@@ -312,12 +323,13 @@ namespace nova {
             uint64_t cache_size =
                     (uint64_t) (NovaConfig::config->block_cache_mb) *
                     1024 * 1024;
-            block_cache = leveldb::NewLRUCache(cache_size);
+            block_cache = leveldb::NewBlockCache(cache_size);
 
             NOVA_LOG(INFO)
-                << fmt::format("Block cache size {}. Configured size {} MB",
+                << fmt::format("Block cache size {}. Configured size {} MB policy {}",
                                block_cache->TotalCapacity(),
-                               NovaConfig::config->block_cache_mb);
+                               NovaConfig::config->block_cache_mb,
+                               NovaConfig::config->block_cache_policy);
         }
         leveldb::MemTablePool *pool = new leveldb::MemTablePool;
         pool->num_available_memtables_ = NovaConfig::config->num_memtables;
@@ -381,7 +393,17 @@ namespace nova {
                 endpoints.push_back(qp);
             }
 
-            if (NovaConfig::config->enable_rdma) {
+            if (NovaConfig::config->enable_rdma &&
+                NovaConfig::config->rdma_transport == RDMATransport::SHM_TRANSPORT) {
+                broker = new NovaRDMAShmBroker(buf, worker_id, endpoints,
+                                               NovaConfig::config->servers.size(),
+                                               NovaConfig::config->rdma_max_num_sends,
+                                               NovaConfig::config->max_msg_size,
+                                               NovaConfig::config->my_server_id,
+                                               NovaConfig::config->shm_transport_dir,
+                                               NovaConfig::config->shm_transport_latency_us,
+                                               fg_rdma_msg_handlers[worker_id]);
+            } else if (NovaConfig::config->enable_rdma) {
                 broker = new NovaRDMARCBroker(buf, worker_id, endpoints,
                                               NovaConfig::config->servers.size(),
                                               NovaConfig::config->rdma_max_num_sends,
@@ -448,7 +470,17 @@ namespace nova {
                 endpoints.push_back(qp);
             }
 
-            if (NovaConfig::config->enable_rdma) {
+            if (NovaConfig::config->enable_rdma &&
+                NovaConfig::config->rdma_transport == RDMATransport::SHM_TRANSPORT) {
+                broker = new NovaRDMAShmBroker(buf, worker_id, endpoints,
+                                               NovaConfig::config->servers.size(),
+                                               NovaConfig::config->rdma_max_num_sends,
+                                               NovaConfig::config->max_msg_size,
+                                               NovaConfig::config->my_server_id,
+                                               NovaConfig::config->shm_transport_dir,
+                                               NovaConfig::config->shm_transport_latency_us,
+                                               cc);
+            } else if (NovaConfig::config->enable_rdma) {
                 broker = new NovaRDMARCBroker(buf, worker_id, endpoints,
                                               NovaConfig::config->servers.size(),
                                               NovaConfig::config->rdma_max_num_sends,
@@ -545,7 +577,7 @@ namespace nova {
         mem_env_option.sstable_mode = leveldb::NovaSSTableMode::SSTABLE_MEM;
         leveldb::PosixEnv *mem_env = new leveldb::PosixEnv;
         mem_env->set_env_option(mem_env_option);
-        auto user_comparator = new leveldb::YCSBKeyComparator();
+        auto user_comparator = leveldb::NewUserKeyComparator();
         leveldb::Options storage_options = BuildStorageOptions(mem_manager,
                                                                mem_env);
         storage_options.comparator = new leveldb::InternalKeyComparator(
@@ -741,6 +773,7 @@ namespace nova {
         stat_thread_->fg_storage_workers_ = fg_storage_workers;
         stat_thread_->compaction_storage_workers_ = compaction_storage_workers;
         stat_thread_->bgs_ = bg_flush_memtable_threads;
+        stat_thread_->mem_manager_ = mem_manager;
 
         stat_thread_->async_workers_ = fg_rdma_msg_handlers;
         stat_thread_->async_compaction_workers_ = bg_rdma_msg_handlers;
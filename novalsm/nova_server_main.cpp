@@ -34,6 +34,8 @@ DEFINE_int64(server_id, -1, "Server id.");
 DEFINE_int64(number_of_ltcs, 0, "The first n are LTCs and the rest are StoCs.");
 
 DEFINE_uint64(mem_pool_size_gb, 0, "Memory pool size in GB.");
+DEFINE_bool(mem_numa_aware, false,
+            "Partition the memory pool by NUMA node. A thread allocates memory from its node.");
 DEFINE_uint64(use_fixed_value_size, 0, "Fixed value size.");
 
 DEFINE_uint64(rdma_port, 0, "The port used by RDMA.");
@@ -42,6 +44,12 @@ DEFINE_uint64(rdma_max_num_sends, 0,
               "The maximum number of pending RDMA sends. This includes READ/WRITE/SEND. We also post the same number of RECV events. ");
 DEFINE_uint64(rdma_doorbell_batch_size, 0, "The doorbell batch size.");
 DEFINE_bool(enable_rdma, false, "Enable RDMA.");
+DEFINE_string(rdma_transport, "rc",
+              "rc/shm. shm emulates RDMA with shared memory. All servers must run on the same machine.");
+DEFINE_string(shm_transport_dir, "/dev/shm/nova",
+              "The directory of the memory regions and channels of the shm transport.");
+DEFINE_uint64(shm_transport_latency_us, 0,
+              "The latency injected into every message and completion of the shm transport.");
 DEFINE_bool(enable_load_data, false, "Enable loading data.");
 
 DEFINE_string(ltc_config_path, "/tmp/uniform-3-32-10000000-frags.txt",
@@ -56,10 +64,16 @@ DEFINE_uint32(num_rdma_bg_workers, 0,
 
 DEFINE_uint32(num_storage_workers, 0,
               "Number of storage worker threads.");
+DEFINE_uint32(storage_worker_queue_size, 0,
+              "Maximum number of queued tasks of each class per storage worker. 0 means unbounded.");
+DEFINE_uint32(stoc_io_uring_depth, 0,
+              "Depth of the io_uring of each storage worker. 0 uses blocking disk reads and writes.");
 DEFINE_uint32(ltc_num_stocs_scatter_data_blocks, 0,
               "Number of StoCs to scatter data blocks of an SSTable.");
 
-DEFINE_uint64(block_cache_mb, 0, "block cache size in mb");
+DEFINE_uint64(block_cache_mb, 0, "block cache size in mb. MultiGet reads data blocks in parallel and scans read ahead only with a block cache.");
+DEFINE_string(block_cache_policy, "lru",
+              "Block cache eviction policy, i.e., lru/slru. slru is a scan-resistant segmented LRU.");
 DEFINE_uint64(row_cache_mb, 0, "row cache size in mb. Not supported");
 
 DEFINE_uint32(num_memtables, 0, "Number of memtables.");
@@ -67,10 +81,20 @@ DEFINE_uint32(num_memtable_partitions, 0,
               "Number of memtable partitions. One active memtable per partition.");
 DEFINE_bool(enable_lookup_index, false, "Enable lookup index.");
 DEFINE_bool(enable_range_index, false, "Enable range index.");
+DEFINE_uint32(scan_prefetch_max_blocks, 0,
+              "Maximum number of data blocks a scan reads ahead from StoCs. 0 disables read-ahead. Requires block_cache_mb > 0.");
+DEFINE_uint32(metadata_partition_size, 0,
+              "Partition the index and filter blocks of an SSTable into blocks of this size. 0 disables partitioning.");
+DEFINE_bool(enable_blocked_bloom_filter, false,
+            "Use a cache-line-blocked Bloom filter for SSTables.");
+DEFINE_string(bloom_bits_per_key_per_level, "",
+              "Comma-separated Bloom filter bits per key of each level, e.g., 14,10,8. The last value applies to deeper levels. Empty uses 10 bits per key.");
 
 DEFINE_uint32(l0_start_compaction_mb, 0,
               "Level-0 size to start compaction in MB.");
 DEFINE_uint32(l0_stop_write_mb, 0, "Level-0 size to stall writes in MB.");
+DEFINE_double(tombstone_compaction_density, 0,
+              "Compact a level once this fraction of its entries are deletions. 0 disables it.");
 DEFINE_int32(level, 2, "Number of levels.");
 
 DEFINE_uint64(memtable_size_mb, 0, "memtable size in mb");
@@ -85,7 +109,17 @@ DEFINE_string(scatter_policy, "random",
 DEFINE_string(log_record_mode, "none",
               "Policy for LogC to replicate log records, i.e., none/rdma");
 DEFINE_uint32(num_log_replicas, 0, "Number of replicas for a log record.");
+DEFINE_uint32(log_group_commit_max_batch_size, 0,
+              "Maximum number of log records replicated in one group commit. 0 disables group commit.");
+DEFINE_uint64(log_group_commit_max_delay_us, 0,
+              "Time in microseconds a group commit leader waits for more log records.");
 DEFINE_string(memtable_type, "", "Memtable type, i.e., pool/static_partition");
+DEFINE_bool(enable_lockfree_memtable_selection, false,
+            "Select an active memtable in the memtable pool without acquiring the range lock.");
+DEFINE_bool(enable_binary_keys, false,
+            "Encode keys as big-endian fixed-width integers instead of decimal strings.");
+DEFINE_bool(enable_concurrent_memtable_writes, false,
+            "Insert into a static partition memtable without holding the partition lock.");
 
 DEFINE_bool(recover_dbs, false, "Enable recovery");
 DEFINE_uint32(num_recovery_threads, 32, "Number of recovery threads");
@@ -116,7 +150,11 @@ DEFINE_uint32(major_compaction_max_tables_in_a_set, 15,
 DEFINE_uint32(num_sstable_replicas, 1, "Number of replicas for SSTables.");
 DEFINE_uint32(num_sstable_metadata_replicas, 1, "Number of replicas for meta blocks of SSTables.");
 DEFINE_bool(use_parity_for_sstable_data_blocks, false, "");
+DEFINE_uint32(num_sstable_parity_fragments, 1,
+              "Number of Reed-Solomon parity fragments for the data blocks of an SSTable. 1 uses XOR parity.");
 DEFINE_uint32(num_manifest_replicas, 1, "Number of replicas for manifest file.");
+DEFINE_double(hedged_read_percentile, 0,
+              "Send a second read of a data block to another replica once the read takes longer than this percentile of read latencies. 0 disables hedged reads.");
 
 DEFINE_int32(fail_stoc_id, -1, "The StoC to fail.");
 DEFINE_int32(exp_seconds_to_fail_stoc, -1,
@@ -124,6 +162,8 @@ DEFINE_int32(exp_seconds_to_fail_stoc, -1,
 DEFINE_int32(failure_duration, -1, "Failure duration");
 DEFINE_int32(num_migration_threads, 1, "Number of migration threads");
 DEFINE_string(ltc_migration_policy, "base", "immediate/base");
+DEFINE_uint32(ltc_migration_chunk_size, 1024 * 1024,
+              "Size of a chunk of the lookup index sent to the destination LTC during migration.");
 DEFINE_bool(use_ordered_flush, false, "use ordered flush");
 
 NovaConfig *NovaConfig::config;
@@ -135,7 +175,6 @@ std::atomic_int_fast32_t leveldb::EnvBGThread::bg_compaction_thread_id_seq;
 std::atomic_int_fast32_t nova::RDMAServerImpl::fg_storage_worker_seq_id_;
 std::atomic_int_fast32_t nova::RDMAServerImpl::bg_storage_worker_seq_id_;
 std::atomic_int_fast32_t leveldb::StoCBlockClient::rdma_worker_seq_id_;
-std::atomic_int_fast32_t nova::DBMigration::migration_seq_id_;
 std::atomic_int_fast32_t leveldb::StorageSelector::stoc_for_compaction_seq_id;
 
 std::unordered_map<uint64_t, leveldb::FileMetaData *> leveldb::Version::last_fnfile;
@@ -154,7 +193,15 @@ void StartServer() {
     ntotal += NovaConfig::config->mem_pool_size_gb * 1024 * 1024 * 1024;
     NOVA_LOG(INFO) << "Allocated buffer size in bytes: " << ntotal;
 
-    auto *buf = (char *) malloc(ntotal);
+    char *buf = nullptr;
+    if (NovaConfig::config->enable_rdma &&
+        NovaConfig::config->rdma_transport == RDMATransport::SHM_TRANSPORT) {
+        buf = NovaRDMAShmBroker::AllocateMemoryRegion(
+                NovaConfig::config->shm_transport_dir,
+                NovaConfig::config->my_server_id, ntotal);
+    } else {
+        buf = (char *) malloc(ntotal);
+    }
     memset(buf, 0, ntotal);
     NovaConfig::config->nova_buf = buf;
     NovaConfig::config->nnovabuf = ntotal;
@@ -196,14 +243,23 @@ int main(int argc, char *argv[]) {
     NovaConfig::config->stoc_files_path = FLAGS_stoc_files_path;
 
     NovaConfig::config->mem_pool_size_gb = FLAGS_mem_pool_size_gb;
+    NovaConfig::config->mem_numa_aware = FLAGS_mem_numa_aware;
     NovaConfig::config->load_default_value_size = FLAGS_use_fixed_value_size;
     // RDMA
     NovaConfig::config->rdma_port = FLAGS_rdma_port;
     NovaConfig::config->max_msg_size = FLAGS_rdma_max_msg_size;
     NovaConfig::config->rdma_max_num_sends = FLAGS_rdma_max_num_sends;
     NovaConfig::config->rdma_doorbell_batch_size = FLAGS_rdma_doorbell_batch_size;
+    if (FLAGS_rdma_transport == "shm") {
+        NovaConfig::config->rdma_transport = RDMATransport::SHM_TRANSPORT;
+    } else {
+        NovaConfig::config->rdma_transport = RDMATransport::RC_TRANSPORT;
+    }
+    NovaConfig::config->shm_transport_dir = FLAGS_shm_transport_dir;
+    NovaConfig::config->shm_transport_latency_us = FLAGS_shm_transport_latency_us;
 
     NovaConfig::config->block_cache_mb = FLAGS_block_cache_mb;
+    NovaConfig::config->block_cache_policy = FLAGS_block_cache_policy;
     NovaConfig::config->memtable_size_mb = FLAGS_memtable_size_mb;
 
     NovaConfig::config->db_path = FLAGS_db_path;
@@ -220,18 +276,24 @@ int main(int argc, char *argv[]) {
     NovaConfig::config->number_of_sstable_metadata_replicas = FLAGS_num_sstable_metadata_replicas;
     NovaConfig::config->number_of_manifest_replicas = FLAGS_num_manifest_replicas;
     NovaConfig::config->use_parity_for_sstable_data_blocks = FLAGS_use_parity_for_sstable_data_blocks;
+    NovaConfig::config->number_of_sstable_parity_fragments = FLAGS_num_sstable_parity_fragments;
+    NovaConfig::config->hedged_read_percentile = FLAGS_hedged_read_percentile;
 
     NovaConfig::config->servers = convert_hosts(FLAGS_all_servers);
     NovaConfig::config->my_server_id = FLAGS_server_id;
     NovaConfig::config->num_conn_workers = FLAGS_ltc_num_client_workers;
     NovaConfig::config->num_fg_rdma_workers = FLAGS_num_rdma_fg_workers;
     NovaConfig::config->num_storage_workers = FLAGS_num_storage_workers;
+    NovaConfig::config->storage_worker_queue_size = FLAGS_storage_worker_queue_size;
+    NovaConfig::config->stoc_io_uring_depth = FLAGS_stoc_io_uring_depth;
     NovaConfig::config->num_compaction_workers = FLAGS_num_compaction_workers;
     NovaConfig::config->num_bg_rdma_workers = FLAGS_num_rdma_bg_workers;
     NovaConfig::config->num_memtables = FLAGS_num_memtables;
     NovaConfig::config->num_memtable_partitions = FLAGS_num_memtable_partitions;
     NovaConfig::config->enable_subrange = FLAGS_enable_subrange;
     NovaConfig::config->memtable_type = FLAGS_memtable_type;
+    NovaConfig::config->enable_lockfree_memtable_selection = FLAGS_enable_lockfree_memtable_selection;
+    NovaConfig::config->enable_concurrent_memtable_writes = FLAGS_enable_concurrent_memtable_writes;
 
     NovaConfig::config->num_stocs_scatter_data_blocks = FLAGS_ltc_num_stocs_scatter_data_blocks;
     NovaConfig::config->max_stoc_file_size = FLAGS_max_stoc_file_size_mb * 1024;
@@ -258,9 +320,16 @@ int main(int argc, char *argv[]) {
     } else if (FLAGS_log_record_mode == "rdma") {
         NovaConfig::config->log_record_mode = NovaLogRecordMode::LOG_RDMA;
     }
+    NovaConfig::config->log_group_commit_max_batch_size = FLAGS_log_group_commit_max_batch_size;
+    NovaConfig::config->log_group_commit_max_delay_us = FLAGS_log_group_commit_max_delay_us;
 
     NovaConfig::config->enable_lookup_index = FLAGS_enable_lookup_index;
     NovaConfig::config->enable_range_index = FLAGS_enable_range_index;
+    NovaConfig::config->scan_prefetch_max_blocks = FLAGS_scan_prefetch_max_blocks;
+    NovaConfig::config->metadata_partition_size = FLAGS_metadata_partition_size;
+    NovaConfig::config->enable_blocked_bloom_filter = FLAGS_enable_blocked_bloom_filter;
+    NovaConfig::config->bloom_bits_per_key_per_level = SplitByDelimiterToInt(
+            &FLAGS_bloom_bits_per_key_per_level, ",");
     NovaConfig::config->subrange_sampling_ratio = FLAGS_sampling_ratio;
     NovaConfig::config->zipfian_dist_file_path = FLAGS_zipfian_dist_ref_counts;
     NovaConfig::config->ReadZipfianDist();
@@ -269,9 +338,11 @@ int main(int argc, char *argv[]) {
     NovaConfig::config->subrange_num_keys_no_flush = FLAGS_subrange_no_flush_num_keys;
     NovaConfig::config->l0_stop_write_mb = FLAGS_l0_stop_write_mb;
     NovaConfig::config->l0_start_compaction_mb = FLAGS_l0_start_compaction_mb;
+    NovaConfig::config->tombstone_compaction_density = FLAGS_tombstone_compaction_density;
     NovaConfig::config->level = FLAGS_level;
     NovaConfig::config->enable_subrange_reorg = FLAGS_enable_subrange_reorg;
     NovaConfig::config->num_migration_threads = FLAGS_num_migration_threads;
+    NovaConfig::config->ltc_migration_chunk_size = FLAGS_ltc_migration_chunk_size;
     NovaConfig::config->use_ordered_flush = FLAGS_use_ordered_flush;
 
     if (FLAGS_ltc_migration_policy == "immediate") {
@@ -298,9 +369,9 @@ int main(int argc, char *argv[]) {
     leveldb::StoCBlockClient::rdma_worker_seq_id_ = 0;
     nova::StorageWorker::storage_file_number_seq = 0;
     nova::RDMAServerImpl::compaction_storage_worker_seq_id_ = 0;
-    nova::DBMigration::migration_seq_id_ = 0;
     leveldb::StorageSelector::stoc_for_compaction_seq_id = nova::NovaConfig::config->my_server_id;
     nova::NovaGlobalVariables::global.Initialize();
+    nova::NovaGlobalVariables::global.binary_keys = FLAGS_enable_binary_keys;
     auto available_stoc_servers = new Servers;
     available_stoc_servers->servers = NovaConfig::config->cfgs[0]->stoc_servers;
     for (int i = 0; i < available_stoc_servers->servers.size(); i++) {
@@ -319,8 +390,12 @@ int main(int argc, char *argv[]) {
     if (NovaConfig::config->use_parity_for_sstable_data_blocks) {
         NOVA_ASSERT(NovaConfig::config->number_of_sstable_data_replicas == 1);
         NOVA_ASSERT(NovaConfig::config->num_stocs_scatter_data_blocks > 1);
+        NOVA_ASSERT(NovaConfig::config->number_of_sstable_parity_fragments >= 1);
+        NOVA_ASSERT(NovaConfig::config->num_stocs_scatter_data_blocks +
+                    NovaConfig::config->number_of_sstable_parity_fragments <= 256);
         NOVA_ASSERT(NovaConfig::config->num_stocs_scatter_data_blocks +
-                    NovaConfig::config->number_of_sstable_metadata_replicas + 1 <=
+                    NovaConfig::config->number_of_sstable_metadata_replicas +
+                    NovaConfig::config->number_of_sstable_parity_fragments <=
                     NovaConfig::config->cfgs[0]->stoc_servers.size());
     }
     for (int i = 0; i < NovaConfig::config->cfgs.size(); i++) {
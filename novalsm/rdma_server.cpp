@@ -60,32 +60,68 @@ namespace nova {
     }
 
     void RDMAServerImpl::AddFGStorageTask(const nova::StorageTask &task) {
-        uint32_t id =
-                fg_storage_worker_seq_id_.fetch_add(1,
-                                                    std::memory_order_relaxed) %
-                fg_storage_workers_.size();
-        fg_storage_workers_[id]->AddTask(task);
+        AddStorageTask(kFGStorageWorkers, task);
     }
 
     void RDMAServerImpl::AddBGStorageTask(const nova::StorageTask &task) {
-        uint32_t id =
-                bg_storage_worker_seq_id_.fetch_add(1,
-                                                    std::memory_order_relaxed) %
-                bg_storage_workers_.size();
-        bg_storage_workers_[id]->AddTask(task);
+        AddStorageTask(kBGStorageWorkers, task);
     }
 
     void
     RDMAServerImpl::AddCompactionStorageTask(const nova::StorageTask &task) {
-        uint32_t id =
-                compaction_storage_worker_seq_id_.fetch_add(1,
-                                                            std::memory_order_relaxed) %
-                compaction_storage_workers_.size();
-        compaction_storage_workers_[id]->AddTask(task);
+        AddStorageTask(kCompactionStorageWorkers, task);
+    }
+
+    void RDMAServerImpl::AddStorageTask(StorageWorkerPool pool,
+                                        const nova::StorageTask &task) {
+        // Preserve the order of tasks within a pool.
+        if (pending_storage_tasks_[pool].empty() &&
+            DispatchStorageTask(pool, task)) {
+            return;
+        }
+        pending_storage_tasks_[pool].push_back(task);
+    }
+
+    bool RDMAServerImpl::DispatchStorageTask(StorageWorkerPool pool,
+                                             const nova::StorageTask &task) {
+        std::vector<StorageWorker *> *workers = nullptr;
+        std::atomic_int_fast32_t *seq_id = nullptr;
+        if (pool == kFGStorageWorkers) {
+            workers = &fg_storage_workers_;
+            seq_id = &fg_storage_worker_seq_id_;
+        } else if (pool == kBGStorageWorkers) {
+            workers = &bg_storage_workers_;
+            seq_id = &bg_storage_worker_seq_id_;
+        } else {
+            workers = &compaction_storage_workers_;
+            seq_id = &compaction_storage_worker_seq_id_;
+        }
+        uint32_t id = seq_id->fetch_add(1, std::memory_order_relaxed) %
+                      workers->size();
+        for (int i = 0; i < workers->size(); i++) {
+            if ((*workers)[(id + i) % workers->size()]->AddTask(task)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    int RDMAServerImpl::DispatchPendingStorageTasks() {
+        int npending = 0;
+        for (int pool = 0; pool < kNumStorageWorkerPools; pool++) {
+            auto &pending = pending_storage_tasks_[pool];
+            while (!pending.empty() &&
+                   DispatchStorageTask((StorageWorkerPool) pool,
+                                       pending.front())) {
+                pending.pop_front();
+            }
+            npending += pending.size();
+        }
+        return npending;
     }
 
     int RDMAServerImpl::ProcessCompletionQueue() {
-        int nworks = 0;
+        int nworks = DispatchPendingStorageTasks();
         mutex_.lock();
         while (!public_cq_.empty()) {
             auto &task = public_cq_.front();
@@ -93,7 +129,7 @@ namespace nova {
             public_cq_.pop_front();
         }
         mutex_.unlock();
-        nworks = private_cq_.size();
+        nworks += private_cq_.size();
 
         auto it = private_cq_.begin();
         while (it != private_cq_.end()) {
@@ -148,7 +184,7 @@ namespace nova {
                                        NovaGlobalVariables::global.stoc_pending_disk_reads);
                 leveldb::EncodeFixed64(sendbuf + 17,
                                        NovaGlobalVariables::global.stoc_pending_disk_writes);
-                rdma_broker_->PostSend(sendbuf, 13, task.remote_server_id,
+                rdma_broker_->PostSend(sendbuf, 25, task.remote_server_id,
                                        task.stoc_req_id);
             } else if (task.request_type ==
                        leveldb::StoCRequestType::STOC_READ_BLOCKS) {
@@ -178,6 +214,13 @@ namespace nova {
                     task.stoc_block_handles[i].EncodeHandle(sendbuf + msg_size);
                     msg_size += leveldb::StoCBlockHandle::HandleSize();
                 }
+                // Piggyback the load of this StoC for the LTC's load table.
+                msg_size += leveldb::EncodeFixed64(sendbuf + msg_size,
+                                                   NovaGlobalVariables::global.stoc_queue_depth);
+                msg_size += leveldb::EncodeFixed64(sendbuf + msg_size,
+                                                   NovaGlobalVariables::global.stoc_pending_disk_reads);
+                msg_size += leveldb::EncodeFixed64(sendbuf + msg_size,
+                                                   NovaGlobalVariables::global.stoc_pending_disk_writes);
                 rdma_broker_->PostSend(sendbuf, msg_size, task.remote_server_id,
                                        task.stoc_req_id);
             } else if (task.request_type ==
@@ -234,10 +277,12 @@ namespace nova {
             : destination_migration_threads_(destination_migration_threads) {}
 
     void RDMAWriteHandler::Handle(char *buf, uint32_t size) {
-        NOVA_ASSERT(buf[0] == leveldb::StoCRequestType::LTC_MIGRATION);
-        int value = DBMigration::migration_seq_id_ %
-                    destination_migration_threads_.size();
-        DBMigration::migration_seq_id_ += 1;
+        NOVA_ASSERT(buf[0] == leveldb::StoCRequestType::LTC_MIGRATION ||
+                    buf[0] == leveldb::StoCRequestType::LTC_MIGRATION_LOOKUP_INDEX);
+        // The lookup index chunks of a database are recovered after its
+        // metadata by the same thread.
+        uint32_t dbid = leveldb::DecodeFixed32(buf + 5);
+        int value = dbid % destination_migration_threads_.size();
         destination_migration_threads_[value]->AddDestMigrateDB(buf, size);
     }
 
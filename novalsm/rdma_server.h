@@ -50,6 +50,9 @@ namespace nova {
         // Replication request
         std::string dbname;
         std::vector<leveldb::ReplicationPair> replication_pairs;
+
+        // Set by the storage worker when the task is enqueued.
+        uint64_t enqueue_us = 0;
     };
 
     struct ServerCompleteTask {
@@ -131,12 +134,29 @@ namespace nova {
         bool is_running_ = true;
         bool is_compaction_thread_ = false;
 
+        enum StorageWorkerPool {
+            kFGStorageWorkers = 0,
+            kBGStorageWorkers = 1,
+            kCompactionStorageWorkers = 2,
+            kNumStorageWorkerPools = 3
+        };
+
         void AddBGStorageTask(const StorageTask &task);
 
         void AddFGStorageTask(const StorageTask &task);
 
         void AddCompactionStorageTask(const StorageTask &task);
 
+        // A task is held back in "pending_storage_tasks_" if the queues of
+        // all workers in its pool are full. It is dispatched again when
+        // processing the completion queue.
+        void AddStorageTask(StorageWorkerPool pool, const StorageTask &task);
+
+        bool DispatchStorageTask(StorageWorkerPool pool,
+                                 const StorageTask &task);
+
+        int DispatchPendingStorageTasks();
+
         uint32_t thread_id_;
         rdmaio::RdmaCtrl *rdma_ctrl_;
         NovaMemManager *mem_manager_;
@@ -146,6 +166,7 @@ namespace nova {
         std::mutex mutex_;
         std::list<ServerCompleteTask> private_cq_;
         std::list<ServerCompleteTask> public_cq_;
+        std::list<StorageTask> pending_storage_tasks_[kNumStorageWorkerPools];
 
         uint32_t current_worker_id_ = 0;
         std::unordered_map<uint64_t, RequestContext> request_context_map_;
@@ -114,6 +114,12 @@ namespace leveldb {
                 lock.release();
             }
 
+            void WaitForMicros(uint64_t micros) {
+                std::unique_lock<std::mutex> lock(mu_->mu_, std::adopt_lock);
+                cv_.wait_for(lock, std::chrono::microseconds(micros));
+                lock.release();
+            }
+
             void Signal() { cv_.notify_one(); }
 
             void SignalAll() { cv_.notify_all(); }
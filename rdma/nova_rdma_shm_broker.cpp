@@ -0,0 +1,407 @@
+//
+// Copyright (c) 2019 University of Southern California. All rights reserved.
+//
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <fmt/core.h>
+
+#include "nova_rdma_shm_broker.h"
+
+namespace nova {
+    namespace {
+        // "NOVASHM1"
+        const uint64_t kSharedFileMagic = 0x4e4f564153484d31;
+        // The memory region starts at a page boundary after its header.
+        const uint64_t kRegionHeaderSize = 4096;
+    }
+
+    NovaRDMAShmBroker::NovaRDMAShmBroker(char *buf, int thread_id,
+                                         const std::vector<QPEndPoint> &end_points,
+                                         int total_num_servers,
+                                         uint32_t max_num_sends,
+                                         uint32_t max_msg_size,
+                                         uint32_t my_server_id,
+                                         const std::string &shm_dir,
+                                         uint64_t latency_us,
+                                         RDMAMsgCallback *callback) :
+            my_server_id_(my_server_id),
+            max_num_sends_(max_num_sends),
+            max_msg_size_(max_msg_size),
+            shm_dir_(shm_dir),
+            latency_us_(latency_us),
+            thread_id_(thread_id),
+            end_points_(end_points),
+            callback_(callback) {
+        NOVA_LOG(DEBUG)
+            << fmt::format("shm[{}]: create broker {} {} {} {} {} {}.",
+                           thread_id_, max_num_sends_, max_msg_size_,
+                           my_server_id_, shm_dir_, latency_us_,
+                           end_points_.size());
+        int num_servers = end_points_.size();
+        regions_.resize(num_servers);
+        send_channels_.resize(num_servers);
+        recv_channels_.resize(num_servers);
+        pending_wrs_.resize(num_servers);
+        rdma_send_buf_ = (char **) malloc(num_servers * sizeof(char *));
+        rdma_recv_buf_ = (char **) malloc(num_servers * sizeof(char *));
+        psend_index_ = (int *) malloc(num_servers * sizeof(int));
+
+        // Same layout as the RC broker.
+        uint64_t nsendbuf = max_num_sends * max_msg_size;
+        uint64_t nrecvbuf = max_num_sends * max_msg_size;
+        uint64_t nbuf = nsendbuf + nrecvbuf;
+        server_qp_idx_map_ = new int[total_num_servers];
+        for (int i = 0; i < total_num_servers; i++) {
+            server_qp_idx_map_[i] = -1;
+        }
+        for (int i = 0; i < num_servers; i++) {
+            psend_index_[i] = 0;
+            rdma_recv_buf_[i] = buf + nbuf * i;
+            memset(rdma_recv_buf_[i], 0, nrecvbuf);
+            rdma_send_buf_[i] = rdma_recv_buf_[i] + nrecvbuf;
+            memset(rdma_send_buf_[i], 0, nsendbuf);
+            server_qp_idx_map_[end_points[i].server_id] = i;
+        }
+    }
+
+    void *
+    NovaRDMAShmBroker::CreateSharedFile(const std::string &path,
+                                        uint64_t size) {
+        // Remove the file of a previous run.
+        unlink(path.data());
+        int fd = open(path.data(), O_CREAT | O_EXCL | O_RDWR, 0666);
+        NOVA_ASSERT(fd >= 0)
+            << fmt::format("{}: {}", path, strerror(errno));
+        NOVA_ASSERT(ftruncate(fd, size) == 0)
+            << fmt::format("{}: {}", path, strerror(errno));
+        void *addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                          fd, 0);
+        NOVA_ASSERT(addr != MAP_FAILED)
+            << fmt::format("{}: {}", path, strerror(errno));
+        close(fd);
+        auto header = reinterpret_cast<SharedFileHeader *>(addr);
+        header->pid = getpid();
+        return addr;
+    }
+
+    void *
+    NovaRDMAShmBroker::OpenSharedFile(const std::string &path,
+                                      uint64_t *size) {
+        int fd = open(path.data(), O_RDWR);
+        if (fd < 0) {
+            return nullptr;
+        }
+        struct stat st = {};
+        if (fstat(fd, &st) != 0 || st.st_size < sizeof(SharedFileHeader)) {
+            close(fd);
+            return nullptr;
+        }
+        void *addr = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE,
+                          MAP_SHARED, fd, 0);
+        close(fd);
+        if (addr == MAP_FAILED) {
+            return nullptr;
+        }
+        auto header = reinterpret_cast<SharedFileHeader *>(addr);
+        if (header->magic.load(std::memory_order_acquire) != kSharedFileMagic ||
+            kill(header->pid, 0) != 0) {
+            munmap(addr, st.st_size);
+            return nullptr;
+        }
+        *size = st.st_size;
+        return addr;
+    }
+
+    char *NovaRDMAShmBroker::AllocateMemoryRegion(const std::string &shm_dir,
+                                                  uint32_t server_id,
+                                                  uint64_t size) {
+        mkdirs(shm_dir.data());
+        std::string path = fmt::format("{}/mr-{}", shm_dir, server_id);
+        char *file = (char *) CreateSharedFile(path, kRegionHeaderSize + size);
+        auto header = reinterpret_cast<RegionHeader *>(file);
+        header->base = (uint64_t) (file + kRegionHeaderSize);
+        header->size = size;
+        header->file.magic.store(kSharedFileMagic, std::memory_order_release);
+        return file + kRegionHeaderSize;
+    }
+
+    uint64_t NovaRDMAShmBroker::NowMicros() {
+        // CLOCK_MONOTONIC is comparable across processes.
+        timespec ts = {};
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    }
+
+    std::string NovaRDMAShmBroker::ChannelPath(uint32_t from_server_id,
+                                               uint32_t from_thread_id,
+                                               uint32_t to_server_id,
+                                               uint32_t to_thread_id) const {
+        return fmt::format("{}/ch-{}-{}-{}-{}", shm_dir_, from_server_id,
+                           from_thread_id, to_server_id, to_thread_id);
+    }
+
+    uint32_t NovaRDMAShmBroker::to_qp_idx(uint32_t server_id) {
+        NOVA_ASSERT(server_qp_idx_map_[server_id] != -1);
+        return server_qp_idx_map_[server_id];
+    }
+
+    void NovaRDMAShmBroker::Init(RdmaCtrl *rdma_ctrl) {
+        NOVA_LOG(INFO) << "Shared memory client thread " << thread_id_
+                       << " initializing";
+        uint64_t channel_size = sizeof(ChannelHeader) +
+                                max_num_sends_ *
+                                (sizeof(Message) + max_msg_size_);
+        // Create the channels to receive from peers before connecting to
+        // them.
+        for (int peer_id = 0; peer_id < end_points_.size(); peer_id++) {
+            const QPEndPoint &peer = end_points_[peer_id];
+            auto header = reinterpret_cast<ChannelHeader *>(CreateSharedFile(
+                    ChannelPath(peer.server_id, peer.thread_id,
+                                my_server_id_, thread_id_), channel_size));
+            recv_channels_[peer_id].header = header;
+            recv_channels_[peer_id].slots =
+                    (char *) header + sizeof(ChannelHeader);
+            header->file.magic.store(kSharedFileMagic,
+                                     std::memory_order_release);
+        }
+
+        for (int peer_id = 0; peer_id < end_points_.size(); peer_id++) {
+            const QPEndPoint &peer = end_points_[peer_id];
+            uint64_t size = 0;
+            void *file = nullptr;
+            std::string path = fmt::format("{}/mr-{}", shm_dir_,
+                                           peer.server_id);
+            while ((file = OpenSharedFile(path, &size)) == nullptr) {
+                usleep(CONN_SLEEP);
+            }
+            auto region = reinterpret_cast<RegionHeader *>(file);
+            regions_[peer_id].buf = (char *) file + kRegionHeaderSize;
+            regions_[peer_id].remote_base = region->base;
+            regions_[peer_id].size = region->size;
+
+            path = ChannelPath(my_server_id_, thread_id_, peer.server_id,
+                               peer.thread_id);
+            while ((file = OpenSharedFile(path, &size)) == nullptr) {
+                usleep(CONN_SLEEP);
+            }
+            NOVA_ASSERT(size == channel_size) << path;
+            send_channels_[peer_id].header = reinterpret_cast<ChannelHeader *>(file);
+            send_channels_[peer_id].slots = (char *) file + sizeof(ChannelHeader);
+            NOVA_LOG(INFO)
+                << fmt::format("shm[{}]: connected to server {}:{}:{}",
+                               thread_id_, peer.host.ip, peer.host.port,
+                               peer.thread_id);
+        }
+        NOVA_LOG(INFO)
+            << fmt::format("Shared memory client thread {} initialized",
+                           thread_id_);
+    }
+
+    NovaRDMAShmBroker::Message *
+    NovaRDMAShmBroker::Slot(const Channel &channel, uint64_t seq) const {
+        return reinterpret_cast<Message *>(channel.slots +
+                                           (seq % max_num_sends_) *
+                                           (sizeof(Message) + max_msg_size_));
+    }
+
+    uint64_t
+    NovaRDMAShmBroker::Deliver(int qp_idx, ibv_wc_opcode opcode,
+                               const char *buf, uint32_t size,
+                               uint32_t imm_data) {
+        Channel &channel = send_channels_[qp_idx];
+        uint64_t head = channel.header->head.load(std::memory_order_relaxed);
+        // The peer has no free receive buffer. Retry like an RNR NAK.
+        while (head - channel.header->tail.load(std::memory_order_acquire) >=
+               max_num_sends_) {
+            sched_yield();
+        }
+        Message *msg = Slot(channel, head);
+        msg->ready_us = NowMicros() + latency_us_;
+        msg->opcode = opcode;
+        msg->imm_data = imm_data;
+        msg->size = size;
+        if (size > 0) {
+            memcpy((char *) msg + sizeof(Message), buf, size);
+        }
+        channel.header->head.store(head + 1, std::memory_order_release);
+        return head + 1;
+    }
+
+    char *NovaRDMAShmBroker::RemoteAddress(int qp_idx, uint64_t remote_addr,
+                                           bool is_offset, uint32_t size) {
+        const Region &region = regions_[qp_idx];
+        uint64_t offset = remote_addr;
+        if (!is_offset) {
+            offset = remote_addr - region.remote_base;
+        }
+        NOVA_ASSERT(offset + size <= region.size)
+            << fmt::format("shm[{}]: addr:{} isoff:{} size:{} region:{}",
+                           thread_id_, remote_addr, is_offset, size,
+                           region.size);
+        return region.buf + offset;
+    }
+
+    uint64_t
+    NovaRDMAShmBroker::PostWR(int qp_idx, ibv_wc_opcode opcode,
+                              uint32_t imm_data, uint64_t seq) {
+        uint64_t wr_id = psend_index_[qp_idx];
+        PendingWR wr = {};
+        wr.wr_id = wr_id;
+        wr.opcode = opcode;
+        wr.imm_data = imm_data;
+        wr.ready_us = NowMicros() + latency_us_;
+        wr.seq = seq;
+        pending_wrs_[qp_idx].push_back(wr);
+        psend_index_[qp_idx]++;
+        if (psend_index_[qp_idx] == max_num_sends_) {
+            psend_index_[qp_idx] = 0;
+        }
+        return wr_id;
+    }
+
+    uint64_t
+    NovaRDMAShmBroker::PostRead(char *localbuf, uint32_t size, int server_id,
+                                uint64_t local_offset,
+                                uint64_t remote_addr, bool is_offset) {
+        uint32_t qp_idx = to_qp_idx(server_id);
+        char *buf = localbuf;
+        if (buf == nullptr) {
+            buf = rdma_send_buf_[qp_idx] + psend_index_[qp_idx] * max_msg_size_;
+        }
+        memcpy(buf + local_offset,
+               RemoteAddress(qp_idx, remote_addr, is_offset, size), size);
+        return PostWR(qp_idx, IBV_WC_RDMA_READ, 0, 0);
+    }
+
+    uint64_t
+    NovaRDMAShmBroker::PostSend(const char *localbuf, uint32_t size,
+                                int server_id, uint32_t imm_data) {
+        NOVA_ASSERT(size < max_msg_size_)
+            << fmt::format("{} {}", size, max_msg_size_);
+        uint32_t qp_idx = to_qp_idx(server_id);
+        const char *buf = localbuf;
+        if (buf == nullptr) {
+            buf = rdma_send_buf_[qp_idx] + psend_index_[qp_idx] * max_msg_size_;
+        }
+        uint64_t seq = Deliver(qp_idx, IBV_WC_RECV, buf, size, imm_data);
+        return PostWR(qp_idx, IBV_WC_SEND, imm_data, seq);
+    }
+
+    uint64_t
+    NovaRDMAShmBroker::PostWrite(const char *localbuf, uint32_t size,
+                                 int server_id,
+                                 uint64_t remote_offset, bool is_remote_offset,
+                                 uint32_t imm_data) {
+        uint32_t qp_idx = to_qp_idx(server_id);
+        const char *buf = localbuf;
+        if (buf == nullptr) {
+            buf = rdma_send_buf_[qp_idx] + psend_index_[qp_idx] * max_msg_size_;
+        }
+        memcpy(RemoteAddress(qp_idx, remote_offset, is_remote_offset, size),
+               buf, size);
+        uint64_t seq = 0;
+        if (imm_data != 0) {
+            seq = Deliver(qp_idx, IBV_WC_RECV_RDMA_WITH_IMM, nullptr, 0,
+                          imm_data);
+        }
+        return PostWR(qp_idx, IBV_WC_RDMA_WRITE, imm_data, seq);
+    }
+
+    void NovaRDMAShmBroker::FlushPendingSends() {}
+
+    void NovaRDMAShmBroker::FlushPendingSends(int peer_sid) {}
+
+    uint32_t NovaRDMAShmBroker::PollSQ(int server_id, uint32_t *new_requests) {
+        uint32_t qp_idx = to_qp_idx(server_id);
+        auto &pending = pending_wrs_[qp_idx];
+        if (pending.empty()) {
+            return 0;
+        }
+        // FIFO.
+        uint64_t now = NowMicros();
+        uint64_t received = send_channels_[qp_idx].header->tail.load(
+                std::memory_order_acquire);
+        bool generate_new_request = false;
+        uint32_t n = 0;
+        while (!pending.empty()) {
+            PendingWR wr = pending.front();
+            if (wr.ready_us > now || wr.seq > received) {
+                break;
+            }
+            pending.pop_front();
+            char *buf = rdma_send_buf_[qp_idx] + wr.wr_id * max_msg_size_;
+            callback_->ProcessRDMAWC(wr.opcode, wr.wr_id, server_id, buf,
+                                     wr.imm_data, &generate_new_request);
+            if (generate_new_request) {
+                (*new_requests)++;
+            }
+            // Send is complete.
+            buf[0] = 0;
+            buf[1] = 0;
+            n++;
+        }
+        return n;
+    }
+
+    void NovaRDMAShmBroker::PostRecv(int server_id, int recv_buf_index) {
+        uint32_t qp_idx = to_qp_idx(server_id);
+        char *local_buf =
+                rdma_recv_buf_[qp_idx] + max_msg_size_ * recv_buf_index;
+        local_buf[0] = 0;
+        local_buf[1] = 0;
+    }
+
+    void NovaRDMAShmBroker::FlushPendingRecvs() {}
+
+    uint32_t NovaRDMAShmBroker::PollRQ(int server_id, uint32_t *new_requests) {
+        uint32_t qp_idx = to_qp_idx(server_id);
+        Channel &channel = recv_channels_[qp_idx];
+        uint64_t tail = channel.header->tail.load(std::memory_order_relaxed);
+        uint64_t head = channel.header->head.load(std::memory_order_acquire);
+        uint64_t now = NowMicros();
+        bool generate_new_request = false;
+        uint32_t n = 0;
+        while (tail < head) {
+            Message *msg = Slot(channel, tail);
+            if (msg->ready_us > now) {
+                break;
+            }
+            uint64_t wr_id = tail % max_num_sends_;
+            char *buf = rdma_recv_buf_[qp_idx] + max_msg_size_ * wr_id;
+            memcpy(buf, (char *) msg + sizeof(Message), msg->size);
+            ibv_wc_opcode opcode = msg->opcode;
+            uint32_t imm_data = msg->imm_data;
+            // The slot can be reused by the peer.
+            tail++;
+            channel.header->tail.store(tail, std::memory_order_release);
+
+            NOVA_LOG(DEBUG)
+                << fmt::format(
+                        "shm[{}]: RQ: received from server {} wr:{} imm:{}",
+                        thread_id_, server_id, wr_id, imm_data);
+            callback_->ProcessRDMAWC(opcode, wr_id, server_id, buf, imm_data,
+                                     &generate_new_request);
+            if (generate_new_request) {
+                (*new_requests)++;
+            }
+            PostRecv(server_id, wr_id);
+            n++;
+        }
+        return n;
+    }
+
+    char *NovaRDMAShmBroker::GetSendBuf() {
+        return nullptr;
+    }
+
+    char *NovaRDMAShmBroker::GetSendBuf(int server_id) {
+        uint32_t qp_idx = to_qp_idx(server_id);
+        return rdma_send_buf_[qp_idx] +
+               psend_index_[qp_idx] * max_msg_size_;
+    }
+}
@@ -0,0 +1,181 @@
+//
+// Copyright (c) 2019 University of Southern California. All rights reserved.
+//
+
+#ifndef RLIB_NOVA_RDMA_SHM_STORE_H
+#define RLIB_NOVA_RDMA_SHM_STORE_H
+
+#include <atomic>
+#include <deque>
+#include <string>
+#include <fmt/core.h>
+
+#include "rdma_ctrl.hpp"
+#include "nova_rdma_broker.h"
+#include "rdma_msg_callback.h"
+#include "common/nova_common.h"
+
+namespace nova {
+
+    using namespace rdmaio;
+
+    // Thread local. One thread has one shared memory broker.
+    // It emulates RDMA RC QPs between servers that run on the same machine.
+    // The memory region of each server is a file under "shm_dir" that all
+    // servers map. RDMA READ/WRITE copy from/to the mapped region of the peer.
+    // SENDs and immediate data are delivered through a single-producer
+    // single-consumer channel per pair of threads. A SEND completes once the
+    // peer has polled it. All completions and messages are delayed by
+    // "latency_us" to emulate the network.
+    class NovaRDMAShmBroker : public NovaRDMABroker {
+    public:
+        NovaRDMAShmBroker(char *buf, int thread_id,
+                          const std::vector<QPEndPoint> &end_points,
+                          int total_num_servers,
+                          uint32_t max_num_sends,
+                          uint32_t max_msg_size,
+                          uint32_t my_server_id,
+                          const std::string &shm_dir,
+                          uint64_t latency_us,
+                          RDMAMsgCallback *callback);
+
+        // Allocate the memory region of this server in a file under
+        // "shm_dir" so that other servers on this machine can map it.
+        static char *
+        AllocateMemoryRegion(const std::string &shm_dir, uint32_t server_id,
+                             uint64_t size);
+
+        void Init(RdmaCtrl *rdma_ctrl);
+
+        uint64_t PostRead(char *localbuf, uint32_t size, int server_id,
+                          uint64_t local_offset,
+                          uint64_t remote_addr, bool is_remote_offset);
+
+        uint64_t PostSend(const char *localbuf, uint32_t size, int server_id,
+                          uint32_t imm_data);
+
+        uint64_t PostWrite(const char *localbuf, uint32_t size, int server_id,
+                           uint64_t remote_offset, bool is_remote_offset,
+                           uint32_t imm_data);
+
+        void FlushPendingSends();
+
+        void FlushPendingSends(int peer_sid) override;
+
+        uint32_t PollSQ(int peer_sid, uint32_t *new_requests);
+
+        void PostRecv(int peer_sid, int recv_buf_index);
+
+        void FlushPendingRecvs();
+
+        uint32_t PollRQ(int peer_sid, uint32_t *new_requests);
+
+        char *GetSendBuf();
+
+        char *GetSendBuf(int server_id);
+
+        uint32_t broker_id() { return thread_id_; }
+
+        const std::vector<QPEndPoint> &end_points() {
+            return end_points_;
+        }
+
+    private:
+        // Every shared file starts with this header. "magic" is set after
+        // the file is initialized. "pid" detects files of a dead process.
+        struct SharedFileHeader {
+            std::atomic<uint64_t> magic;
+            uint64_t pid;
+        };
+
+        struct RegionHeader {
+            SharedFileHeader file;
+            uint64_t base;
+            uint64_t size;
+        };
+
+        struct alignas(64) ChannelHeader {
+            SharedFileHeader file;
+            // Number of messages sent.
+            alignas(64) std::atomic<uint64_t> head;
+            // Number of messages received.
+            alignas(64) std::atomic<uint64_t> tail;
+        };
+
+        struct Message {
+            uint64_t ready_us;
+            ibv_wc_opcode opcode;
+            uint32_t imm_data;
+            uint32_t size;
+        };
+
+        struct Channel {
+            ChannelHeader *header = nullptr;
+            char *slots = nullptr;
+        };
+
+        struct Region {
+            char *buf = nullptr;
+            uint64_t remote_base = 0;
+            uint64_t size = 0;
+        };
+
+        struct PendingWR {
+            uint64_t wr_id;
+            ibv_wc_opcode opcode;
+            uint32_t imm_data;
+            uint64_t ready_us;
+            // The WR completes after the peer received message "seq" - 1.
+            // 0 if it does not send a message.
+            uint64_t seq;
+        };
+
+        static void *CreateSharedFile(const std::string &path, uint64_t size);
+
+        // Returns nullptr if the file is not initialized by a live process.
+        static void *OpenSharedFile(const std::string &path, uint64_t *size);
+
+        static uint64_t NowMicros();
+
+        std::string ChannelPath(uint32_t from_server_id,
+                                uint32_t from_thread_id,
+                                uint32_t to_server_id,
+                                uint32_t to_thread_id) const;
+
+        uint32_t to_qp_idx(uint32_t server_id);
+
+        Message *Slot(const Channel &channel, uint64_t seq) const;
+
+        // Returns the sequence number of the message.
+        uint64_t Deliver(int qp_idx, ibv_wc_opcode opcode, const char *buf,
+                         uint32_t size, uint32_t imm_data);
+
+        char *RemoteAddress(int qp_idx, uint64_t remote_addr, bool is_offset,
+                            uint32_t size);
+
+        uint64_t
+        PostWR(int qp_idx, ibv_wc_opcode opcode, uint32_t imm_data,
+               uint64_t seq);
+
+        const uint32_t my_server_id_ = 0;
+        const uint32_t max_num_sends_ = 0;
+        const uint32_t max_msg_size_ = 0;
+        const std::string shm_dir_;
+        const uint64_t latency_us_ = 0;
+
+        const int thread_id_ = 0;
+
+        int *server_qp_idx_map_ = nullptr;
+        std::vector<QPEndPoint> end_points_;
+        std::vector<Region> regions_;
+        std::vector<Channel> send_channels_;
+        std::vector<Channel> recv_channels_;
+        std::vector<std::deque<PendingWR>> pending_wrs_;
+        char **rdma_send_buf_ = nullptr;
+        char **rdma_recv_buf_ = nullptr;
+        int *psend_index_ = nullptr;
+        RDMAMsgCallback *callback_ = nullptr;
+    };
+}
+
+#endif //RLIB_NOVA_RDMA_SHM_STORE_H
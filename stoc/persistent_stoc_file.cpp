@@ -4,10 +4,13 @@
 // Copyright (c) 2020 University of Southern California. All rights reserved.
 //
 #include <fmt/core.h>
+#include <string.h>
+#include <unistd.h>
 #include "leveldb/cache.h"
 #include "db/filename.h"
 
 #include "persistent_stoc_file.h"
+#include "stoc_io_uring.h"
 #include "common/nova_console_logging.h"
 #include "common/nova_common.h"
 #include "common/nova_config.h"
@@ -211,7 +214,8 @@ namespace leveldb {
     }
 
     uint64_t
-    StoCPersistentFile::Persist(uint32_t given_file_id_for_assertion) {
+    StoCPersistentFile::Persist(uint32_t given_file_id_for_assertion,
+                                StoCIOUring *ring) {
         NOVA_ASSERT(given_file_id_for_assertion == file_id_)
             << fmt::format("{} {}", given_file_id_for_assertion, file_id_);
 
@@ -298,67 +302,149 @@ namespace leveldb {
         }
 
 
-        int i = 1;
-        int persisted_i = 0;
-        uint64_t offset = writes[0].mem_handle.offset();
-        uint64_t size = writes[0].mem_handle.size();
+        if (ring && file_->fd() >= 0) {
+            persisted_bytes = PersistWithIOUring(writes, ring);
+            mutex_.lock();
+            MarkPersisted(writes, 0, writes.size());
+            mutex_.unlock();
+        } else {
+            int i = 1;
+            int persisted_i = 0;
+            uint64_t offset = writes[0].mem_handle.offset();
+            uint64_t size = writes[0].mem_handle.size();
+            while (i <= writes.size()) {
+                if (i < writes.size() &&
+                    offset + size == writes[i].mem_handle.offset()) {
+                    size += writes[i].mem_handle.size();
+                    i++;
+                    continue;
+                }
+
+                // persist offset -> size.
+                nova::NovaGlobalVariables::global.stoc_queue_depth += 1;
+                nova::NovaGlobalVariables::global.stoc_pending_disk_writes += size;
+                nova::NovaGlobalVariables::global.total_disk_writes += size;
+                persisted_bytes += size;
+
+                Status s = file_->Append(Slice(backing_mem_ + offset, size));
+                NOVA_ASSERT(s.ok()) << fmt::format("{}", s.ToString());
+                s = file_->Sync();
+                NOVA_ASSERT(s.ok()) << fmt::format("{}", s.ToString());
+                disk_write_offset_ += size;
+
+                nova::NovaGlobalVariables::global.stoc_queue_depth -= 1;
+                nova::NovaGlobalVariables::global.stoc_pending_disk_writes -= size;
+
+                mutex_.lock();
+                MarkPersisted(writes, persisted_i, i);
+                mutex_.unlock();
+                if (i == writes.size()) {
+                    break;
+                }
+                persisted_i = i;
+                offset = writes[i].mem_handle.offset();
+                size = writes[i].mem_handle.size();
+                i += 1;
+            }
+        }
+
+        mutex_.lock();
+        written_mem_blocks_.erase(written_mem_blocks_.begin(),
+                                  written_mem_blocks_.begin() + writes.size());
+        Seal();
+        mutex_.unlock();
+        persist_mutex_.unlock();
+        return persisted_bytes;
+    }
+
+    uint64_t StoCPersistentFile::PersistWithIOUring(
+            const std::vector<BatchWrite> &writes, StoCIOUring *ring) {
+        NOVA_ASSERT(ring->inflight() == 0);
+        int fd = file_->fd();
+        uint64_t persisted_bytes = 0;
+        std::vector<StoCIOUring::Completion> completions;
+        std::vector<RangeWrite> ranges;
+
+        // Prepare the write of the unwritten part of a range.
+        auto prepare_write = [&](uint64_t id) {
+            const RangeWrite &w = ranges[id];
+            while (!ring->PrepareWrite(fd, backing_mem_ + w.mem_offset + w.written,
+                                       w.size - w.written,
+                                       w.disk_offset + w.written, id)) {
+                ring->SubmitAndWait(1, &completions);
+            }
+        };
+
+        // Issue the writes of all contiguous ranges at once and sync them
+        // with a single fsync once all of them complete.
+        int i = 0;
         while (i < writes.size()) {
-            if (offset + size == writes[i].mem_handle.offset()) {
+            uint64_t offset = writes[i].mem_handle.offset();
+            uint64_t size = writes[i].mem_handle.size();
+            i++;
+            while (i < writes.size() &&
+                   offset + size == writes[i].mem_handle.offset()) {
                 size += writes[i].mem_handle.size();
                 i++;
-                continue;
             }
-
-            // persist offset -> size.
             nova::NovaGlobalVariables::global.stoc_queue_depth += 1;
             nova::NovaGlobalVariables::global.stoc_pending_disk_writes += size;
             nova::NovaGlobalVariables::global.total_disk_writes += size;
+            RangeWrite w = {};
+            w.mem_offset = offset;
+            w.disk_offset = disk_write_offset_;
+            w.size = size;
+            ranges.push_back(w);
+            prepare_write(ranges.size() - 1);
+            disk_write_offset_ += size;
             persisted_bytes += size;
-
-            Status s = file_->Append(Slice(backing_mem_ + offset, size));
-            NOVA_ASSERT(s.ok()) << fmt::format("{}", s.ToString());
-            s = file_->Sync();
-            NOVA_ASSERT(s.ok()) << fmt::format("{}", s.ToString());
-
-            nova::NovaGlobalVariables::global.stoc_queue_depth -= 1;
-            nova::NovaGlobalVariables::global.stoc_pending_disk_writes -= size;
-
-            mutex_.lock();
-            for (int j = persisted_i; j < i; j++) {
-                if (writes[j].internal_type == FileInternalType::kFileMetadata) {
-                    NOVA_ASSERT(file_meta_block_offset_.find(writes[j].sstable) != file_meta_block_offset_.end());
-                    file_meta_block_offset_[writes[j].sstable].persisted = true;
-                } else if (writes[j].internal_type == FileInternalType::kFileParity) {
-                    NOVA_ASSERT(file_parity_block_offset_.find(writes[j].sstable) != file_parity_block_offset_.end());
-                    file_parity_block_offset_[writes[j].sstable].persisted = true;
-                } else {
-                    NOVA_ASSERT(file_block_offset_.find(writes[j].sstable) != file_block_offset_.end());
-                    file_block_offset_[writes[j].sstable].persisted = true;
-                }
-                persisting_cnt -= 1;
-            }
-            mutex_.unlock();
-            persisted_i = i;
-            offset = writes[i].mem_handle.offset();
-            size = writes[i].mem_handle.size();
-            i += 1;
         }
-        // Persist the last range.
-        nova::NovaGlobalVariables::global.stoc_queue_depth += 1;
-        nova::NovaGlobalVariables::global.stoc_pending_disk_writes += size;
-        nova::NovaGlobalVariables::global.total_disk_writes += size;
-        persisted_bytes += size;
 
-        Status s = file_->Append(Slice(backing_mem_ + offset, size));
-        NOVA_ASSERT(s.ok()) << fmt::format("{}", s.ToString());
-        s = file_->Sync();
-        NOVA_ASSERT(s.ok()) << fmt::format("{}", s.ToString());
-
-        nova::NovaGlobalVariables::global.stoc_queue_depth -= 1;
-        nova::NovaGlobalVariables::global.stoc_pending_disk_writes -= size;
+        // A write may be short. Resubmit the rest of its range until all
+        // ranges are written.
+        uint32_t unwritten_ranges = ranges.size();
+        uint32_t next = 0;
+        while (unwritten_ranges > 0) {
+            if (next == completions.size()) {
+                completions.clear();
+                next = 0;
+                ring->SubmitAndWait(1, &completions);
+                continue;
+            }
+            StoCIOUring::Completion c = completions[next++];
+            RangeWrite &w = ranges[c.user_data];
+            if (c.res == -EINTR || c.res == -EAGAIN) {
+                prepare_write(c.user_data);
+                continue;
+            }
+            NOVA_ASSERT(c.res > 0)
+                << fmt::format("write {} failed: {} {}", stoc_file_name_,
+                               w.size - w.written, strerror(-c.res));
+            w.written += c.res;
+            if (w.written < w.size) {
+                prepare_write(c.user_data);
+                continue;
+            }
+            nova::NovaGlobalVariables::global.stoc_queue_depth -= 1;
+            nova::NovaGlobalVariables::global.stoc_pending_disk_writes -= w.size;
+            unwritten_ranges--;
+        }
+
+        NOVA_ASSERT(ring->PrepareFsync(fd, UINT64_MAX));
+        completions.clear();
+        ring->SubmitAndWait(1, &completions);
+        NOVA_ASSERT(completions.size() == 1 && completions[0].res == 0)
+            << fmt::format("fsync {} failed: {}", stoc_file_name_,
+                           strerror(-completions[0].res));
+        // Keep the file position in sync for appends.
+        NOVA_ASSERT(lseek(fd, disk_write_offset_, SEEK_SET) ==
+                    disk_write_offset_);
+        return persisted_bytes;
+    }
 
-        mutex_.lock();
-        for (int j = persisted_i; j < writes.size(); j++) {
+    void StoCPersistentFile::MarkPersisted(
+            const std::vector<BatchWrite> &writes, int from, int to) {
+        for (int j = from; j < to; j++) {
             if (writes[j].internal_type == FileInternalType::kFileMetadata) {
                 NOVA_ASSERT(file_meta_block_offset_.find(writes[j].sstable) != file_meta_block_offset_.end());
                 file_meta_block_offset_[writes[j].sstable].persisted = true;
@@ -371,15 +457,6 @@ namespace leveldb {
             }
             persisting_cnt -= 1;
         }
-        mutex_.unlock();
-
-        mutex_.lock();
-        written_mem_blocks_.erase(written_mem_blocks_.begin(),
-                                  written_mem_blocks_.begin() + writes.size());
-        Seal();
-        mutex_.unlock();
-        persist_mutex_.unlock();
-        return persisted_bytes;
     }
 
     bool
@@ -647,6 +724,65 @@ namespace leveldb {
         block_cache_->Release(cache_handle);
     }
 
+    void StocPersistentFileManager::ReadDataBlocks(
+            std::vector<StoCBlockRead> *reads, StoCIOUring *ring) {
+        if (!ring || block_cache_) {
+            for (auto &read : *reads) {
+                ReadDataBlock(read.handle, read.handle.offset,
+                              read.handle.size, read.scratch, &read.result);
+            }
+            return;
+        }
+
+        NOVA_ASSERT(ring->inflight() == 0);
+        std::vector<StoCPersistentFile *> stoc_files(reads->size());
+        std::vector<StoCIOUring::Completion> completions;
+        for (int i = 0; i < reads->size(); i++) {
+            StoCBlockRead &read = (*reads)[i];
+            StoCPersistentFile *stoc_file = FindStoCFile(
+                    read.handle.stoc_file_id);
+            NOVA_ASSERT(stoc_file) << read.handle.stoc_file_id;
+            int fd = stoc_file->fd();
+            if (fd < 0) {
+                ReadDataBlock(read.handle, read.handle.offset,
+                              read.handle.size, read.scratch, &read.result);
+                continue;
+            }
+            stoc_files[i] = stoc_file;
+            nova::NovaGlobalVariables::global.stoc_queue_depth += 1;
+            nova::NovaGlobalVariables::global.stoc_pending_disk_reads += read.handle.size;
+            nova::NovaGlobalVariables::global.total_disk_reads += read.handle.size;
+            while (!ring->PrepareRead(fd, read.scratch, read.handle.size,
+                                      read.handle.offset, i)) {
+                ring->SubmitAndWait(1, &completions);
+            }
+        }
+        ring->SubmitAndWait(ring->inflight(), &completions);
+
+        for (const auto &c : completions) {
+            StoCBlockRead &read = (*reads)[c.user_data];
+            StoCPersistentFile *stoc_file = stoc_files[c.user_data];
+            nova::NovaGlobalVariables::global.stoc_queue_depth -= 1;
+            nova::NovaGlobalVariables::global.stoc_pending_disk_reads -= read.handle.size;
+            NOVA_ASSERT(c.res >= 0)
+                << fmt::format("Read {} from stoc file {} failed: {}",
+                               read.handle.DebugString(),
+                               stoc_file->stoc_file_name_,
+                               strerror(-c.res));
+            read.result = Slice(read.scratch, c.res);
+
+            leveldb::FileType type;
+            NOVA_ASSERT(ParseFileName(stoc_file->stoc_file_name_, &type));
+            if (type == leveldb::FileType::kTableFile) {
+                NOVA_ASSERT(read.result.size() == read.handle.size)
+                    << fmt::format("fn:{} given size:{} read size:{}",
+                                   stoc_file->stoc_file_name_,
+                                   read.handle.size, read.result.size());
+                NOVA_ASSERT(stoc_file->sealed()) << fmt::format("Read but not sealed {}", stoc_file->stoc_file_name_);
+            }
+        }
+    }
+
     void StocPersistentFileManager::OpenStoCFiles(
             const std::unordered_map<std::string, uint32_t> &fn_files) {
         mutex_.lock();
@@ -16,6 +16,14 @@
 
 namespace leveldb {
 
+    class StoCIOUring;
+
+    struct StoCBlockRead {
+        StoCBlockHandle handle = {};
+        char *scratch = nullptr;
+        Slice result;
+    };
+
     // Persistent StoC file.
     class StoCPersistentFile {
     public:
@@ -29,7 +37,10 @@ namespace leveldb {
         Status
         ReadForReplication(uint64_t offset, uint32_t size, char *scratch, Slice *result);
 
-        uint64_t Persist(uint32_t given_file_id_for_assertion);
+        // With "ring", the writes of all contiguous ranges are in flight
+        // concurrently and synced with a single fsync.
+        uint64_t Persist(uint32_t given_file_id_for_assertion,
+                         StoCIOUring *ring = nullptr);
 
         uint64_t AllocateBuf(const std::string &filename,
                              uint32_t size, FileInternalType internal_type);
@@ -54,6 +65,10 @@ namespace leveldb {
             return sealed_;
         }
 
+        int fd() {
+            return file_ ? file_->fd() : -1;
+        }
+
         std::string stoc_file_name_;
     private:
 
@@ -78,6 +93,22 @@ namespace leveldb {
             FileInternalType internal_type;
         };
 
+        // A contiguous range of the backing memory written to disk.
+        struct RangeWrite {
+            uint64_t mem_offset = 0;
+            uint64_t disk_offset = 0;
+            uint64_t size = 0;
+            // Number of bytes written so far.
+            uint64_t written = 0;
+        };
+
+        uint64_t PersistWithIOUring(const std::vector<BatchWrite> &writes,
+                                    StoCIOUring *ring);
+
+        // Requires mutex_ to be held.
+        void MarkPersisted(const std::vector<BatchWrite> &writes, int from,
+                           int to);
+
         Env *env_ = nullptr;
         ReadWriteFile *file_ = nullptr;
 
@@ -92,6 +123,8 @@ namespace leveldb {
         MemManager *mem_manager_ = nullptr;
         char *backing_mem_ = nullptr;
         uint64_t current_disk_offset_ = 0;
+        // Number of bytes written to the file.
+        uint64_t disk_write_offset_ = 0;
         uint64_t current_mem_offset_ = 0;
         uint32_t file_size_ = 0;
         uint32_t allocated_mem_size_ = 0;
@@ -122,6 +155,11 @@ namespace leveldb {
         ReadDataBlock(const StoCBlockHandle &stoc_block_handle, uint64_t offset,
                       uint32_t size, char *scratch, Slice *result);
 
+        // Read a batch of blocks. With "ring", all reads are in flight
+        // concurrently.
+        void ReadDataBlocks(std::vector<StoCBlockRead> *reads,
+                            StoCIOUring *ring);
+
         bool
         ReadDataBlockForReplication(const StoCBlockHandle &stoc_block_handle,
                                     uint64_t offset,
@@ -0,0 +1,207 @@
+//
+// Copyright (c) 2020 University of Southern California. All rights reserved.
+//
+
+#include "stoc_io_uring.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <string.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "common/nova_console_logging.h"
+
+namespace leveldb {
+    namespace {
+        int io_uring_setup(uint32_t entries, io_uring_params *p) {
+            return (int) syscall(__NR_io_uring_setup, entries, p);
+        }
+
+        int io_uring_enter(int fd, uint32_t to_submit, uint32_t min_complete,
+                           uint32_t flags) {
+            return (int) syscall(__NR_io_uring_enter, fd, to_submit,
+                                 min_complete, flags, nullptr, 0);
+        }
+
+        uint32_t *RingField(void *ring, uint32_t offset) {
+            return reinterpret_cast<uint32_t *>(
+                    reinterpret_cast<char *>(ring) + offset);
+        }
+    }
+
+    StoCIOUring::StoCIOUring(uint32_t depth) : depth_(depth) {
+    }
+
+    StoCIOUring::~StoCIOUring() {
+        if (sqes_) {
+            munmap(sqes_, sqes_size_);
+        }
+        if (cq_ring_ && cq_ring_ != sq_ring_) {
+            munmap(cq_ring_, cq_ring_size_);
+        }
+        if (sq_ring_) {
+            munmap(sq_ring_, sq_ring_size_);
+        }
+        if (ring_fd_ >= 0) {
+            close(ring_fd_);
+        }
+    }
+
+    bool StoCIOUring::Init() {
+        io_uring_params p = {};
+        ring_fd_ = io_uring_setup(depth_, &p);
+        if (ring_fd_ < 0) {
+            NOVA_LOG(rdmaio::WARNING)
+                << "io_uring_setup failed: " << strerror(errno);
+            return false;
+        }
+
+        sq_ring_size_ = p.sq_off.array + p.sq_entries * sizeof(uint32_t);
+        cq_ring_size_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        bool single_mmap = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap) {
+            sq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+            cq_ring_size_ = sq_ring_size_;
+        }
+        sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring_fd_,
+                        IORING_OFF_SQ_RING);
+        if (sq_ring_ == MAP_FAILED) {
+            sq_ring_ = nullptr;
+            return false;
+        }
+        if (single_mmap) {
+            cq_ring_ = sq_ring_;
+        } else {
+            cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, ring_fd_,
+                            IORING_OFF_CQ_RING);
+            if (cq_ring_ == MAP_FAILED) {
+                cq_ring_ = nullptr;
+                return false;
+            }
+        }
+        sqes_size_ = p.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = reinterpret_cast<io_uring_sqe *>(
+                mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES));
+        if (sqes_ == MAP_FAILED) {
+            sqes_ = nullptr;
+            return false;
+        }
+
+        sq_head_ = RingField(sq_ring_, p.sq_off.head);
+        sq_tail_ = RingField(sq_ring_, p.sq_off.tail);
+        sq_ring_mask_ = RingField(sq_ring_, p.sq_off.ring_mask);
+        sq_ring_entries_ = RingField(sq_ring_, p.sq_off.ring_entries);
+        sq_array_ = RingField(sq_ring_, p.sq_off.array);
+        cq_head_ = RingField(cq_ring_, p.cq_off.head);
+        cq_tail_ = RingField(cq_ring_, p.cq_off.tail);
+        cq_ring_mask_ = RingField(cq_ring_, p.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe *>(
+                reinterpret_cast<char *>(cq_ring_) + p.cq_off.cqes);
+        local_sq_tail_ = *sq_tail_;
+        NOVA_LOG(rdmaio::INFO)
+            << "io_uring created with " << p.sq_entries << " entries";
+        return true;
+    }
+
+    io_uring_sqe *StoCIOUring::NextSQE() {
+        // The kernel may still own submitted entries, so inflight_ bounds
+        // the number of requests instead of the submission queue head.
+        if (inflight_ >= *sq_ring_entries_) {
+            return nullptr;
+        }
+        uint32_t head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+        if (local_sq_tail_ - head >= *sq_ring_entries_) {
+            return nullptr;
+        }
+        uint32_t index = local_sq_tail_ & *sq_ring_mask_;
+        io_uring_sqe *sqe = &sqes_[index];
+        memset(sqe, 0, sizeof(io_uring_sqe));
+        sq_array_[index] = index;
+        local_sq_tail_++;
+        to_submit_++;
+        inflight_++;
+        return sqe;
+    }
+
+    bool StoCIOUring::PrepareRead(int fd, char *buf, uint32_t size,
+                                  uint64_t offset, uint64_t user_data) {
+        io_uring_sqe *sqe = NextSQE();
+        if (!sqe) {
+            return false;
+        }
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = fd;
+        sqe->addr = (uint64_t) buf;
+        sqe->len = size;
+        sqe->off = offset;
+        sqe->user_data = user_data;
+        return true;
+    }
+
+    bool StoCIOUring::PrepareWrite(int fd, const char *buf, uint32_t size,
+                                   uint64_t offset, uint64_t user_data) {
+        io_uring_sqe *sqe = NextSQE();
+        if (!sqe) {
+            return false;
+        }
+        sqe->opcode = IORING_OP_WRITE;
+        sqe->fd = fd;
+        sqe->addr = (uint64_t) buf;
+        sqe->len = size;
+        sqe->off = offset;
+        sqe->user_data = user_data;
+        return true;
+    }
+
+    bool StoCIOUring::PrepareFsync(int fd, uint64_t user_data) {
+        io_uring_sqe *sqe = NextSQE();
+        if (!sqe) {
+            return false;
+        }
+        sqe->opcode = IORING_OP_FSYNC;
+        sqe->flags = IOSQE_IO_DRAIN;
+        sqe->fd = fd;
+        sqe->user_data = user_data;
+        return true;
+    }
+
+    uint32_t StoCIOUring::SubmitAndWait(uint32_t min_complete,
+                                        std::vector<Completion> *completions) {
+        NOVA_ASSERT(min_complete <= inflight_)
+            << min_complete << " " << inflight_;
+        __atomic_store_n(sq_tail_, local_sq_tail_, __ATOMIC_RELEASE);
+        uint32_t reaped = 0;
+        while (true) {
+            uint32_t head = *cq_head_;
+            uint32_t tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+            while (head != tail) {
+                io_uring_cqe *cqe = &cqes_[head & *cq_ring_mask_];
+                completions->push_back({cqe->user_data, cqe->res});
+                head++;
+                reaped++;
+            }
+            __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+            if (to_submit_ == 0 && reaped >= min_complete) {
+                break;
+            }
+            uint32_t wait = reaped >= min_complete ? 0 : min_complete - reaped;
+            int ret = io_uring_enter(ring_fd_, to_submit_, wait,
+                                     wait > 0 ? IORING_ENTER_GETEVENTS : 0);
+            if (ret < 0) {
+                NOVA_ASSERT(errno == EINTR || errno == EAGAIN ||
+                            errno == EBUSY)
+                    << "io_uring_enter failed: " << strerror(errno);
+                continue;
+            }
+            to_submit_ -= ret;
+        }
+        inflight_ -= reaped;
+        return reaped;
+    }
+}
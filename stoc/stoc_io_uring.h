@@ -0,0 +1,91 @@
+//
+// Copyright (c) 2020 University of Southern California. All rights reserved.
+//
+
+#ifndef LEVELDB_STOC_IO_URING_H
+#define LEVELDB_STOC_IO_URING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace leveldb {
+
+    // An io_uring instance that a storage worker uses to keep many disk reads
+    // and writes in flight. It is not thread safe. It talks to the kernel
+    // through the raw system calls so that it does not require liburing.
+    // It requires Linux 5.6 or later.
+    class StoCIOUring {
+    public:
+        struct Completion {
+            uint64_t user_data;
+            // Number of bytes transferred or -errno.
+            int32_t res;
+        };
+
+        explicit StoCIOUring(uint32_t depth);
+
+        ~StoCIOUring();
+
+        // Returns false if the kernel does not support io_uring.
+        bool Init();
+
+        // The Prepare functions return false if the submission queue is full.
+        bool PrepareRead(int fd, char *buf, uint32_t size, uint64_t offset,
+                         uint64_t user_data);
+
+        bool PrepareWrite(int fd, const char *buf, uint32_t size,
+                          uint64_t offset, uint64_t user_data);
+
+        // The fsync starts after all previously prepared requests complete.
+        bool PrepareFsync(int fd, uint64_t user_data);
+
+        // Submit the prepared requests and wait until at least
+        // "min_complete" requests complete. Append the completions to
+        // "completions" and return the number of appended completions.
+        uint32_t SubmitAndWait(uint32_t min_complete,
+                               std::vector<Completion> *completions);
+
+        // Number of requests that are prepared but not yet completed.
+        uint32_t inflight() const {
+            return inflight_;
+        }
+
+        uint32_t depth() const {
+            return depth_;
+        }
+
+    private:
+        io_uring_sqe *NextSQE();
+
+        const uint32_t depth_ = 0;
+        int ring_fd_ = -1;
+
+        void *sq_ring_ = nullptr;
+        size_t sq_ring_size_ = 0;
+        void *cq_ring_ = nullptr;
+        size_t cq_ring_size_ = 0;
+        io_uring_sqe *sqes_ = nullptr;
+        size_t sqes_size_ = 0;
+
+        uint32_t *sq_head_ = nullptr;
+        uint32_t *sq_tail_ = nullptr;
+        uint32_t *sq_ring_mask_ = nullptr;
+        uint32_t *sq_ring_entries_ = nullptr;
+        uint32_t *sq_array_ = nullptr;
+
+        uint32_t *cq_head_ = nullptr;
+        uint32_t *cq_tail_ = nullptr;
+        uint32_t *cq_ring_mask_ = nullptr;
+        io_uring_cqe *cqes_ = nullptr;
+
+        uint32_t local_sq_tail_ = 0;
+        uint32_t to_submit_ = 0;
+        uint32_t inflight_ = 0;
+    };
+}
+
+#endif //LEVELDB_STOC_IO_URING_H
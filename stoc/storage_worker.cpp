@@ -18,6 +18,28 @@
 #include "db/version_set.h"
 
 namespace nova {
+    StorageTaskClass StorageTaskClassOf(leveldb::StoCRequestType type) {
+        switch (type) {
+            case leveldb::StoCRequestType::STOC_READ_BLOCKS:
+                return kStorageTaskRead;
+            case leveldb::StoCRequestType::STOC_PERSIST:
+                return kStorageTaskPersist;
+            default:
+                return kStorageTaskBackground;
+        }
+    }
+
+    std::string StorageTaskClassName(StorageTaskClass c) {
+        switch (c) {
+            case kStorageTaskRead:
+                return "read";
+            case kStorageTaskPersist:
+                return "persist";
+            default:
+                return "background";
+        }
+    }
+
     StorageWorker::StorageWorker(
             leveldb::StocPersistentFileManager *stoc_file_manager,
             std::vector<RDMAServerImpl *> &rdma_servers,
@@ -35,16 +57,36 @@ namespace nova {
         stat_read_bytes_ = 0;
         stat_write_bytes_ = 0;
         sem_init(&sem_, 0, 0);
+        for (int i = 0; i < kNumStorageTaskClasses; i++) {
+            latency_hists_[i].Clear();
+        }
     }
 
-    void StorageWorker::AddTask(
-            const nova::StorageTask &task) {
+    bool StorageWorker::AddTask(const nova::StorageTask &task) {
+        StorageTaskClass c = StorageTaskClassOf(task.request_type);
+        uint32_t max_queue_size = NovaConfig::config->storage_worker_queue_size;
         mutex_.lock();
+        if (max_queue_size > 0 && queues_[c].size() >= max_queue_size) {
+            stat_rejected_tasks_ += 1;
+            mutex_.unlock();
+            return false;
+        }
         stat_tasks_ += 1;
-        queue_.push_back(task);
+        queues_[c].push_back(task);
+        queues_[c].back().enqueue_us = env_->NowMicros();
         mutex_.unlock();
 
         sem_post(&sem_);
+        return true;
+    }
+
+    void StorageWorker::CollectLatencyHistograms(leveldb::Histogram *hists) {
+        stats_mutex_.lock();
+        for (int i = 0; i < kNumStorageTaskClasses; i++) {
+            hists[i].Merge(latency_hists_[i]);
+            latency_hists_[i].Clear();
+        }
+        stats_mutex_.unlock();
     }
 
     std::vector<leveldb::ReplicationPair> StorageWorker::ReplicateSSTables(
@@ -114,154 +156,206 @@ namespace nova {
         return replication_results;
     }
 
-    void StorageWorker::Start() {
-        NOVA_LOG(DEBUG) << "CC server worker started";
-
-        nova::NovaConfig::config->add_tid_mapping();
+    void StorageWorker::ExecuteTask(const StorageTask &task,
+                                    ServerCompleteTask *ct) {
+        if (task.request_type ==
+            leveldb::StoCRequestType::STOC_PERSIST) {
+            NOVA_ASSERT(task.persist_pairs.size() == 1);
+            leveldb::FileType type = leveldb::FileType::kCurrentFile;
+            for (auto &pair : task.persist_pairs) {
+                leveldb::StoCPersistentFile *stoc_file = stoc_file_manager_->FindStoCFile(
+                        pair.stoc_file_id);
+                uint64_t persisted_bytes = stoc_file->Persist(
+                        pair.stoc_file_id, io_uring_);
+                stat_write_bytes_ += persisted_bytes;
+                NOVA_LOG(DEBUG) << fmt::format(
+                            "Persisting stoc file {} for sstable {}",
+                            pair.stoc_file_id, pair.sstable_name);
 
-        while (is_running_) {
-            sem_wait(&sem_);
+                leveldb::BlockHandle h = stoc_file->Handle(pair.sstable_name, task.internal_type);
+                leveldb::StoCBlockHandle rh = {};
+                rh.server_id = NovaConfig::config->my_server_id;
+                rh.stoc_file_id = pair.stoc_file_id;
+                rh.offset = h.offset();
+                rh.size = h.size();
+                ct->stoc_block_handles.push_back(rh);
+                NOVA_ASSERT(leveldb::ParseFileName(pair.sstable_name, &type));
+                if (type == leveldb::FileType::kTableFile) {
+                    stoc_file->ForceSeal();
+                }
+            }
+        } else if (task.request_type ==
+                   leveldb::StoCRequestType::STOC_REPLICATE_SSTABLES) {
+            ct->replication_results = ReplicateSSTables(task.dbname, task.replication_pairs);
+        } else if (task.request_type ==
+                   leveldb::StoCRequestType::STOC_COMPACTION) {
+            leveldb::TableCache table_cache(
+                    task.compaction_request->dbname, options_, 0,
+                    nullptr);
+            leveldb::VersionFileMap version_files(&table_cache);
+            leveldb::Compaction *compaction = new leveldb::Compaction(
+                    &version_files, &icmp_, &options_,
+                    task.compaction_request->source_level,
+                    task.compaction_request->target_level);
+            compaction->grandparents_ = task.compaction_request->guides;
+            compaction->drop_obsolete_deletions_ = task.compaction_request->drop_obsolete_deletions;
+            compaction->deeper_ranges_ = task.compaction_request->deeper_ranges;
+            compaction->smallest_unflushed_sequence_ = task.compaction_request->smallest_unflushed_sequence;
+            for (int which = 0; which < 2; which++) {
+                compaction->inputs_[which] = task.compaction_request->inputs[which];
+                for (auto meta : compaction->inputs_[which]) {
+                    version_files.fn_files_[meta->number] = meta;
+                }
+            }
+            for (auto meta : compaction->grandparents_) {
+                version_files.fn_files_[meta->number] = meta;
+            }
 
-            std::vector<StorageTask> tasks;
-            mutex_.lock();
+            // This will delete the subranges.
+            leveldb::SubRanges srs;
+            srs.subranges = task.compaction_request->subranges;
+            srs.AssertSubrangeBoundary(user_comparator_);
+            compaction->input_version_ = &version_files;
 
-            while (!queue_.empty()) {
-                auto task = queue_.front();
-                tasks.push_back(task);
-                queue_.pop_front();
+            leveldb::CompactionState *state = new leveldb::CompactionState(
+                    compaction, &srs,
+                    task.compaction_request->smallest_snapshot);
+            std::function<uint64_t(void)> fn_generator = []() {
+                uint32_t fn = storage_file_number_seq.fetch_add(1);
+                uint64_t stocid = nova::NovaConfig::config->my_server_id + 1;
+                return (stocid << 32) | fn;
+            };
+            {
+                std::vector<const leveldb::FileMetaData *> files;
+                for (int which = 0; which < 2; which++) {
+                    for (int i = 0; i < compaction->num_input_files(which); i++) {
+                        files.push_back(compaction->input(which, i));
+                    }
+                }
+                FetchMetadataFilesInParallel(files,
+                                             task.compaction_request->dbname,
+                                             options_,
+                                             reinterpret_cast<leveldb::StoCBlockClient *>(client_),
+                                             env_);
             }
-            mutex_.unlock();
+            leveldb::CompactionJob job(fn_generator, env_,
+                                       task.compaction_request->dbname,
+                                       user_comparator_,
+                                       options_, this, &table_cache);
+            NOVA_LOG(rdmaio::DEBUG)
+                << fmt::format("storage[{}]: {}", thread_id_, compaction->DebugString(user_comparator_));
+            auto it = compaction->MakeInputIterator(&table_cache, this);
+            leveldb::CompactionStats stats = state->BuildStats();
+            job.CompactTables(state, it, &stats, true,
+                              leveldb::CompactInputType::kCompactInputSSTables,
+                              leveldb::CompactOutputType::kCompactOutputSSTables);
+            ct->compaction_state = state;
+            ct->compaction_request = task.compaction_request;
+        } else {
+            NOVA_ASSERT(false);
+        }
+    }
 
-            if (tasks.empty()) {
-                continue;
-            }
+    void StorageWorker::ExecuteReads(const std::vector<StorageTask> &tasks,
+                                     std::vector<ServerCompleteTask> *cts) {
+        std::vector<leveldb::StoCBlockRead> reads(tasks.size());
+        for (int i = 0; i < tasks.size(); i++) {
+            reads[i].handle = tasks[i].stoc_block_handle;
+            reads[i].scratch = tasks[i].rdma_buf;
+        }
+        stoc_file_manager_->ReadDataBlocks(&reads, io_uring_);
+        for (int i = 0; i < tasks.size(); i++) {
+            (*cts)[i].size = reads[i].result.size();
+            NOVA_ASSERT(reads[i].result.size() <= tasks[i].stoc_block_handle.size);
+            stat_read_bytes_ += tasks[i].stoc_block_handle.size;
+        }
+    }
 
-            std::map<uint32_t, std::vector<ServerCompleteTask>> t_tasks;
-            for (auto &task : tasks) {
-                stat_tasks_ += 1;
-                ServerCompleteTask ct = {};
-                ct.remote_server_id = task.remote_server_id;
-                ct.stoc_req_id = task.stoc_req_id;
-                ct.request_type = task.request_type;
-                ct.rdma_buf = task.rdma_buf;
-                ct.ltc_mr_offset = task.ltc_mr_offset;
-                ct.stoc_block_handle = task.stoc_block_handle;
+    void StorageWorker::Start() {
+        NOVA_LOG(DEBUG) << "CC server worker started";
 
-                if (task.request_type ==
-                    leveldb::StoCRequestType::STOC_READ_BLOCKS) {
-                    leveldb::Slice result;
-                    stoc_file_manager_->ReadDataBlock(task.stoc_block_handle,
-                                                      task.stoc_block_handle.offset,
-                                                      task.stoc_block_handle.size,
-                                                      task.rdma_buf, &result);
-                    ct.size = result.size();
-                    NOVA_ASSERT(result.size() <= task.stoc_block_handle.size);
-                    stat_read_bytes_ += task.stoc_block_handle.size;
-                } else if (task.request_type ==
-                           leveldb::StoCRequestType::STOC_PERSIST) {
-                    NOVA_ASSERT(task.persist_pairs.size() == 1);
-                    leveldb::FileType type = leveldb::FileType::kCurrentFile;
-                    for (auto &pair : task.persist_pairs) {
-                        leveldb::StoCPersistentFile *stoc_file = stoc_file_manager_->FindStoCFile(
-                                pair.stoc_file_id);
-                        uint64_t persisted_bytes = stoc_file->Persist(
-                                pair.stoc_file_id);
-                        stat_write_bytes_ += persisted_bytes;
-                        NOVA_LOG(DEBUG) << fmt::format(
-                                    "Persisting stoc file {} for sstable {}",
-                                    pair.stoc_file_id, pair.sstable_name);
+        nova::NovaConfig::config->add_tid_mapping();
 
-                        leveldb::BlockHandle h = stoc_file->Handle(pair.sstable_name, task.internal_type);
-                        leveldb::StoCBlockHandle rh = {};
-                        rh.server_id = NovaConfig::config->my_server_id;
-                        rh.stoc_file_id = pair.stoc_file_id;
-                        rh.offset = h.offset();
-                        rh.size = h.size();
-                        ct.stoc_block_handles.push_back(rh);
-                        NOVA_ASSERT(leveldb::ParseFileName(pair.sstable_name, &type));
-                        if (type == leveldb::FileType::kTableFile) {
-                            stoc_file->ForceSeal();
-                        }
-                    }
-                } else if (task.request_type ==
-                           leveldb::StoCRequestType::STOC_REPLICATE_SSTABLES) {
-                    ct.replication_results = ReplicateSSTables(task.dbname, task.replication_pairs);
-                } else if (task.request_type ==
-                           leveldb::StoCRequestType::STOC_COMPACTION) {
-                    leveldb::TableCache table_cache(
-                            task.compaction_request->dbname, options_, 0,
-                            nullptr);
-                    leveldb::VersionFileMap version_files(&table_cache);
-                    leveldb::Compaction *compaction = new leveldb::Compaction(
-                            &version_files, &icmp_, &options_,
-                            task.compaction_request->source_level,
-                            task.compaction_request->target_level);
-                    compaction->grandparents_ = task.compaction_request->guides;
-                    for (int which = 0; which < 2; which++) {
-                        compaction->inputs_[which] = task.compaction_request->inputs[which];
-                        for (auto meta : compaction->inputs_[which]) {
-                            version_files.fn_files_[meta->number] = meta;
+        if (NovaConfig::config->stoc_io_uring_depth > 0) {
+            io_uring_ = new leveldb::StoCIOUring(
+                    NovaConfig::config->stoc_io_uring_depth);
+            NOVA_ASSERT(io_uring_->Init())
+                << "io_uring is not supported. Set stoc_io_uring_depth to 0.";
+        }
+
+        while (is_running_) {
+            sem_wait(&sem_);
+
+            while (true) {
+                // Reads are cheap and latency sensitive. Run all of them
+                // together. Other tasks run one at a time so that a read
+                // queued behind them waits for at most one task.
+                std::vector<StorageTask> tasks;
+                mutex_.lock();
+                for (int c = 0; c < kNumStorageTaskClasses; c++) {
+                    auto &queue = queues_[c];
+                    while (!queue.empty()) {
+                        tasks.push_back(queue.front());
+                        queue.pop_front();
+                        if (c != kStorageTaskRead) {
+                            break;
                         }
                     }
-                    for (auto meta : compaction->grandparents_) {
-                        version_files.fn_files_[meta->number] = meta;
+                    if (!tasks.empty()) {
+                        break;
                     }
+                }
+                mutex_.unlock();
 
-                    // This will delete the subranges.
-                    leveldb::SubRanges srs;
-                    srs.subranges = task.compaction_request->subranges;
-                    srs.AssertSubrangeBoundary(user_comparator_);
-                    compaction->input_version_ = &version_files;
+                if (tasks.empty()) {
+                    break;
+                }
 
-                    leveldb::CompactionState *state = new leveldb::CompactionState(
-                            compaction, &srs,
-                            task.compaction_request->smallest_snapshot);
-                    std::function<uint64_t(void)> fn_generator = []() {
-                        uint32_t fn = storage_file_number_seq.fetch_add(1);
-                        uint64_t stocid = nova::NovaConfig::config->my_server_id + 1;
-                        return (stocid << 32) | fn;
-                    };
-                    {
-                        std::vector<const leveldb::FileMetaData *> files;
-                        for (int which = 0; which < 2; which++) {
-                            for (int i = 0; i < compaction->num_input_files(which); i++) {
-                                files.push_back(compaction->input(which, i));
-                            }
-                        }
-                        FetchMetadataFilesInParallel(files,
-                                                     task.compaction_request->dbname,
-                                                     options_,
-                                                     reinterpret_cast<leveldb::StoCBlockClient *>(client_),
-                                                     env_);
-                    }
-                    leveldb::CompactionJob job(fn_generator, env_,
-                                               task.compaction_request->dbname,
-                                               user_comparator_,
-                                               options_, this, &table_cache);
-                    NOVA_LOG(rdmaio::DEBUG)
-                        << fmt::format("storage[{}]: {}", thread_id_, compaction->DebugString(user_comparator_));
-                    auto it = compaction->MakeInputIterator(&table_cache, this);
-                    leveldb::CompactionStats stats = state->BuildStats();
-                    job.CompactTables(state, it, &stats, true,
-                                      leveldb::CompactInputType::kCompactInputSSTables,
-                                      leveldb::CompactOutputType::kCompactOutputSSTables);
-                    ct.compaction_state = state;
-                    ct.compaction_request = task.compaction_request;
+                std::vector<ServerCompleteTask> cts(tasks.size());
+                for (int i = 0; i < tasks.size(); i++) {
+                    const auto &task = tasks[i];
+                    stat_tasks_ += 1;
+                    ServerCompleteTask &ct = cts[i];
+                    ct.remote_server_id = task.remote_server_id;
+                    ct.stoc_req_id = task.stoc_req_id;
+                    ct.request_type = task.request_type;
+                    ct.rdma_buf = task.rdma_buf;
+                    ct.ltc_mr_offset = task.ltc_mr_offset;
+                    ct.stoc_block_handle = task.stoc_block_handle;
+                }
+                if (tasks[0].request_type ==
+                    leveldb::StoCRequestType::STOC_READ_BLOCKS) {
+                    ExecuteReads(tasks, &cts);
                 } else {
-                    NOVA_ASSERT(false);
+                    NOVA_ASSERT(tasks.size() == 1);
+                    ExecuteTask(tasks[0], &cts[0]);
+                }
+
+                std::map<uint32_t, std::vector<ServerCompleteTask>> t_tasks;
+                for (int i = 0; i < tasks.size(); i++) {
+                    const auto &task = tasks[i];
+                    const auto &ct = cts[i];
+                    NOVA_LOG(DEBUG)
+                        << fmt::format(
+                                "CCWorker: Working on t:{} ss:{} req:{} type:{}",
+                                task.rdma_server_thread_id, ct.remote_server_id,
+                                ct.stoc_req_id,
+                                ct.request_type);
+                    t_tasks[task.rdma_server_thread_id].push_back(ct);
                 }
-                NOVA_LOG(DEBUG)
-                    << fmt::format(
-                            "CCWorker: Working on t:{} ss:{} req:{} type:{}",
-                            task.rdma_server_thread_id, ct.remote_server_id,
-                            ct.stoc_req_id,
-                            ct.request_type);
-                t_tasks[task.rdma_server_thread_id].push_back(ct);
-            }
 
-            for (auto &it : t_tasks) {
-                rdma_servers_[it.first]->AddCompleteTasks(it.second);
+                for (auto &it : t_tasks) {
+                    rdma_servers_[it.first]->AddCompleteTasks(it.second);
+                }
+
+                uint64_t now = env_->NowMicros();
+                stats_mutex_.lock();
+                for (auto &task : tasks) {
+                    StorageTaskClass c = StorageTaskClassOf(task.request_type);
+                    latency_hists_[c].Add(now - task.enqueue_us);
+                }
+                stats_mutex_.unlock();
             }
         }
     }
-}
\ No newline at end of file
+}
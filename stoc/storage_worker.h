@@ -11,11 +11,13 @@
 
 #include "leveldb/db_types.h"
 #include "db/table_cache.h"
+#include "util/histogram.h"
 
 #include "rdma/nova_rdma_rc_broker.h"
 #include "common/nova_mem_manager.h"
 #include "log/stoc_log_manager.h"
 #include "stoc/persistent_stoc_file.h"
+#include "stoc/stoc_io_uring.h"
 #include "novalsm/rdma_server.h"
 
 namespace nova {
@@ -25,6 +27,20 @@ namespace nova {
 
     class ServerCompleteTask;
 
+    // Storage tasks are executed in the order of their class. A worker
+    // always runs queued reads before persists and persists before
+    // compactions and replications.
+    enum StorageTaskClass {
+        kStorageTaskRead = 0,
+        kStorageTaskPersist = 1,
+        kStorageTaskBackground = 2,
+        kNumStorageTaskClasses = 3
+    };
+
+    StorageTaskClass StorageTaskClassOf(leveldb::StoCRequestType type);
+
+    std::string StorageTaskClassName(StorageTaskClass c);
+
     // A storage worker that handles storage related requests.
     class StorageWorker : public leveldb::EnvBGThread {
     public:
@@ -37,7 +53,8 @@ namespace nova {
                       uint64_t thread_id,
                       leveldb::Env *env);
 
-        void AddTask(const StorageTask &task);
+        // Returns false if the queue of the task's class is full.
+        bool AddTask(const StorageTask &task);
 
         void Start();
 
@@ -74,12 +91,23 @@ namespace nova {
                 const std::string &dbname,
                 const std::vector<leveldb::ReplicationPair> &replication_pairs);
 
+        // Merge the latency histograms of each task class into "hists"
+        // and clear them. Latency includes the time spent in the queue.
+        void CollectLatencyHistograms(leveldb::Histogram *hists);
+
         static std::atomic_int_fast32_t storage_file_number_seq;
 
         uint32_t stat_tasks_ = 0;
         uint64_t stat_read_bytes_ = 0;
         uint64_t stat_write_bytes_ = 0;
+        // Number of tasks rejected since their queue was full.
+        uint64_t stat_rejected_tasks_ = 0;
     private:
+        void ExecuteTask(const StorageTask &task, ServerCompleteTask *ct);
+
+        void ExecuteReads(const std::vector<StorageTask> &tasks,
+                          std::vector<ServerCompleteTask> *cts);
+
         leveldb::StocPersistentFileManager *stoc_file_manager_;
         std::vector<RDMAServerImpl *> rdma_servers_;
 
@@ -91,12 +119,16 @@ namespace nova {
 
         leveldb::StoCClient *client_;
         leveldb::MemManager *mem_manager_;
+        leveldb::StoCIOUring *io_uring_ = nullptr;
         uint64_t thread_id_;
         unsigned int rand_seed_ = 0;
 
         std::mutex mutex_;
-        std::list<StorageTask> queue_;
+        std::list<StorageTask> queues_[kNumStorageTaskClasses];
         sem_t sem_;
+
+        std::mutex stats_mutex_;
+        leveldb::Histogram latency_hists_[kNumStorageTaskClasses];
     };
 }
 
@@ -185,11 +185,11 @@ namespace leveldb {
             }
             auto userkey = ExtractUserKey(target);
             uint64_t userkeyint;
-            nova::str_to_int(userkey.data(), &userkeyint, userkey.size());
+            userkeyint = nova::user_key_to_int(userkey.data(), userkey.size());
             while (Valid()) {
                 auto pivot = ExtractUserKey(key());
                 uint64_t pivot_uk;
-                nova::str_to_int(pivot.data(), &pivot_uk, pivot.size());
+                pivot_uk = nova::user_key_to_int(pivot.data(), pivot.size());
                 NOVA_LOG(rdmaio::DEBUG)
                     << fmt::format("Block skip:{} {}", userkey.ToString(),
                                    pivot_uk);
@@ -2,6 +2,7 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 
+#include <algorithm>
 #include <common/nova_console_logging.h>
 #include <fmt/core.h>
 #include "table/filter_block.h"
@@ -17,8 +18,53 @@ namespace leveldb {
     static const size_t kFilterBaseLg = 11;
     static const size_t kFilterBase = 1 << kFilterBaseLg;
 
-    FilterBlockBuilder::FilterBlockBuilder(const FilterPolicy *policy)
-            : policy_(policy) {}
+    FilterBlockBuilder::FilterBlockBuilder(const FilterPolicy *policy,
+                                           int bits_per_key)
+            : policy_(policy), bits_per_key_(bits_per_key) {}
+
+    FilterStats::FilterStats() {
+        for (int i = 0; i < kMaxLevels; i++) {
+            levels_[i].nprobes = 0;
+            levels_[i].nnegatives = 0;
+            levels_[i].nfalse_positives = 0;
+            levels_[i].probe_ns = 0;
+        }
+    }
+
+    void FilterStats::Record(int level, bool may_match, bool found,
+                             uint64_t probe_ns) {
+        Level &l = levels_[std::min(std::max(level, 0), kMaxLevels - 1)];
+        l.nprobes.fetch_add(1, std::memory_order_relaxed);
+        l.probe_ns.fetch_add(probe_ns, std::memory_order_relaxed);
+        if (!may_match) {
+            l.nnegatives.fetch_add(1, std::memory_order_relaxed);
+        } else if (!found) {
+            l.nfalse_positives.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    std::string FilterStats::DebugString() const {
+        std::string result;
+        for (int i = 0; i < kMaxLevels; i++) {
+            const Level &l = levels_[i];
+            uint64_t nprobes = l.nprobes;
+            if (nprobes == 0) {
+                continue;
+            }
+            uint64_t nnegatives = l.nnegatives;
+            uint64_t nfalse_positives = l.nfalse_positives;
+            double false_positive_rate = 0;
+            if (nnegatives + nfalse_positives > 0) {
+                false_positive_rate = (double) nfalse_positives /
+                                      (double) (nnegatives + nfalse_positives);
+            }
+            result += fmt::format("{},{},{},{},{:.6f},{:.1f}\n", i, nprobes,
+                                  nnegatives, nfalse_positives,
+                                  false_positive_rate,
+                                  (double) l.probe_ns / (double) nprobes);
+        }
+        return result;
+    }
 
     void FilterBlockBuilder::StartBlock(uint64_t block_offset) {
         uint64_t filter_index = (block_offset / kFilterBase);
@@ -69,8 +115,14 @@ namespace leveldb {
 
         // Generate filter for current set of keys and append to result_.
         filter_offsets_.push_back(result_.size());
-        policy_->CreateFilter(&tmp_keys_[0], static_cast<int>(num_keys),
-                              &result_);
+        if (bits_per_key_ > 0) {
+            policy_->CreateFilterWithBitsPerKey(&tmp_keys_[0],
+                                                static_cast<int>(num_keys),
+                                                bits_per_key_, &result_);
+        } else {
+            policy_->CreateFilter(&tmp_keys_[0], static_cast<int>(num_keys),
+                                  &result_);
+        }
 
         tmp_keys_.clear();
         keys_.clear();
@@ -115,6 +167,38 @@ namespace leveldb {
         return policy_->KeyMayMatch(key, filter);
     }
 
+    void ExtractFilterPartition(const Slice &contents, uint64_t begin_offset,
+                                uint64_t end_offset, std::string *result,
+                                uint64_t *base_offset) {
+        size_t n = contents.size();
+        NOVA_ASSERT(n >= 9);
+        NOVA_ASSERT(contents[n - 1] == kFilterBaseLg);
+        const char *data = contents.data();
+        uint32_t filter_size = DecodeFixed32(data + n - 5);
+        uint32_t num_filter_offsets = DecodeFixed32(data + n - 9);
+        uint64_t begin = std::min(begin_offset / kFilterBase,
+                                  (uint64_t) num_filter_offsets);
+        uint64_t end = std::min(end_offset / kFilterBase + 1,
+                                (uint64_t) num_filter_offsets);
+        uint32_t start = filter_size;
+        if (begin < num_filter_offsets) {
+            start = DecodeFixed32(data + filter_size + begin * 4);
+        }
+        uint32_t limit = filter_size;
+        if (end < num_filter_offsets) {
+            limit = DecodeFixed32(data + filter_size + end * 4);
+        }
+        result->append(data + start, limit - start);
+        for (uint64_t i = begin; i < end; i++) {
+            PutFixed32(result,
+                       DecodeFixed32(data + filter_size + i * 4) - start);
+        }
+        PutFixed32(result, end - begin);
+        PutFixed32(result, limit - start);
+        result->push_back(kFilterBaseLg);
+        *base_offset = begin * kFilterBase;
+    }
+
     std::string FilterBlockReader::DebugString(uint64_t block_offset,
                                                const leveldb::Slice &key) {
         std::string debug;
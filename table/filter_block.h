@@ -12,6 +12,7 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <atomic>
 #include <string>
 #include <vector>
 
@@ -30,7 +31,8 @@ namespace leveldb {
 //      (StartBlock AddKey*)* Finish
     class FilterBlockBuilder {
     public:
-        explicit FilterBlockBuilder(const FilterPolicy *);
+        // If "bits_per_key" > 0, it overrides the bits per key of the policy.
+        explicit FilterBlockBuilder(const FilterPolicy *, int bits_per_key = 0);
 
         FilterBlockBuilder(const FilterBlockBuilder &) = delete;
 
@@ -46,6 +48,7 @@ namespace leveldb {
         void GenerateFilter();
 
         const FilterPolicy *policy_;
+        const int bits_per_key_;
         std::string keys_;             // Flattened key contents
         std::vector<size_t> start_;    // Starting index in keys_ of each key
         std::string result_;           // Filter data computed so far
@@ -73,6 +76,38 @@ namespace leveldb {
         uint32_t filter_size_ = 0;
     };
 
+// Per-level stats of the filter probes of Get. A probe that matches but
+// does not find the key in the data block is a false positive.
+    class FilterStats {
+    public:
+        static const int kMaxLevels = 16;
+
+        FilterStats();
+
+        void Record(int level, bool may_match, bool found, uint64_t probe_ns);
+
+        // One line per probed level:
+        // level,probes,negatives,false positives,false positive rate,
+        // average probe ns.
+        std::string DebugString() const;
+
+    private:
+        struct Level {
+            std::atomic_uint_fast64_t nprobes;
+            std::atomic_uint_fast64_t nnegatives;
+            std::atomic_uint_fast64_t nfalse_positives;
+            std::atomic_uint_fast64_t probe_ns;
+        };
+        Level levels_[kMaxLevels];
+    };
+
+// Copy the filters of the data blocks at offsets [begin_offset, end_offset]
+// in the filter block "contents" into a new filter block "*result". The
+// new filter block is looked up with block offsets minus "*base_offset".
+    void ExtractFilterPartition(const Slice &contents, uint64_t begin_offset,
+                                uint64_t end_offset, std::string *result,
+                                uint64_t *base_offset);
+
 }  // namespace leveldb
 
 #endif  // STORAGE_LEVELDB_TABLE_FILTER_BLOCK_H_
\ No newline at end of file
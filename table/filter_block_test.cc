@@ -121,6 +121,37 @@ namespace leveldb {
         ASSERT_TRUE(!reader.KeyMayMatch(9000, "bar"));
     }
 
+    TEST(FilterBlockTest, Partition) {
+        FilterBlockBuilder builder(policy_);
+        builder.StartBlock(0);
+        builder.AddKey("foo");
+        builder.StartBlock(3100);
+        builder.AddKey("box");
+        builder.StartBlock(9000);
+        builder.AddKey("hello");
+        Slice block = builder.Finish();
+
+        // The first and second filter.
+        std::string partition;
+        uint64_t base_offset = 0;
+        ExtractFilterPartition(block, 0, 3100, &partition, &base_offset);
+        ASSERT_EQ(0, base_offset);
+        FilterBlockReader reader(policy_, partition);
+        ASSERT_TRUE(reader.KeyMayMatch(0, "foo"));
+        ASSERT_TRUE(!reader.KeyMayMatch(0, "box"));
+        ASSERT_TRUE(reader.KeyMayMatch(3100, "box"));
+        ASSERT_TRUE(!reader.KeyMayMatch(3100, "hello"));
+
+        // The empty filters and the last filter.
+        partition.clear();
+        ExtractFilterPartition(block, 4100, 9000, &partition, &base_offset);
+        ASSERT_EQ(4096, base_offset);
+        FilterBlockReader last_reader(policy_, partition);
+        ASSERT_TRUE(!last_reader.KeyMayMatch(4100 - base_offset, "box"));
+        ASSERT_TRUE(last_reader.KeyMayMatch(9000 - base_offset, "hello"));
+        ASSERT_TRUE(!last_reader.KeyMayMatch(9000 - base_offset, "box"));
+    }
+
 }  // namespace leveldb
 
 int main(int argc, char **argv) { return leveldb::test::RunAllTests(); }
@@ -29,6 +29,23 @@ namespace leveldb {
         }
     }
 
+    void MetadataPartitionHandle::EncodeTo(std::string *dst) const {
+        index_handle.EncodeTo(dst);
+        filter_handle.EncodeTo(dst);
+        PutVarint64(dst, filter_base_offset);
+    }
+
+    Status MetadataPartitionHandle::DecodeFrom(Slice *input) {
+        Status s = index_handle.DecodeFrom(input);
+        if (s.ok()) {
+            s = filter_handle.DecodeFrom(input);
+        }
+        if (s.ok() && !GetVarint64(input, &filter_base_offset)) {
+            s = Status::Corruption("bad metadata partition handle");
+        }
+        return s;
+    }
+
     void Footer::EncodeTo(std::string *dst) const {
         const size_t original_size = dst->size();
         metaindex_handle_.EncodeTo(dst);
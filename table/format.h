@@ -95,6 +95,25 @@ namespace leveldb {
         BlockHandle index_handle_;
     };
 
+// A table may partition its index and filter blocks. Its metaindex block
+// then maps kPartitionedFilterPrefix followed by the filter policy name to
+// an empty value. Its index block is a top-level index that maps the last
+// key of every partition to an encoded MetadataPartitionHandle.
+    static const char kPartitionedFilterPrefix[] = "partitioned.filter.";
+
+// MetadataPartitionHandle points to an index partition and the filter
+// partition for the same data blocks. The filter partition is looked up
+// with data block offsets minus "filter_base_offset".
+    struct MetadataPartitionHandle {
+        BlockHandle index_handle;
+        BlockHandle filter_handle;
+        uint64_t filter_base_offset = 0;
+
+        void EncodeTo(std::string *dst) const;
+
+        Status DecodeFrom(Slice *input);
+    };
+
 // kTableMagicNumber was picked by running
 //    echo http://code.google.com/p/leveldb/ | sha1sum
 // and taking the leading 64 bits.
@@ -12,6 +12,7 @@
 #include "leveldb/iterator.h"
 #include "table/iterator_wrapper.h"
 #include "db/dbformat.h"
+#include "util/coding.h"
 
 namespace leveldb {
 
@@ -46,7 +47,7 @@ namespace leveldb {
                 for (int i = 0; i < n_; i++) {
                     uint64_t uk;
                     auto user = ExtractUserKey(target);
-                    nova::str_to_int(user.data(), &uk, user.size());
+                    uk = nova::user_key_to_int(user.data(), user.size());
                     NOVA_LOG(rdmaio::DEBUG)
                         << fmt::format("Merge skip {} key:{}", i, uk);
                     children_[i].SkipToNextUserKey(target);
@@ -199,6 +200,176 @@ namespace leveldb {
             }
             current_ = largest;
         }
+
+        class LoserTreeMergingIterator : public Iterator {
+        public:
+            LoserTreeMergingIterator(const InternalKeyComparator *comparator,
+                                     Iterator **children, int n)
+                    : user_comparator_(comparator->user_comparator()),
+                      children_(new Child[n]),
+                      tree_(new int[n]),
+                      n_(n) {
+                for (int i = 0; i < n; i++) {
+                    children_[i].iter.Set(children[i]);
+                    tree_[i] = i;
+                }
+            }
+
+            ~LoserTreeMergingIterator() override {
+                delete[] children_;
+                delete[] tree_;
+            }
+
+            bool Valid() const override {
+                return children_[tree_[0]].iter.Valid();
+            }
+
+            void SeekToFirst() override {
+                for (int i = 0; i < n_; i++) {
+                    children_[i].iter.SeekToFirst();
+                    Decode(i);
+                }
+                Build();
+            }
+
+            void Seek(const Slice &target) override {
+                for (int i = 0; i < n_; i++) {
+                    children_[i].iter.Seek(target);
+                    Decode(i);
+                }
+                Build();
+            }
+
+            void SkipToNextUserKey(const Slice &target) override {
+                for (int i = 0; i < n_; i++) {
+                    children_[i].iter.SkipToNextUserKey(target);
+                    Decode(i);
+                }
+                Build();
+            }
+
+            void Next() override {
+                assert(Valid());
+                int winner = tree_[0];
+                children_[winner].iter.Next();
+                Decode(winner);
+                // Replay the matches on the path from the leaf to the root.
+                for (int p = (winner + n_) / 2; p >= 1; p /= 2) {
+                    if (Less(tree_[p], winner)) {
+                        std::swap(tree_[p], winner);
+                    }
+                }
+                tree_[0] = winner;
+            }
+
+            void SeekToLast() override {
+                NOVA_ASSERT(false) << "Not supported";
+            }
+
+            void Prev() override {
+                NOVA_ASSERT(false) << "Not supported";
+            }
+
+            Slice key() const override {
+                assert(Valid());
+                return children_[tree_[0]].iter.key();
+            }
+
+            Slice value() const override {
+                assert(Valid());
+                return children_[tree_[0]].iter.value();
+            }
+
+            Status status() const override {
+                Status status;
+                for (int i = 0; i < n_; i++) {
+                    status = children_[i].iter.status();
+                    if (!status.ok()) {
+                        break;
+                    }
+                }
+                return status;
+            }
+
+        private:
+            struct Child {
+                IteratorWrapper iter;
+                Slice user_key;
+                uint64_t tag = 0;
+                // The integer of user_key if int_key_valid.
+                uint64_t int_key = 0;
+                bool int_key_valid = false;
+            };
+
+            void Decode(int i) {
+                Child &child = children_[i];
+                if (!child.iter.Valid()) {
+                    return;
+                }
+                Slice key = child.iter.key();
+                NOVA_ASSERT(key.size() >= 8);
+                child.user_key = Slice(key.data(), key.size() - 8);
+                child.tag = DecodeFixed64(key.data() + key.size() - 8);
+                child.int_key_valid = user_comparator_->KeyToInt(
+                        child.user_key, &child.int_key);
+            }
+
+            // Returns true if child a is before child b. An exhausted child
+            // is after all other children. Ties are broken by the child
+            // index, same as MergingIterator.
+            bool Less(int a, int b) const {
+                const Child &ca = children_[a];
+                const Child &cb = children_[b];
+                if (!ca.iter.Valid()) {
+                    return false;
+                }
+                if (!cb.iter.Valid()) {
+                    return true;
+                }
+                int r;
+                if (ca.int_key_valid && cb.int_key_valid) {
+                    r = ca.int_key < cb.int_key ? -1 :
+                        (ca.int_key > cb.int_key ? 1 : 0);
+                } else {
+                    r = user_comparator_->Compare(ca.user_key, cb.user_key);
+                }
+                if (r != 0) {
+                    return r < 0;
+                }
+                // Larger tags come first.
+                if (ca.tag != cb.tag) {
+                    return ca.tag > cb.tag;
+                }
+                return a < b;
+            }
+
+            // tree_[0] is the winner. tree_[p] for p in [1, n) is the loser
+            // of the match at internal node p. The leaf of child i is n + i
+            // and the parent of node p is p / 2.
+            void Build() {
+                std::vector<int> winners(2 * n_);
+                for (int i = 0; i < n_; i++) {
+                    winners[n_ + i] = i;
+                }
+                for (int p = n_ - 1; p >= 1; p--) {
+                    int a = winners[2 * p];
+                    int b = winners[2 * p + 1];
+                    if (Less(a, b)) {
+                        winners[p] = a;
+                        tree_[p] = b;
+                    } else {
+                        winners[p] = b;
+                        tree_[p] = a;
+                    }
+                }
+                tree_[0] = winners[1];
+            }
+
+            const Comparator *user_comparator_;
+            Child *children_;
+            int *tree_;
+            int n_;
+        };
     }  // namespace
 
     Iterator *
@@ -214,4 +385,18 @@ namespace leveldb {
         }
     }
 
+
+    Iterator *
+    NewCompactionMergingIterator(const InternalKeyComparator *comparator,
+                                 Iterator **children, int n) {
+        assert(n >= 0);
+        if (n == 0) {
+            return NewEmptyIterator();
+        } else if (n == 1) {
+            return children[0];
+        } else {
+            return new LoserTreeMergingIterator(comparator, children, n);
+        }
+    }
+
 }  // namespace leveldb
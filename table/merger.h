@@ -9,6 +9,8 @@ namespace leveldb {
 
     class Comparator;
 
+    class InternalKeyComparator;
+
     class Iterator;
 
 // Return an iterator that provided the union of the data in
@@ -23,6 +25,16 @@ namespace leveldb {
     NewMergingIterator(const Comparator *comparator, Iterator **children,
                        int n);
 
+// Same as NewMergingIterator() but for compactions with many children. The
+// children are merged with a loser tree that takes O(log n) comparisons per
+// entry. The user key and tag of each child are decoded once per entry so
+// that comparisons do not parse internal keys.
+//
+// The result only supports SeekToFirst(), Seek() and Next().
+    Iterator *
+    NewCompactionMergingIterator(const InternalKeyComparator *comparator,
+                                 Iterator **children, int n);
+
 }  // namespace leveldb
 
 #endif  // STORAGE_LEVELDB_TABLE_MERGER_H_
@@ -3,6 +3,7 @@
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 
 #include "util/crc32c.h"
+#include <chrono>
 #include <fmt/core.h>
 #include <db/dbformat.h>
 #include <common/nova_console_logging.h>
@@ -45,7 +46,9 @@ namespace leveldb {
         std::unordered_map<uint64_t, uint64_t> stoc_file_data_relative_offset;
 
         BlockHandle metaindex_handle;  // Handle to metaindex_block: saved from footer
+        // The top-level index if the index and filter blocks are partitioned.
         Block *index_block;
+        bool partitioned = false;
     };
 
     Status Table::Open(const Options &options,
@@ -146,11 +149,19 @@ namespace leveldb {
                                 footer.metaindex_handle().offset());
 
         Iterator *iter = meta->NewIterator(BytewiseComparator());
-        std::string key = "filter.";
-        key.append(rep_->options.filter_policy->Name());
-        iter->Seek(key);
-        NOVA_ASSERT(iter->Valid() && iter->key() == Slice(key));
-        ReadFilter(iter->value());
+        std::string partitioned_key = kPartitionedFilterPrefix;
+        partitioned_key.append(rep_->options.filter_policy->Name());
+        iter->Seek(partitioned_key);
+        if (iter->Valid() && iter->key() == Slice(partitioned_key)) {
+            // Filter partitions are read on demand.
+            rep_->partitioned = true;
+        } else {
+            std::string key = "filter.";
+            key.append(rep_->options.filter_policy->Name());
+            iter->Seek(key);
+            NOVA_ASSERT(iter->Valid() && iter->key() == Slice(key));
+            ReadFilter(iter->value());
+        }
         delete iter;
         delete meta;
     }
@@ -194,6 +205,150 @@ namespace leveldb {
         cache->Release(handle);
     }
 
+    namespace {
+        // A filter partition in the block cache.
+        struct FilterPartition {
+            FilterPartition(const FilterPolicy *policy,
+                            const BlockContents &contents)
+                    : data(contents.heap_allocated ? contents.data.data()
+                                                   : nullptr),
+                      reader(policy, contents.data) {}
+
+            ~FilterPartition() { delete[] data; }
+
+            const char *data;
+            FilterBlockReader reader;
+        };
+
+        void DeleteCachedFilterPartition(const Slice &key, void *value) {
+            delete reinterpret_cast<FilterPartition *>(value);
+        }
+    }
+
+    Slice Table::MetadataPartitionCacheKey(char type, const BlockHandle &handle,
+                                           char *buf) const {
+        EncodeFixed64(buf, rep_->cache_id);
+        buf[8] = type;
+        EncodeFixed64(buf + 9, handle.offset());
+        return Slice(buf, kMetadataPartitionCacheKeySize);
+    }
+
+    Status Table::ReadMetadataPartition(const BlockHandle &handle,
+                                        BlockContents *contents) const {
+        ReadOptions opt;
+        if (rep_->options.paranoid_checks) {
+            opt.verify_checksums = true;
+        }
+        StoCBlockHandle h = {};
+        h.offset = handle.offset();
+        h.size = handle.size();
+        return ReadBlock(rep_->file, opt, h, contents);
+    }
+
+    Iterator *
+    Table::IndexPartitionReader(void *arg, void *arg2,
+                                BlockReadContext context,
+                                const ReadOptions &options,
+                                const Slice &index_value,
+                                std::string *next_key) {
+        Table *table = reinterpret_cast<Table *>(arg);
+        Cache *block_cache = table->rep_->options.block_cache;
+        Slice input = index_value;
+        MetadataPartitionHandle partition;
+        Status s = partition.DecodeFrom(&input);
+        if (!s.ok()) {
+            return NewErrorIterator(s);
+        }
+        char cache_key_buffer[kMetadataPartitionCacheKeySize];
+        Slice key = table->MetadataPartitionCacheKey('i',
+                                                     partition.index_handle,
+                                                     cache_key_buffer);
+        Block *block = nullptr;
+        Cache::Handle *cache_handle = nullptr;
+        if (block_cache != nullptr) {
+            cache_handle = block_cache->Lookup(key);
+            if (cache_handle != nullptr) {
+                block = reinterpret_cast<Block *>(block_cache->Value(
+                        cache_handle));
+            }
+        }
+        if (block == nullptr) {
+            BlockContents contents;
+            s = table->ReadMetadataPartition(partition.index_handle,
+                                             &contents);
+            if (!s.ok()) {
+                return NewErrorIterator(s);
+            }
+            block = new Block(contents, table->rep_->file_number,
+                              partition.index_handle.offset());
+            if (block_cache != nullptr && contents.cachable) {
+                cache_handle = block_cache->Insert(key, block, block->size(),
+                                                   &DeleteCachedBlock);
+            }
+        }
+        Iterator *iter = block->NewIterator(table->rep_->options.comparator);
+        if (cache_handle == nullptr) {
+            iter->RegisterCleanup(&DeleteBlock, block, nullptr);
+        } else {
+            iter->RegisterCleanup(&ReleaseBlock, block_cache, cache_handle);
+        }
+        return iter;
+    }
+
+    bool Table::KeyMayMatch(const Slice &key, uint64_t data_block_offset) {
+        if (!rep_->partitioned) {
+            return rep_->filter->KeyMayMatch(data_block_offset, key);
+        }
+        // The partition of the data block is the first partition whose last
+        // key is >= key.
+        bool may_match = true;
+        Iterator *iter = rep_->index_block->NewIterator(
+                rep_->options.comparator);
+        iter->Seek(key);
+        MetadataPartitionHandle partition;
+        Slice input;
+        if (iter->Valid()) {
+            input = iter->value();
+        }
+        if (!input.empty() && partition.DecodeFrom(&input).ok()) {
+            Cache *block_cache = rep_->options.block_cache;
+            char cache_key_buffer[kMetadataPartitionCacheKeySize];
+            Slice cache_key = MetadataPartitionCacheKey('f',
+                                                        partition.filter_handle,
+                                                        cache_key_buffer);
+            FilterPartition *filter = nullptr;
+            Cache::Handle *cache_handle = nullptr;
+            if (block_cache != nullptr) {
+                cache_handle = block_cache->Lookup(cache_key);
+                if (cache_handle != nullptr) {
+                    filter = reinterpret_cast<FilterPartition *>(block_cache->Value(
+                            cache_handle));
+                }
+            }
+            if (filter == nullptr) {
+                BlockContents contents;
+                NOVA_ASSERT(ReadMetadataPartition(partition.filter_handle,
+                                                  &contents).ok());
+                filter = new FilterPartition(rep_->options.filter_policy,
+                                             contents);
+                if (block_cache != nullptr && contents.cachable) {
+                    cache_handle = block_cache->Insert(cache_key, filter,
+                                                       contents.data.size(),
+                                                       &DeleteCachedFilterPartition);
+                }
+            }
+            may_match = filter->reader.KeyMayMatch(
+                    data_block_offset - partition.filter_base_offset, key);
+            if (cache_handle != nullptr) {
+                block_cache->Release(cache_handle);
+            } else {
+                delete filter;
+            }
+        }
+        delete iter;
+        return may_match;
+    }
+
 // Convert an index iterator value (i.e., an encoded BlockHandle)
 // into an iterator over the contents of the corresponding block.
     Iterator *
@@ -240,9 +395,16 @@ namespace leveldb {
                     block = new Block(contents, table->rep_->file_number,
                                       stoc_block_handle.offset);
                     if (contents.cachable && options.fill_cache) {
+                        // Blocks read by iterators are inserted at low
+                        // priority so that scans do not evict hot blocks.
+                        Cache::Priority priority =
+                                context.caller == AccessCaller::kUserIterator
+                                ? Cache::Priority::kLow
+                                : Cache::Priority::kHigh;
                         cache_handle = block_cache->Insert(key, block,
                                                            block->size(),
-                                                           &DeleteCachedBlock);
+                                                           &DeleteCachedBlock,
+                                                           priority);
                         insert = true;
                     }
                 }
@@ -266,6 +428,10 @@ namespace leveldb {
                     stoc_block_handle.stoc_file_id,
                     stoc_block_handle.offset, stoc_block_handle.size, table->rep_->meta->DebugString());
 
+        if (table->db_profiler_ != nullptr && block_cache != nullptr) {
+            table->db_profiler_->RecordBlockCacheAccess(context.caller,
+                                                        cache_hit);
+        }
         if (table->db_profiler_ != nullptr) {
             Access access = {
                     .trace_type = TraceType::DATA_BLOCK,
@@ -277,6 +443,10 @@ namespace leveldb {
             };
             table->db_profiler_->Trace(access);
         }
+        if (context.caller == AccessCaller::kUserIterator &&
+            options.scan_stats != nullptr) {
+            options.scan_stats->number_of_scan_data_blocks_ += 1;
+        }
 
         Iterator *iter;
         if (block != nullptr) {
@@ -293,7 +463,8 @@ namespace leveldb {
     }
 
     Iterator *
-    Table::NewIterator(AccessCaller caller, const ReadOptions &options) const {
+    Table::NewIterator(AccessCaller caller, const ReadOptions &options,
+                       BlockPrefetcher *prefetcher) const {
         BlockReadContext context = {
                 .caller = caller,
                 .file_number = rep_->file_number,
@@ -314,10 +485,26 @@ namespace leveldb {
         }
 
         return NewTwoLevelIterator(
-                rep_->index_block->NewIterator(rep_->options.comparator),
+                NewIndexIterator(caller),
                 context,
                 &Table::DataBlockReader, const_cast<Table *>(this), nullptr,
-                options);
+                options, nullptr, false, prefetcher);
+    }
+
+    Iterator *Table::NewIndexIterator(AccessCaller caller) const {
+        Iterator *iter = rep_->index_block->NewIterator(
+                rep_->options.comparator);
+        if (!rep_->partitioned) {
+            return iter;
+        }
+        BlockReadContext context = {
+                .caller = caller,
+                .file_number = rep_->file_number,
+                .level = rep_->level,
+        };
+        return NewTwoLevelIterator(iter, context, &Table::IndexPartitionReader,
+                                   const_cast<Table *>(this), nullptr,
+                                   ReadOptions());
     }
 
     uint64_t Table::TranslateToDataBlockOffset(const leveldb::StoCBlockHandle &handle) {
@@ -351,7 +538,7 @@ namespace leveldb {
         }
 
         Status s;
-        Iterator *iiter = rep_->index_block->NewIterator(rep_->options.comparator);
+        Iterator *iiter = NewIndexIterator(AccessCaller::kUserGet);
         iiter->Seek(k);
         if (iiter->Valid()) {
             Slice handle_value = iiter->value();
@@ -360,7 +547,7 @@ namespace leveldb {
             bool found = true;
             bool key_doest_not_exist = false;
             uint64_t data_block_offset = 0;
-            NOVA_ASSERT(filter != nullptr);
+            NOVA_ASSERT(filter != nullptr || rep_->partitioned);
             NOVA_ASSERT(StoCBlockHandle::DecodeHandle(&handle_value, &handle));
             // Not found
             if (db_profiler_ != nullptr) {
@@ -370,15 +557,28 @@ namespace leveldb {
                         .block_id = 0,
                         .sstable_id = rep_->file_number,
                         .level = rep_->level,
-                        .size = rep_->filter->size()
+                        .size = filter != nullptr ? filter->size() : 0
                 };
                 db_profiler_->Trace(access);
             }
             data_block_offset = TranslateToDataBlockOffset(handle);
-            if (!filter->KeyMayMatch(data_block_offset, k)) {
+            FilterStats *filter_stats = rep_->options.filter_stats;
+            std::chrono::steady_clock::time_point probe_start;
+            if (filter_stats != nullptr) {
+                probe_start = std::chrono::steady_clock::now();
+            }
+            if (!KeyMayMatch(k, data_block_offset)) {
                 found = false;
                 key_doest_not_exist = true;
             }
+            uint64_t probe_ns = 0;
+            if (filter_stats != nullptr) {
+                probe_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - probe_start).count();
+            }
+            if (!found && filter_stats != nullptr) {
+                filter_stats->Record(rep_->level, false, false, probe_ns);
+            }
             if (found) {
                 BlockReadContext context{
                         .caller = AccessCaller::kUserGet,
@@ -389,6 +589,14 @@ namespace leveldb {
                                                        options,
                                                        iiter->value(), nullptr);
                 block_iter->Seek(k);
+                if (filter_stats != nullptr) {
+                    bool key_found = block_iter->Valid() &&
+                                     BytewiseComparator()->Compare(
+                                             ExtractUserKey(block_iter->key()),
+                                             ExtractUserKey(k)) == 0;
+                    filter_stats->Record(rep_->level, true, key_found,
+                                         probe_ns);
+                }
                 if (block_iter->Valid()) {
                     if (handle_result) {
                         (*handle_result)(arg, block_iter->key(),
@@ -407,7 +615,9 @@ namespace leveldb {
                                     ExtractUserKey(
                                             block_iter->key()).ToString(),
                                     ExtractUserKey(k).ToString(),
-                                    filter->DebugString(data_block_offset, k),
+                                    filter != nullptr
+                                    ? filter->DebugString(data_block_offset, k)
+                                    : "",
                                     rep_->meta->DebugString());
                     }
                 }
@@ -422,6 +632,100 @@ namespace leveldb {
         return s;
     }
 
+    void
+    Table::CollectUncachedDataBlocks(const std::vector<Slice> &keys,
+                                     std::vector<DataBlockPrefetch> *blocks) {
+        if (rep_->options.block_cache == nullptr) {
+            return;
+        }
+        Iterator *iiter = NewIndexIterator(AccessCaller::kUserGet);
+        std::string last_cache_key;
+        for (const Slice &k : keys) {
+            iiter->Seek(k);
+            if (!iiter->Valid()) {
+                // The remaining keys are larger than the last key.
+                break;
+            }
+            Slice handle_value = iiter->value();
+            StoCBlockHandle handle;
+            NOVA_ASSERT(StoCBlockHandle::DecodeHandle(&handle_value, &handle));
+            if (!KeyMayMatch(k, TranslateToDataBlockOffset(handle))) {
+                continue;
+            }
+            DataBlockPrefetch block;
+            if (!UncachedDataBlock(iiter->value(), &block) ||
+                block.cache_key == last_cache_key) {
+                continue;
+            }
+            last_cache_key = block.cache_key;
+            blocks->push_back(block);
+        }
+        delete iiter;
+    }
+
+    bool Table::UncachedDataBlock(const Slice &index_value,
+                                  DataBlockPrefetch *block) {
+        Cache *block_cache = rep_->options.block_cache;
+        if (block_cache == nullptr) {
+            return false;
+        }
+        Slice input = index_value;
+        StoCBlockHandle handle;
+        NOVA_ASSERT(StoCBlockHandle::DecodeHandle(&input, &handle));
+        // Same as DataBlockReader.
+        const auto &replicas = rep_->meta->block_replica_handles;
+        if (replicas.size() == 1 &&
+            replicas[0].data_block_group_handles.size() == 1) {
+            handle.server_id = replicas[0].data_block_group_handles[0].server_id;
+            handle.stoc_file_id = replicas[0].data_block_group_handles[0].stoc_file_id;
+        }
+        if (handle.stoc_file_id == 0) {
+            return false;
+        }
+        char cache_key_buffer[8 + StoCBlockHandle::HandleSize()];
+        EncodeFixed64(cache_key_buffer, rep_->cache_id);
+        handle.EncodeHandle(cache_key_buffer + 8);
+        Slice key(cache_key_buffer, sizeof(cache_key_buffer));
+        Cache::Handle *cache_handle = block_cache->Lookup(key);
+        if (cache_handle != nullptr) {
+            block_cache->Release(cache_handle);
+            return false;
+        }
+        block->table = this;
+        block->handle = handle;
+        block->cache_key = key.ToString();
+        return true;
+    }
+
+    Status Table::InsertDataBlock(const ReadOptions &options,
+                                  const DataBlockPrefetch &block,
+                                  const char *buf, Cache::Priority priority) {
+        Cache *block_cache = rep_->options.block_cache;
+        NOVA_ASSERT(block_cache);
+        size_t n = block.handle.size + kBlockTrailerSize;
+        char *heap_buf = new char[n];
+        memcpy(heap_buf, buf, n);
+        BlockContents contents;
+        Status s = ReadBlock(heap_buf, Slice(heap_buf, n), options,
+                             block.handle, &contents);
+        if (!s.ok()) {
+            return s;
+        }
+        Block *data_block = new Block(contents, rep_->file_number,
+                                      block.handle.offset);
+        if (!contents.cachable) {
+            delete data_block;
+            return s;
+        }
+        Cache::Handle *cache_handle = block_cache->Insert(block.cache_key,
+                                                          data_block,
+                                                          data_block->size(),
+                                                          &DeleteCachedBlock,
+                                                          priority);
+        block_cache->Release(cache_handle);
+        return s;
+    }
+
     Status
     Table::ReadBlock(const char *buf, const Slice &contents,
                      const ReadOptions &options,
@@ -512,8 +816,7 @@ namespace leveldb {
     }
 
     uint64_t Table::ApproximateOffsetOf(const Slice &key) const {
-        Iterator *index_iter =
-                rep_->index_block->NewIterator(rep_->options.comparator);
+        Iterator *index_iter = NewIndexIterator();
         index_iter->Seek(key);
         uint64_t result;
         if (index_iter->Valid()) {
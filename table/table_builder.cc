@@ -4,6 +4,7 @@
 
 #include "leveldb/table_builder.h"
 
+#include <algorithm>
 #include <assert.h>
 #include <common/nova_console_logging.h>
 #include <fmt/core.h>
@@ -21,8 +22,18 @@
 
 namespace leveldb {
 
+    namespace {
+        int FilterBitsPerKey(const Options &options, int level) {
+            const std::vector<int> &bits = options.filter_bits_per_key_per_level;
+            if (bits.empty()) {
+                return 0;
+            }
+            return bits[std::min(std::max(level, 0), (int) bits.size() - 1)];
+        }
+    }
+
     struct TableBuilder::Rep {
-        Rep(const Options &opt, WritableFile *f)
+        Rep(const Options &opt, WritableFile *f, int level)
                 : options(opt),
                   index_block_options(opt),
                   file(f),
@@ -34,7 +45,8 @@ namespace leveldb {
                   closed(false),
                   filter_block(opt.filter_policy == nullptr
                                ? nullptr
-                               : new FilterBlockBuilder(opt.filter_policy)),
+                               : new FilterBlockBuilder(opt.filter_policy,
+                                                        FilterBitsPerKey(opt, level))),
                   pending_index_entry(false) {
             index_block_options.block_restart_interval = 1;
         }
@@ -67,8 +79,9 @@ namespace leveldb {
         std::string compressed_output;
     };
 
-    TableBuilder::TableBuilder(const Options &options, WritableFile *file)
-            : rep_(new Rep(options, file)) {
+    TableBuilder::TableBuilder(const Options &options, WritableFile *file,
+                               int level)
+            : rep_(new Rep(options, file, level)) {
         if (rep_->filter_block != nullptr) {
             rep_->filter_block->StartBlock(0);
         }
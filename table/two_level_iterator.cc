@@ -4,6 +4,8 @@
 
 #include "table/two_level_iterator.h"
 
+#include <algorithm>
+
 #include "leveldb/table.h"
 #include "merger.h"
 #include "table/block.h"
@@ -23,6 +25,10 @@ namespace leveldb {
                                            const Slice &,
                                            std::string *);
 
+        // Start to read ahead after the iterator moves forward across this
+        // many consecutive blocks.
+        const uint32_t kSequentialBlocksToPrefetch = 2;
+
         // TODO: Support merging. When you call next, the data_iter will merge the current with the new iter. The newly merged iterator will then seek to the new key.
         //  Support forwarding only if no_reset is true.
         class TwoLevelIterator : public Iterator {
@@ -33,7 +39,8 @@ namespace leveldb {
                     BlockFunction block_function,
                     void *arg, void *arg2, const ReadOptions &options,
                     const Comparator *comparator,
-                    bool merging);
+                    bool merging,
+                    BlockPrefetcher *prefetcher);
 
             ~TwoLevelIterator() override;
 
@@ -90,7 +97,11 @@ namespace leveldb {
 
             void SetDataIterator(Iterator *data_iter);
 
-            bool InitDataBlock(std::string *);
+            // "sequential" is true if the index iterator moved to the next
+            // block.
+            bool InitDataBlock(std::string *, bool sequential = false);
+
+            void Prefetch(bool sequential);
 
             const BlockReadContext context_;
             BlockFunction block_function_;
@@ -105,6 +116,10 @@ namespace leveldb {
             std::string data_block_handle_;
             const bool merging_;
             const Comparator *comparator_;
+            BlockPrefetcher *prefetcher_;
+            // Number of consecutive blocks the iterator moved across.
+            uint32_t sequential_blocks_ = 0;
+            uint32_t prefetch_window_ = 0;
         };
 
         TwoLevelIterator::TwoLevelIterator(Iterator *index_iter,
@@ -114,7 +129,8 @@ namespace leveldb {
                                            void *arg2,
                                            const ReadOptions &options,
                                            const Comparator *comparator,
-                                           bool merging)
+                                           bool merging,
+                                           BlockPrefetcher *prefetcher)
                 : comparator_(comparator),
                   block_function_(block_function),
                   arg_(arg),
@@ -122,9 +138,12 @@ namespace leveldb {
                   context_(context),
                   options_(options),
                   index_iter_(index_iter),
-                  data_iter_(nullptr), merging_(merging) {}
+                  data_iter_(nullptr), merging_(merging),
+                  prefetcher_(prefetcher) {}
 
-        TwoLevelIterator::~TwoLevelIterator() = default;
+        TwoLevelIterator::~TwoLevelIterator() {
+            delete prefetcher_;
+        }
 
         void TwoLevelIterator::Seek(const Slice &target) {
             if (merging_) {
@@ -199,7 +218,7 @@ namespace leveldb {
                     return;
                 }
                 index_iter_.Next();
-                InitDataBlock(nullptr);
+                InitDataBlock(nullptr, true);
                 if (data_iter_.iter() != nullptr) data_iter_.SeekToFirst();
             }
         }
@@ -223,7 +242,8 @@ namespace leveldb {
             data_iter_.Set(data_iter);
         }
 
-        bool TwoLevelIterator::InitDataBlock(std::string *next_key) {
+        bool TwoLevelIterator::InitDataBlock(std::string *next_key,
+                                             bool sequential) {
             if (!index_iter_.Valid()) {
                 SetDataIterator(nullptr);
                 return true;
@@ -235,16 +255,42 @@ namespace leveldb {
                     // no need to change anything
                     return false;
                 } else {
+                    if (prefetcher_ != nullptr) {
+                        prefetcher_->Complete(handle);
+                    }
                     Iterator *iter = (*block_function_)(arg_, arg2_, context_,
                                                         options_, handle,
                                                         next_key);
                     data_block_handle_.assign(handle.data(), handle.size());
                     SetDataIterator(iter);
+                    Prefetch(sequential);
                     return true;
                 }
             }
         }
 
+        void TwoLevelIterator::Prefetch(bool sequential) {
+            if (prefetcher_ == nullptr) {
+                return;
+            }
+            if (!sequential) {
+                sequential_blocks_ = 0;
+                prefetch_window_ = 0;
+                return;
+            }
+            sequential_blocks_ += 1;
+            if (sequential_blocks_ < kSequentialBlocksToPrefetch) {
+                return;
+            }
+            if (prefetch_window_ == 0) {
+                prefetch_window_ = 1;
+            } else {
+                prefetch_window_ = std::min(prefetch_window_ * 2,
+                                            prefetcher_->max_window());
+            }
+            prefetcher_->Prefetch(index_iter_.key(), prefetch_window_);
+        }
+
         void TwoLevelIterator::MergingDataBlocksForward() {
             while (data_iter_.iter() == nullptr || !data_iter_.Valid()) {
                 // Move to next block
@@ -254,7 +300,7 @@ namespace leveldb {
                     return;
                 }
                 index_iter_.Next();
-                InitDataBlock(nullptr);
+                InitDataBlock(nullptr, true);
             }
         }
 
@@ -278,10 +324,12 @@ namespace leveldb {
                         BlockReadContext context,
                         BlockFunction block_function, void *arg, void *arg2,
                         const ReadOptions &options,
-                        const Comparator *comparator, bool merging) {
+                        const Comparator *comparator, bool merging,
+                        BlockPrefetcher *prefetcher) {
         return new TwoLevelIterator(index_iter, context,
                                     block_function,
-                                    arg, arg2, options, comparator, merging);
+                                    arg, arg2, options, comparator, merging,
+                                    prefetcher);
     }
 
 }  // namespace leveldb
@@ -13,6 +13,22 @@ namespace leveldb {
 
     struct ReadOptions;
 
+// Reads the blocks of a two-level iterator ahead of a sequential scan.
+    class BlockPrefetcher {
+    public:
+        virtual ~BlockPrefetcher() = default;
+
+        // Start reading up to "window" blocks that follow the block at
+        // "index_key" in the background.
+        virtual void Prefetch(const Slice &index_key, uint32_t window) = 0;
+
+        // Wait for the block at "index_value" if it is being prefetched.
+        virtual void Complete(const Slice &index_value) = 0;
+
+        // The maximum number of blocks to read ahead.
+        virtual uint32_t max_window() const = 0;
+    };
+
 // Return a new two level iterator.  A two-level iterator contains an
 // index iterator whose values point to a sequence of blocks where
 // each block is itself a sequence of key,value pairs.  The returned
@@ -22,6 +38,11 @@ namespace leveldb {
 //
 // Uses a supplied function to convert an index_iter value into
 // an iterator over the contents of the corresponding block.
+//
+// If "prefetcher" is non-null, the iterator reads the following blocks
+// ahead once it moves forward across consecutive blocks. The window
+// doubles on every further block and is reset when the iterator seeks.
+// Takes ownership of "prefetcher".
     Iterator *NewTwoLevelIterator(
             Iterator *index_iter,
             BlockReadContext context,
@@ -32,7 +53,8 @@ namespace leveldb {
                                         const Slice &index_value,
                                         std::string* next_key),
             void *arg, void *arg2, const ReadOptions &options,
-            const Comparator *comparator = nullptr, bool merging = false);
+            const Comparator *comparator = nullptr, bool merging = false,
+            BlockPrefetcher *prefetcher = nullptr);
 
 }  // namespace leveldb
 
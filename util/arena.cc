@@ -4,6 +4,8 @@
 
 #include "util/arena.h"
 
+#include <thread>
+
 namespace leveldb {
 
     static const int kBlockSize = 4096;
@@ -57,10 +59,39 @@ namespace leveldb {
         return result;
     }
 
+    char *Arena::AllocateAlignedConcurrent(size_t bytes) {
+        const int align = (sizeof(void *) > 8) ? sizeof(void *) : 8;
+        // Round up so that the shards always hand out aligned memory.
+        bytes = (bytes + align - 1) & ~(size_t) (align - 1);
+        if (bytes > kShardBlockSize / 4) {
+            std::lock_guard<std::mutex> l(mutex_);
+            return AllocateAligned(bytes);
+        }
+
+        Shard *shard = &shards_[std::hash<std::thread::id>{}(
+                std::this_thread::get_id()) % kNumShards];
+        while (shard->lock.test_and_set(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+        if (bytes > shard->alloc_bytes_remaining) {
+            // We waste the remaining space of the shard.
+            std::lock_guard<std::mutex> l(mutex_);
+            shard->alloc_ptr = AllocateAligned(kShardBlockSize);
+            shard->alloc_bytes_remaining = kShardBlockSize;
+        }
+        char *result = shard->alloc_ptr;
+        shard->alloc_ptr += bytes;
+        shard->alloc_bytes_remaining -= bytes;
+        shard->lock.clear(std::memory_order_release);
+        assert((reinterpret_cast<uintptr_t>(result) & (align - 1)) == 0);
+        return result;
+    }
+
     char *Arena::AllocateNewBlock(size_t block_bytes) {
         char *result = new char[block_bytes];
         blocks_.push_back(result);
-        memory_usage_+= (block_bytes + sizeof(char *));
+        memory_usage_.fetch_add(block_bytes + sizeof(char *),
+                                std::memory_order_relaxed);
         return result;
     }
 
@@ -9,6 +9,7 @@
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
+#include <mutex>
 #include <vector>
 
 namespace leveldb {
@@ -29,13 +30,30 @@ namespace leveldb {
         // Allocate memory with the normal alignment guarantees provided by malloc.
         char *AllocateAligned(size_t bytes);
 
+        // Thread-safe variant of AllocateAligned(). Allocations are served
+        // from per-core shards that refill from the arena under a mutex.
+        // REQUIRES: All allocations of the arena use this method while
+        // there are concurrent writers.
+        char *AllocateAlignedConcurrent(size_t bytes);
+
         // Returns an estimate of the total memory usage of data allocated
         // by the arena.
         size_t MemoryUsage() const {
-            return memory_usage_;
+            return memory_usage_.load(std::memory_order_relaxed);
         }
 
     private:
+        enum {
+            kNumShards = 8,
+            kShardBlockSize = 16384
+        };
+
+        struct alignas(64) Shard {
+            std::atomic_flag lock = ATOMIC_FLAG_INIT;
+            char *alloc_ptr = nullptr;
+            size_t alloc_bytes_remaining = 0;
+        };
+
         char *AllocateFallback(size_t bytes);
 
         char *AllocateNewBlock(size_t block_bytes);
@@ -51,7 +69,11 @@ namespace leveldb {
         //
         // TODO(costan): This member is accessed via atomics, but the others are
         //               accessed without any locking. Is this OK?
-        size_t memory_usage_ = 0;
+        std::atomic<size_t> memory_usage_;
+
+        // Protects the allocation state above for concurrent allocations.
+        std::mutex mutex_;
+        Shard shards_[kNumShards];
     };
 
     inline char *Arena::Allocate(size_t bytes) {
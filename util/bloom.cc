@@ -4,6 +4,12 @@
 
 #include "leveldb/filter_policy.h"
 
+#include <algorithm>
+#include <cstring>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
 #include "leveldb/slice.h"
 #include "util/hash.h"
 
@@ -14,14 +20,18 @@ namespace leveldb {
             return Hash(key.data(), key.size(), 0xbc9f1d34);
         }
 
+        static size_t NumProbes(int bits_per_key) {
+            // We intentionally round down to reduce probing cost a little bit
+            size_t k = static_cast<size_t>(bits_per_key * 0.69);  // 0.69 =~ ln(2)
+            if (k < 1) k = 1;
+            if (k > 30) k = 30;
+            return k;
+        }
+
         class BloomFilterPolicy : public FilterPolicy {
         public:
             explicit BloomFilterPolicy(int bits_per_key) : bits_per_key_(
                     bits_per_key) {
-                // We intentionally round down to reduce probing cost a little bit
-                k_ = static_cast<size_t>(bits_per_key * 0.69);  // 0.69 =~ ln(2)
-                if (k_ < 1) k_ = 1;
-                if (k_ > 30) k_ = 30;
             }
 
             const char *
@@ -29,8 +39,15 @@ namespace leveldb {
 
             void CreateFilter(const Slice *keys, int n,
                               std::string *dst) const override {
+                CreateFilterWithBitsPerKey(keys, n, bits_per_key_, dst);
+            }
+
+            void CreateFilterWithBitsPerKey(const Slice *keys, int n,
+                                            int bits_per_key,
+                                            std::string *dst) const override {
+                const size_t k = NumProbes(bits_per_key);
                 // Compute bloom filter size (in both bits and bytes)
-                size_t bits = n * bits_per_key_;
+                size_t bits = n * bits_per_key;
 
                 // For small n, we can see a very high false positive rate.  Fix it
                 // by enforcing a minimum bloom filter length.
@@ -42,7 +59,7 @@ namespace leveldb {
                 const size_t init_size = dst->size();
                 dst->resize(init_size + bytes, 0);
                 dst->push_back(
-                        static_cast<char>(k_));  // Remember # of probes in filter
+                        static_cast<char>(k));  // Remember # of probes in filter
                 char *array = &(*dst)[init_size];
                 for (int i = 0; i < n; i++) {
                     // Use double-hashing to generate a sequence of hash values.
@@ -50,7 +67,7 @@ namespace leveldb {
                     uint32_t h = BloomHash(keys[i]);
                     const uint32_t delta =
                             (h >> 17) | (h << 15);  // Rotate right 17 bits
-                    for (size_t j = 0; j < k_; j++) {
+                    for (size_t j = 0; j < k; j++) {
                         const uint32_t bitpos = h % bits;
                         array[bitpos / 8] |= (1 << (bitpos % 8));
                         h += delta;
@@ -89,7 +106,150 @@ namespace leveldb {
 
         private:
             size_t bits_per_key_;
-            size_t k_;
+        };
+
+        // Bits and bytes of a block of the blocked bloom filter. A block is
+        // one cache line.
+        static const size_t kBlockBits = 512;
+        static const size_t kBlockBytes = kBlockBits / 8;
+        static const size_t kBlockWords = kBlockBytes / 8;
+
+        // The block is selected with the hash of the key. The probes within
+        // the block use the upper 9 bits of a remixed hash.
+        static uint32_t BlockedBloomBlock(uint32_t h, size_t nblocks) {
+            return static_cast<uint32_t>(
+                    (static_cast<uint64_t>(h) * nblocks) >> 32);
+        }
+
+        static uint32_t BlockedBloomRemix(uint32_t h) {
+            return h * 0x9e3779b9u;
+        }
+
+        // Set the bits of the probes of hash "h" in "mask".
+        static void BlockedBloomMask(uint32_t h, size_t k,
+                                     uint64_t mask[kBlockWords]) {
+            uint32_t g = BlockedBloomRemix(h);
+            const uint32_t delta = (g >> 17) | (g << 15);  // Rotate right 17 bits
+            for (size_t i = 0; i < kBlockWords; i++) {
+                mask[i] = 0;
+            }
+            for (size_t j = 0; j < k; j++) {
+                const uint32_t bitpos = g >> 23;
+                mask[bitpos / 64] |= (1ull << (bitpos % 64));
+                g += delta;
+            }
+        }
+
+#if defined(__x86_64__)
+        // Compiled for AVX2 regardless of the build flags. Only called if
+        // the CPU supports AVX2.
+        __attribute__((target("avx2")))
+        static bool BlockedBloomMatchAVX2(const char *block,
+                                          const uint64_t mask[kBlockWords]) {
+            const __m256i m0 = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i *>(mask));
+            const __m256i m1 = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i *>(mask + 4));
+            const __m256i b0 = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i *>(block));
+            const __m256i b1 = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i *>(block + 32));
+            // testc returns 1 if all bits of the mask are set in the block.
+            return _mm256_testc_si256(b0, m0) && _mm256_testc_si256(b1, m1);
+        }
+
+        static bool CPUHasAVX2() {
+            static const bool has_avx2 = []() {
+                __builtin_cpu_init();
+                return __builtin_cpu_supports("avx2") != 0;
+            }();
+            return has_avx2;
+        }
+#endif
+
+        // Returns true if all bits of "mask" are set in "block".
+        static bool BlockedBloomMatch(const char *block,
+                                      const uint64_t mask[kBlockWords]) {
+#if defined(__x86_64__)
+            if (CPUHasAVX2()) {
+                return BlockedBloomMatchAVX2(block, mask);
+            }
+#endif
+            // Branch-free so that the compiler vectorizes the loop.
+            uint64_t missing = 0;
+            for (size_t i = 0; i < kBlockWords; i++) {
+                uint64_t word;
+                memcpy(&word, block + i * 8, sizeof(word));
+                missing |= mask[i] & ~word;
+            }
+            return missing == 0;
+        }
+
+        // A bloom filter that keeps all probes of a key in one cache line.
+        // The filter is an array of 64-byte blocks followed by the number of
+        // probes.
+        class BlockedBloomFilterPolicy : public FilterPolicy {
+        public:
+            explicit BlockedBloomFilterPolicy(int bits_per_key)
+                    : bits_per_key_(bits_per_key) {
+            }
+
+            const char *
+            Name() const override { return "leveldb.BlockedBloomFilter"; }
+
+            void CreateFilter(const Slice *keys, int n,
+                              std::string *dst) const override {
+                CreateFilterWithBitsPerKey(keys, n, bits_per_key_, dst);
+            }
+
+            void CreateFilterWithBitsPerKey(const Slice *keys, int n,
+                                            int bits_per_key,
+                                            std::string *dst) const override {
+                const size_t k = NumProbes(bits_per_key);
+                size_t bits = n * bits_per_key;
+                const size_t nblocks = std::max<size_t>(
+                        (bits + kBlockBits - 1) / kBlockBits, 1);
+
+                const size_t init_size = dst->size();
+                dst->resize(init_size + nblocks * kBlockBytes, 0);
+                dst->push_back(static_cast<char>(k));
+                char *array = &(*dst)[init_size];
+                uint64_t mask[kBlockWords];
+                for (int i = 0; i < n; i++) {
+                    const uint32_t h = BloomHash(keys[i]);
+                    char *block =
+                            array + BlockedBloomBlock(h, nblocks) * kBlockBytes;
+                    BlockedBloomMask(h, k, mask);
+                    for (size_t w = 0; w < kBlockWords; w++) {
+                        uint64_t word;
+                        memcpy(&word, block + w * 8, sizeof(word));
+                        word |= mask[w];
+                        memcpy(block + w * 8, &word, sizeof(word));
+                    }
+                }
+            }
+
+            bool KeyMayMatch(const Slice &key,
+                             const Slice &bloom_filter) const override {
+                const size_t len = bloom_filter.size();
+                if (len < kBlockBytes + 1) return false;
+
+                const char *array = bloom_filter.data();
+                const size_t nblocks = (len - 1) / kBlockBytes;
+                const size_t k = array[len - 1];
+                if (k > 30) {
+                    return true;
+                }
+                const uint32_t h = BloomHash(key);
+                uint64_t mask[kBlockWords];
+                BlockedBloomMask(h, k, mask);
+                return BlockedBloomMatch(
+                        array + BlockedBloomBlock(h, nblocks) * kBlockBytes,
+                        mask);
+            }
+
+        private:
+            size_t bits_per_key_;
         };
     }  // namespace
 
@@ -97,4 +257,8 @@ namespace leveldb {
         return new BloomFilterPolicy(bits_per_key);
     }
 
+    const FilterPolicy *NewBlockedBloomFilterPolicy(int bits_per_key) {
+        return new BlockedBloomFilterPolicy(bits_per_key);
+    }
+
 }  // namespace leveldb
@@ -23,6 +23,8 @@ namespace leveldb {
     public:
         BloomTest() : policy_(NewBloomFilterPolicy(10)) {}
 
+        explicit BloomTest(const FilterPolicy *policy) : policy_(policy) {}
+
         ~BloomTest() { delete policy_; }
 
         void Reset() {
@@ -32,15 +34,21 @@ namespace leveldb {
 
         void Add(const Slice &s) { keys_.push_back(s.ToString()); }
 
-        void Build() {
+        void Build(int bits_per_key = 0) {
             std::vector<Slice> key_slices;
             for (size_t i = 0; i < keys_.size(); i++) {
                 key_slices.push_back(Slice(keys_[i]));
             }
             filter_.clear();
-            policy_->CreateFilter(&key_slices[0],
-                                  static_cast<int>(key_slices.size()),
-                                  &filter_);
+            if (bits_per_key > 0) {
+                policy_->CreateFilterWithBitsPerKey(&key_slices[0],
+                                                    static_cast<int>(key_slices.size()),
+                                                    bits_per_key, &filter_);
+            } else {
+                policy_->CreateFilter(&key_slices[0],
+                                      static_cast<int>(key_slices.size()),
+                                      &filter_);
+            }
             keys_.clear();
             if (kVerbose >= 2) DumpFilter();
         }
@@ -154,6 +162,90 @@ namespace leveldb {
 
 // Different bits-per-byte
 
+    TEST(BloomTest, BitsPerKey) {
+        char buffer[sizeof(int)];
+        double last_rate = 1.0;
+        for (int bits_per_key : {6, 10, 16}) {
+            Reset();
+            for (int i = 0; i < 10000; i++) {
+                Add(Key(i, buffer));
+            }
+            Build(bits_per_key);
+            ASSERT_LE(FilterSize(),
+                      static_cast<size_t>((10000 * bits_per_key / 8) + 40));
+            for (int i = 0; i < 10000; i++) {
+                ASSERT_TRUE(Matches(Key(i, buffer)));
+            }
+            double rate = FalsePositiveRate();
+            ASSERT_LT(rate, last_rate);
+            last_rate = rate;
+        }
+    }
+
+    class BlockedBloomTest : public BloomTest {
+    public:
+        BlockedBloomTest() : BloomTest(NewBlockedBloomFilterPolicy(10)) {}
+    };
+
+    TEST(BlockedBloomTest, BlockedEmptyFilter) {
+        ASSERT_TRUE(!Matches("hello"));
+        ASSERT_TRUE(!Matches("world"));
+    }
+
+    TEST(BlockedBloomTest, BlockedSmall) {
+        Add("hello");
+        Add("world");
+        ASSERT_TRUE(Matches("hello"));
+        ASSERT_TRUE(Matches("world"));
+        ASSERT_TRUE(!Matches("x"));
+        ASSERT_TRUE(!Matches("foo"));
+    }
+
+    TEST(BlockedBloomTest, BlockedVaryingLengths) {
+        char buffer[sizeof(int)];
+        for (int length = 1; length <= 10000; length = NextLength(length)) {
+            Reset();
+            for (int i = 0; i < length; i++) {
+                Add(Key(i, buffer));
+            }
+            Build();
+
+            // A filter is at least one 64-byte block.
+            ASSERT_LE(FilterSize(),
+                      static_cast<size_t>((length * 10 / 8) + 64 + 1))
+                    << length;
+            for (int i = 0; i < length; i++) {
+                ASSERT_TRUE(Matches(Key(i, buffer)))
+                        << "Length " << length << "; key " << i;
+            }
+            double rate = FalsePositiveRate();
+            if (kVerbose >= 1) {
+                fprintf(stderr,
+                        "False positives: %5.2f%% @ length = %6d ; bytes = %6d\n",
+                        rate * 100.0, length, static_cast<int>(FilterSize()));
+            }
+            ASSERT_LE(rate, 0.02);  // Must not be over 2%
+        }
+    }
+
+    TEST(BlockedBloomTest, BlockedBitsPerKey) {
+        char buffer[sizeof(int)];
+        double last_rate = 1.0;
+        for (int bits_per_key : {6, 10, 16}) {
+            Reset();
+            for (int i = 0; i < 10000; i++) {
+                Add(Key(i, buffer));
+            }
+            Build(bits_per_key);
+            for (int i = 0; i < 10000; i++) {
+                ASSERT_TRUE(Matches(Key(i, buffer)));
+            }
+            double rate = FalsePositiveRate();
+            ASSERT_LT(rate, last_rate);
+            last_rate = rate;
+        }
+    }
+
 }  // namespace leveldb
 
 nova::NovaGlobalVariables nova::NovaGlobalVariables::global;
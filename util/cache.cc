@@ -36,6 +36,15 @@ namespace leveldb {
 // Elements are moved between these lists by the Ref() and Unref() methods,
 // when they detect an element in the cache acquiring or losing its only
 // external reference.
+//
+// A segmented LRU cache splits the LRU list into a probationary and a
+// protected segment. New entries enter the probationary segment. An entry
+// that is hit again moves to the protected segment, which holds up to a
+// fraction of the capacity; its oldest entries are demoted back to the
+// probationary segment. Eviction takes the probationary segment first, so a
+// scan that reads every block once cannot evict the protected entries.
+// Low priority entries enter at the oldest end of the probationary segment
+// and are not promoted by their first hit.
 
 // An entry is a variable length heap-allocated structure.  Entries
 // are kept in a circular doubly linked list ordered by access time.
@@ -50,6 +59,8 @@ namespace leveldb {
             size_t charge;  // TODO(opt): Only allow uint32_t?
             size_t key_length;
             bool in_cache;     // Whether entry is in the cache.
+            bool is_protected; // Whether entry is in the protected segment.
+            bool low_priority; // Whether entry was inserted at low priority.
             uint32_t refs;     // References, including cache reference, if present.
             uint32_t hash;     // Hash of key(); used for fast sharding and comparisons
             char key_data[1];  // Beginning of key
@@ -160,6 +171,11 @@ namespace leveldb {
             // Separate from constructor so caller can easily make an array of LRUCache
             void SetCapacity(size_t capacity) { capacity_ = capacity; }
 
+            // Bytes of the protected segment. 0 disables segmentation.
+            void SetProtectedCapacity(size_t capacity) {
+                protected_capacity_ = capacity;
+            }
+
             size_t GetCapacity() const {
                 return capacity_;
             }
@@ -168,7 +184,8 @@ namespace leveldb {
             Cache::Handle *Insert(const Slice &key, uint32_t hash, void *value,
                                   size_t charge,
                                   void (*deleter)(const Slice &key,
-                                                  void *value));
+                                                  void *value),
+                                  Cache::Priority priority);
 
             Cache::Handle *Lookup(const Slice &key, uint32_t hash);
 
@@ -192,20 +209,30 @@ namespace leveldb {
 
             void Unref(LRUHandle *e);
 
+            // Move "e" to the protected segment and demote the oldest
+            // protected entries that no longer fit.
+            void Promote(LRUHandle *e) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
             bool FinishErase(LRUHandle *e) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
             // Initialized before use.
             size_t capacity_;
+            size_t protected_capacity_;
 
             // mutex_ protects the following state.
             mutable port::Mutex mutex_;
             size_t usage_ GUARDED_BY(mutex_);
+            size_t protected_usage_ GUARDED_BY(mutex_);
 
             // Dummy head of LRU list.
             // lru.prev is newest entry, lru.next is oldest entry.
             // Entries have refs==1 and in_cache==true.
             LRUHandle lru_ GUARDED_BY(mutex_);
 
+            // Dummy head of the protected segment of the LRU list.
+            // Entries have refs==1, in_cache==true and is_protected==true.
+            LRUHandle protected_ GUARDED_BY(mutex_);
+
             // Dummy head of in-use list.
             // Entries are in use by clients, and have refs >= 2 and in_cache==true.
             LRUHandle in_use_ GUARDED_BY(mutex_);
@@ -213,10 +240,13 @@ namespace leveldb {
             HandleTable table_ GUARDED_BY(mutex_);
         };
 
-        LRUCache::LRUCache() : capacity_(0), usage_(0) {
+        LRUCache::LRUCache() : capacity_(0), protected_capacity_(0),
+                               usage_(0), protected_usage_(0) {
             // Make empty circular linked lists.
             lru_.next = &lru_;
             lru_.prev = &lru_;
+            protected_.next = &protected_;
+            protected_.prev = &protected_;
             in_use_.next = &in_use_;
             in_use_.prev = &in_use_;
         }
@@ -224,13 +254,15 @@ namespace leveldb {
         LRUCache::~LRUCache() {
             assert(in_use_.next ==
                    &in_use_);  // Error if caller has an unreleased handle
-            for (LRUHandle *e = lru_.next; e != &lru_;) {
-                LRUHandle *next = e->next;
-                assert(e->in_cache);
-                e->in_cache = false;
-                assert(e->refs == 1);  // Invariant of lru_ list.
-                Unref(e);
-                e = next;
+            for (LRUHandle *list : {&lru_, &protected_}) {
+                for (LRUHandle *e = list->next; e != list;) {
+                    LRUHandle *next = e->next;
+                    assert(e->in_cache);
+                    e->in_cache = false;
+                    assert(e->refs == 1);  // Invariant of lru_ list.
+                    Unref(e);
+                    e = next;
+                }
             }
         }
 
@@ -253,7 +285,28 @@ namespace leveldb {
             } else if (e->in_cache && e->refs == 1) {
                 // No longer in use; move to lru_ list.
                 LRU_Remove(e);
-                LRU_Append(&lru_, e);
+                if (e->is_protected) {
+                    LRU_Append(&protected_, e);
+                } else if (e->low_priority) {
+                    // Make "e" the oldest entry.
+                    LRU_Append(lru_.next, e);
+                } else {
+                    LRU_Append(&lru_, e);
+                }
+            }
+        }
+
+        void LRUCache::Promote(LRUHandle *e) {
+            e->is_protected = true;
+            protected_usage_ += e->charge;
+            while (protected_usage_ > protected_capacity_ &&
+                   protected_.next != &protected_) {
+                LRUHandle *old = protected_.next;
+                assert(old->refs == 1);
+                LRU_Remove(old);
+                old->is_protected = false;
+                protected_usage_ -= old->charge;
+                LRU_Append(&lru_, old);
             }
         }
 
@@ -275,6 +328,11 @@ namespace leveldb {
             LRUHandle *e = table_.Lookup(key, hash);
             if (e != nullptr) {
                 Ref(e);
+                if (e->low_priority) {
+                    e->low_priority = false;
+                } else if (protected_capacity_ > 0 && !e->is_protected) {
+                    Promote(e);
+                }
             }
             return reinterpret_cast<Cache::Handle *>(e);
         }
@@ -288,7 +346,8 @@ namespace leveldb {
         LRUCache::Insert(const Slice &key, uint32_t hash, void *value,
                          size_t charge,
                          void (*deleter)(const Slice &key,
-                                         void *value)) {
+                                         void *value),
+                         Cache::Priority priority) {
             MutexLock l(&mutex_);
 
             LRUHandle *e =
@@ -300,6 +359,8 @@ namespace leveldb {
             e->key_length = key.size();
             e->hash = hash;
             e->in_cache = false;
+            e->is_protected = false;
+            e->low_priority = priority == Cache::Priority::kLow;
             e->refs = 1;  // for the returned handle.
             memcpy(e->key_data, key.data(), key.size());
 
@@ -313,8 +374,11 @@ namespace leveldb {
                 // next is read by key() in an assert, so it must be initialized
                 e->next = nullptr;
             }
-            while (usage_ > capacity_ && lru_.next != &lru_) {
-                LRUHandle *old = lru_.next;
+            while (usage_ > capacity_ &&
+                   (lru_.next != &lru_ || protected_.next != &protected_)) {
+                // Evict from the probationary segment first.
+                LRUHandle *old =
+                        lru_.next != &lru_ ? lru_.next : protected_.next;
                 assert(old->refs == 1);
                 bool erased = FinishErase(table_.Remove(old->key(), old->hash));
                 if (!erased) {  // to avoid unused variable when compiled NDEBUG
@@ -332,6 +396,10 @@ namespace leveldb {
                 LRU_Remove(e);
                 e->in_cache = false;
                 usage_ -= e->charge;
+                if (e->is_protected) {
+                    e->is_protected = false;
+                    protected_usage_ -= e->charge;
+                }
                 Unref(e);
             }
             return e != nullptr;
@@ -344,22 +412,29 @@ namespace leveldb {
 
         void LRUCache::Prune() {
             MutexLock l(&mutex_);
-            while (lru_.next != &lru_) {
-                LRUHandle *e = lru_.next;
-                assert(e->refs == 1);
-                bool erased = FinishErase(table_.Remove(e->key(), e->hash));
-                if (!erased) {  // to avoid unused variable when compiled NDEBUG
-                    assert(erased);
+            for (LRUHandle *list : {&lru_, &protected_}) {
+                while (list->next != list) {
+                    LRUHandle *e = list->next;
+                    assert(e->refs == 1);
+                    bool erased = FinishErase(table_.Remove(e->key(), e->hash));
+                    if (!erased) {  // to avoid unused variable when compiled NDEBUG
+                        assert(erased);
+                    }
                 }
             }
         }
 
         static const int kNumShardBits = 8;
         static const int kNumShards = 1 << kNumShardBits;
+        // A small cache uses fewer shards so that each shard holds at least
+        // kMinShardCapacity and evicts close to LRU order of the cache.
+        static const size_t kMinShardCapacity = 64;
 
         class ShardedLRUCache : public Cache {
         private:
             LRUCache shard_[kNumShards];
+            int num_shard_bits_;
+            int num_shards_;
             port::Mutex id_mutex_;
             uint64_t last_id_;
 
@@ -367,16 +442,27 @@ namespace leveldb {
                 return Hash(s.data(), s.size(), 0);
             }
 
-            static uint32_t Shard(uint32_t hash) {
-                return hash >> (32 - kNumShardBits);
+            uint32_t Shard(uint32_t hash) const {
+                if (num_shard_bits_ == 0) {
+                    return 0;
+                }
+                return hash >> (32 - num_shard_bits_);
             }
 
         public:
-            explicit ShardedLRUCache(size_t capacity) : last_id_(0) {
+            ShardedLRUCache(size_t capacity, double protected_ratio)
+                    : num_shard_bits_(kNumShardBits), last_id_(0) {
+                while (num_shard_bits_ > 0 &&
+                       (capacity >> num_shard_bits_) < kMinShardCapacity) {
+                    num_shard_bits_--;
+                }
+                num_shards_ = 1 << num_shard_bits_;
                 const size_t per_shard =
-                        (capacity + (kNumShards - 1)) / kNumShards;
-                for (int s = 0; s < kNumShards; s++) {
+                        (capacity + (num_shards_ - 1)) / num_shards_;
+                for (int s = 0; s < num_shards_; s++) {
                     shard_[s].SetCapacity(per_shard);
+                    shard_[s].SetProtectedCapacity(
+                            static_cast<size_t>(per_shard * protected_ratio));
                 }
             }
 
@@ -385,9 +471,15 @@ namespace leveldb {
             Handle *Insert(const Slice &key, void *value, size_t charge,
                            void (*deleter)(const Slice &key,
                                            void *value)) override {
+                return Insert(key, value, charge, deleter, Priority::kHigh);
+            }
+
+            Handle *Insert(const Slice &key, void *value, size_t charge,
+                           void (*deleter)(const Slice &key, void *value),
+                           Priority priority) override {
                 const uint32_t hash = HashSlice(key);
                 return shard_[Shard(hash)].Insert(key, hash, value, charge,
-                                                  deleter);
+                                                  deleter, priority);
             }
 
             Handle *Lookup(const Slice &key) override {
@@ -415,14 +507,14 @@ namespace leveldb {
             }
 
             void Prune() override {
-                for (int s = 0; s < kNumShards; s++) {
+                for (int s = 0; s < num_shards_; s++) {
                     shard_[s].Prune();
                 }
             }
 
             size_t TotalCharge() const override {
                 size_t total = 0;
-                for (int s = 0; s < kNumShards; s++) {
+                for (int s = 0; s < num_shards_; s++) {
                     total += shard_[s].TotalCharge();
                 }
                 return total;
@@ -430,7 +522,7 @@ namespace leveldb {
 
             size_t TotalCapacity() const override {
                 size_t total = 0;
-                for (int s = 0; s < kNumShards; s++) {
+                for (int s = 0; s < num_shards_; s++) {
                     total += shard_[s].GetCapacity();
                 }
                 return total;
@@ -440,7 +532,12 @@ namespace leveldb {
     }  // end anonymous namespace
 
     Cache *NewLRUCache(size_t capacity) {
-        return new ShardedLRUCache(capacity);
+        return new ShardedLRUCache(capacity, 0);
+    }
+
+    Cache *NewSegmentedLRUCache(size_t capacity, double protected_ratio) {
+        assert(protected_ratio > 0 && protected_ratio < 1);
+        return new ShardedLRUCache(capacity, protected_ratio);
     }
 
 }  // namespace leveldb
@@ -229,6 +229,58 @@ namespace leveldb {
         ASSERT_EQ(-1, Lookup(1));
     }
 
+    TEST(CacheTest, LowPriorityEvictedFirst) {
+        delete cache_;
+        cache_ = NewLRUCache(100000);
+
+        for (int i = 0; i < 1000; i++) {
+            Insert(i, i + 1);
+        }
+        // A scan inserts many entries at low priority.
+        for (int i = 1000; i < 201000; i++) {
+            cache_->Release(cache_->Insert(EncodeKey(i), EncodeValue(i + 1), 1,
+                                           &CacheTest::Deleter,
+                                           Cache::Priority::kLow));
+        }
+        for (int i = 0; i < 1000; i++) {
+            ASSERT_EQ(i + 1, Lookup(i));
+        }
+    }
+
+    TEST(CacheTest, SegmentedLRUScanResistance) {
+        delete cache_;
+        cache_ = NewSegmentedLRUCache(100000, 0.5);
+
+        // Hit the hot entries once so that they become protected.
+        for (int i = 0; i < 1000; i++) {
+            Insert(i, i + 1);
+            ASSERT_EQ(i + 1, Lookup(i));
+        }
+        // A scan reads many entries once.
+        for (int i = 1000; i < 201000; i++) {
+            Insert(i, i + 1);
+        }
+        for (int i = 0; i < 1000; i++) {
+            ASSERT_EQ(i + 1, Lookup(i));
+        }
+        ASSERT_LE(cache_->TotalCharge(), cache_->TotalCapacity());
+    }
+
+    TEST(CacheTest, SegmentedLRUDemotion) {
+        delete cache_;
+        cache_ = NewSegmentedLRUCache(kCacheSize, 0.5);
+
+        // Promote more entries than the protected segment holds. The demoted
+        // entries are evicted once the cache is full.
+        for (int i = 0; i < 2 * kCacheSize; i++) {
+            Insert(i, i + 1);
+            Lookup(i);
+        }
+        ASSERT_LE(cache_->TotalCharge(), cache_->TotalCapacity());
+        ASSERT_EQ(-1, Lookup(0));
+        ASSERT_EQ(2 * kCacheSize, Lookup(2 * kCacheSize - 1));
+    }
+
 }  // namespace leveldb
 
 int main(int argc, char **argv) { return leveldb::test::RunAllTests(); }
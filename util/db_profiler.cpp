@@ -6,6 +6,8 @@
 
 #include "leveldb/db_profiler.h"
 
+#include <fmt/core.h>
+
 namespace leveldb {
     DBProfiler::DBProfiler(bool enabled, std::string trace_file_path)
             : enabled_(enabled), trace_file_path_(trace_file_path),
@@ -15,6 +17,31 @@ namespace leveldb {
                       trace_file_path + "/compaction_profiler.log") {
 //        accesses_ = new Access[WRITE_BATCH_SIZE];
         tracing_ = false;
+        for (int i = 0; i < NUM_ACCESS_CALLERS; i++) {
+            block_cache_lookups_[i] = 0;
+            block_cache_hits_[i] = 0;
+        }
+    }
+
+    void DBProfiler::RecordBlockCacheAccess(AccessCaller caller, bool hit) {
+        block_cache_lookups_[caller].fetch_add(1, std::memory_order_relaxed);
+        if (hit) {
+            block_cache_hits_[caller].fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    std::string DBProfiler::BlockCacheStats() const {
+        std::string stats;
+        for (int i = 0; i < NUM_ACCESS_CALLERS; i++) {
+            uint64_t lookups = block_cache_lookups_[i];
+            if (lookups == 0) {
+                continue;
+            }
+            uint64_t hits = block_cache_hits_[i];
+            stats += fmt::format("{},{},{},{:.4f}\n", i, lookups, hits,
+                                 (double) hits / (double) lookups);
+        }
+        return stats;
     }
 
     void DBProfiler::Trace(Access access) {
@@ -169,6 +169,8 @@ namespace leveldb {
         Status Flush() override;
 
         Status Sync() override;
+
+        int fd() override { return fd_; }
     private:
         Status WriteUnbuffered(const char *data, size_t size);
 
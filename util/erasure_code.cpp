@@ -0,0 +1,301 @@
+//
+// Copyright (c) 2020 University of Southern California. All rights reserved.
+//
+
+#include "util/erasure_code.h"
+
+#include <assert.h>
+#include <string.h>
+#include <utility>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace leveldb {
+    namespace {
+        // GF(2^8) with the polynomial x^8 + x^4 + x^3 + x^2 + 1.
+        class GaloisField {
+        public:
+            GaloisField() {
+                uint32_t x = 1;
+                for (int i = 0; i < 255; i++) {
+                    exp_[i] = x;
+                    exp_[i + 255] = x;
+                    log_[x] = i;
+                    x <<= 1;
+                    if (x & 0x100) {
+                        x ^= 0x11d;
+                    }
+                }
+                log_[0] = 0;
+            }
+
+            uint8_t Mul(uint8_t a, uint8_t b) const {
+                if (a == 0 || b == 0) {
+                    return 0;
+                }
+                return exp_[log_[a] + log_[b]];
+            }
+
+            uint8_t Inv(uint8_t a) const {
+                assert(a != 0);
+                return exp_[255 - log_[a]];
+            }
+
+        private:
+            uint8_t exp_[510];
+            uint8_t log_[256];
+        };
+
+        const GaloisField &GF() {
+            static GaloisField gf;
+            return gf;
+        }
+
+#if defined(__x86_64__)
+        // The vector loops are compiled for their instruction sets with
+        // target attributes and chosen by the CPU at runtime. Each returns
+        // the number of bytes it processed.
+        struct CPUFeatures {
+            CPUFeatures() {
+                __builtin_cpu_init();
+                avx2 = __builtin_cpu_supports("avx2") != 0;
+                avx512bw = __builtin_cpu_supports("avx512f") != 0 &&
+                           __builtin_cpu_supports("avx512bw") != 0;
+            }
+
+            bool avx2;
+            bool avx512bw;
+        };
+
+        const CPUFeatures &CPU() {
+            static CPUFeatures features;
+            return features;
+        }
+
+        __attribute__((target("avx512f,avx512bw")))
+        size_t XorRegionAVX512(const char *src, char *dst, size_t n) {
+            size_t i = 0;
+            for (; i + 64 <= n; i += 64) {
+                __m512i s = _mm512_loadu_si512((const void *) (src + i));
+                __m512i d = _mm512_loadu_si512((const void *) (dst + i));
+                _mm512_storeu_si512((void *) (dst + i), _mm512_xor_si512(s, d));
+            }
+            return i;
+        }
+
+        __attribute__((target("avx2")))
+        size_t XorRegionAVX2(const char *src, char *dst, size_t n) {
+            size_t i = 0;
+            for (; i + 32 <= n; i += 32) {
+                __m256i s = _mm256_loadu_si256((const __m256i *) (src + i));
+                __m256i d = _mm256_loadu_si256((const __m256i *) (dst + i));
+                _mm256_storeu_si256((__m256i *) (dst + i),
+                                    _mm256_xor_si256(s, d));
+            }
+            return i;
+        }
+
+        __attribute__((target("avx512f,avx512bw")))
+        size_t GFMulXorAVX512(const uint8_t *low, const uint8_t *high,
+                              const uint8_t *s, uint8_t *d, size_t n) {
+            __m128i l = _mm_load_si128((const __m128i *) low);
+            __m128i h = _mm_load_si128((const __m128i *) high);
+            __m512i tlow = _mm512_broadcast_i32x4(l);
+            __m512i thigh = _mm512_broadcast_i32x4(h);
+            __m512i mask = _mm512_set1_epi8(0x0f);
+            size_t i = 0;
+            for (; i + 64 <= n; i += 64) {
+                __m512i x = _mm512_loadu_si512((const void *) (s + i));
+                __m512i lo = _mm512_and_si512(x, mask);
+                __m512i hi = _mm512_and_si512(_mm512_srli_epi16(x, 4), mask);
+                __m512i r = _mm512_xor_si512(_mm512_shuffle_epi8(tlow, lo),
+                                             _mm512_shuffle_epi8(thigh, hi));
+                __m512i y = _mm512_loadu_si512((const void *) (d + i));
+                _mm512_storeu_si512((void *) (d + i), _mm512_xor_si512(r, y));
+            }
+            return i;
+        }
+
+        __attribute__((target("avx2")))
+        size_t GFMulXorAVX2(const uint8_t *low, const uint8_t *high,
+                            const uint8_t *s, uint8_t *d, size_t n) {
+            __m128i l = _mm_load_si128((const __m128i *) low);
+            __m128i h = _mm_load_si128((const __m128i *) high);
+            __m256i tlow = _mm256_broadcastsi128_si256(l);
+            __m256i thigh = _mm256_broadcastsi128_si256(h);
+            __m256i mask = _mm256_set1_epi8(0x0f);
+            size_t i = 0;
+            for (; i + 32 <= n; i += 32) {
+                __m256i x = _mm256_loadu_si256((const __m256i *) (s + i));
+                __m256i lo = _mm256_and_si256(x, mask);
+                __m256i hi = _mm256_and_si256(_mm256_srli_epi16(x, 4), mask);
+                __m256i r = _mm256_xor_si256(_mm256_shuffle_epi8(tlow, lo),
+                                             _mm256_shuffle_epi8(thigh, hi));
+                __m256i y = _mm256_loadu_si256((const __m256i *) (d + i));
+                _mm256_storeu_si256((__m256i *) (d + i),
+                                    _mm256_xor_si256(r, y));
+            }
+            return i;
+        }
+#endif
+
+        void XorRegion(const char *src, char *dst, size_t n) {
+            size_t i = 0;
+#if defined(__x86_64__)
+            if (CPU().avx512bw) {
+                i = XorRegionAVX512(src, dst, n);
+            } else if (CPU().avx2) {
+                i = XorRegionAVX2(src, dst, n);
+            }
+#endif
+            for (; i + 8 <= n; i += 8) {
+                uint64_t s;
+                uint64_t d;
+                memcpy(&s, src + i, 8);
+                memcpy(&d, dst + i, 8);
+                d ^= s;
+                memcpy(dst + i, &d, 8);
+            }
+            for (; i < n; i++) {
+                dst[i] ^= src[i];
+            }
+        }
+    }
+
+    void GFMulXor(uint8_t c, const char *src, char *dst, size_t n) {
+        if (c == 0) {
+            return;
+        }
+        if (c == 1) {
+            XorRegion(src, dst, n);
+            return;
+        }
+        // c * x = c * (x & 0x0f) ^ c * (x & 0xf0). Both halves are looked up
+        // in 16-entry tables so that a byte shuffle multiplies 32 or 64
+        // bytes at a time.
+        const GaloisField &gf = GF();
+        alignas(16) uint8_t low[16];
+        alignas(16) uint8_t high[16];
+        for (uint32_t x = 0; x < 16; x++) {
+            low[x] = gf.Mul(c, x);
+            high[x] = gf.Mul(c, x << 4);
+        }
+        const uint8_t *s = reinterpret_cast<const uint8_t *>(src);
+        uint8_t *d = reinterpret_cast<uint8_t *>(dst);
+        size_t i = 0;
+#if defined(__x86_64__)
+        if (CPU().avx512bw) {
+            i = GFMulXorAVX512(low, high, s, d, n);
+        } else if (CPU().avx2) {
+            i = GFMulXorAVX2(low, high, s, d, n);
+        }
+#endif
+        for (; i < n; i++) {
+            d[i] ^= low[s[i] & 0x0f] ^ high[s[i] >> 4];
+        }
+    }
+
+    ErasureCoder::ErasureCoder(uint32_t k, uint32_t m) : k_(k), m_(m) {
+        assert(k >= 1 && m >= 1 && k + m <= 256);
+        const GaloisField &gf = GF();
+        parity_matrix_.resize(m * k);
+        for (uint32_t j = 0; j < m; j++) {
+            for (uint32_t i = 0; i < k; i++) {
+                if (m == 1) {
+                    parity_matrix_[j * k + i] = 1;
+                } else {
+                    // Cauchy matrix 1 / (x_j + y_i) with x_j = k + j and
+                    // y_i = i. All x_j and y_i are distinct.
+                    parity_matrix_[j * k + i] = gf.Inv((k + j) ^ i);
+                }
+            }
+        }
+    }
+
+    void ErasureCoder::Encode(const char *const *data,
+                              const size_t *data_sizes, size_t size,
+                              char **parity) const {
+        for (uint32_t j = 0; j < m_; j++) {
+            memset(parity[j], 0, size);
+            for (uint32_t i = 0; i < k_; i++) {
+                assert(data_sizes[i] <= size);
+                GFMulXor(coefficient(j, i), data[i], parity[j],
+                         data_sizes[i]);
+            }
+        }
+    }
+
+    bool ErasureCoder::Reconstruct(const char *const *fragments, size_t size,
+                                   uint32_t index, char *out) const {
+        assert(index < k_);
+        if (fragments[index]) {
+            memcpy(out, fragments[index], size);
+            return true;
+        }
+        // Pick k available fragments. Data fragments first since their rows
+        // are unit vectors.
+        std::vector<uint32_t> rows;
+        for (uint32_t f = 0; f < k_ + m_ && rows.size() < k_; f++) {
+            if (fragments[f]) {
+                rows.push_back(f);
+            }
+        }
+        if (rows.size() < k_) {
+            return false;
+        }
+        // The chosen rows of the generator matrix form A with
+        // A * data = fragments. Invert A with Gauss-Jordan elimination.
+        const GaloisField &gf = GF();
+        std::vector<uint8_t> a(k_ * k_, 0);
+        std::vector<uint8_t> inv(k_ * k_, 0);
+        for (uint32_t r = 0; r < k_; r++) {
+            uint32_t f = rows[r];
+            for (uint32_t i = 0; i < k_; i++) {
+                if (f < k_) {
+                    a[r * k_ + i] = (f == i) ? 1 : 0;
+                } else {
+                    a[r * k_ + i] = coefficient(f - k_, i);
+                }
+            }
+            inv[r * k_ + r] = 1;
+        }
+        for (uint32_t col = 0; col < k_; col++) {
+            uint32_t pivot = col;
+            while (pivot < k_ && a[pivot * k_ + col] == 0) {
+                pivot++;
+            }
+            if (pivot == k_) {
+                return false;
+            }
+            if (pivot != col) {
+                for (uint32_t i = 0; i < k_; i++) {
+                    std::swap(a[pivot * k_ + i], a[col * k_ + i]);
+                    std::swap(inv[pivot * k_ + i], inv[col * k_ + i]);
+                }
+            }
+            uint8_t scale = gf.Inv(a[col * k_ + col]);
+            for (uint32_t i = 0; i < k_; i++) {
+                a[col * k_ + i] = gf.Mul(a[col * k_ + i], scale);
+                inv[col * k_ + i] = gf.Mul(inv[col * k_ + i], scale);
+            }
+            for (uint32_t r = 0; r < k_; r++) {
+                uint8_t factor = a[r * k_ + col];
+                if (r == col || factor == 0) {
+                    continue;
+                }
+                for (uint32_t i = 0; i < k_; i++) {
+                    a[r * k_ + i] ^= gf.Mul(factor, a[col * k_ + i]);
+                    inv[r * k_ + i] ^= gf.Mul(factor, inv[col * k_ + i]);
+                }
+            }
+        }
+        // data[index] = sum over r of inv[index][r] * fragments[rows[r]].
+        memset(out, 0, size);
+        for (uint32_t r = 0; r < k_; r++) {
+            GFMulXor(inv[index * k_ + r], fragments[rows[r]], out, size);
+        }
+        return true;
+    }
+}
@@ -0,0 +1,62 @@
+//
+// Copyright (c) 2020 University of Southern California. All rights reserved.
+//
+
+#ifndef LEVELDB_ERASURE_CODE_H
+#define LEVELDB_ERASURE_CODE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace leveldb {
+
+    // Systematic Reed-Solomon code over GF(2^8) with k data fragments and m
+    // parity fragments. Any k of the k+m fragments reconstruct the data.
+    //
+    // With m=1 the parity is the XOR of the data fragments. With m>1 the
+    // parity rows form a Cauchy matrix so that every k x k submatrix of the
+    // generator matrix is invertible.
+    //
+    // Fragments may have different sizes. Bytes past the end of a data
+    // fragment are treated as zeros.
+    class ErasureCoder {
+    public:
+        // REQUIRES: k >= 1, m >= 1, k + m <= 256.
+        ErasureCoder(uint32_t k, uint32_t m);
+
+        uint32_t k() const { return k_; }
+
+        uint32_t m() const { return m_; }
+
+        // Compute the parity fragments of "size" bytes. data[i] has
+        // data_sizes[i] <= size bytes. parity[j] has "size" bytes.
+        void Encode(const char *const *data, const size_t *data_sizes,
+                    size_t size, char **parity) const;
+
+        // Reconstruct "size" bytes of data fragment "index" into "out".
+        // fragments[0, k) are the data fragments and fragments[k, k+m) are
+        // the parity fragments, all at the same offset and "size" bytes long.
+        // Bytes past the end of a short data fragment must be zeros. A
+        // fragment is nullptr if it is not available. Returns false if fewer
+        // than k fragments are available.
+        bool Reconstruct(const char *const *fragments, size_t size,
+                         uint32_t index, char *out) const;
+
+    private:
+        // Coefficient of data fragment i in parity fragment j.
+        uint8_t coefficient(uint32_t j, uint32_t i) const {
+            return parity_matrix_[j * k_ + i];
+        }
+
+        const uint32_t k_;
+        const uint32_t m_;
+        std::vector<uint8_t> parity_matrix_;
+    };
+
+    // dst[0, n) ^= c * src[0, n) over GF(2^8). Uses AVX-512 or AVX2 when
+    // the CPU supports them and a plain XOR when c is 1.
+    void GFMulXor(uint8_t c, const char *src, char *dst, size_t n);
+}
+
+#endif //LEVELDB_ERASURE_CODE_H
@@ -0,0 +1,145 @@
+//
+// Copyright (c) 2020 University of Southern California. All rights reserved.
+//
+
+#include <common/nova_common.h>
+#include "util/erasure_code.h"
+
+#include "util/random.h"
+#include "util/testharness.h"
+
+namespace leveldb {
+
+    class ErasureCodeTest {
+    public:
+        // Build k data fragments of different sizes and encode them.
+        void Build(uint32_t k, uint32_t m, size_t size) {
+            Random rnd(301);
+            coder_.reset(new ErasureCoder(k, m));
+            data_.assign(k, std::string());
+            sizes_.assign(k, 0);
+            for (uint32_t i = 0; i < k; i++) {
+                sizes_[i] = size - rnd.Uniform(size / 2 + 1);
+                for (size_t b = 0; b < sizes_[i]; b++) {
+                    data_[i].push_back(static_cast<char>(rnd.Next()));
+                }
+                // Readers see zeros past the end of a short fragment.
+                data_[i].resize(size, 0);
+            }
+            parity_.assign(m, std::string(size, 0));
+            std::vector<const char *> data(k);
+            std::vector<char *> parity(m);
+            for (uint32_t i = 0; i < k; i++) {
+                data[i] = data_[i].data();
+            }
+            for (uint32_t j = 0; j < m; j++) {
+                parity[j] = &parity_[j][0];
+            }
+            coder_->Encode(data.data(), sizes_.data(), size, parity.data());
+        }
+
+        // Reconstruct data fragment "index" with the fragments in "lost"
+        // unavailable, starting at "offset".
+        bool Recover(const std::vector<uint32_t> &lost, uint32_t index,
+                     size_t offset, size_t size, std::string *out) {
+            uint32_t k = coder_->k();
+            std::vector<const char *> fragments(k + coder_->m());
+            for (uint32_t f = 0; f < fragments.size(); f++) {
+                fragments[f] = f < k ? data_[f].data() + offset :
+                               parity_[f - k].data() + offset;
+            }
+            for (uint32_t f : lost) {
+                fragments[f] = nullptr;
+            }
+            out->assign(size, 0);
+            return coder_->Reconstruct(fragments.data(), size, index,
+                                       &(*out)[0]);
+        }
+
+        std::unique_ptr<ErasureCoder> coder_;
+        std::vector<std::string> data_;
+        std::vector<size_t> sizes_;
+        std::vector<std::string> parity_;
+    };
+
+    TEST(ErasureCodeTest, XorParity) {
+        Build(4, 1, 1000);
+        for (size_t b = 0; b < 1000; b++) {
+            char x = 0;
+            for (uint32_t i = 0; i < 4; i++) {
+                x ^= data_[i][b];
+            }
+            ASSERT_EQ(x, parity_[0][b]);
+        }
+        std::string out;
+        for (uint32_t i = 0; i < 4; i++) {
+            ASSERT_TRUE(Recover({i}, i, 0, 1000, &out));
+            ASSERT_EQ(data_[i], out);
+        }
+        ASSERT_TRUE(!Recover({0, 1}, 0, 0, 1000, &out));
+    }
+
+    TEST(ErasureCodeTest, AnyTwoLost) {
+        Build(6, 2, 4099);
+        std::string out;
+        for (uint32_t a = 0; a < 8; a++) {
+            for (uint32_t b = a + 1; b < 8; b++) {
+                for (uint32_t i = 0; i < 6; i++) {
+                    ASSERT_TRUE(Recover({a, b}, i, 0, 4099, &out));
+                    ASSERT_EQ(data_[i], out);
+                }
+            }
+        }
+        ASSERT_TRUE(!Recover({0, 1, 2}, 0, 0, 4099, &out));
+    }
+
+    TEST(ErasureCodeTest, PartialRange) {
+        Build(10, 4, 8192);
+        std::string out;
+        ASSERT_TRUE(Recover({3, 5, 10, 12}, 3, 1234, 777, &out));
+        ASSERT_EQ(data_[3].substr(1234, 777), out);
+        ASSERT_TRUE(Recover({0, 1, 2, 3}, 2, 7000, 1192, &out));
+        ASSERT_EQ(data_[2].substr(7000, 1192), out);
+    }
+
+    // Carry-less multiply modulo x^8 + x^4 + x^3 + x^2 + 1, bit by bit.
+    static uint8_t ReferenceGFMul(uint8_t a, uint8_t b) {
+        uint32_t x = a;
+        uint8_t product = 0;
+        while (b != 0) {
+            if (b & 1) {
+                product ^= x;
+            }
+            b >>= 1;
+            x <<= 1;
+            if (x & 0x100) {
+                x ^= 0x11d;
+            }
+        }
+        return product;
+    }
+
+    TEST(ErasureCodeTest, MulXorMatchesReference) {
+        Random rnd(17);
+        // Covers the 64 and 32 byte vector loops and the byte tail.
+        std::string src(333, 0);
+        std::string init(src.size(), 0);
+        for (size_t b = 0; b < src.size(); b++) {
+            src[b] = static_cast<char>(rnd.Next());
+            init[b] = static_cast<char>(rnd.Next());
+        }
+        for (uint32_t c = 0; c < 256; c++) {
+            std::string dst = init;
+            GFMulXor(c, src.data(), &dst[0], src.size());
+            for (size_t b = 0; b < src.size(); b++) {
+                uint8_t expected = static_cast<uint8_t>(init[b]) ^
+                                   ReferenceGFMul(c, static_cast<uint8_t>(src[b]));
+                ASSERT_EQ(expected, static_cast<uint8_t>(dst[b]));
+            }
+        }
+    }
+}  // namespace leveldb
+
+nova::NovaGlobalVariables nova::NovaGlobalVariables::global;
+
+int main(int argc, char **argv) { return leveldb::test::RunAllTests(); }
@@ -23,11 +23,6 @@ namespace leveldb {
 
         std::string ToString() const;
 
-    private:
-        enum {
-            kNumBuckets = 154
-        };
-
         double Median() const;
 
         double Percentile(double p) const;
@@ -36,6 +31,13 @@ namespace leveldb {
 
         double StandardDeviation() const;
 
+        double num() const { return num_; }
+
+    private:
+        enum {
+            kNumBuckets = 154
+        };
+
         static const double kBucketLimit[kNumBuckets];
 
         double min_;